@@ -503,7 +503,19 @@ calendar_window_new (time_t     *static_current_time,
 void
 calendar_window_refresh (CalendarWindow *calwin)
 {
+	struct tm tm1;
+
 	g_return_if_fail (CALENDAR_IS_WINDOW (calwin));
+
+	if (!calwin->priv->calendar)
+		return;
+
+	/* the window is kept around between uses: go back to today */
+	localtime_r (calwin->priv->current_time, &tm1);
+	ctk_calendar_select_month (CTK_CALENDAR (calwin->priv->calendar),
+				   tm1.tm_mon, tm1.tm_year + 1900);
+	ctk_calendar_select_day (CTK_CALENDAR (calwin->priv->calendar), tm1.tm_mday);
+	calendar_mark_today (CTK_CALENDAR (calwin->priv->calendar));
 }
 
 gboolean
@@ -524,7 +536,14 @@ calendar_window_set_invert_order (CalendarWindow *calwin,
 		return;
 
 	calwin->priv->invert_order = invert_order;
-	//FIXME: update the order of the content of the window
+
+	if (calwin->priv->calendar) {
+		CtkWidget *vbox;
+
+		vbox = ctk_widget_get_parent (calwin->priv->calendar);
+		ctk_box_reorder_child (CTK_BOX (vbox), calwin->priv->calendar,
+				       invert_order ? -1 : 0);
+	}
 
 	g_object_notify (G_OBJECT (calwin), "invert-order");
 }
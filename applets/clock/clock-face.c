@@ -19,8 +19,11 @@
 #include "clock-face.h"
 #include "clock-location.h"
 #include "clock-utils.h"
+#include "panel-memory.h"
 
 static GHashTable *pixbuf_cache = NULL;
+/* the faces hold the pixbufs, the cache only shares them */
+static gsize       pixbuf_cache_bytes = 0;
 
 static void     clock_face_finalize             (GObject *);
 static gboolean clock_face_draw                 (CtkWidget      *clock,
@@ -395,8 +398,11 @@ clock_face_finalize (GObject *obj)
 /* The pixbuf is being disposed, so remove it from the cache */
 static void
 remove_pixbuf_from_cache (const char *key,
-			  GObject    *pixbuf G_GNUC_UNUSED)
+			  GObject    *pixbuf)
 {
+    pixbuf_cache_bytes -= panel_memory_pixbuf_size (GDK_PIXBUF (pixbuf));
+    panel_memory_charge (NULL, "clock-faces", pixbuf_cache_bytes);
+
     g_hash_table_remove (pixbuf_cache, key);
 }
 
@@ -460,6 +466,9 @@ clock_face_load_face (ClockFace *this, gint width, gint height)
             g_object_weak_ref (G_OBJECT (priv->face_pixbuf),
                                (GWeakNotify) remove_pixbuf_from_cache,
                                cache_name);
+
+            pixbuf_cache_bytes += panel_memory_pixbuf_size (priv->face_pixbuf);
+            panel_memory_charge (NULL, "clock-faces", pixbuf_cache_bytes);
     } else
             g_free (cache_name);
 }
@@ -29,6 +29,7 @@ typedef struct {
         SystemTimezone *systz;
 
         gchar *timezone;
+        GTimeZone *gtz;
 
         gchar *tzname;
 
@@ -231,6 +232,11 @@ clock_location_finalize (GObject *g_obj)
                 priv->timezone = NULL;
         }
 
+        if (priv->gtz) {
+                g_time_zone_unref (priv->gtz);
+                priv->gtz = NULL;
+        }
+
         if (priv->tzname) {
                 g_free (priv->tzname);
                 priv->tzname = NULL;
@@ -325,6 +331,11 @@ clock_location_set_timezone (ClockLocation *loc, const gchar *timezone)
                 priv->timezone = NULL;
         }
 
+        if (priv->gtz) {
+                g_time_zone_unref (priv->gtz);
+                priv->gtz = NULL;
+        }
+
         priv->timezone = g_strdup (timezone);
 }
 
@@ -435,6 +446,40 @@ clock_location_localtime (ClockLocation *loc, struct tm *tm)
         clock_location_unset_tz (loc);
 }
 
+/* Unlike clock_location_localtime(), this does not go through TZ and
+ * tzset(), so it is cheap enough to call for every location. */
+glong
+clock_location_get_utc_offset (ClockLocation *loc, gint64 t)
+{
+        ClockLocationPrivate *priv = clock_location_get_instance_private (loc);
+        GTimeZone *tz;
+        gint interval;
+        glong offset;
+
+        if (priv->timezone == NULL) {
+                /* the system timezone can change, GLib keeps track of it */
+                tz = g_time_zone_new_local ();
+        } else {
+                if (priv->gtz == NULL) {
+#if GLIB_CHECK_VERSION (2, 68, 0)
+                        priv->gtz = g_time_zone_new_identifier (priv->timezone);
+                        if (priv->gtz == NULL)
+                                priv->gtz = g_time_zone_new_utc ();
+#else
+                        priv->gtz = g_time_zone_new (priv->timezone);
+#endif
+                }
+                tz = g_time_zone_ref (priv->gtz);
+        }
+
+        interval = g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL, t);
+        offset = g_time_zone_get_offset (tz, interval);
+
+        g_time_zone_unref (tz);
+
+        return offset;
+}
+
 gboolean
 clock_location_is_current_timezone (ClockLocation *loc)
 {
@@ -64,6 +64,7 @@ void clock_location_get_coords (ClockLocation *loc, gfloat *latitude, gfloat *lo
 void clock_location_set_coords (ClockLocation *loc, gfloat latitude, gfloat longitude);
 
 void clock_location_localtime (ClockLocation *loc, struct tm *tm);
+glong clock_location_get_utc_offset (ClockLocation *loc, gint64 t);
 
 gboolean clock_location_is_current (ClockLocation *loc);
 void clock_location_make_current (ClockLocation *loc,
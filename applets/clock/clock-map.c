@@ -11,6 +11,7 @@
 #include "clock-map.h"
 #include "clock-sunpos.h"
 #include "clock-marshallers.h"
+#include "panel-memory.h"
 
 enum {
 	NEED_LOCATIONS,
@@ -32,6 +33,9 @@ static char *marker_files[MARKER_NB] = {
 
 static guint signals[LAST_SIGNAL] = { 0 };
 
+/* for the shrinker */
+static GSList *clock_maps = NULL;
+
 typedef struct {
         time_t last_refresh;
 
@@ -45,9 +49,6 @@ typedef struct {
 
         GdkPixbuf *location_map_pixbuf;
 
-        /* The shadow itself */
-        GdkPixbuf *shadow_pixbuf;
-
         /* The map with the shadow composited onto it */
         GdkPixbuf *shadow_map_pixbuf;
 } ClockMapPrivate;
@@ -55,6 +56,7 @@ typedef struct {
 G_DEFINE_TYPE_WITH_PRIVATE (ClockMap, clock_map, CTK_TYPE_WIDGET)
 
 static void clock_map_finalize (GObject *);
+static void clock_map_map (CtkWidget *this);
 static void clock_map_size_allocate (CtkWidget *this,
 					 CtkAllocation *allocation);
 static gboolean clock_map_draw (CtkWidget *this,
@@ -69,6 +71,45 @@ static void clock_map_place_locations (ClockMap *this);
 static void clock_map_render_shadow (ClockMap *this);
 static void clock_map_display (ClockMap *this);
 
+static void
+clock_map_charge (ClockMap *this)
+{
+        ClockMapPrivate *priv = clock_map_get_instance_private (this);
+        gsize bytes;
+        int i;
+
+        bytes = panel_memory_pixbuf_size (priv->stock_map_pixbuf) +
+                panel_memory_pixbuf_size (priv->location_map_pixbuf) +
+                panel_memory_pixbuf_size (priv->shadow_map_pixbuf);
+        for (i = 0; i < MARKER_NB; i++)
+                bytes += panel_memory_pixbuf_size (priv->location_marker_pixbuf[i]);
+
+        panel_memory_charge (this, "clock-map", bytes);
+}
+
+/* Drops the maps that are not shown; they are rebuilt when they are
+ * shown again. */
+static void
+clock_map_shrink (void)
+{
+        GSList *l;
+
+        for (l = clock_maps; l; l = l->next) {
+                ClockMap *this = l->data;
+                ClockMapPrivate *priv = clock_map_get_instance_private (this);
+
+                if (ctk_widget_get_mapped (CTK_WIDGET (this)) ||
+                    priv->highlight_timeout_id)
+                        continue;
+
+                g_clear_object (&priv->stock_map_pixbuf);
+                g_clear_object (&priv->location_map_pixbuf);
+                g_clear_object (&priv->shadow_map_pixbuf);
+
+                clock_map_charge (this);
+        }
+}
+
 ClockMap *
 clock_map_new (void)
 {
@@ -89,6 +130,7 @@ clock_map_class_init (ClockMapClass *this_class)
 
         /* CtkWidget signals */
 
+        widget_class->map = clock_map_map;
         widget_class->size_allocate = clock_map_size_allocate;
         widget_class->draw = clock_map_draw;
 	widget_class->get_preferred_width = clock_map_get_preferred_width;
@@ -117,11 +159,18 @@ clock_map_class_init (ClockMapClass *this_class)
 static void
 clock_map_init (ClockMap *this)
 {
+        static gboolean shrinker_added = FALSE;
         int i;
         ClockMapPrivate *priv = clock_map_get_instance_private (this);
 
         ctk_widget_set_has_window (CTK_WIDGET (this), FALSE);
 
+        if (!shrinker_added) {
+                panel_memory_add_shrinker (clock_map_shrink);
+                shrinker_added = TRUE;
+        }
+        clock_maps = g_slist_prepend (clock_maps, this);
+
 	priv->last_refresh = 0;
 	priv->width = 0;
 	priv->height = 0;
@@ -137,6 +186,8 @@ clock_map_init (ClockMap *this)
                 priv->location_marker_pixbuf[i] = gdk_pixbuf_new_from_resource (resource, NULL);
                 g_free (resource);
         }
+
+        clock_map_charge (this);
 }
 
 static void
@@ -167,16 +218,14 @@ clock_map_finalize (GObject *g_obj)
                 priv->location_map_pixbuf = NULL;
         }
 
-        if (priv->shadow_pixbuf) {
-                g_object_unref (priv->shadow_pixbuf);
-                priv->shadow_pixbuf = NULL;
-        }
-
         if (priv->shadow_map_pixbuf) {
                 g_object_unref (priv->shadow_map_pixbuf);
                 priv->shadow_map_pixbuf = NULL;
         }
 
+        clock_maps = g_slist_remove (clock_maps, g_obj);
+        panel_memory_charge (g_obj, "clock-map", 0);
+
         G_OBJECT_CLASS (clock_map_parent_class)->finalize (g_obj);
 }
 
@@ -218,6 +267,18 @@ clock_map_refresh (ClockMap *this)
         clock_map_display (this);
 }
 
+static void
+clock_map_map (CtkWidget *this)
+{
+        ClockMapPrivate *priv = clock_map_get_instance_private (CLOCK_MAP (this));
+
+        CTK_WIDGET_CLASS (clock_map_parent_class)->map (this);
+
+        /* the shrinker may have dropped the map while it was hidden */
+        if (!priv->shadow_map_pixbuf)
+                clock_map_refresh (CLOCK_MAP (this));
+}
+
 static gboolean
 clock_map_draw (CtkWidget *this, cairo_t *cr)
 {
@@ -556,18 +617,16 @@ static void
 clock_map_render_shadow (ClockMap *this)
 {
         ClockMapPrivate *priv = clock_map_get_instance_private (this);
+        GdkPixbuf *shadow_pixbuf;
 
-        if (priv->shadow_pixbuf) {
-                g_object_unref (priv->shadow_pixbuf);
-        }
-
-        priv->shadow_pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
-                                              priv->width, priv->height);
+        /* The shadow itself, only needed until it is composited */
+        shadow_pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                                        priv->width, priv->height);
 
         /* Initialize to all shadow */
-        gdk_pixbuf_fill (priv->shadow_pixbuf, 0x6d9ccdff);
+        gdk_pixbuf_fill (shadow_pixbuf, 0x6d9ccdff);
 
-        clock_map_render_shadow_pixbuf (priv->shadow_pixbuf);
+        clock_map_render_shadow_pixbuf (shadow_pixbuf);
 
         if (priv->shadow_map_pixbuf) {
                 g_object_unref (priv->shadow_map_pixbuf);
@@ -575,9 +634,13 @@ clock_map_render_shadow (ClockMap *this)
 
         priv->shadow_map_pixbuf = gdk_pixbuf_copy (priv->location_map_pixbuf);
 
-        gdk_pixbuf_composite (priv->shadow_pixbuf, priv->shadow_map_pixbuf,
+        gdk_pixbuf_composite (shadow_pixbuf, priv->shadow_map_pixbuf,
                               0, 0, priv->width, priv->height,
                               0, 0, 1, 1, GDK_INTERP_NEAREST, 0x66);
+
+        g_object_unref (shadow_pixbuf);
+
+        clock_map_charge (this);
 }
 
 static void
@@ -585,7 +648,9 @@ clock_map_display (ClockMap *this)
 {
         ClockMapPrivate *priv = clock_map_get_instance_private (this);
 
-        if (priv->width > 0 || priv->height > 0)
+        /* nothing to render once shrunk, until the next refresh */
+        if ((priv->width > 0 || priv->height > 0) &&
+            priv->location_map_pixbuf)
                 clock_map_render_shadow (this);
                 
         /* Ensure that the width-to-height ratio remains constant when resizing the image clock-map.png 2:1 */
@@ -66,6 +66,7 @@
 #include "clock-location-tile.h"
 #include "clock-map.h"
 #include "clock-utils.h"
+#include "panel-memory.h"
 #include "set-timezone.h"
 #include "system-timezone.h"
 
@@ -112,6 +113,7 @@ struct _ClockData {
 
         CtkWidget *props;
         CtkWidget *calendar_popup;
+        guint      build_popup_id;
 
         CtkWidget *clock_vbox;
         CtkSizeGroup *clock_group;
@@ -528,7 +530,8 @@ set_atk_name_description (CtkWidget  *widget,
 }
 
 static void
-update_location_tiles (ClockData *cd)
+update_location_tiles (ClockData *cd,
+                       gboolean   force_refresh)
 {
         GList *l;
 
@@ -536,7 +539,7 @@ update_location_tiles (ClockData *cd)
                 ClockLocationTile *tile;
 
                 tile = CLOCK_LOCATION_TILE (l->data);
-                clock_location_tile_refresh (tile, FALSE);
+                clock_location_tile_refresh (tile, force_refresh);
         }
 }
 
@@ -629,10 +632,13 @@ update_clock (ClockData * cd)
         ctk_widget_queue_resize (cd->panel_button);
 
         update_tooltip (cd);
-        update_location_tiles (cd);
 
-        if (cd->map_widget && cd->calendar_popup && ctk_widget_get_visible (cd->calendar_popup))
-                clock_map_update_time (CLOCK_MAP (cd->map_widget));
+        /* the tiles and the map catch up when the popup is shown */
+        if (cd->calendar_popup && ctk_widget_get_visible (cd->calendar_popup)) {
+                update_location_tiles (cd, FALSE);
+                if (cd->map_widget)
+                        clock_map_update_time (CLOCK_MAP (cd->map_widget));
+        }
 
         if (cd->current_time_label &&
             ctk_widget_get_visible (cd->current_time_label)) {
@@ -688,7 +694,7 @@ update_tooltip (ClockData * cd)
 
                 g_free (utf8);
         } else {
-                if (cd->calendar_popup)
+                if (cd->calendar_popup && ctk_widget_get_visible (cd->calendar_popup))
                         tip = _("Click to hide month calendar");
                 else
                         tip = _("Click to view month calendar");
@@ -775,6 +781,10 @@ destroy_clock (CtkWidget *widget G_GNUC_UNUSED,
                 ctk_widget_destroy (cd->props);
         cd->props = NULL;
 
+        if (cd->build_popup_id)
+                g_source_remove (cd->build_popup_id);
+        cd->build_popup_id = 0;
+
         if (cd->calendar_popup)
                 ctk_widget_destroy (cd->calendar_popup);
         cd->calendar_popup = NULL;
@@ -1064,50 +1074,49 @@ create_cities_store (ClockData *cd)
         }
 }
 
+typedef struct {
+        ClockLocation *location;
+        gint64         wall_time;
+} LocationSortKey;
+
 static gint
 sort_locations_by_time (gconstpointer a, gconstpointer b)
 {
-        ClockLocation *loc_a = (ClockLocation *) a;
-        ClockLocation *loc_b = (ClockLocation *) b;
+        const LocationSortKey *key_a = a;
+        const LocationSortKey *key_b = b;
 
-        struct tm tm_a;
-        struct tm tm_b;
-        gint ret;
+        if (key_a->wall_time == key_b->wall_time)
+                return 0;
 
-        clock_location_localtime (loc_a, &tm_a);
-        clock_location_localtime (loc_b, &tm_b);
+        return (key_a->wall_time < key_b->wall_time) ? -1 : 1;
+}
 
-        ret = (tm_a.tm_year == tm_b.tm_year) ? 0 : 1;
-        if (ret) {
-                return (tm_a.tm_year < tm_b.tm_year) ? -1 : 1;
-        }
+/* Returns the locations sorted by their local time, earliest first.
+ * The key of each location is computed once, the comparisons used to
+ * call localtime(), and tzset() twice, for both sides. */
+static GArray *
+sort_locations (GList *locations)
+{
+        GArray *keys;
+        GList *l;
+        gint64 now;
 
-        ret = (tm_a.tm_mon == tm_b.tm_mon) ? 0 : 1;
-        if (ret) {
-                return (tm_a.tm_mon < tm_b.tm_mon) ? -1 : 1;
-        }
+        now = time (NULL);
 
-        ret = (tm_a.tm_mday == tm_b.tm_mday) ? 0 : 1;
-        if (ret) {
-                return (tm_a.tm_mday < tm_b.tm_mday) ? -1 : 1;
-        }
+        keys = g_array_sized_new (FALSE, FALSE, sizeof (LocationSortKey),
+                                  g_list_length (locations));
+        for (l = locations; l; l = l->next) {
+                LocationSortKey key;
 
-        ret = (tm_a.tm_hour == tm_b.tm_hour) ? 0 : 1;
-        if (ret) {
-                return (tm_a.tm_hour < tm_b.tm_hour) ? -1 : 1;
-        }
+                key.location = l->data;
+                key.wall_time = now + clock_location_get_utc_offset (key.location, now);
 
-        ret = (tm_a.tm_min == tm_b.tm_min) ? 0 : 1;
-        if (ret) {
-                return (tm_a.tm_min < tm_b.tm_min) ? -1 : 1;
+                g_array_append_val (keys, key);
         }
 
-        ret = (tm_a.tm_sec == tm_b.tm_sec) ? 0 : 1;
-        if (ret) {
-                return (tm_a.tm_sec < tm_b.tm_sec) ? -1 : 1;
-        }
+        g_array_sort (keys, sort_locations_by_time);
 
-        return ret;
+        return keys;
 }
 
 static void
@@ -1132,63 +1141,94 @@ location_tile_need_clock_format_cb (ClockLocationTile *tile G_GNUC_UNUSED,
         return cd->format;
 }
 
+static ClockLocationTile *
+create_location_tile (ClockData *cd, ClockLocation *loc)
+{
+        ClockLocationTile *city;
+
+        city = clock_location_tile_new (loc, CLOCK_FACE_SMALL);
+        g_signal_connect (city, "tile-pressed",
+                          G_CALLBACK (location_tile_pressed_cb), cd);
+        g_signal_connect (city, "need-clock-format",
+                          G_CALLBACK (location_tile_need_clock_format_cb), cd);
+
+        ctk_box_pack_start (CTK_BOX (cd->cities_section),
+                            CTK_WIDGET (city),
+                            FALSE, FALSE, 0);
+
+        clock_location_tile_refresh (city, TRUE);
+        ctk_widget_show_all (CTK_WIDGET (city));
+
+        return city;
+}
+
 static void
 create_cities_section (ClockData *cd)
 {
-        GList *node;
         ClockLocationTile *city;
-        GList *cities;
+        GHashTable *old_tiles;
+        GHashTableIter iter;
+        GArray *sorted;
         GList *l;
+        guint i;
+        gint position;
 
-        if (cd->cities_section) {
-                ctk_widget_destroy (cd->cities_section);
-                cd->cities_section = NULL;
-        }
+        if (!cd->cities_section) {
+                cd->cities_section = ctk_box_new (CTK_ORIENTATION_VERTICAL, 6);
+                ctk_container_set_border_width (CTK_CONTAINER (cd->cities_section), 0);
 
-        if (cd->location_tiles)
-                g_list_free (cd->location_tiles);
-        cd->location_tiles = NULL;
+                ctk_box_pack_end (CTK_BOX (cd->clock_vbox),
+                                  cd->cities_section, FALSE, FALSE, 0);
+        }
 
-        cd->cities_section = ctk_box_new (CTK_ORIENTATION_VERTICAL, 6);
-        ctk_container_set_border_width (CTK_CONTAINER (cd->cities_section), 0);
+        /* the locations that did not change are the same objects, keep
+         * their tiles and only move them where they belong now */
+        old_tiles = g_hash_table_new (NULL, NULL);
+        for (l = cd->location_tiles; l; l = l->next) {
+                ClockLocation *loc;
 
-        cities = cd->locations;
-        if (g_list_length (cities) == 0) {
-                /* if the list is empty, don't bother showing the
-                   cities section */
-                ctk_widget_hide (cd->cities_section);
-                return;
+                city = l->data;
+                loc = clock_location_tile_get_location (city);
+                /* the same location can be listed twice */
+                if (g_hash_table_contains (old_tiles, loc))
+                        ctk_widget_destroy (CTK_WIDGET (city));
+                else
+                        g_hash_table_insert (old_tiles, loc, city);
+                g_object_unref (loc);
         }
 
-        /* Copy the existing list, so we can sort it nondestructively */
-        node = g_list_copy (cities);
-        node = g_list_sort (node, sort_locations_by_time);
-        node = g_list_reverse (node);
+        g_list_free (cd->location_tiles);
+        cd->location_tiles = NULL;
 
-        for (l = node; l; l = g_list_next (l)) {
-                ClockLocation *loc = l->data;
+        /* latest local time first */
+        sorted = sort_locations (cd->locations);
+        position = 0;
+        for (i = sorted->len; i > 0; i--) {
+                ClockLocation *loc;
 
-                city = clock_location_tile_new (loc, CLOCK_FACE_SMALL);
-                g_signal_connect (city, "tile-pressed",
-                                  G_CALLBACK (location_tile_pressed_cb), cd);
-                g_signal_connect (city, "need-clock-format",
-                                  G_CALLBACK (location_tile_need_clock_format_cb), cd);
+                loc = g_array_index (sorted, LocationSortKey, i - 1).location;
 
-                ctk_box_pack_start (CTK_BOX (cd->cities_section),
-                                    CTK_WIDGET (city),
-                                    FALSE, FALSE, 0);
+                city = g_hash_table_lookup (old_tiles, loc);
+                if (city)
+                        g_hash_table_remove (old_tiles, loc);
+                else
+                        city = create_location_tile (cd, loc);
 
-                cd->location_tiles = g_list_prepend (cd->location_tiles, city);
+                ctk_box_reorder_child (CTK_BOX (cd->cities_section),
+                                       CTK_WIDGET (city), position++);
 
-                clock_location_tile_refresh (city, TRUE);
+                cd->location_tiles = g_list_prepend (cd->location_tiles, city);
         }
+        g_array_free (sorted, TRUE);
 
-        g_list_free (node);
+        g_hash_table_iter_init (&iter, old_tiles);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &city))
+                ctk_widget_destroy (CTK_WIDGET (city));
+        g_hash_table_destroy (old_tiles);
 
-        ctk_box_pack_end (CTK_BOX (cd->clock_vbox),
-                          cd->cities_section, FALSE, FALSE, 0);
-
-        ctk_widget_show_all (cd->cities_section);
+        /* if the list is empty, don't bother showing the cities
+         * section */
+        ctk_widget_set_visible (cd->cities_section, cd->locations != NULL);
 }
 
 static GList *
@@ -1225,42 +1265,60 @@ create_map_section (ClockData *cd)
         ctk_widget_show (cd->map_widget);
 }
 
+static void
+build_calendar_popup (ClockData *cd)
+{
+        cd->calendar_popup = create_calendar (cd);
+        g_object_add_weak_pointer (G_OBJECT (cd->calendar_popup),
+                                   (gpointer *) &cd->calendar_popup);
+
+        create_clock_window (cd);
+        create_cities_store (cd);
+        create_cities_section (cd);
+        create_map_section (cd);
+}
+
+/* The popup is built once, while nobody is waiting for it, and only
+ * hidden when it is closed. */
+static gboolean
+build_calendar_popup_idle (gpointer data)
+{
+        ClockData *cd = data;
+
+        cd->build_popup_id = 0;
+
+        if (!cd->calendar_popup)
+                build_calendar_popup (cd);
+
+        return FALSE;
+}
+
 static void
 update_calendar_popup (ClockData *cd)
 {
         if (!ctk_toggle_button_get_active (CTK_TOGGLE_BUTTON (cd->panel_button))) {
-                if (cd->calendar_popup) {
-                        ctk_widget_destroy (cd->calendar_popup);
-                        cd->calendar_popup = NULL;
-                        cd->cities_section = NULL;
-                        cd->map_widget = NULL;
-                        cd->clock_vbox = NULL;
-
-                        if (cd->location_tiles)
-                                g_list_free (cd->location_tiles);
-                        cd->location_tiles = NULL;
-                }
+                if (cd->calendar_popup)
+                        ctk_widget_hide (cd->calendar_popup);
                 update_tooltip (cd);
                 return;
         }
 
-        if (!cd->calendar_popup) {
-                cd->calendar_popup = create_calendar (cd);
-                g_object_add_weak_pointer (G_OBJECT (cd->calendar_popup),
-                                           (gpointer *) &cd->calendar_popup);
-                update_tooltip (cd);
+        if (!cd->calendar_popup)
+                build_calendar_popup (cd);
 
-                create_clock_window (cd);
-                create_cities_store (cd);
-                create_cities_section (cd);
-                create_map_section (cd);
-        }
-
-        if (cd->calendar_popup && ctk_widget_get_realized (cd->panel_button)) {
+        if (ctk_widget_get_realized (cd->panel_button)) {
                 calendar_window_refresh (CALENDAR_WINDOW (cd->calendar_popup));
+                /* the tiles are not updated while the popup is hidden:
+                 * their order and their times may both be stale */
+                create_cities_section (cd);
+                update_location_tiles (cd, TRUE);
+                if (cd->map_widget)
+                        clock_map_update_time (CLOCK_MAP (cd->map_widget));
                 position_calendar_popup (cd);
                 ctk_window_present (CTK_WINDOW (cd->calendar_popup));
         }
+
+        update_tooltip (cd);
 }
 
 static void
@@ -1531,6 +1589,10 @@ applet_change_orient (CafePanelApplet       *applet G_GNUC_UNUSED,
         ctk_orientable_set_orientation (CTK_ORIENTABLE (cd->main_obox), o);
         ctk_orientable_set_orientation (CTK_ORIENTABLE (cd->weather_obox), o);
 
+        if (cd->calendar_popup)
+                calendar_window_set_invert_order (CALENDAR_WINDOW (cd->calendar_popup),
+                                                  cd->orient == CAFE_PANEL_APPLET_ORIENT_UP);
+
         unfix_size (cd);
         update_clock (cd);
         update_calendar_popup (cd);
@@ -1935,7 +1997,8 @@ format_changed (GSettings    *settings,
         clock->format = new_format;
         refresh_clock_timeout (clock);
 
-        if (clock->calendar_popup != NULL) {
+        if (clock->calendar_popup != NULL &&
+            ctk_widget_get_visible (clock->calendar_popup)) {
                 position_calendar_popup (clock);
         }
 
@@ -2135,7 +2198,7 @@ location_set_current_cb (ClockLocation *loc,
 
         if (cd->map_widget)
                 clock_map_refresh (CLOCK_MAP (cd->map_widget));
-        update_location_tiles (cd);
+        update_location_tiles (cd, FALSE);
         save_cities_store (cd);
 }
 
@@ -2412,7 +2475,8 @@ show_week_changed (GSettings    *settings,
 
         if (clock->calendar_popup != NULL) {
                 calendar_window_set_show_weeks (CALENDAR_WINDOW (clock->calendar_popup), clock->showweek);
-                position_calendar_popup (clock);
+                if (ctk_widget_get_visible (clock->calendar_popup))
+                        position_calendar_popup (clock);
         }
 }
 
@@ -2584,6 +2648,10 @@ fill_clock_applet (CafePanelApplet *applet)
                           G_CALLBACK (weather_icon_updated_cb),
                           cd);
 
+        cd->build_popup_id = g_idle_add_full (G_PRIORITY_LOW,
+                                              build_calendar_popup_idle,
+                                              cd, NULL);
+
         return TRUE;
 }
 
@@ -3475,6 +3543,8 @@ clock_factory (CafePanelApplet *applet,
 {
         gboolean retval = FALSE;
 
+        panel_memory_follow_budget_setting ();
+
         if (!strcmp (iid, "ClockApplet"))
                 retval = fill_clock_applet (applet);
 
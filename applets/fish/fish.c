@@ -61,6 +61,21 @@
 #define LOCKDOWN_SCHEMA                       "org.cafe.lockdown"
 #define LOCKDOWN_DISABLE_COMMAND_LINE_KEY     "disable-command-line"
 
+#define SCREENSAVER_PATH      "/org/cafe/ScreenSaver"
+#define SCREENSAVER_INTERFACE "org.cafe.ScreenSaver"
+
+/* Number of rendered animation strips kept around, enough for the
+ * sizes and rotations of a panel flipping between orientations */
+#define FISH_ATLAS_SIZE 4
+
+typedef struct {
+	cairo_surface_t   *surface;
+	int                width;
+	int                height;
+	int                angle;
+	gboolean           april_fools;
+} FishAtlas;
+
 typedef struct {
 	CafePanelApplet        applet;
 
@@ -83,11 +98,20 @@ typedef struct {
 	cairo_surface_t   *surface;
 	gint               surface_width;
 	gint               surface_height;
+	FishAtlas          atlas [FISH_ATLAS_SIZE];
+	int                atlas_next;
 
 	guint              timeout;
 	int                current_frame;
 	gboolean           in_applet;
 
+	CtkWidget         *toplevel;
+	gboolean           obscured;
+	gboolean           offscreen;
+	gboolean           screen_locked;
+	GDBusConnection   *session_bus;
+	guint              screensaver_signal;
+
 	GdkPixbuf         *pixbuf;
 
 	CtkWidget         *preferences_dialog;
@@ -1232,6 +1256,142 @@ static void setup_timeout(FishApplet *fish)
 				       fish);
 }
 
+/* Only wake up for the animation when somebody can actually see it:
+ * not when the applet is unmapped, slid off-screen by an autohidden
+ * panel, covered by other windows or behind the screen lock.
+ */
+static void fish_update_animation(FishApplet *fish)
+{
+	gboolean animate;
+
+	animate = ctk_widget_get_mapped (fish->drawing_area) &&
+		  !fish->obscured &&
+		  !fish->offscreen &&
+		  !fish->screen_locked;
+
+	if (animate && !fish->timeout) {
+		setup_timeout (fish);
+	} else if (!animate && fish->timeout) {
+		g_source_remove (fish->timeout);
+		fish->timeout = 0;
+	}
+}
+
+/* Out of process the toplevel is a CtkPlug whose configure events are
+ * relative to the panel's socket, so they never move when the panel
+ * slides away.  Ask the X server where the fish really is instead.
+ */
+static void fish_update_offscreen(FishApplet *fish)
+{
+	CdkWindow    *window;
+	CdkMonitor   *monitor;
+	CdkRectangle  rect;
+	CdkRectangle  monitor_geometry;
+	int           root_x, root_y;
+	int           x, y;
+
+	fish->offscreen = FALSE;
+
+	if (!fish->toplevel || !ctk_widget_get_realized (fish->toplevel))
+		return;
+
+	if (!ctk_widget_translate_coordinates (fish->drawing_area, fish->toplevel,
+					       0, 0, &x, &y))
+		return;
+
+	window = ctk_widget_get_window (fish->toplevel);
+	cdk_window_get_origin (window, &root_x, &root_y);
+
+	rect.x      = root_x + x;
+	rect.y      = root_y + y;
+	rect.width  = ctk_widget_get_allocated_width (fish->drawing_area);
+	rect.height = ctk_widget_get_allocated_height (fish->drawing_area);
+
+	monitor = cdk_display_get_monitor_at_point (cdk_window_get_display (window),
+						    rect.x + rect.width / 2,
+						    rect.y + rect.height / 2);
+	cdk_monitor_get_geometry (monitor, &monitor_geometry);
+
+	fish->offscreen = !cdk_rectangle_intersect (&rect, &monitor_geometry, NULL);
+}
+
+/* An autohidden panel sliding in or out changes the visibility of the
+ * plug even though the plug itself is not moved, so re-check the root
+ * position here as well as on configure.
+ */
+static gboolean fish_toplevel_visibility_notify(CtkWidget          *widget G_GNUC_UNUSED,
+						CdkEventVisibility *event,
+						FishApplet         *fish)
+{
+	fish->obscured = (event->state == CDK_VISIBILITY_FULLY_OBSCURED);
+	fish_update_offscreen (fish);
+	fish_update_animation (fish);
+
+	return FALSE;
+}
+
+static gboolean fish_toplevel_configure(CtkWidget         *widget G_GNUC_UNUSED,
+					CdkEventConfigure *event G_GNUC_UNUSED,
+					FishApplet        *fish)
+{
+	fish_update_offscreen (fish);
+	fish_update_animation (fish);
+
+	return FALSE;
+}
+
+static void fish_hierarchy_changed(CtkWidget  *widget,
+				   CtkWidget  *previous_toplevel G_GNUC_UNUSED,
+				   FishApplet *fish)
+{
+	CtkWidget *toplevel;
+
+	toplevel = ctk_widget_get_toplevel (widget);
+	if (!ctk_widget_is_toplevel (toplevel))
+		toplevel = NULL;
+
+	if (toplevel == fish->toplevel)
+		return;
+
+	if (fish->toplevel)
+		g_signal_handlers_disconnect_by_data (fish->toplevel, fish);
+
+	fish->toplevel = toplevel;
+	fish->obscured = FALSE;
+	fish->offscreen = FALSE;
+
+	if (toplevel) {
+		ctk_widget_add_events (toplevel, CDK_VISIBILITY_NOTIFY_MASK |
+						 CDK_STRUCTURE_MASK);
+		g_signal_connect (toplevel, "visibility-notify-event",
+				  G_CALLBACK (fish_toplevel_visibility_notify), fish);
+		g_signal_connect (toplevel, "configure-event",
+				  G_CALLBACK (fish_toplevel_configure), fish);
+	}
+
+	fish_update_animation (fish);
+}
+
+static void screensaver_active_changed(GDBusConnection *connection G_GNUC_UNUSED,
+				       const gchar     *sender_name G_GNUC_UNUSED,
+				       const gchar     *object_path G_GNUC_UNUSED,
+				       const gchar     *interface_name G_GNUC_UNUSED,
+				       const gchar     *signal_name G_GNUC_UNUSED,
+				       GVariant        *parameters,
+				       gpointer         user_data)
+{
+	FishApplet *fish = (FishApplet *) user_data;
+	gboolean    active;
+
+	if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(b)")))
+		return;
+
+	g_variant_get (parameters, "(b)", &active);
+
+	fish->screen_locked = active;
+	fish_update_animation (fish);
+}
+
 static void speed_changed_notify(GSettings* settings, gchar* key, FishApplet* fish)
 {
 	gdouble value;
@@ -1242,7 +1402,8 @@ static void speed_changed_notify(GSettings* settings, gchar* key, FishApplet* fi
 		return;
 	fish->speed = value;
 
-	setup_timeout (fish);
+	if (fish->timeout)
+		setup_timeout (fish);
 
 	if (fish->speed_spin &&
 	    ctk_spin_button_get_value (CTK_SPIN_BUTTON (fish->frames_spin)) != fish->speed)
@@ -1318,6 +1479,63 @@ static void setup_gsettings(FishApplet* fish)
 					  fish);
 }
 
+static void fish_atlas_clear(FishApplet* fish)
+{
+	int i;
+
+	for (i = 0; i < FISH_ATLAS_SIZE; i++) {
+		if (fish->atlas [i].surface)
+			cairo_surface_destroy (fish->atlas [i].surface);
+		fish->atlas [i].surface = NULL;
+	}
+	fish->atlas_next = 0;
+
+	fish->surface = NULL;
+	fish->surface_width = 0;
+	fish->surface_height = 0;
+}
+
+static cairo_surface_t* fish_atlas_lookup(FishApplet* fish,
+					  int         width,
+					  int         height,
+					  int         angle)
+{
+	int i;
+
+	for (i = 0; i < FISH_ATLAS_SIZE; i++) {
+		FishAtlas *atlas = &fish->atlas [i];
+
+		if (atlas->surface &&
+		    atlas->width == width &&
+		    atlas->height == height &&
+		    atlas->angle == angle &&
+		    atlas->april_fools == fish->april_fools)
+			return atlas->surface;
+	}
+
+	return NULL;
+}
+
+static void fish_atlas_insert(FishApplet*      fish,
+			      int              width,
+			      int              height,
+			      int              angle,
+			      cairo_surface_t *surface)
+{
+	FishAtlas *atlas = &fish->atlas [fish->atlas_next];
+
+	if (atlas->surface)
+		cairo_surface_destroy (atlas->surface);
+
+	atlas->surface = surface;
+	atlas->width = width;
+	atlas->height = height;
+	atlas->angle = angle;
+	atlas->april_fools = fish->april_fools;
+
+	fish->atlas_next = (fish->atlas_next + 1) % FISH_ATLAS_SIZE;
+}
+
 static gboolean load_fish_image(FishApplet* fish)
 {
 	GdkPixbuf *pixbuf;
@@ -1341,6 +1559,9 @@ static gboolean load_fish_image(FishApplet* fish)
 		g_object_unref (fish->pixbuf);
 	fish->pixbuf = pixbuf;
 
+	/* the strips rendered from the previous image are useless now */
+	fish_atlas_clear (fish);
+
 	if (fish->preview_image)
 		ctk_image_set_from_pixbuf (CTK_IMAGE (fish->preview_image),
 					   fish->pixbuf);
@@ -1367,6 +1588,8 @@ static void update_pixmap(FishApplet* fish)
 	int            pixbuf_width = -1;
 	int            pixbuf_height = -1;
 	gboolean       rotate = FALSE;
+	int            angle = 0;
+	cairo_surface_t *surface;
 	cairo_t       *cr;
 	cairo_matrix_t matrix;
 	cairo_pattern_t *pattern;
@@ -1383,8 +1606,10 @@ static void update_pixmap(FishApplet* fish)
 
 	if (fish->rotate &&
 	    (fish->orientation == CAFE_PANEL_APPLET_ORIENT_LEFT ||
-	     fish->orientation == CAFE_PANEL_APPLET_ORIENT_RIGHT))
+	     fish->orientation == CAFE_PANEL_APPLET_ORIENT_RIGHT)) {
 		rotate = TRUE;
+		angle = fish->orientation == CAFE_PANEL_APPLET_ORIENT_RIGHT ? 90 : 270;
+	}
 
 	pixbuf_width  = gdk_pixbuf_get_width  (fish->pixbuf);
 	pixbuf_height = gdk_pixbuf_get_height (fish->pixbuf);
@@ -1423,19 +1648,26 @@ static void update_pixmap(FishApplet* fish)
 	if (width == 0 || height == 0)
 		return;
 
-	if (fish->surface)
-		cairo_surface_destroy (fish->surface);
-	fish->surface = cdk_window_create_similar_surface (ctk_widget_get_window (widget),
-													   CAIRO_CONTENT_COLOR_ALPHA,
-													   width, height);
+	ctk_widget_queue_resize (widget);
+
 	fish->surface_width = width;
 	fish->surface_height = height;
 
-	ctk_widget_queue_resize (widget);
+	/* the high quality scaling below is expensive, so each strip is only
+	 * rendered once and reused when the panel flips back to it */
+	fish->surface = fish_atlas_lookup (fish, width, height, angle);
+	if (fish->surface)
+		return;
+
+	surface = cdk_window_create_similar_surface (ctk_widget_get_window (widget),
+						     CAIRO_CONTENT_COLOR_ALPHA,
+						     width, height);
+	fish_atlas_insert (fish, width, height, angle, surface);
+	fish->surface = surface;
 
 	g_assert (pixbuf_width != -1 && pixbuf_height != -1);
 
-	cr = cairo_create (fish->surface);
+	cr = cairo_create (surface);
 
 	cairo_set_source_rgb (cr, 1, 1, 1);
 	cairo_paint (cr);
@@ -1538,11 +1770,7 @@ static void fish_applet_realize (CtkWidget  *widget G_GNUC_UNUSED,
 static void fish_applet_unrealize (CtkWidget  *widget G_GNUC_UNUSED,
 				   FishApplet *fish)
 {
-	if (fish->surface)
-		cairo_surface_destroy (fish->surface);
-	fish->surface = NULL;
-	fish->surface_width = 0;
-	fish->surface_height = 0;
+	fish_atlas_clear (fish);
 }
 
 static void fish_applet_change_orient(CafePanelApplet* applet, CafePanelAppletOrient orientation)
@@ -1678,6 +1906,12 @@ static void setup_fish_widget(FishApplet* fish)
 			  G_CALLBACK (fish_applet_size_allocate), fish);
 	g_signal_connect (fish->drawing_area, "draw",
 			  G_CALLBACK (fish_applet_draw), fish);
+	g_signal_connect_swapped (fish->drawing_area, "map",
+				  G_CALLBACK (fish_update_animation), fish);
+	g_signal_connect_swapped (fish->drawing_area, "unmap",
+				  G_CALLBACK (fish_update_animation), fish);
+	g_signal_connect (widget, "hierarchy-changed",
+			  G_CALLBACK (fish_hierarchy_changed), fish);
 
 	ctk_widget_add_events (widget, CDK_ENTER_NOTIFY_MASK |
 				       CDK_LEAVE_NOTIFY_MASK |
@@ -1698,7 +1932,20 @@ static void setup_fish_widget(FishApplet* fish)
 
 	update_pixmap (fish);
 
-	setup_timeout (fish);
+	fish->session_bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+	if (fish->session_bus)
+		fish->screensaver_signal =
+			g_dbus_connection_signal_subscribe (fish->session_bus,
+							    NULL,
+							    SCREENSAVER_INTERFACE,
+							    "ActiveChanged",
+							    SCREENSAVER_PATH,
+							    NULL,
+							    G_DBUS_SIGNAL_FLAGS_NONE,
+							    screensaver_active_changed,
+							    fish, NULL);
+
+	fish_hierarchy_changed (widget, NULL, fish);
 
 	set_tooltip (fish);
 	set_ally_name_desc (CTK_WIDGET (fish), fish);
@@ -1809,6 +2056,19 @@ static void fish_applet_dispose (GObject *object)
 
 	fish->timeout = 0;
 
+	if (fish->toplevel)
+		g_signal_handlers_disconnect_by_data (fish->toplevel, fish);
+	fish->toplevel = NULL;
+
+	if (fish->screensaver_signal)
+		g_dbus_connection_signal_unsubscribe (fish->session_bus,
+						      fish->screensaver_signal);
+	fish->screensaver_signal = 0;
+
+	if (fish->session_bus)
+		g_object_unref (fish->session_bus);
+	fish->session_bus = NULL;
+
 	if (fish->settings)
 		g_object_unref (fish->settings);
 	fish->settings = NULL;
@@ -1829,11 +2089,7 @@ static void fish_applet_dispose (GObject *object)
 		g_free (fish->command);
 	fish->command = NULL;
 
-	if (fish->surface)
-		cairo_surface_destroy (fish->surface);
-	fish->surface = NULL;
-	fish->surface_width = 0;
-	fish->surface_height = 0;
+	fish_atlas_clear (fish);
 
 	if (fish->pixbuf)
 		g_object_unref (fish->pixbuf);
@@ -36,6 +36,8 @@
 #include <ctk/ctk.h>
 #include <gio/gio.h>
 
+#include "panel-memory.h"
+
 #include "main.h"
 #include "na-grid.h"
 
@@ -511,6 +513,8 @@ applet_factory (CafePanelApplet *applet,
   ctk_window_set_default_icon_name (NOTIFICATION_AREA_ICON);
 #endif
 
+  panel_memory_follow_budget_setting ();
+
   ctk_widget_show_all (CTK_WIDGET (applet));
 
   return TRUE;
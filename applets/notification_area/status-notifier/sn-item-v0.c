@@ -20,6 +20,8 @@
 
 #include <math.h>
 
+#include "panel-memory.h"
+
 #include "sn-item.h"
 #include "sn-item-v0.h"
 #include "sn-item-v0-gen.h"
@@ -359,9 +361,38 @@ update_cb (gpointer user_data)
   return G_SOURCE_REMOVE;
 }
 
+static gsize
+icon_pixmap_size (SnIconPixmap **data)
+{
+  gsize bytes = 0;
+  gint i;
+
+  for (i = 0; data != NULL && data[i] != NULL; i++)
+    bytes += panel_memory_surface_size (data[i]->surface);
+
+  return bytes;
+}
+
+/* the pixmaps come over D-Bus, they cannot be dropped */
+static void
+charge_pixmaps (SnItemV0 *v0)
+{
+  gsize bytes;
+
+  bytes = icon_pixmap_size (v0->icon_pixmap) +
+          icon_pixmap_size (v0->overlay_icon_pixmap) +
+          icon_pixmap_size (v0->attention_icon_pixmap);
+  if (v0->tooltip != NULL)
+    bytes += icon_pixmap_size (v0->tooltip->icon_pixmap);
+
+  panel_memory_charge (v0, "sni-pixmaps", bytes);
+}
+
 static void
 queue_update (SnItemV0 *v0)
 {
+  charge_pixmaps (v0);
+
   if (v0->update_id != 0)
     return;
 
@@ -1016,6 +1047,7 @@ get_all_cb (GObject      *source_object,
   g_signal_connect (v0->proxy, "g-signal",
                     G_CALLBACK (g_signal_cb), v0);
 
+  charge_pixmaps (v0);
   update (v0);
   sn_item_emit_ready (SN_ITEM (v0));
 }
@@ -1121,6 +1153,8 @@ sn_item_v0_finalize (GObject *object)
   g_clear_pointer (&v0->icon_theme_path, g_free);
   g_clear_pointer (&v0->menu, g_free);
 
+  panel_memory_charge (v0, "sni-pixmaps", 0);
+
   G_OBJECT_CLASS (sn_item_v0_parent_class)->finalize (object);
 }
 
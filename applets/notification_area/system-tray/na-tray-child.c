@@ -157,6 +157,26 @@ na_tray_child_get_preferred_height (CtkWidget *widget,
 }
 #endif
 
+static void
+na_tray_child_size_allocate (CtkWidget     *widget,
+                             CtkAllocation *allocation)
+{
+  NaTrayChild  *child = NA_TRAY_CHILD (widget);
+  CtkAllocation old_allocation;
+  gboolean      moved;
+
+  ctk_widget_get_allocation (widget, &old_allocation);
+  moved = (allocation->x != old_allocation.x ||
+           allocation->y != old_allocation.y);
+
+  CTK_WIDGET_CLASS (na_tray_child_parent_class)->size_allocate (widget,
+                                                                allocation);
+
+  /* only this icon has been shifted with respect to the background */
+  if (moved && child->parent_relative_bg)
+    na_tray_child_force_redraw (child);
+}
+
 /* The plug window should completely occupy the area of the child, so we won't
  * get an expose event. But in case we do (the plug unmaps itself, say), this
  * expose handler draws with real or fake transparency.
@@ -219,6 +239,7 @@ na_tray_child_draw_on_parent (NaItem    *item,
       CtkWidget    *widget = CTK_WIDGET (item);
       CtkAllocation parent_allocation = { 0 };
       CtkAllocation allocation;
+      CdkRectangle  clip;
 
       /* if the parent doesn't have a window, our allocation is not relative to
        * the context coordinates but to the parent's allocation */
@@ -229,6 +250,13 @@ na_tray_child_draw_on_parent (NaItem    *item,
       allocation.x -= parent_allocation.x;
       allocation.y -= parent_allocation.y;
 
+      /* CDK tracks the damage of composited windows and only invalidates
+       * the parts of the parent covered by the children that changed, so
+       * leave the others alone rather than compositing them again */
+      if (cdk_cairo_get_clip_rectangle (parent_cr, &clip) &&
+          ! cdk_rectangle_intersect (&clip, &allocation, NULL))
+        return TRUE;
+
       cairo_save (parent_cr);
       cdk_cairo_set_source_window (parent_cr,
                                    ctk_widget_get_window (widget),
@@ -387,6 +415,7 @@ na_tray_child_class_init (NaTrayChildClass *klass)
   widget_class->get_preferred_height = na_tray_child_get_preferred_height;
 #endif
   widget_class->draw = na_tray_child_draw;
+  widget_class->size_allocate = na_tray_child_size_allocate;
 
   /* we don't really care actually */
   g_object_class_override_property (gobject_class, PROP_ORIENTATION, "orientation");
@@ -555,20 +584,47 @@ na_tray_child_set_composited (NaTrayChild *child,
 /* If we are faking transparency with a window-relative background, force a
  * redraw of the icon. This should be called if the background changes or if
  * the child is shifted with respect to the background.
+ *
+ * Only those icons show the background through their own window: icons with
+ * an alpha channel are composited onto the background by us, so redrawing
+ * our parent is enough, and opaque icons don't care at all.
  */
 void
 na_tray_child_force_redraw (NaTrayChild *child)
 {
   CtkWidget *widget = CTK_WIDGET (child);
+  CdkWindow *plug_window;
+  CdkDisplay *display;
 
-  if (ctk_widget_get_mapped (widget))
+  if (!ctk_widget_get_mapped (widget))
+    return;
+
+  if (child->has_alpha)
     {
-    /* Hiding and showing is the safe way to do it, but can result in more
-     * flickering.
-     */
-    ctk_widget_hide(widget);
-    ctk_widget_show_all(widget);
+      CtkWidget *parent = ctk_widget_get_parent (widget);
+
+      if (parent)
+        ctk_widget_queue_draw (parent);
+      return;
     }
+
+  if (!child->parent_relative_bg)
+    return;
+
+  plug_window = ctk_socket_get_plug_window (CTK_SOCKET (child));
+  if (!plug_window)
+    return;
+
+  /* Clearing the plug window to its (parent-relative) background with
+   * exposures makes the client repaint just that window, which is a lot
+   * less traffic than unmapping and mapping the icon again. */
+  display = ctk_widget_get_display (widget);
+  cdk_x11_display_error_trap_push (display);
+  XClearArea (CDK_DISPLAY_XDISPLAY (display),
+              CDK_WINDOW_XID (plug_window),
+              0, 0, 0, 0,
+              True);
+  cdk_x11_display_error_trap_pop_ignored (display);
 }
 
 /* from libvnck/xutils.c, comes as LGPLv2+ */
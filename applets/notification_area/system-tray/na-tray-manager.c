@@ -467,7 +467,7 @@ na_tray_manager_handle_cancel_message (NaTrayManager       *manager,
 
 static CdkFilterReturn
 na_tray_manager_window_filter (CdkXEvent *xev,
-                               CdkEvent  *event,
+                               CdkEvent  *event G_GNUC_UNUSED,
                                gpointer   data)
 {
   XEvent        *xevent = (CdkXEvent *)xev;
@@ -489,7 +489,7 @@ na_tray_manager_window_filter (CdkXEvent *xev,
                xevent->xclient.data.l[1] == SYSTEM_TRAY_BEGIN_MESSAGE)
         {
           na_tray_manager_handle_begin_message (manager,
-                                                (XClientMessageEvent *) event);
+                                                (XClientMessageEvent *) xevent);
           return CDK_FILTER_REMOVE;
         }
       /* _NET_SYSTEM_TRAY_OPCODE: SYSTEM_TRAY_CANCEL_MESSAGE */
@@ -497,14 +497,14 @@ na_tray_manager_window_filter (CdkXEvent *xev,
                xevent->xclient.data.l[1] == SYSTEM_TRAY_CANCEL_MESSAGE)
         {
           na_tray_manager_handle_cancel_message (manager,
-                                                 (XClientMessageEvent *) event);
+                                                 (XClientMessageEvent *) xevent);
           return CDK_FILTER_REMOVE;
         }
       /* _NET_SYSTEM_TRAY_MESSAGE_DATA */
       else if (xevent->xclient.message_type == manager->message_data_atom)
         {
           na_tray_manager_handle_message_data (manager,
-                                               (XClientMessageEvent *) event);
+                                               (XClientMessageEvent *) xevent);
           return CDK_FILTER_REMOVE;
         }
     }
@@ -19,13 +19,28 @@
  * Boston, MA 02110-1301, USA.
  */
 
+/*
+ * Without arguments, this hosts a tray that icons can be added to by
+ * hand. With --stress, it also starts a private session bus and a
+ * second process with --xembed-clients XEmbed icons and --sni-clients
+ * StatusNotifierItems, which all change their icon, tooltip, title and
+ * balloon message (status for the items) --rate times per second. After
+ * --duration seconds it prints the draw times of the tray, the D-Bus
+ * traffic and the memory growth of the host, for instance:
+ *
+ *   xvfb-run ./testtray --stress --xembed-clients 50 --sni-clients 50
+ */
+
 #include "config.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <signal.h>
+#include <unistd.h>
 #include <glib-unix.h>
 #include <ctk/ctk.h>
+#include <ctk/ctkx.h>
+#include <X11/Xlib.h>
 #include "system-tray/na-tray-manager.h"
 #ifdef PROVIDE_WATCHER_SERVICE
 # include "libstatus-notifier-watcher/gf-status-notifier-watcher.h"
@@ -34,8 +49,36 @@
 
 #define NOTIFICATION_AREA_ICON "cafe-panel-notification-area"
 
+#define SYSTEM_TRAY_REQUEST_DOCK    0
+#define SYSTEM_TRAY_BEGIN_MESSAGE   1
+
+#define STRESS_ICON_SIZE 16
+
 static guint n_windows = 0;
 
+static gboolean opt_stress = FALSE;
+static gboolean opt_stress_clients = FALSE;
+static gint     opt_xembed_clients = 20;
+static gint     opt_sni_clients = 20;
+static gdouble  opt_rate = 2.0;
+static gint     opt_duration = 30;
+
+static GOptionEntry options[] = {
+  { "stress", 0, 0, G_OPTION_ARG_NONE, &opt_stress,
+    "Run the stress clients against the tray and report", NULL },
+  { "xembed-clients", 0, 0, G_OPTION_ARG_INT, &opt_xembed_clients,
+    "Number of XEmbed tray icons", "N" },
+  { "sni-clients", 0, 0, G_OPTION_ARG_INT, &opt_sni_clients,
+    "Number of StatusNotifierItems", "M" },
+  { "rate", 0, 0, G_OPTION_ARG_DOUBLE, &opt_rate,
+    "Changes per second made by each client", "RATE" },
+  { "duration", 0, 0, G_OPTION_ARG_INT, &opt_duration,
+    "Seconds to run the stress test for", "SECONDS" },
+  { "stress-clients", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &opt_stress_clients,
+    NULL, NULL },
+  { NULL }
+};
+
 typedef struct
 {
   CdkScreen *screen;
@@ -207,6 +250,653 @@ create_tray_on_screen (CdkScreen *screen,
   return data;
 }
 
+/* The clients, in their own process */
+
+typedef struct
+{
+  guint      index;
+  guint      tick;
+  CtkWidget *plug;
+  CtkWidget *area;
+} XEmbedClient;
+
+typedef struct
+{
+  guint    index;
+  guint    tick;
+  char    *path;
+  gboolean needs_attention;
+} SniClient;
+
+static GSList          *pending_docks = NULL;
+static GDBusConnection *client_bus = NULL;
+static GDBusNodeInfo   *sni_node_info = NULL;
+
+static const char sni_introspection[] =
+  "<node>"
+  "  <interface name='org.kde.StatusNotifierItem'>"
+  "    <method name='ContextMenu'><arg type='i' direction='in'/><arg type='i' direction='in'/></method>"
+  "    <method name='Activate'><arg type='i' direction='in'/><arg type='i' direction='in'/></method>"
+  "    <method name='SecondaryActivate'><arg type='i' direction='in'/><arg type='i' direction='in'/></method>"
+  "    <method name='Scroll'><arg type='i' direction='in'/><arg type='s' direction='in'/></method>"
+  "    <property name='Category' type='s' access='read'/>"
+  "    <property name='Id' type='s' access='read'/>"
+  "    <property name='Title' type='s' access='read'/>"
+  "    <property name='Status' type='s' access='read'/>"
+  "    <property name='IconName' type='s' access='read'/>"
+  "    <property name='IconPixmap' type='a(iiay)' access='read'/>"
+  "    <property name='ToolTip' type='(sa(iiay)ss)' access='read'/>"
+  "    <property name='ItemIsMenu' type='b' access='read'/>"
+  "    <signal name='NewTitle'/>"
+  "    <signal name='NewIcon'/>"
+  "    <signal name='NewToolTip'/>"
+  "    <signal name='NewStatus'><arg type='s'/></signal>"
+  "  </interface>"
+  "</node>";
+
+static guint
+stress_interval (void)
+{
+  return opt_rate > 0 ? MAX (1, (guint) (1000 / opt_rate)) : 1000;
+}
+
+static void
+stress_color (guint     index,
+              guint     tick,
+              guint8   *rgb)
+{
+  rgb[0] = (index * 37 + tick * 13) & 0xff;
+  rgb[1] = (index * 59 + tick * 29) & 0xff;
+  rgb[2] = (index * 83 + tick * 7) & 0xff;
+}
+
+static void
+xembed_send_opcode (Window xwindow,
+                    Window manager,
+                    long   opcode,
+                    long   data1,
+                    long   data2,
+                    long   data3)
+{
+  CdkDisplay          *display = cdk_display_get_default ();
+  Display             *xdisplay = CDK_DISPLAY_XDISPLAY (display);
+  XClientMessageEvent  ev;
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = xwindow;
+  ev.message_type = XInternAtom (xdisplay, "_NET_SYSTEM_TRAY_OPCODE", False);
+  ev.format = 32;
+  ev.data.l[0] = CurrentTime;
+  ev.data.l[1] = opcode;
+  ev.data.l[2] = data1;
+  ev.data.l[3] = data2;
+  ev.data.l[4] = data3;
+
+  cdk_x11_display_error_trap_push (display);
+  XSendEvent (xdisplay, manager, False, NoEventMask, (XEvent *) &ev);
+  cdk_x11_display_error_trap_pop_ignored (display);
+}
+
+static Window
+xembed_get_manager (void)
+{
+  CdkScreen *screen = cdk_screen_get_default ();
+  Display   *xdisplay = CDK_DISPLAY_XDISPLAY (cdk_screen_get_display (screen));
+  char       name[64];
+
+  g_snprintf (name, sizeof (name), "_NET_SYSTEM_TRAY_S%d",
+              cdk_x11_screen_get_screen_number (screen));
+
+  return XGetSelectionOwner (xdisplay, XInternAtom (xdisplay, name, False));
+}
+
+static gboolean
+xembed_dock_pending (gpointer data G_GNUC_UNUSED)
+{
+  Window  manager;
+  GSList *l;
+
+  /* the tray may not be up yet */
+  manager = xembed_get_manager ();
+  if (manager == None)
+    return TRUE;
+
+  for (l = pending_docks; l; l = l->next)
+    {
+      XEmbedClient *client = l->data;
+
+      xembed_send_opcode (ctk_plug_get_id (CTK_PLUG (client->plug)), manager,
+                          SYSTEM_TRAY_REQUEST_DOCK,
+                          ctk_plug_get_id (CTK_PLUG (client->plug)), 0, 0);
+    }
+
+  g_slist_free (pending_docks);
+  pending_docks = NULL;
+
+  return FALSE;
+}
+
+static void
+xembed_send_balloon (XEmbedClient *client,
+                     const char   *text)
+{
+  CdkDisplay          *display = cdk_display_get_default ();
+  Display             *xdisplay = CDK_DISPLAY_XDISPLAY (display);
+  XClientMessageEvent  ev;
+  Window               xwindow;
+  Window               manager;
+  gsize                len;
+  gsize                offset;
+
+  manager = xembed_get_manager ();
+  if (manager == None)
+    return;
+
+  xwindow = ctk_plug_get_id (CTK_PLUG (client->plug));
+  len = strlen (text);
+
+  xembed_send_opcode (xwindow, manager, SYSTEM_TRAY_BEGIN_MESSAGE,
+                      2000, len, client->tick);
+
+  memset (&ev, 0, sizeof (ev));
+  ev.type = ClientMessage;
+  ev.window = xwindow;
+  ev.message_type = XInternAtom (xdisplay, "_NET_SYSTEM_TRAY_MESSAGE_DATA", False);
+  ev.format = 8;
+
+  cdk_x11_display_error_trap_push (display);
+  for (offset = 0; offset < len; offset += 20)
+    {
+      memset (ev.data.b, 0, sizeof (ev.data.b));
+      memcpy (ev.data.b, text + offset, MIN (len - offset, 20));
+      XSendEvent (xdisplay, manager, False, StructureNotifyMask, (XEvent *) &ev);
+    }
+  cdk_x11_display_error_trap_pop_ignored (display);
+}
+
+static gboolean
+xembed_client_draw (CtkWidget    *area G_GNUC_UNUSED,
+                    cairo_t      *cr,
+                    XEmbedClient *client)
+{
+  guint8 rgb[3];
+
+  stress_color (client->index, client->tick, rgb);
+  cairo_set_source_rgb (cr, rgb[0] / 255., rgb[1] / 255., rgb[2] / 255.);
+  cairo_paint (cr);
+
+  return TRUE;
+}
+
+static gboolean
+xembed_client_tick (XEmbedClient *client)
+{
+  char *text;
+
+  switch (client->tick++ % 4)
+    {
+    case 0:
+      ctk_widget_queue_draw (client->area);
+      break;
+    case 1:
+      text = g_strdup_printf ("XEmbed client %u, change %u", client->index, client->tick);
+      ctk_widget_set_tooltip_text (client->area, text);
+      g_free (text);
+      break;
+    case 2:
+      text = g_strdup_printf ("XEmbed client %u (%u)", client->index, client->tick);
+      ctk_window_set_title (CTK_WINDOW (client->plug), text);
+      g_free (text);
+      break;
+    case 3:
+      text = g_strdup_printf ("Balloon %u from XEmbed client %u", client->tick, client->index);
+      xembed_send_balloon (client, text);
+      g_free (text);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  return TRUE;
+}
+
+static void
+xembed_client_new (guint index)
+{
+  XEmbedClient *client;
+
+  client = g_new0 (XEmbedClient, 1);
+  client->index = index;
+
+  client->plug = ctk_plug_new (0);
+  client->area = ctk_drawing_area_new ();
+  ctk_widget_set_size_request (client->area, STRESS_ICON_SIZE, STRESS_ICON_SIZE);
+  g_signal_connect (client->area, "draw", G_CALLBACK (xembed_client_draw), client);
+  ctk_container_add (CTK_CONTAINER (client->plug), client->area);
+  ctk_widget_show_all (client->plug);
+
+  pending_docks = g_slist_prepend (pending_docks, client);
+
+  g_timeout_add (stress_interval (), (GSourceFunc) xembed_client_tick, client);
+}
+
+static GVariant *
+sni_client_icon_pixmap (SniClient *client)
+{
+  GVariantBuilder builder;
+  guint8          rgb[3];
+  guint8         *data;
+  gsize           size;
+  gsize           i;
+
+  stress_color (client->index, client->tick, rgb);
+
+  /* ARGB32 in network byte order */
+  size = STRESS_ICON_SIZE * STRESS_ICON_SIZE * 4;
+  data = g_malloc (size);
+  for (i = 0; i < size; i += 4)
+    {
+      data[i] = 0xff;
+      data[i + 1] = rgb[0];
+      data[i + 2] = rgb[1];
+      data[i + 3] = rgb[2];
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iiay)"));
+  g_variant_builder_add (&builder, "(ii@ay)", STRESS_ICON_SIZE, STRESS_ICON_SIZE,
+                         g_variant_new_from_data (G_VARIANT_TYPE ("ay"), data, size,
+                                                  TRUE, g_free, data));
+
+  return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+sni_client_get_property (GDBusConnection *connection G_GNUC_UNUSED,
+                         const gchar     *sender G_GNUC_UNUSED,
+                         const gchar     *object_path G_GNUC_UNUSED,
+                         const gchar     *interface_name G_GNUC_UNUSED,
+                         const gchar     *property_name,
+                         GError         **error,
+                         gpointer         user_data)
+{
+  SniClient *client = user_data;
+  GVariant  *value = NULL;
+  char      *text;
+
+  if (g_strcmp0 (property_name, "Category") == 0)
+    value = g_variant_new_string ("ApplicationStatus");
+  else if (g_strcmp0 (property_name, "Id") == 0)
+    {
+      text = g_strdup_printf ("testtray-%u", client->index);
+      value = g_variant_new_take_string (text);
+    }
+  else if (g_strcmp0 (property_name, "Title") == 0)
+    {
+      text = g_strdup_printf ("SNI client %u (%u)", client->index, client->tick);
+      value = g_variant_new_take_string (text);
+    }
+  else if (g_strcmp0 (property_name, "Status") == 0)
+    value = g_variant_new_string (client->needs_attention ? "NeedsAttention" : "Active");
+  else if (g_strcmp0 (property_name, "IconName") == 0)
+    value = g_variant_new_string ("");
+  else if (g_strcmp0 (property_name, "IconPixmap") == 0)
+    value = sni_client_icon_pixmap (client);
+  else if (g_strcmp0 (property_name, "ToolTip") == 0)
+    {
+      text = g_strdup_printf ("SNI client %u, change %u", client->index, client->tick);
+      value = g_variant_new ("(s@a(iiay)ss)", "",
+                             g_variant_new_array (G_VARIANT_TYPE ("(iiay)"), NULL, 0),
+                             text, "");
+      g_free (text);
+    }
+  else if (g_strcmp0 (property_name, "ItemIsMenu") == 0)
+    value = g_variant_new_boolean (FALSE);
+  else
+    g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+                 "No property %s", property_name);
+
+  return value;
+}
+
+static void
+sni_client_method_call (GDBusConnection       *connection G_GNUC_UNUSED,
+                        const gchar           *sender G_GNUC_UNUSED,
+                        const gchar           *object_path G_GNUC_UNUSED,
+                        const gchar           *interface_name G_GNUC_UNUSED,
+                        const gchar           *method_name G_GNUC_UNUSED,
+                        GVariant              *parameters G_GNUC_UNUSED,
+                        GDBusMethodInvocation *invocation,
+                        gpointer               user_data G_GNUC_UNUSED)
+{
+  g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static const GDBusInterfaceVTable sni_client_vtable = {
+  sni_client_method_call,
+  sni_client_get_property,
+  NULL
+};
+
+static void
+sni_client_emit (SniClient  *client,
+                 const char *signal_name,
+                 GVariant   *parameters)
+{
+  g_dbus_connection_emit_signal (client_bus, NULL, client->path,
+                                 "org.kde.StatusNotifierItem", signal_name,
+                                 parameters, NULL);
+}
+
+static gboolean
+sni_client_tick (SniClient *client)
+{
+  switch (client->tick++ % 4)
+    {
+    case 0:
+      sni_client_emit (client, "NewIcon", NULL);
+      break;
+    case 1:
+      sni_client_emit (client, "NewToolTip", NULL);
+      break;
+    case 2:
+      sni_client_emit (client, "NewTitle", NULL);
+      break;
+    case 3:
+      /* there are no balloons for these, blink instead */
+      client->needs_attention = !client->needs_attention;
+      sni_client_emit (client, "NewStatus",
+                       g_variant_new ("(s)", client->needs_attention ?
+                                             "NeedsAttention" : "Active"));
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  return TRUE;
+}
+
+static void
+sni_client_registered (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      user_data G_GNUC_UNUSED)
+{
+  GVariant *ret;
+  GError   *error = NULL;
+
+  ret = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), res, &error);
+  if (!ret)
+    {
+      g_warning ("Cannot register the status notifier item: %s", error->message);
+      g_error_free (error);
+      return;
+    }
+
+  g_variant_unref (ret);
+}
+
+static void
+sni_watcher_appeared (GDBusConnection *connection,
+                      const gchar     *name G_GNUC_UNUSED,
+                      const gchar     *name_owner G_GNUC_UNUSED,
+                      gpointer         user_data G_GNUC_UNUSED)
+{
+  gint i;
+
+  for (i = 0; i < opt_sni_clients; i++)
+    {
+      SniClient *client;
+      GError    *error = NULL;
+
+      client = g_new0 (SniClient, 1);
+      client->index = i;
+      client->path = g_strdup_printf ("/org/cafe/testtray/Item%d", i);
+
+      if (!g_dbus_connection_register_object (connection, client->path,
+                                              sni_node_info->interfaces[0],
+                                              &sni_client_vtable,
+                                              client, NULL, &error))
+        {
+          g_warning ("Cannot export %s: %s", client->path, error->message);
+          g_error_free (error);
+          g_free (client->path);
+          g_free (client);
+          continue;
+        }
+
+      /* an object path is taken to be on the connection that sends it */
+      g_dbus_connection_call (connection,
+                              "org.kde.StatusNotifierWatcher",
+                              "/StatusNotifierWatcher",
+                              "org.kde.StatusNotifierWatcher",
+                              "RegisterStatusNotifierItem",
+                              g_variant_new ("(s)", client->path),
+                              NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                              sni_client_registered, NULL);
+
+      g_timeout_add (stress_interval (), (GSourceFunc) sni_client_tick, client);
+    }
+}
+
+static int
+run_stress_clients (void)
+{
+  GError *error = NULL;
+  gint    i;
+
+  for (i = 0; i < opt_xembed_clients; i++)
+    xembed_client_new (i);
+
+  if (pending_docks && xembed_dock_pending (NULL))
+    g_timeout_add (100, xembed_dock_pending, NULL);
+
+  if (opt_sni_clients > 0)
+    {
+      client_bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+      if (!client_bus)
+        {
+          g_printerr ("Cannot connect to the session bus: %s\n", error->message);
+          g_error_free (error);
+          return 1;
+        }
+
+      sni_node_info = g_dbus_node_info_new_for_xml (sni_introspection, NULL);
+      g_bus_watch_name_on_connection (client_bus, "org.kde.StatusNotifierWatcher",
+                                      G_BUS_NAME_WATCHER_FLAGS_NONE,
+                                      sni_watcher_appeared, NULL, NULL, NULL);
+    }
+
+  ctk_main ();
+
+  return 0;
+}
+
+/* The host side of the stress test */
+
+static GArray          *stress_draw_times = NULL;
+static gint64           stress_draw_start = 0;
+static gint64           stress_start_time = 0;
+static gsize            stress_rss_start = 0;
+static volatile gint    stress_dbus_in = 0;
+static volatile gint    stress_dbus_out = 0;
+static GSubprocess     *stress_clients = NULL;
+
+static gsize
+stress_get_rss (void)
+{
+  unsigned long size, resident;
+  char         *contents;
+  gsize         rss = 0;
+
+  if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    {
+      if (sscanf (contents, "%lu %lu", &size, &resident) == 2)
+        rss = (gsize) resident * sysconf (_SC_PAGESIZE);
+      g_free (contents);
+    }
+
+  return rss;
+}
+
+static GDBusMessage *
+stress_count_message (GDBusConnection *connection G_GNUC_UNUSED,
+                      GDBusMessage    *message,
+                      gboolean         incoming,
+                      gpointer         user_data G_GNUC_UNUSED)
+{
+  /* called from the GDBus worker thread */
+  if (incoming)
+    g_atomic_int_inc (&stress_dbus_in);
+  else
+    g_atomic_int_inc (&stress_dbus_out);
+
+  return message;
+}
+
+static gboolean
+stress_draw_begin (CtkWidget *traybox G_GNUC_UNUSED,
+                   cairo_t   *cr G_GNUC_UNUSED)
+{
+  stress_draw_start = g_get_monotonic_time ();
+
+  return FALSE;
+}
+
+static gboolean
+stress_draw_end (CtkWidget *traybox G_GNUC_UNUSED,
+                 cairo_t   *cr G_GNUC_UNUSED)
+{
+  gint64 duration;
+
+  duration = g_get_monotonic_time () - stress_draw_start;
+  g_array_append_val (stress_draw_times, duration);
+
+  return FALSE;
+}
+
+static gboolean
+stress_done (gpointer data G_GNUC_UNUSED)
+{
+  ctk_main_quit ();
+
+  return FALSE;
+}
+
+static gint
+compare_gint64 (gconstpointer a,
+                gconstpointer b)
+{
+  gint64 va = *(const gint64 *) a;
+  gint64 vb = *(const gint64 *) b;
+
+  return va < vb ? -1 : va > vb;
+}
+
+static double
+stress_draw_time_at (double fraction)
+{
+  guint i;
+
+  i = MIN (stress_draw_times->len - 1, (guint) (fraction * stress_draw_times->len));
+
+  return g_array_index (stress_draw_times, gint64, i) / 1000.;
+}
+
+static void
+stress_report (TrayData *data)
+{
+  guint n_children = 0;
+  gsize rss_end;
+
+  ctk_container_foreach (CTK_CONTAINER (data->traybox), (CtkCallback) do_add, &n_children);
+  rss_end = stress_get_rss ();
+
+  g_print ("duration: %.1f s\n",
+           (g_get_monotonic_time () - stress_start_time) / (double) G_USEC_PER_SEC);
+  g_print ("clients: %d xembed, %d sni, %g changes/s each\n",
+           opt_xembed_clients, opt_sni_clients, opt_rate);
+  g_print ("icons: %u\n", n_children);
+
+  g_print ("draws: %u\n", stress_draw_times->len);
+  if (stress_draw_times->len > 0)
+    {
+      g_array_sort (stress_draw_times, compare_gint64);
+      g_print ("draw-time-p50: %.3f ms\n", stress_draw_time_at (0.50));
+      g_print ("draw-time-p95: %.3f ms\n", stress_draw_time_at (0.95));
+      g_print ("draw-time-max: %.3f ms\n", stress_draw_time_at (1.0));
+    }
+
+  g_print ("dbus-messages-in: %d\n", g_atomic_int_get (&stress_dbus_in));
+  g_print ("dbus-messages-out: %d\n", g_atomic_int_get (&stress_dbus_out));
+
+  g_print ("rss-start: %" G_GSIZE_FORMAT " kB\n", stress_rss_start / 1024);
+  g_print ("rss-end: %" G_GSIZE_FORMAT " kB\n", rss_end / 1024);
+  g_print ("rss-growth: %" G_GSSIZE_FORMAT " kB\n",
+           ((gssize) rss_end - (gssize) stress_rss_start) / 1024);
+}
+
+static void
+stress_start (TrayData   *data,
+              const char *program)
+{
+  GDBusConnection *bus;
+  GError          *error = NULL;
+  char             rate[G_ASCII_DTOSTR_BUF_SIZE];
+  char            *xembed;
+  char            *sni;
+
+  stress_draw_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_signal_connect (data->traybox, "draw", G_CALLBACK (stress_draw_begin), NULL);
+  g_signal_connect_after (data->traybox, "draw", G_CALLBACK (stress_draw_end), NULL);
+
+  /* the connection the hosts and the watcher share */
+  bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (bus)
+    {
+      g_dbus_connection_add_filter (bus, stress_count_message, NULL, NULL);
+      g_object_unref (bus);
+    }
+  else
+    {
+      g_warning ("Cannot connect to the session bus: %s", error->message);
+      g_clear_error (&error);
+    }
+
+  g_ascii_dtostr (rate, sizeof (rate), opt_rate);
+  xembed = g_strdup_printf ("%d", opt_xembed_clients);
+  sni = g_strdup_printf ("%d", opt_sni_clients);
+
+  stress_clients = g_subprocess_new (G_SUBPROCESS_FLAGS_NONE, &error,
+                                     program, "--stress-clients",
+                                     "--xembed-clients", xembed,
+                                     "--sni-clients", sni,
+                                     "--rate", rate,
+                                     NULL);
+  if (!stress_clients)
+    {
+      g_warning ("Cannot start the stress clients: %s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (xembed);
+  g_free (sni);
+
+  stress_rss_start = stress_get_rss ();
+  stress_start_time = g_get_monotonic_time ();
+  g_timeout_add_seconds (opt_duration, stress_done, NULL);
+}
+
+static void
+stress_stop (void)
+{
+  if (!stress_clients)
+    return;
+
+  g_subprocess_send_signal (stress_clients, SIGTERM);
+  g_subprocess_wait (stress_clients, NULL, NULL);
+  g_clear_object (&stress_clients);
+}
+
 static gboolean
 signal_handler (gpointer data G_GNUC_UNUSED)
 {
@@ -254,15 +944,33 @@ main (int argc, char *argv[])
 {
   CdkDisplay *display;
   CdkScreen *screen;
+  TrayData *data;
+  GTestDBus *private_bus = NULL;
+  GError *error = NULL;
 #ifdef PROVIDE_WATCHER_SERVICE
   GfStatusNotifierWatcher *service;
 #endif
 
-  ctk_init (&argc, &argv);
+  if (!ctk_init_with_args (&argc, &argv, NULL, options, NULL, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      return 1;
+    }
 
   g_unix_signal_add (SIGTERM, signal_handler, NULL);
   g_unix_signal_add (SIGINT, signal_handler, NULL);
 
+  if (opt_stress_clients)
+    return run_stress_clients ();
+
+  /* keep the stress clients away from the bus of the session */
+  if (opt_stress)
+    {
+      private_bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+      g_test_dbus_up (private_bus);
+    }
+
 #ifdef PROVIDE_WATCHER_SERVICE
   service = status_notifier_watcher_maybe_new ();
 #endif
@@ -272,14 +980,26 @@ main (int argc, char *argv[])
   display = cdk_display_get_default ();
   screen = cdk_display_get_default_screen (display);
 
-  create_tray_on_screen (screen, FALSE);
+  data = create_tray_on_screen (screen, opt_stress);
+
+  if (opt_stress && data)
+    stress_start (data, argv[0]);
 
   ctk_main ();
 
+  if (opt_stress && data)
+    {
+      stress_stop ();
+      stress_report (data);
+    }
+
 #ifdef PROVIDE_WATCHER_SERVICE
   if (service)
     g_object_unref (service);
 #endif
 
+  if (private_bus)
+    g_test_dbus_stop (private_bus);
+
   return 0;
 }
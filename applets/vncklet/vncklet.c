@@ -38,6 +38,8 @@
 #define VNCK_I_KNOW_THIS_IS_UNSTABLE
 #include <libvnck/libvnck.h>
 
+#include "panel-memory.h"
+
 #include "vncklet.h"
 #include "window-menu.h"
 #include "workspace-switcher.h"
@@ -130,6 +132,8 @@ static gboolean vncklet_factory (CafePanelApplet *applet,
 		type_registered = TRUE;
 	}
 
+	panel_memory_follow_budget_setting();
+
 	if (!strcmp(iid, "WindowMenuApplet"))
 		retval = window_menu_applet_fill(applet);
 	else if (!strcmp(iid, "WorkspaceSwitcherApplet") || !strcmp(iid, "PagerApplet"))
@@ -29,11 +29,16 @@
 #define CAFE_DESKTOP_USE_UNSTABLE_API
 #include <libcafe-desktop/cafe-desktop-utils.h>
 
+#include "panel-memory.h"
+
 #include "vncklet.h"
 #include "window-list.h"
 
 #define WINDOW_LIST_ICON "cafe-panel-window-list"
 #define WINDOW_LIST_SCHEMA "org.cafe.panel.applet.window-list"
+/* Button widths jitter by a pixel or two as titles change; don't make
+ * the panel relayout for that. */
+#define WINDOW_LIST_SIZE_HINTS_HYSTERESIS 2
 #ifdef HAVE_WINDOW_PREVIEWS
 #define WINDOW_LIST_PREVIEW_SCHEMA "org.cafe.panel.applet.window-list-previews"
 #endif
@@ -275,6 +280,11 @@ static gboolean preview_window_draw (CtkWidget *widget, cairo_t *cr, GdkPixbuf *
 	return FALSE;
 }
 
+static void preview_window_destroyed (CtkWidget *preview)
+{
+	panel_memory_charge (preview, "window-thumbnail", 0);
+}
+
 static gboolean applet_enter_notify_event (VnckTasklist *tl G_GNUC_UNUSED,
 					   GList        *vnck_windows,
 					   TasklistData *tasklist)
@@ -326,6 +336,9 @@ static gboolean applet_enter_notify_event (VnckTasklist *tl G_GNUC_UNUSED,
 
 	g_signal_connect_data (G_OBJECT (tasklist->preview), "draw", G_CALLBACK (preview_window_draw), thumbnail, (GClosureNotify) g_object_unref, 0);
 
+	panel_memory_charge (tasklist->preview, "window-thumbnail", panel_memory_pixbuf_size (thumbnail));
+	g_signal_connect (tasklist->preview, "destroy", G_CALLBACK (preview_window_destroyed), NULL);
+
 	return FALSE;
 }
 
@@ -688,6 +701,7 @@ gboolean window_list_applet_fill(CafePanelApplet* applet)
 	g_object_unref (provider);
 
 	cafe_panel_applet_set_flags(CAFE_PANEL_APPLET(tasklist->applet), CAFE_PANEL_APPLET_EXPAND_MAJOR | CAFE_PANEL_APPLET_EXPAND_MINOR | CAFE_PANEL_APPLET_HAS_HANDLE);
+	cafe_panel_applet_set_size_hints_hysteresis(CAFE_PANEL_APPLET(tasklist->applet), WINDOW_LIST_SIZE_HINTS_HYSTERESIS);
 
 	setup_gsettings(tasklist);
 
@@ -45,6 +45,10 @@
 
 #define WORKSPACE_SWITCHER_ICON "cafe-panel-workspace-switcher"
 
+/* how long a switch we asked for may take to show up before scrolling
+ * starts again from the active workspace */
+#define SCROLL_CONFIRM_TIMEOUT (250 * G_TIME_SPAN_MILLISECOND)
+
 typedef enum {
 	PAGER_WM_CROMA,
 	PAGER_WM_METACITY,
@@ -83,6 +87,14 @@ typedef struct {
 	gboolean display_all;
 	gboolean wrap_workspaces;
 
+	/* scroll events are coalesced until the next frame, where a
+	 * single switch to scroll_target is sent */
+	int scroll_target;
+	guint32 scroll_time;
+	guint scroll_tick_id;
+	gint64 scroll_sent;
+	guint scroll_confirm_id;
+
 	GSettings* settings;
 } PagerData;
 
@@ -199,12 +211,38 @@ static void window_manager_changed(VnckScreen* screen, PagerData* pager)
 	pager_update(pager);
 }
 
+static void active_workspace_changed (VnckScreen    *screen,
+				      VnckWorkspace *previous G_GNUC_UNUSED,
+				      PagerData     *pager)
+{
+	VnckWorkspace* active;
+
+	if (pager->scroll_target < 0)
+		return;
+
+	/* only the switch we sent last is ours: an earlier one, or one
+	 * from somewhere else, leaves the target and its timeout alone */
+	active = vnck_screen_get_active_workspace(screen);
+	if (!active || vnck_workspace_get_number(active) != pager->scroll_target)
+		return;
+
+	pager->scroll_target = -1;
+	ctk_widget_queue_draw(pager->pager);
+
+	if (pager->scroll_confirm_id)
+	{
+		g_source_remove(pager->scroll_confirm_id);
+		pager->scroll_confirm_id = 0;
+	}
+}
+
 static void applet_realized(CafePanelApplet* applet, PagerData* pager)
 {
 	pager->screen = vncklet_get_screen(CTK_WIDGET(applet));
 
 	window_manager_changed(pager->screen, pager);
 	vncklet_connect_while_alive(pager->screen, "window_manager_changed", G_CALLBACK(window_manager_changed), pager, pager->applet);
+	vncklet_connect_while_alive(pager->screen, "active_workspace_changed", G_CALLBACK(active_workspace_changed), pager, pager->applet);
 }
 
 static void applet_unrealized (CafePanelApplet *applet G_GNUC_UNUSED,
@@ -212,6 +250,7 @@ static void applet_unrealized (CafePanelApplet *applet G_GNUC_UNUSED,
 {
 	pager->screen = NULL;
 	pager->wm = PAGER_WM_UNKNOWN;
+	pager->scroll_target = -1;
 }
 
 static void applet_change_orient (CafePanelApplet      *applet G_GNUC_UNUSED,
@@ -288,21 +327,12 @@ static void applet_style_updated (CafePanelApplet *applet G_GNUC_UNUSED,
 /* Replacement for the default scroll handler that also cares about the wrapping property.
  * Alternative: Add behaviour to libvnck (to the VnckPager widget).
  */
-static gboolean applet_scroll(CafePanelApplet* applet, CdkEventScroll* event, PagerData* pager)
+static int pager_scroll_step(PagerData* pager, int index, CdkScrollDirection absolute_direction)
 {
-	CdkScrollDirection absolute_direction;
-	int index;
 	int n_workspaces;
 	int n_columns;
 	int in_last_row;
 
-	if (event->type != CDK_SCROLL)
-		return FALSE;
-
-	if (event->direction == CDK_SCROLL_SMOOTH)
-		return FALSE;
-
-	index = vnck_workspace_get_number(vnck_screen_get_active_workspace(pager->screen));
 	n_workspaces = vnck_screen_get_workspace_count(pager->screen);
 	n_columns = n_workspaces / pager->n_rows;
 
@@ -311,22 +341,9 @@ static gboolean applet_scroll(CafePanelApplet* applet, CdkEventScroll* event, Pa
 
 	in_last_row    = n_workspaces % n_columns;
 
-	absolute_direction = event->direction;
-
-	if (ctk_widget_get_direction(CTK_WIDGET(applet)) == CTK_TEXT_DIR_RTL)
-	{
-		switch (event->direction)
-		{
-			case CDK_SCROLL_RIGHT:
-				absolute_direction = CDK_SCROLL_LEFT;
-				break;
-			case CDK_SCROLL_LEFT:
-				absolute_direction = CDK_SCROLL_RIGHT;
-				break;
-			default:
-				break;
-		}
-	}
+	/* workspaces may have gone away since the scroll started */
+	if (index >= n_workspaces)
+		index = n_workspaces - 1;
 
 	switch (absolute_direction)
 	{
@@ -389,11 +406,158 @@ static gboolean applet_scroll(CafePanelApplet* applet, CdkEventScroll* event, Pa
 			break;
 	}
 
-	vnck_workspace_activate(vnck_screen_get_workspace(pager->screen, index), event->time);
+	return index;
+}
+
+/* the window manager ignored the switch: stop showing where we
+ * wanted to go */
+static gboolean pager_scroll_confirm_timeout (gpointer user_data)
+{
+	PagerData* pager = user_data;
+
+	pager->scroll_confirm_id = 0;
+
+	if (pager->scroll_tick_id == 0 && pager->scroll_target >= 0)
+	{
+		pager->scroll_target = -1;
+		ctk_widget_queue_draw(pager->pager);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean pager_scroll_flush (CtkWidget     *widget G_GNUC_UNUSED,
+				    CdkFrameClock *frame_clock G_GNUC_UNUSED,
+				    gpointer       user_data)
+{
+	PagerData* pager = user_data;
+	VnckWorkspace* workspace;
+
+	pager->scroll_tick_id = 0;
+
+	if (!pager->screen)
+		return G_SOURCE_REMOVE;
+
+	workspace = vnck_screen_get_workspace(pager->screen, pager->scroll_target);
+
+	if (workspace && workspace != vnck_screen_get_active_workspace(pager->screen))
+	{
+		vnck_workspace_activate(workspace, pager->scroll_time);
+		pager->scroll_sent = g_get_monotonic_time();
+
+		if (pager->scroll_confirm_id)
+			g_source_remove(pager->scroll_confirm_id);
+		pager->scroll_confirm_id = g_timeout_add(SCROLL_CONFIRM_TIMEOUT / G_TIME_SPAN_MILLISECOND,
+							 pager_scroll_confirm_timeout, pager);
+	}
+	else
+	{
+		/* scrolled back to where we were */
+		pager->scroll_target = -1;
+		ctk_widget_queue_draw(pager->pager);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean applet_scroll(CafePanelApplet* applet, CdkEventScroll* event, PagerData* pager)
+{
+	CdkScrollDirection absolute_direction;
+
+	if (event->type != CDK_SCROLL)
+		return FALSE;
+
+	if (event->direction == CDK_SCROLL_SMOOTH)
+		return FALSE;
+
+	absolute_direction = event->direction;
+
+	if (ctk_widget_get_direction(CTK_WIDGET(applet)) == CTK_TEXT_DIR_RTL)
+	{
+		switch (event->direction)
+		{
+			case CDK_SCROLL_RIGHT:
+				absolute_direction = CDK_SCROLL_LEFT;
+				break;
+			case CDK_SCROLL_LEFT:
+				absolute_direction = CDK_SCROLL_RIGHT;
+				break;
+			default:
+				break;
+		}
+	}
+
+	/* keep going from the workspace we are about to switch to, unless
+	 * the window manager did not follow the last switch */
+	if (pager->scroll_target < 0 ||
+	    (pager->scroll_tick_id == 0 &&
+	     g_get_monotonic_time() - pager->scroll_sent > SCROLL_CONFIRM_TIMEOUT))
+		pager->scroll_target = vnck_workspace_get_number(vnck_screen_get_active_workspace(pager->screen));
+
+	pager->scroll_target = pager_scroll_step(pager, pager->scroll_target, absolute_direction);
+	pager->scroll_time = event->time;
+
+	if (pager->scroll_tick_id == 0)
+		pager->scroll_tick_id = ctk_widget_add_tick_callback(pager->pager, pager_scroll_flush, pager, NULL);
+
+	ctk_widget_queue_draw(pager->pager);
 
 	return TRUE;
 }
 
+static gboolean pager_draw_scroll_target (CtkWidget *widget,
+					  cairo_t   *cr,
+					  PagerData *pager)
+{
+	int n_workspaces;
+	int per_row;
+	int row, col;
+	int width, height;
+	int cell_width, cell_height;
+	int x;
+
+	/* the pager only highlights the workspace the window manager
+	 * says is active; show where the scroll is going meanwhile */
+	if (pager->scroll_target < 0 || !pager->display_all || !pager->screen)
+		return FALSE;
+
+	if (pager->scroll_target == vnck_workspace_get_number(vnck_screen_get_active_workspace(pager->screen)))
+		return FALSE;
+
+	n_workspaces = vnck_screen_get_workspace_count(pager->screen);
+	if (pager->scroll_target >= n_workspaces)
+		return FALSE;
+
+	/* the same grid as VnckPager */
+	per_row = (n_workspaces + pager->n_rows - 1) / pager->n_rows;
+	width = ctk_widget_get_allocated_width(widget);
+	height = ctk_widget_get_allocated_height(widget);
+
+	if (pager->orientation == CTK_ORIENTATION_VERTICAL)
+	{
+		col = pager->scroll_target / per_row;
+		row = pager->scroll_target % per_row;
+		cell_width = width / pager->n_rows;
+		cell_height = height / per_row;
+	}
+	else
+	{
+		row = pager->scroll_target / per_row;
+		col = pager->scroll_target % per_row;
+		cell_width = width / per_row;
+		cell_height = height / pager->n_rows;
+	}
+
+	x = col * cell_width;
+	if (ctk_widget_get_direction(widget) == CTK_TEXT_DIR_RTL)
+		x = width - x - cell_width;
+
+	ctk_render_focus(ctk_widget_get_style_context(widget), cr,
+			 x, row * cell_height, cell_width, cell_height);
+
+	return FALSE;
+}
+
 static const CtkActionEntry pager_menu_actions[] = {
 	{
 		"PagerPreferences",
@@ -532,6 +696,7 @@ gboolean workspace_switcher_applet_fill(CafePanelApplet* applet)
 	gboolean display_names;
 
 	pager = g_new0(PagerData, 1);
+	pager->scroll_target = -1;
 
 	pager->applet = CTK_WIDGET(applet);
 
@@ -586,6 +751,7 @@ gboolean workspace_switcher_applet_fill(CafePanelApplet* applet)
 
 	/* overwrite default VnckPager widget scroll-event */
 	g_signal_connect(G_OBJECT(pager->pager), "scroll-event", G_CALLBACK(applet_scroll), pager);
+	g_signal_connect_after(G_OBJECT(pager->pager), "draw", G_CALLBACK(pager_draw_scroll_target), pager);
 
 	ctk_container_add(CTK_CONTAINER(pager->applet), pager->pager);
 
@@ -1038,9 +1204,15 @@ static void display_properties_dialog (CtkAction *action G_GNUC_UNUSED,
 	ctk_window_present(CTK_WINDOW(pager->properties_dialog));
 }
 
-static void destroy_pager (CtkWidget *widget G_GNUC_UNUSED,
+static void destroy_pager (CtkWidget *widget,
 			   PagerData *pager)
 {
+	if (pager->scroll_tick_id)
+		ctk_widget_remove_tick_callback (widget, pager->scroll_tick_id);
+
+	if (pager->scroll_confirm_id)
+		g_source_remove (pager->scroll_confirm_id);
+
 	g_signal_handlers_disconnect_by_data (pager->settings, pager);
 
 	g_object_unref (pager->settings);
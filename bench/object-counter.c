@@ -0,0 +1,134 @@
+/*
+ * object-counter.c: count the objects of one GObject type that the
+ * processes it is preloaded into create
+ *
+ * Copyright (C) 2026 CAFE developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * Built and preloaded by panel-bench.py, like tzset-counter.c. The
+ * type is named by $OBJECT_COUNTER_TYPE, and each process keeps its
+ * count in a file of $OBJECT_COUNTER_DIR named after its pid and
+ * command. Only the objects created with g_object_new() from another
+ * library or program are seen, which is how the applets create their
+ * widgets.
+ *
+ * It is built without the GLib headers: GType is a gsize.
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef size_t GType;
+
+static void *            (*real_g_object_new_valist) (GType       object_type,
+						      const char *first_property_name,
+						      va_list     var_args);
+static GType             (*real_g_type_from_name)    (const char *name);
+static const char        *counted_name;
+static GType              counted_type;
+static volatile uint64_t *counter;
+
+__attribute__((constructor))
+static void
+counter_init (void)
+{
+	const char *dir;
+	char        comm[64] = "unknown";
+	char        path[PATH_MAX];
+	void       *map;
+	FILE       *f;
+	int         fd;
+
+	dir = getenv ("OBJECT_COUNTER_DIR");
+	counted_name = getenv ("OBJECT_COUNTER_TYPE");
+	if (dir == NULL || counted_name == NULL)
+		return;
+
+	f = fopen ("/proc/self/comm", "r");
+	if (f != NULL) {
+		if (fgets (comm, sizeof (comm), f) != NULL)
+			comm[strcspn (comm, "\n")] = '\0';
+		fclose (f);
+	}
+
+	snprintf (path, sizeof (path), "%s/%d.%s", dir, (int) getpid (), comm);
+	fd = open (path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return;
+
+	if (ftruncate (fd, sizeof (uint64_t)) == 0) {
+		map = mmap (NULL, sizeof (uint64_t), PROT_READ | PROT_WRITE,
+			    MAP_SHARED, fd, 0);
+		if (map != MAP_FAILED)
+			counter = map;
+	}
+
+	close (fd);
+}
+
+static int
+is_counted_type (GType object_type)
+{
+	if (counter == NULL)
+		return 0;
+
+	/* the type is registered when the first object is created */
+	if (counted_type == 0) {
+		if (real_g_type_from_name == NULL)
+			real_g_type_from_name = (GType (*) (const char *))
+				dlsym (RTLD_NEXT, "g_type_from_name");
+		if (real_g_type_from_name != NULL)
+			counted_type = real_g_type_from_name (counted_name);
+	}
+
+	return counted_type != 0 && object_type == counted_type;
+}
+
+void *
+g_object_new (GType       object_type,
+	      const char *first_property_name,
+	      ...)
+{
+	va_list  var_args;
+	void    *object;
+
+	/* GObject is loaded by then, even in the processes that did not
+	 * link it when the constructor ran */
+	if (real_g_object_new_valist == NULL)
+		real_g_object_new_valist = (void * (*) (GType, const char *, va_list))
+			dlsym (RTLD_NEXT, "g_object_new_valist");
+
+	if (is_counted_type (object_type))
+		__atomic_fetch_add (counter, 1, __ATOMIC_RELAXED);
+
+	va_start (var_args, first_property_name);
+	object = real_g_object_new_valist (object_type, first_property_name, var_args);
+	va_end (var_args);
+
+	return object;
+}
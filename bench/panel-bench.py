@@ -0,0 +1,1617 @@
+#!/usr/bin/env python3
+#
+# panel-bench.py: headless performance benchmarks for cafe-panel
+#
+# Copyright (C) 2026 CAFE developers
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation; either version 2 of the
+# License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+
+"""Run cafe-panel through scripted scenarios and report JSON results.
+
+The panel runs against a private Xvfb server and a private session bus,
+with a throw-away home directory and the keyfile GSettings backend, so
+that nothing leaks from or into the session of the user running it.
+The applet factories are D-Bus activated from the installation prefix.
+
+For each scenario the results hold the wall time until the panel went
+idle again, the percentiles of the main loop latency measured with
+_NET_WM_PING round trips while the scenario ran, the resident memory
+of the panel and, when xtrace is available, the number of X requests
+that needed a reply.
+
+The scenarios that synthesize input or talk the X protocol directly
+need python-xlib; they are skipped (and reported as such) without it.
+"""
+
+import argparse
+import configparser
+import glob
+import json
+import os
+import re
+import shutil
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+try:
+    from Xlib import X, Xatom, display as xdisplay, error as xerror
+    from Xlib.ext import xtest
+    from Xlib.protocol import event as xevent
+    HAVE_XLIB = True
+except ImportError:
+    HAVE_XLIB = False
+
+SETTLE_QUIET = 0.3      # seconds without CPU use for the panel to be idle
+SETTLE_POLL = 0.02
+SETTLE_TIMEOUT = 60.0
+PING_INTERVAL = 0.01
+
+DBUS_CONFIG = """<!DOCTYPE busconfig PUBLIC "-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN"
+ "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+<busconfig>
+  <type>session</type>
+  <listen>unix:tmpdir={tmpdir}</listen>
+  <servicedir>{servicedir}</servicedir>
+  <policy context="default">
+    <allow send_destination="*" eavesdrop="true"/>
+    <allow eavesdrop="true"/>
+    <allow own="*"/>
+  </policy>
+</busconfig>
+"""
+
+# time zones the clock-locations scenario cycles through
+BENCH_TIMEZONES = ["Europe/Paris", "America/New_York", "Asia/Tokyo",
+                   "Australia/Sydney", "America/Sao_Paulo", "Africa/Cairo",
+                   "Asia/Kolkata", "Pacific/Auckland", "America/Los_Angeles",
+                   "Europe/Moscow"]
+
+# the properties the panel sets once it is registered
+SM_INITIAL_PROPERTIES = ["Program", "CloneCommand", "RestartCommand", "UserID",
+                         "ProcessID", "RestartStyleHint"]
+
+LAUNCHER_DESKTOP = """[Desktop Entry]
+Type=Application
+Name=Bench Launcher {index}
+Exec=true
+Icon=application-x-executable
+"""
+
+# the add-to-panel scenario lists a known set of applets and menu items
+ADDTO_APPLET_FACTORY = """[Applet Factory]
+Id=BenchAppletFactory
+InProcess=false
+Name=Bench applet factory
+Description=Applets of the add-to-panel benchmark
+"""
+
+ADDTO_APPLET = """
+[BenchApplet{index}]
+Name=Bench Applet {index}
+Description=Applet {index} of the add-to-panel benchmark
+Icon=application-x-executable
+"""
+
+ADDTO_MENU = """<!DOCTYPE Menu PUBLIC "-//freedesktop//DTD Menu 1.0//EN"
+ "http://www.freedesktop.org/standards/menu-spec/1.0/menu.dtd">
+<Menu>
+  <Name>{name}</Name>
+{submenus}</Menu>
+"""
+
+ADDTO_SUBMENU = """  <Menu>
+    <Name>{name}</Name>
+    <AppDir>{appdir}</AppDir>
+    <Include><All/></Include>
+  </Menu>
+"""
+
+
+# the wheel buttons, and the order the workspace-scroll scenario spins
+# the wheel in: down twice, so that it wraps
+SCROLL_BUTTONS = {"up": 4, "down": 5, "left": 6, "right": 7}
+SCROLL_BURSTS = ["down", "right", "down", "left", "up"]
+
+
+def percentiles(samples):
+    if not samples:
+        return None
+
+    samples = sorted(samples)
+
+    def at(fraction):
+        return round(samples[min(len(samples) - 1, int(fraction * len(samples)))] * 1000.0, 3)
+
+    return {
+        "samples": len(samples),
+        "p50": at(0.50),
+        "p90": at(0.90),
+        "p99": at(0.99),
+        "max": round(samples[-1] * 1000.0, 3),
+    }
+
+
+def scroll_step(index, direction, n_workspaces, n_rows):
+    """Where the workspace switcher goes from index on a wheel click.
+
+    A copy of pager_scroll_step() in the workspace switcher, with the
+    workspaces wrapping around.
+    """
+    n_columns = n_workspaces // n_rows
+    if n_workspaces % n_rows != 0:
+        n_columns += 1
+    in_last_row = n_workspaces % n_columns
+    index = min(index, n_workspaces - 1)
+
+    if direction == "down":
+        if index + n_columns < n_workspaces:
+            index += n_columns
+        elif index == n_workspaces - 1:
+            index = 0
+        elif ((index < n_workspaces - 1 and index + in_last_row != n_workspaces - 1) or
+              (index == n_workspaces - 1 and in_last_row != 0)):
+            index = (index % n_columns) + 1
+    elif direction == "right":
+        index = index + 1 if index < n_workspaces - 1 else 0
+    elif direction == "up":
+        if index - n_columns >= 0:
+            index -= n_columns
+        elif index > 0:
+            index = ((n_rows - 1) * n_columns) + (index % n_columns) - 1
+        else:
+            index = n_workspaces - 1
+        if index >= n_workspaces:
+            index -= n_columns
+    elif direction == "left":
+        index = index - 1 if index > 0 else n_workspaces - 1
+
+    return index
+
+
+class PanelProcess:
+    def __init__(self, proc):
+        self.proc = proc
+
+    @property
+    def pid(self):
+        return self.proc.pid
+
+    def cpu_ticks(self):
+        with open("/proc/%d/stat" % self.pid) as f:
+            fields = f.read().rsplit(")", 1)[1].split()
+        # utime and stime, fields 14 and 15 of the full line
+        return int(fields[11]) + int(fields[12])
+
+    def memory(self):
+        result = {}
+        with open("/proc/%d/status" % self.pid) as f:
+            for line in f:
+                if line.startswith("VmRSS:"):
+                    result["rss_kb"] = int(line.split()[1])
+                elif line.startswith("VmHWM:"):
+                    result["peak_rss_kb"] = int(line.split()[1])
+        return result
+
+    def wait_settled(self, since):
+        """Wait for the panel to stop using CPU, return the time it went idle."""
+        deadline = since + SETTLE_TIMEOUT
+        last_ticks = self.cpu_ticks()
+        last_change = since
+
+        while time.monotonic() < deadline:
+            if self.proc.poll() is not None:
+                raise RuntimeError("cafe-panel exited with status %d" % self.proc.returncode)
+
+            time.sleep(SETTLE_POLL)
+            now = time.monotonic()
+            ticks = self.cpu_ticks()
+            if ticks != last_ticks:
+                last_ticks = ticks
+                last_change = now
+            elif now - last_change >= SETTLE_QUIET:
+                return last_change
+
+        raise RuntimeError("cafe-panel did not settle within %d seconds" % SETTLE_TIMEOUT)
+
+
+class PingProbe(threading.Thread):
+    """Measure the main loop latency of the panel.
+
+    CDK answers _NET_WM_PING from its event filter, so the round trip
+    time of a ping sent to a panel toplevel is the time the main loop
+    needed to get back to dispatching X events.
+    """
+
+    def __init__(self, display_name, window_id):
+        threading.Thread.__init__(self, daemon=True)
+        self.display = xdisplay.Display(display_name)
+        self.window = self.display.create_resource_object("window", window_id)
+        self.root = self.display.screen().root
+        self.root.change_attributes(event_mask=X.SubstructureNotifyMask)
+        self.wm_protocols = self.display.intern_atom("WM_PROTOCOLS")
+        self.net_wm_ping = self.display.intern_atom("_NET_WM_PING")
+        self.samples = []
+        self.stopping = threading.Event()
+
+    def ping_once(self, serial):
+        ev = xevent.ClientMessage(window=self.window,
+                                  client_type=self.wm_protocols,
+                                  data=(32, [self.net_wm_ping, serial,
+                                             self.window.id, 0, 0]))
+        start = time.monotonic()
+        self.window.send_event(ev, event_mask=0)
+        self.display.flush()
+
+        while not self.stopping.is_set():
+            if self.display.pending_events() == 0:
+                time.sleep(0.0005)
+                continue
+            reply = self.display.next_event()
+            if (reply.type == X.ClientMessage and
+                    reply.client_type == self.wm_protocols and
+                    reply.data[1][1] == serial):
+                return time.monotonic() - start
+        return None
+
+    def run(self):
+        serial = 1
+        while not self.stopping.is_set():
+            latency = self.ping_once(serial)
+            if latency is not None:
+                self.samples.append(latency)
+            serial += 1
+            time.sleep(PING_INTERVAL)
+
+    def stop(self):
+        self.stopping.set()
+        self.join()
+        self.display.close()
+        return percentiles(self.samples)
+
+
+class StubSessionManager(threading.Thread):
+    """Stand in for a busy XSMP session manager.
+
+    Clients are accepted on a local ICE socket and go through the ICE
+    connection and protocol setup at once, but the reply to their
+    RegisterClient is held for the delay: the panel has to cope with a
+    registration that takes that long. The stub then sends the initial
+    SaveYourself, as session managers do, and records the properties
+    the client sets.
+
+    Only what libICE and libSM send to a new client without any
+    authentication data is understood.
+    """
+
+    # ICE core messages
+    ICE_BYTE_ORDER = 1
+    ICE_CONNECTION_SETUP = 2
+    ICE_CONNECTION_REPLY = 6
+    ICE_PROTOCOL_SETUP = 7
+    ICE_PROTOCOL_REPLY = 8
+    ICE_PING = 9
+    ICE_PING_REPLY = 10
+
+    # XSMP messages
+    SM_REGISTER_CLIENT = 1
+    SM_REGISTER_CLIENT_REPLY = 2
+    SM_SAVE_YOURSELF = 3
+    SM_CLOSE_CONNECTION = 11
+    SM_SET_PROPERTIES = 12
+
+    def __init__(self, path, delay):
+        threading.Thread.__init__(self, daemon=True)
+        self.delay = delay
+        self.listener = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.listener.bind(path)
+        self.listener.listen(4)
+        self.address = "local/%s:%s" % (socket.gethostname(), path)
+        self.connected = None
+        self.handshake_done = None
+        # (time, names) of each SetProperties
+        self.properties = []
+        # the byte order of the client; the stub uses its own
+        self.order = "<"
+        self.xsmp_opcode = None
+
+    # ICE encoding: strings are padded to 32 bits, arrays and whole
+    # messages to 64 bits
+
+    @staticmethod
+    def pad(length, unit):
+        return (unit - length % unit) % unit
+
+    def ice_string(self, text):
+        data = struct.pack("=H", len(text)) + text
+        return data + b"\0" * self.pad(len(data), 4)
+
+    def array8(self, data):
+        data = struct.pack("=I", len(data)) + data
+        return data + b"\0" * self.pad(len(data), 8)
+
+    def send(self, conn, major, minor, data0=0, data1=0, body=b""):
+        body += b"\0" * self.pad(len(body), 8)
+        conn.sendall(struct.pack("=BBBBI", major, minor, data0, data1,
+                                 len(body) // 8) + body)
+
+    def receive(self, conn):
+        header = self.read(conn, 8)
+        if header is None:
+            return None
+        major, minor = header[0], header[1]
+        if major == 0 and minor == self.ICE_BYTE_ORDER:
+            # IceLSBfirst is 0, IceMSBfirst is 1
+            self.order = "<" if header[2] == 0 else ">"
+        length = struct.unpack(self.order + "I", header[4:8])[0]
+        body = self.read(conn, length * 8)
+        if body is None:
+            return None
+        return major, minor, header[2], body
+
+    @staticmethod
+    def read(conn, size):
+        data = b""
+        while len(data) < size:
+            chunk = conn.recv(size - len(data))
+            if not chunk:
+                return None
+            data += chunk
+        return data
+
+    def property_names(self, body):
+        names = []
+        count = struct.unpack(self.order + "I", body[0:4])[0]
+        offset = 8
+
+        def array8(offset):
+            length = struct.unpack(self.order + "I", body[offset:offset + 4])[0]
+            data = body[offset + 4:offset + 4 + length]
+            return data, offset + 4 + length + self.pad(4 + length, 8)
+
+        for _ in range(count):
+            name, offset = array8(offset)
+            _, offset = array8(offset)
+            values = struct.unpack(self.order + "I", body[offset:offset + 4])[0]
+            offset += 8
+            for _ in range(values):
+                _, offset = array8(offset)
+            names.append(name.decode(errors="replace"))
+        return names
+
+    def serve(self, conn):
+        byte_order = 0 if sys.byteorder == "little" else 1
+        conn.sendall(struct.pack("=BBBBI", 0, self.ICE_BYTE_ORDER, byte_order, 0, 0))
+
+        while True:
+            message = self.receive(conn)
+            if message is None:
+                return
+            major, minor, data0, body = message
+            vendor = self.ice_string(b"panel-bench") + self.ice_string(b"1.0")
+
+            # the first version the client offers is the one taken
+            if major == 0 and minor == self.ICE_CONNECTION_SETUP:
+                self.send(conn, 0, self.ICE_CONNECTION_REPLY, body=vendor)
+            elif major == 0 and minor == self.ICE_PROTOCOL_SETUP:
+                # the client picks the major opcode of XSMP
+                self.xsmp_opcode = data0
+                self.send(conn, 0, self.ICE_PROTOCOL_REPLY, body=vendor)
+            elif major == 0 and minor == self.ICE_PING:
+                self.send(conn, 0, self.ICE_PING_REPLY)
+            elif major == self.xsmp_opcode and minor == self.SM_REGISTER_CLIENT:
+                time.sleep(self.delay)
+                self.send(conn, major, self.SM_REGISTER_CLIENT_REPLY,
+                          body=self.array8(b"1bench%d" % os.getpid()))
+                if self.handshake_done is None:
+                    self.handshake_done = time.monotonic()
+                # SmSaveLocal, no shutdown, SmInteractStyleNone, not fast
+                self.send(conn, major, self.SM_SAVE_YOURSELF,
+                          body=struct.pack("BBBB4x", 1, 0, 0, 0))
+            elif major == self.xsmp_opcode and minor == self.SM_SET_PROPERTIES:
+                self.properties.append((time.monotonic(), self.property_names(body)))
+            elif major == self.xsmp_opcode and minor == self.SM_CLOSE_CONNECTION:
+                return
+
+    def run(self):
+        while True:
+            try:
+                conn, _ = self.listener.accept()
+            except OSError:
+                return
+            if self.connected is None:
+                self.connected = time.monotonic()
+            try:
+                self.serve(conn)
+            except OSError:
+                pass
+            conn.close()
+
+    def stop(self):
+        self.listener.close()
+
+
+class StubWindowManager(threading.Thread):
+    """Stand in for the workspace side of an EWMH window manager.
+
+    It advertises a number of desktops, and follows and counts the
+    _NET_CURRENT_DESKTOP requests that clients send to the root window.
+    Windows are left alone, nothing is redirected.
+    """
+
+    def __init__(self, display_name, n_desktops):
+        threading.Thread.__init__(self, daemon=True)
+        self.display = xdisplay.Display(display_name)
+        self.root = self.display.screen().root
+        self.net_current_desktop = self.display.intern_atom("_NET_CURRENT_DESKTOP")
+        self.requests = 0
+        self.current = 0
+        self.stopping = threading.Event()
+
+        atom = self.display.intern_atom
+        supported = [self.net_current_desktop, atom("_NET_NUMBER_OF_DESKTOPS"),
+                     atom("_NET_SUPPORTING_WM_CHECK")]
+
+        self.check = self.root.create_window(-1, -1, 1, 1, 0, X.CopyFromParent,
+                                             override_redirect=1)
+        for window in (self.root, self.check):
+            window.change_property(atom("_NET_SUPPORTING_WM_CHECK"), Xatom.WINDOW,
+                                   32, [self.check.id])
+        self.check.change_property(atom("_NET_WM_NAME"), atom("UTF8_STRING"),
+                                   8, b"panel-bench")
+        self.root.change_property(atom("_NET_SUPPORTED"), Xatom.ATOM, 32, supported)
+        self.root.change_property(atom("_NET_NUMBER_OF_DESKTOPS"), Xatom.CARDINAL,
+                                  32, [n_desktops])
+        self.root.change_property(self.net_current_desktop, Xatom.CARDINAL, 32, [0])
+        self.root.change_attributes(event_mask=X.SubstructureNotifyMask)
+        self.display.flush()
+
+    def run(self):
+        while not self.stopping.is_set():
+            if self.display.pending_events() == 0:
+                time.sleep(0.001)
+                continue
+            ev = self.display.next_event()
+            if (ev.type == X.ClientMessage and
+                    ev.client_type == self.net_current_desktop):
+                self.requests += 1
+                self.current = ev.data[1][0]
+                self.root.change_property(self.net_current_desktop, Xatom.CARDINAL,
+                                          32, [self.current])
+                self.display.flush()
+
+    def stop(self):
+        self.stopping.set()
+        self.join()
+        self.check.destroy()
+        self.display.close()
+
+
+class Session:
+    def __init__(self, args):
+        self.args = args
+        self.tmpdir = tempfile.mkdtemp(prefix="panel-bench-")
+        self.children = []
+        self.panel = None
+        self.env = None
+        self.display_name = None
+        self.xtrace_log = None
+        self.session_manager = None
+        self.tzset_dir = None
+        self.tile_dir = None
+        self.addto_applets = 0
+        self.addto_menu_rows = 0
+
+    # environment
+
+    def start(self):
+        display_number = self.find_free_display()
+        self.display_name = ":%d" % display_number
+
+        self.spawn(["Xvfb", self.display_name,
+                    "-screen", "0", "%sx24" % self.args.screen,
+                    "-nolisten", "tcp", "-noreset"])
+        self.wait_for(lambda: os.path.exists("/tmp/.X11-unix/X%d" % display_number),
+                      "Xvfb")
+
+        home = os.path.join(self.tmpdir, "home")
+        env = dict(os.environ)
+        for key in ("SESSION_MANAGER", "DESKTOP_AUTOSTART_ID", "WAYLAND_DISPLAY"):
+            env.pop(key, None)
+        env.update({
+            "DISPLAY": self.display_name,
+            "HOME": home,
+            "XDG_CONFIG_HOME": os.path.join(home, ".config"),
+            "XDG_DATA_HOME": os.path.join(home, ".local", "share"),
+            "XDG_CACHE_HOME": os.path.join(home, ".cache"),
+            "XDG_RUNTIME_DIR": os.path.join(self.tmpdir, "runtime"),
+            "GSETTINGS_BACKEND": "keyfile",
+            "NO_AT_BRIDGE": "1",
+        })
+        self.write_addto_data(env)
+        schemas = os.path.join(self.args.prefix, "share", "glib-2.0", "schemas")
+        if os.path.isdir(schemas):
+            env["GSETTINGS_SCHEMA_DIR"] = schemas
+        for directory in (home, env["XDG_CONFIG_HOME"], env["XDG_DATA_HOME"],
+                          env["XDG_CACHE_HOME"], env["XDG_RUNTIME_DIR"]):
+            os.makedirs(directory, mode=0o700, exist_ok=True)
+
+        config = os.path.join(self.tmpdir, "session.conf")
+        with open(config, "w") as f:
+            f.write(DBUS_CONFIG.format(tmpdir=self.tmpdir,
+                                       servicedir=os.path.join(self.args.prefix, "share", "dbus-1", "services")))
+        bus = self.spawn(["dbus-daemon", "--config-file=" + config,
+                          "--nofork", "--print-address=1"],
+                         env=env, stdout=subprocess.PIPE)
+        env["DBUS_SESSION_BUS_ADDRESS"] = bus.stdout.readline().decode().strip()
+
+        if self.args.sm_delay > 0:
+            self.session_manager = StubSessionManager(os.path.join(self.tmpdir, "ice-sm"),
+                                                      self.args.sm_delay)
+            self.session_manager.start()
+            env["SESSION_MANAGER"] = self.session_manager.address
+
+        if self.args.count_tzset:
+            self.tzset_dir = self.preload_counter(env, "tzset-counter",
+                                                  "TZSET_COUNTER_DIR")
+            self.tile_dir = self.preload_counter(env, "object-counter",
+                                                 "OBJECT_COUNTER_DIR")
+            env["OBJECT_COUNTER_TYPE"] = "ClockLocationTile"
+
+        self.env = env
+
+    def write_addto_data(self, env):
+        installed = os.path.join(self.args.prefix, "share", "cafe-panel", "applets")
+        applets = os.path.join(self.tmpdir, "applets")
+        os.makedirs(applets)
+        env["CAFE_PANEL_APPLETS_DIR"] = installed + ":" + applets
+
+        with open(os.path.join(applets, "bench.cafe-panel-applet"), "w") as f:
+            f.write(ADDTO_APPLET_FACTORY)
+            for i in range(self.args.addto_applets):
+                f.write(ADDTO_APPLET.format(index=i))
+
+        # the dialog lists the installed applets too
+        self.addto_applets = self.args.addto_applets
+        for path in glob.glob(os.path.join(installed, "*.cafe-panel-applet")):
+            parser = configparser.RawConfigParser(strict=False)
+            parser.optionxform = str
+            try:
+                parser.read(path)
+            except configparser.Error:
+                continue
+            self.addto_applets += sum(1 for group in parser.sections()
+                                      if group != "Applet Factory" and
+                                      "Name" in parser[group])
+
+        # the menus of the configuration home hide those of the system;
+        # the settings menu gets a single directory
+        menus = os.path.join(env["XDG_CONFIG_HOME"], "menus")
+        os.makedirs(menus)
+        for menu, directories in (("cafe-applications", self.args.addto_menus),
+                                  ("cafe-settings", 1)):
+            submenus = ""
+            for i in range(directories):
+                appdir = os.path.join(self.tmpdir, "addto", menu, str(i))
+                os.makedirs(appdir)
+                for j in range(self.args.addto_entries):
+                    with open(os.path.join(appdir, "bench-%d.desktop" % j), "w") as f:
+                        f.write(LAUNCHER_DESKTOP.format(index="%s %d.%d" % (menu, i, j)))
+                submenus += ADDTO_SUBMENU.format(name="Bench %d" % i, appdir=appdir)
+                self.addto_menu_rows += 1 + self.args.addto_entries
+
+            with open(os.path.join(menus, menu + ".menu"), "w") as f:
+                f.write(ADDTO_MENU.format(name=menu, submenus=submenus))
+
+    def preload_counter(self, env, name, variable):
+        # every process of the session, the D-Bus activated applets
+        # included, keeps its count in the directory returned
+        compiler = shutil.which("cc")
+        if not compiler:
+            return None
+        library = os.path.join(self.tmpdir, name + ".so")
+        source = os.path.join(os.path.dirname(os.path.abspath(__file__)), name + ".c")
+        if subprocess.call([compiler, "-shared", "-fPIC", "-O2", "-o", library,
+                            source, "-ldl"]) != 0:
+            return None
+
+        directory = os.path.join(self.tmpdir, name)
+        os.makedirs(directory)
+        env[variable] = directory
+        env["LD_PRELOAD"] = " ".join(filter(None, [env.get("LD_PRELOAD"), library]))
+        return directory
+
+    def counted(self, directory, command=None):
+        total = 0
+        for name in os.listdir(directory):
+            if command and not name.split(".", 1)[-1].startswith(command[:15]):
+                continue
+            with open(os.path.join(directory, name), "rb") as f:
+                data = f.read(8)
+            if len(data) == 8:
+                total += struct.unpack("=Q", data)[0]
+        return total
+
+    def tzset_calls(self, command=None):
+        return self.counted(self.tzset_dir, command)
+
+    def tiles_created(self, command=None):
+        return self.counted(self.tile_dir, command)
+
+    def stop(self):
+        if self.session_manager:
+            self.session_manager.stop()
+        for proc in reversed(self.children):
+            if proc.poll() is None:
+                proc.send_signal(signal.SIGTERM)
+                try:
+                    proc.wait(timeout=5)
+                except subprocess.TimeoutExpired:
+                    proc.kill()
+                    proc.wait()
+        shutil.rmtree(self.tmpdir, ignore_errors=True)
+
+    def find_free_display(self):
+        for number in range(99, 200):
+            if not os.path.exists("/tmp/.X%d-lock" % number):
+                return number
+        raise RuntimeError("no free X display number")
+
+    def spawn(self, argv, **kwargs):
+        kwargs.setdefault("stdout", subprocess.DEVNULL)
+        kwargs.setdefault("stderr", None if self.args.verbose else subprocess.DEVNULL)
+        proc = subprocess.Popen(argv, **kwargs)
+        self.children.append(proc)
+        return proc
+
+    def wait_for(self, predicate, what, timeout=SETTLE_TIMEOUT, poll=SETTLE_POLL):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            if predicate():
+                return time.monotonic()
+            time.sleep(poll)
+        raise RuntimeError("timed out waiting for %s" % what)
+
+    def gsettings(self, *args):
+        return subprocess.check_output(["gsettings"] + list(args),
+                                       env=self.env).decode().strip()
+
+    # layout
+
+    def write_layout(self):
+        launchers = os.path.join(self.tmpdir, "launchers")
+        os.makedirs(launchers)
+
+        path = os.path.join(self.tmpdir, "bench.layout")
+        orientations = ["top", "bottom", "left", "right"]
+        with open(path, "w") as f:
+            for i in range(self.args.toplevels):
+                f.write("[Toplevel bench%d]\nexpand=true\norientation=%s\nsize=24\n\n"
+                        % (i, orientations[i % len(orientations)]))
+
+            f.write("[Object notification-area]\nobject-type=applet\n"
+                    "applet-iid=NotificationAreaAppletFactory::NotificationArea\n"
+                    "toplevel-id=bench0\nposition=0\npanel-right-stick=true\n\n")
+            f.write("[Object clock]\nobject-type=applet\n"
+                    "applet-iid=ClockAppletFactory::ClockApplet\n"
+                    "toplevel-id=bench0\nposition=200\npanel-right-stick=true\n\n")
+
+            for i in range(self.args.launchers):
+                desktop = os.path.join(launchers, "bench-%d.desktop" % i)
+                with open(desktop, "w") as d:
+                    d.write(LAUNCHER_DESKTOP.format(index=i))
+                f.write("[Object launcher%d]\nobject-type=launcher\n"
+                        "launcher-location=%s\ntoplevel-id=bench%d\nposition=%d\n\n"
+                        % (i, desktop, i % self.args.toplevels,
+                           (i // self.args.toplevels) * 24))
+        return path
+
+    # panel
+
+    def start_panel(self):
+        argv = [os.path.join(self.args.prefix, "bin", "cafe-panel")]
+        env = dict(self.env)
+
+        if self.args.xtrace and shutil.which("xtrace"):
+            self.xtrace_log = os.path.join(self.tmpdir, "xtrace.log")
+            fake = ":%d" % (self.find_free_display() + 1)
+            argv = ["xtrace", "-n", "-d", self.display_name, "-D", fake,
+                    "-o", self.xtrace_log, "--"] + argv
+
+        self.panel = PanelProcess(self.spawn(argv, env=env))
+
+    def panel_stats(self, counter, reset=False):
+        # the sum of a counter over the toplevels, the applet frames
+        # and the panel itself, from the statistics the panel exports
+        # on the session bus
+        method = "Reset" if reset else "GetSnapshot"
+        output = subprocess.check_output(
+            ["gdbus", "call", "--session", "--dest", "org.cafe.Panel",
+             "--object-path", "/org/cafe/Panel/Stats",
+             "--method", "org.cafe.Panel.Stats." + method],
+            env=self.env).decode()
+        return sum(int(n) for n in
+                   re.findall(r"'%s': (?:uint64 )?(\d+)" % re.escape(counter), output))
+
+    def x_round_trips(self):
+        if not self.xtrace_log or not os.path.exists(self.xtrace_log):
+            return None
+        with open(self.xtrace_log, errors="replace") as f:
+            return sum(1 for line in f if " Reply to " in line)
+
+    def panel_windows(self, dpy, instance="cafe-panel"):
+        windows = []
+        for window in dpy.screen().root.query_tree().children:
+            try:
+                wm_class = window.get_wm_class()
+                attributes = window.get_attributes()
+            except xerror.XError:
+                continue
+            if (wm_class and wm_class[0] == instance and
+                    attributes.map_state == X.IsViewable):
+                windows.append(window)
+        return windows
+
+    def plug_window(self, dpy, instance):
+        # out of process applets are embedded somewhere below the
+        # panel toplevels
+        pending = self.panel_windows(dpy)
+        while pending:
+            window = pending.pop()
+            try:
+                wm_class = window.get_wm_class()
+                children = window.query_tree().children
+            except xerror.XError:
+                continue
+            if wm_class and wm_class[0] == instance:
+                return window
+            pending.extend(children)
+        return None
+
+
+class Bench:
+    def __init__(self, session):
+        self.session = session
+        self.results = []
+        self.failures = []
+        self.dpy = xdisplay.Display(session.display_name) if HAVE_XLIB else None
+        self.probe_window = None
+
+    def record(self, name, start, end, stalls, extra=None):
+        result = {
+            "name": name,
+            "wall_ms": round((end - start) * 1000.0, 3),
+            "stall_ms": stalls,
+            "x_round_trips": self.session.x_round_trips(),
+        }
+        result.update(self.session.panel.memory())
+        if extra:
+            result.update(extra)
+        self.results.append(result)
+        return result
+
+    def skip(self, name, reason):
+        self.results.append({"name": name, "skipped": reason})
+
+    def fail(self, name, reason):
+        # the results are still written out, but the run fails
+        self.failures.append("%s: %s" % (name, reason))
+
+    def measure(self, name, action, extra=None):
+        probe = None
+        if self.probe_window is not None:
+            probe = PingProbe(self.session.display_name, self.probe_window)
+            probe.start()
+
+        start = time.monotonic()
+        action()
+        end = self.session.panel.wait_settled(start)
+
+        stalls = probe.stop() if probe else None
+        return self.record(name, start, end, stalls, extra)
+
+    # scenarios
+
+    def cold_start(self):
+        layout = self.session.write_layout()
+        self.session.gsettings("set", "org.cafe.panel", "default-layout", layout)
+
+        extra = {"toplevels": self.session.args.toplevels,
+                 "launchers": self.session.args.launchers}
+
+        start = time.monotonic()
+        self.session.start_panel()
+        if self.dpy:
+            mapped = self.session.wait_for(
+                lambda: len(self.session.panel_windows(self.dpy)) >= self.session.args.toplevels,
+                "the panel toplevels")
+
+            # the toplevels must not wait for the session manager
+            sm = self.session.session_manager
+            if sm:
+                extra["mapped_before_sm_handshake"] = (sm.handshake_done is None or
+                                                       sm.handshake_done > mapped)
+                if not extra["mapped_before_sm_handshake"]:
+                    self.fail("cold-start", "the toplevels waited for the "
+                              "session manager")
+        end = self.session.panel.wait_settled(start)
+
+        # the properties set while the panel was registering are
+        # only sent once it is registered
+        sm = self.session.session_manager
+        if sm:
+            self.session.wait_for(lambda: sm.handshake_done is not None,
+                                  "the session manager registration")
+            try:
+                self.session.wait_for(lambda: sm.properties, "the session properties",
+                                      timeout=5.0)
+            except RuntimeError:
+                pass
+            names = set(n for _, props in sm.properties for n in props)
+            extra["sm_properties"] = sorted(names)
+            if any(when < sm.handshake_done for when, _ in sm.properties):
+                self.fail("cold-start", "properties were sent before the "
+                          "registration was over")
+            missing = set(SM_INITIAL_PROPERTIES) - names
+            if missing:
+                self.fail("cold-start", "the session manager did not get %s"
+                          % ", ".join(sorted(missing)))
+            self.session.panel.wait_settled(time.monotonic())
+
+        if self.dpy:
+            self.probe_window = self.session.panel_windows(self.dpy)[0].id
+
+        self.record("cold-start", start, end, None, extra)
+
+    def id_list(self, key):
+        ids = self.session.gsettings("get", "org.cafe.panel", key)
+        return [i.strip().strip("'") for i in ids.strip("[]@as ").split(",") if i.strip()]
+
+    def set_id_list(self, key, ids):
+        self.session.gsettings("set", "org.cafe.panel", key,
+                               "[%s]" % ", ".join("'%s'" % i for i in ids))
+
+    def toplevel_path(self):
+        first = self.id_list("toplevel-id-list")[0]
+        return "org.cafe.panel.toplevel:/org/cafe/panel/toplevels/%s/" % first
+
+    def resize_and_orientation(self):
+        schema = self.toplevel_path()
+
+        for size in ("48", "24"):
+            self.measure("resize-%s" % size,
+                         lambda: self.session.gsettings("set", schema, "size", size))
+
+        for orientation in ("left", "top"):
+            self.measure("orientation-%s" % orientation,
+                         lambda: self.session.gsettings("set", schema, "orientation", orientation))
+
+    def wallpaper(self):
+        if not self.dpy:
+            self.skip("wallpaper", "python-xlib is not available")
+            return
+
+        schema = self.toplevel_path().replace("org.cafe.panel.toplevel:",
+                                              "org.cafe.panel.toplevel.background:") + "background/"
+        self.session.gsettings("set", schema, "type", "color")
+        self.session.gsettings("set", schema, "color", "rgba(32,32,32,0.5)")
+        self.session.panel.wait_settled(time.monotonic())
+
+        screen = self.dpy.screen()
+        root = screen.root
+        xrootpmap = self.dpy.intern_atom("_XROOTPMAP_ID")
+        esetroot = self.dpy.intern_atom("ESETROOT_PMAP_ID")
+
+        def set_wallpaper(shade):
+            pixmap = root.create_pixmap(screen.width_in_pixels,
+                                        screen.height_in_pixels,
+                                        screen.root_depth)
+            gc = root.create_gc(foreground=shade)
+            pixmap.fill_rectangle(gc, 0, 0, screen.width_in_pixels, screen.height_in_pixels)
+            gc.free()
+            for atom in (xrootpmap, esetroot):
+                root.change_property(atom, Xatom.PIXMAP, 32, [pixmap.id])
+            self.dpy.flush()
+
+        for i, shade in enumerate((0x204a87, 0x4e9a06, 0xa40000)):
+            self.measure("wallpaper-%d" % i, lambda: set_wallpaper(shade))
+
+    def tray_icons(self):
+        if not self.dpy:
+            self.skip("tray-icons", "python-xlib is not available")
+            return
+
+        selection = self.dpy.intern_atom("_NET_SYSTEM_TRAY_S%d" % self.dpy.get_default_screen())
+        opcode = self.dpy.intern_atom("_NET_SYSTEM_TRAY_OPCODE")
+        xembed_info = self.dpy.intern_atom("_XEMBED_INFO")
+        root = self.dpy.screen().root
+
+        try:
+            self.session.wait_for(lambda: self.dpy.get_selection_owner(selection) != X.NONE,
+                                  "the notification area", timeout=10)
+        except RuntimeError:
+            self.skip("tray-icons", "no notification area owns the tray selection")
+            return
+
+        icons = []
+
+        def dock():
+            manager = self.dpy.get_selection_owner(selection)
+            for i in range(self.session.args.tray_icons):
+                icon = root.create_window(0, 0, 22, 22, 0, X.CopyFromParent,
+                                          background_pixel=0x3465a4 + i)
+                icon.change_property(xembed_info, xembed_info, 32, [0, 1])
+                ev = xevent.ClientMessage(window=manager, client_type=opcode,
+                                          data=(32, [X.CurrentTime, 0, icon.id, 0, 0]))
+                manager.send_event(ev, event_mask=X.NoEventMask)
+                icons.append(icon)
+            self.dpy.flush()
+
+            def all_docked():
+                for icon in icons:
+                    if icon.query_tree().parent.id == root.id:
+                        return False
+                return True
+            self.session.wait_for(all_docked, "the tray icons to dock")
+
+        self.measure("tray-icons", dock, {"icons": self.session.args.tray_icons})
+
+        for icon in icons:
+            icon.destroy()
+        self.dpy.flush()
+        self.session.panel.wait_settled(time.monotonic())
+
+    def run_dialog(self):
+        if not self.dpy:
+            self.skip("run-dialog", "python-xlib is not available")
+            return
+
+        root = self.dpy.screen().root
+        action = self.dpy.intern_atom("_CAFE_PANEL_ACTION")
+        run = self.dpy.intern_atom("_CAFE_PANEL_ACTION_RUN_DIALOG")
+        before = len(self.session.panel_windows(self.dpy))
+
+        def open_dialog():
+            ev = xevent.ClientMessage(window=root, client_type=action,
+                                      data=(32, [run, X.CurrentTime, 0, 0, 0]))
+            root.send_event(ev, event_mask=X.StructureNotifyMask)
+            self.dpy.flush()
+            self.session.wait_for(lambda: len(self.session.panel_windows(self.dpy)) > before,
+                                  "the run dialog")
+
+        self.measure("run-dialog-open", open_dialog)
+
+        def type_text():
+            for char in "cafe-terminal --help":
+                keycode = self.dpy.keysym_to_keycode(ord(char))
+                xtest.fake_input(self.dpy, X.KeyPress, keycode)
+                xtest.fake_input(self.dpy, X.KeyRelease, keycode)
+                self.dpy.flush()
+                time.sleep(0.03)
+
+        self.measure("run-dialog-typing", type_text)
+
+        escape = self.dpy.keysym_to_keycode(0xff1b)
+        xtest.fake_input(self.dpy, X.KeyPress, escape)
+        xtest.fake_input(self.dpy, X.KeyRelease, escape)
+        self.dpy.flush()
+        self.session.panel.wait_settled(time.monotonic())
+
+    def add_to_panel(self):
+        if not self.dpy:
+            self.skip("add-to-panel", "python-xlib is not available")
+            return
+
+        # the middle of the top panel is free: the launchers are packed
+        # at its start and the applets stick to its end
+        x = self.dpy.screen().width_in_pixels // 2
+        before = len(self.session.panel_windows(self.dpy))
+        extra = {"applets": self.session.addto_applets,
+                 "menu_rows": self.session.addto_menu_rows}
+
+        def type_keys(keysyms):
+            for keysym in keysyms:
+                keycode = self.dpy.keysym_to_keycode(keysym)
+                xtest.fake_input(self.dpy, X.KeyPress, keycode)
+                xtest.fake_input(self.dpy, X.KeyRelease, keycode)
+            self.dpy.flush()
+
+        def open_dialog():
+            start = time.monotonic()
+            xtest.fake_input(self.dpy, X.MotionNotify, x=x, y=12)
+            xtest.fake_input(self.dpy, X.ButtonPress, 3)
+            xtest.fake_input(self.dpy, X.ButtonRelease, 3)
+            self.dpy.flush()
+            time.sleep(0.2)
+
+            # "_Add to Panel…" is the first item of the context menu
+            type_keys([ord("a")])
+            mapped = self.session.wait_for(
+                lambda: len(self.session.panel_windows(self.dpy)) > before,
+                "the add to panel dialog", poll=0.001)
+            extra["map_ms"] = round((mapped - start) * 1000.0, 3)
+
+            # the internal applets are there from the start, the first
+            # row the producer adds is the first queried applet
+            first = self.session.wait_for(
+                lambda: self.session.panel_stats("addto-applet-rows") > 0,
+                "the first applet row", poll=0.001)
+            extra["first_row_ms"] = round((first - start) * 1000.0, 3)
+
+            # the search entry has the focus: select "Application
+            # Launcher..." through its description, and add it to get
+            # the menus walked
+            type_keys([ord(c) for c in "copy a launcher"] + [0xff0d])
+
+        self.session.panel_stats("addto-applet-rows", reset=True)
+
+        # the wall time runs until both lists are filled and the panel
+        # goes idle again
+        result = self.measure("add-to-panel", open_dialog, extra)
+
+        # every row is there, and only once
+        result["applet_rows_added"] = self.session.panel_stats("addto-applet-rows")
+        result["menu_rows_added"] = self.session.panel_stats("addto-menu-rows")
+        if result["applet_rows_added"] != result["applets"]:
+            self.fail("add-to-panel", "%d applet rows for %d applets"
+                      % (result["applet_rows_added"], result["applets"]))
+        if result["menu_rows_added"] != result["menu_rows"]:
+            self.fail("add-to-panel", "%d menu rows for %d menu items"
+                      % (result["menu_rows_added"], result["menu_rows"]))
+
+        type_keys([0xff1b])
+        self.session.panel.wait_settled(time.monotonic())
+
+    def launch_animation(self):
+        if not self.dpy:
+            self.skip("launch-animation", "python-xlib is not available")
+            return
+
+        self.session.gsettings("set", "org.cafe.panel", "enable-animations", "true")
+        self.session.panel.wait_settled(time.monotonic())
+
+        def launch():
+            # the first launcher of the top panel; its command is "true"
+            # so only the feedback animation costs anything
+            for i in range(self.session.args.launches):
+                xtest.fake_input(self.dpy, X.MotionNotify, x=12, y=12)
+                xtest.fake_input(self.dpy, X.ButtonPress, 1)
+                xtest.fake_input(self.dpy, X.ButtonRelease, 1)
+                self.dpy.flush()
+                time.sleep(0.25)
+
+        result = self.measure("launch-animation", launch,
+                              {"launches": self.session.args.launches})
+
+        limit = self.session.args.max_launch_stall_ms
+        if limit > 0 and result["stall_ms"] and result["stall_ms"]["max"] > limit:
+            self.fail("launch-animation",
+                      "the main loop stalled for %g ms, more than %g ms"
+                      % (result["stall_ms"]["max"], limit))
+
+    def launch_storm(self):
+        if not self.dpy:
+            self.skip("launch-storm", "python-xlib is not available")
+            return
+
+        self.session.gsettings("set", "org.cafe.panel", "enable-animations", "false")
+        self.session.panel.wait_settled(time.monotonic())
+
+        def launch():
+            # as many launches of "true" as the panel takes, with
+            # nothing but the spawning itself to slow it down
+            for i in range(self.session.args.storm_launches):
+                xtest.fake_input(self.dpy, X.MotionNotify, x=12, y=12)
+                xtest.fake_input(self.dpy, X.ButtonPress, 1)
+                xtest.fake_input(self.dpy, X.ButtonRelease, 1)
+                self.dpy.flush()
+                time.sleep(0.01)
+
+        self.measure("launch-storm", launch, {"launches": self.session.args.storm_launches})
+
+    def clock_click(self):
+        """Return a function clicking the clock, None without the clock."""
+        plug = self.session.plug_window(self.dpy, "clock-applet")
+        if plug is None:
+            return None
+
+        root = self.dpy.screen().root
+        geometry = plug.get_geometry()
+        origin = root.translate_coords(plug, 0, 0)
+        x = origin.x + geometry.width // 2
+        y = origin.y + geometry.height // 2
+
+        def click():
+            xtest.fake_input(self.dpy, X.MotionNotify, x=x, y=y)
+            xtest.fake_input(self.dpy, X.ButtonPress, 1)
+            xtest.fake_input(self.dpy, X.ButtonRelease, 1)
+            self.dpy.flush()
+        return click
+
+    def clock_popup_mapped(self):
+        return len(self.session.panel_windows(self.dpy, "clock-applet")) > 0
+
+    def clock_locations(self):
+        if not self.session.tzset_dir or not self.session.tile_dir:
+            self.skip("clock-locations", "the counters could not be built")
+            return
+        if not self.dpy:
+            self.skip("clock-locations", "python-xlib is not available")
+            return
+        click = self.clock_click()
+        if click is None:
+            self.skip("clock-locations", "the clock applet is not running")
+            return
+
+        count = self.session.args.clock_locations
+        schema = "org.cafe.panel.applet.clock:/org/cafe/panel/objects/clock/prefs/"
+
+        def city(i, name):
+            timezone = BENCH_TIMEZONES[i % len(BENCH_TIMEZONES)]
+            return ('<location name="" city="%s" timezone="%s" '
+                    'latitude="%f" longitude="%f" code="" current="false"/>'
+                    % (name, timezone, (i % 170) - 85.0, (i % 360) - 180.0))
+
+        def after_clock_tick():
+            # the open popup refreshes every tile when the clock ticks,
+            # at the start of each minute: keep the ticks out of the
+            # measurements
+            seconds = time.time() % 60
+            if not 1 <= seconds <= 30:
+                time.sleep(61 - seconds)
+            self.session.panel.wait_settled(time.monotonic())
+
+        def set_cities(name, cities):
+            after_clock_tick()
+            tzset_before = self.session.tzset_calls("clock-applet")
+            tiles_before = self.session.tiles_created("clock-applet")
+            value = "[%s]" % ", ".join("'%s'" % c for c in cities)
+
+            def set_locations():
+                self.session.gsettings("set", schema, "cities", value)
+                self.session.panel.wait_settled(time.monotonic())
+
+            result = self.measure(name, set_locations, {"locations": count})
+            result["tzset_calls"] = self.session.tzset_calls("clock-applet") - tzset_before
+            result["tiles_created"] = self.session.tiles_created("clock-applet") - tiles_before
+            return result
+
+        # the tiles are only kept up to date while the popup is shown
+        self.session.panel.wait_settled(time.monotonic())
+        time.sleep(1.0)
+        click()
+        self.session.wait_for(self.clock_popup_mapped, "the calendar popup")
+
+        cities = [city(i, "Bench City %d" % i) for i in range(count)]
+        result = set_cities("clock-locations", cities)
+
+        limit = self.session.args.max_tzset_per_location * count
+        if result["tzset_calls"] > limit:
+            self.fail("clock-locations", "%d tzset() calls for %d locations, more than %d"
+                      % (result["tzset_calls"], count, limit))
+        if result["tiles_created"] != count:
+            self.fail("clock-locations", "%d tiles created for %d locations"
+                      % (result["tiles_created"], count))
+
+        # a single location changes: only its tile is replaced
+        cities[count // 2] = city(count // 2, "Bench City changed")
+        result = set_cities("clock-location-change", cities)
+
+        limit = self.session.args.max_tzset_per_change
+        if result["tzset_calls"] > limit:
+            self.fail("clock-location-change", "%d tzset() calls, more than %d"
+                      % (result["tzset_calls"], limit))
+        if result["tiles_created"] != 1:
+            self.fail("clock-location-change", "%d tiles created for one location"
+                      % result["tiles_created"])
+
+        click()
+        self.session.wait_for(lambda: not self.clock_popup_mapped(),
+                              "the calendar popup to go away")
+        self.session.panel.wait_settled(time.monotonic())
+
+    def applet_drag(self):
+        if not self.dpy:
+            self.skip("applet-drag", "python-xlib is not available")
+            return
+
+        width = self.dpy.screen().width_in_pixels
+
+        def drag():
+            # the first launcher of the top panel, moved with the middle
+            # button all the way to the other end of the panel
+            xtest.fake_input(self.dpy, X.MotionNotify, x=12, y=12)
+            xtest.fake_input(self.dpy, X.ButtonPress, 2)
+            self.dpy.flush()
+            for x in range(12, width - 12, 8):
+                xtest.fake_input(self.dpy, X.MotionNotify, x=x, y=12)
+                self.dpy.flush()
+                time.sleep(0.002)
+            xtest.fake_input(self.dpy, X.ButtonRelease, 2)
+            self.dpy.flush()
+
+        self.measure("applet-drag", drag, {"panel_width": width})
+
+    def calendar_popup(self):
+        if not self.dpy:
+            self.skip("calendar-popup", "python-xlib is not available")
+            return
+
+        click = self.clock_click()
+        if click is None:
+            self.skip("calendar-popup", "the clock applet is not running")
+            return
+        popup_mapped = self.clock_popup_mapped
+
+        # the popup is built in an idle once the applet is up, give it
+        # the time to get there before the first click
+        self.session.panel.wait_settled(time.monotonic())
+        time.sleep(1.0)
+
+        extra = {"opens": self.session.args.calendar_opens}
+        latencies = []
+
+        def open_and_close():
+            for i in range(self.session.args.calendar_opens):
+                start = time.monotonic()
+                click()
+                mapped = self.session.wait_for(popup_mapped, "the calendar popup",
+                                               poll=0.001)
+                latencies.append(mapped - start)
+
+                click()
+                self.session.wait_for(lambda: not popup_mapped(),
+                                      "the calendar popup to go away")
+            extra["map_ms"] = percentiles(latencies)
+
+        self.measure("calendar-popup", open_and_close, extra)
+
+    def autohide_frames(self):
+        if not self.dpy:
+            self.skip("autohide-frames", "python-xlib is not available")
+            return
+        if not shutil.which("gdbus"):
+            self.skip("autohide-frames", "gdbus is not available")
+            return
+
+        # the toplevels draw their frame around the hide buttons, and
+        # are redrawn at every step of the autohide animation; the
+        # extra ones are spread along the top and bottom edges
+        args = self.session.args
+        original = self.id_list("toplevel-id-list")
+        extra_ids = ["bench-autohide%d" % i
+                     for i in range(max(args.autohide_toplevels - len(original), 0))]
+        width = self.dpy.screen().width_in_pixels
+        height = self.dpy.screen().height_in_pixels
+        slots = (len(extra_ids) + 1) // 2 + 1
+        settings = (("expand", "false"), ("auto-hide", "true"),
+                    ("enable-animations", "true"), ("enable-buttons", "true"),
+                    ("enable-arrows", "true"),
+                    ("hide-delay", "0"), ("unhide-delay", "0"))
+
+        for i, toplevel in enumerate(extra_ids):
+            schema = "org.cafe.panel.toplevel:/org/cafe/panel/toplevels/%s/" % toplevel
+            for key, value in (("orientation", ("top", "bottom")[i % 2]),
+                               ("size", "24"), ("x-centered", "false"),
+                               ("x", str((i // 2 + 1) * width // slots))):
+                self.session.gsettings("set", schema, key, value)
+        for toplevel in original + extra_ids:
+            schema = "org.cafe.panel.toplevel:/org/cafe/panel/toplevels/%s/" % toplevel
+            for key, value in settings:
+                self.session.gsettings("set", schema, key, value)
+        self.set_id_list("toplevel-id-list", original + extra_ids)
+
+        toplevels = len(original) + len(extra_ids)
+        self.session.wait_for(
+            lambda: len(self.session.panel_windows(self.dpy)) >= toplevels,
+            "the autohide toplevels")
+        self.session.panel.wait_settled(time.monotonic())
+
+        # where the pointer has to go to bring back each toplevel: the
+        # middle of the screen edge it hides against
+        root = self.dpy.screen().root
+        edges = []
+        for panel in self.session.panel_windows(self.dpy):
+            geometry = panel.get_geometry()
+            origin = root.translate_coords(panel, 0, 0)
+            x = min(max(origin.x + geometry.width // 2, 0), width - 1)
+            y = min(max(origin.y + geometry.height // 2, 0), height - 1)
+            nearest = min((y, "top"), (height - 1 - y, "bottom"),
+                          (x, "left"), (width - 1 - x, "right"))[1]
+            edges.append({"top": (x, 0), "bottom": (x, height - 1),
+                          "left": (0, y), "right": (width - 1, y)}[nearest])
+
+        cycles = args.autohide_cycles
+        extra = {"cycles": cycles, "toplevels": toplevels}
+        self.session.panel_stats("frame-draws", reset=True)
+
+        def hide_and_unhide():
+            # each step hides the toplevel the pointer leaves and
+            # brings back the one it reaches
+            for i in range(cycles):
+                xtest.fake_input(self.dpy, X.MotionNotify, x=width // 2, y=height // 2)
+                self.dpy.flush()
+                time.sleep(0.5)
+                for x, y in edges:
+                    xtest.fake_input(self.dpy, X.MotionNotify, x=x, y=y)
+                    self.dpy.flush()
+                    time.sleep(0.5)
+
+        result = self.measure("autohide-frames", hide_and_unhide, extra)
+
+        # the time spent in panel_frame_draw() itself, without the
+        # sleeps that let the animations run
+        frame_draws = self.session.panel_stats("frame-draws")
+        frame_draw_us = self.session.panel_stats("frame-draw-us")
+        result["frame_draws"] = frame_draws
+        result["frame_draws_per_cycle"] = (round(frame_draws / float(cycles), 1)
+                                           if cycles else None)
+        result["frame_draw_ms"] = round(frame_draw_us / 1000.0, 3)
+        result["frame_draw_us_mean"] = (round(frame_draw_us / float(frame_draws), 1)
+                                        if frame_draws else None)
+        if cycles and frame_draws < toplevels * cycles:
+            self.fail("autohide-frames", "%d toplevels hidden and shown %d times "
+                      "drew their frame %d times" % (toplevels, cycles, frame_draws))
+
+        # the other scenarios expect the layout of the cold start
+        self.set_id_list("toplevel-id-list", original)
+        for toplevel in original:
+            schema = "org.cafe.panel.toplevel:/org/cafe/panel/toplevels/%s/" % toplevel
+            for key, value in (("expand", "true"), ("auto-hide", "false"),
+                               ("enable-buttons", "false")):
+                self.session.gsettings("set", schema, key, value)
+        self.session.wait_for(
+            lambda: len(self.session.panel_windows(self.dpy)) == len(original),
+            "the autohide toplevels to go away")
+        self.session.panel.wait_settled(time.monotonic())
+
+    def workspace_scroll(self):
+        if not self.dpy:
+            self.skip("workspace-scroll", "python-xlib is not available")
+            return
+
+        args = self.session.args
+        wm = StubWindowManager(self.session.display_name, args.workspaces)
+        wm.start()
+
+        # only this scenario gets a workspace switcher, so that the
+        # layout of the others stays the same; its workspaces are laid
+        # out in rows and wrap around, like the scrolling it copies
+        objects = self.id_list("object-id-list")
+        schema = "org.cafe.panel.object:/org/cafe/panel/objects/bench-pager/"
+        prefs = ("org.cafe.panel.applet.workspace-switcher:"
+                 "/org/cafe/panel/objects/bench-pager/prefs/")
+        try:
+            for key, value in (("num-rows", str(args.scroll_rows)),
+                               ("wrap-workspaces", "true")):
+                self.session.gsettings("set", prefs, key, value)
+        except subprocess.CalledProcessError:
+            wm.stop()
+            self.skip("workspace-scroll", "the workspace switcher schema is not installed")
+            return
+        for key, value in (("object-type", "applet"),
+                           ("applet-iid", "VnckletFactory::WorkspaceSwitcherApplet"),
+                           ("toplevel-id", self.id_list("toplevel-id-list")[0]),
+                           ("position", "400"), ("panel-right-stick", "true")):
+            self.session.gsettings("set", schema, key, value)
+        self.set_id_list("object-id-list", objects + ["bench-pager"])
+
+        try:
+            try:
+                self.session.wait_for(
+                    lambda: self.session.plug_window(self.dpy, "vnck-applet") is not None,
+                    "the workspace switcher")
+            except RuntimeError:
+                self.skip("workspace-scroll", "the workspace switcher is not running")
+                return
+            self.session.panel.wait_settled(time.monotonic())
+            plug = self.session.plug_window(self.dpy, "vnck-applet")
+
+            root = self.dpy.screen().root
+            geometry = plug.get_geometry()
+            origin = root.translate_coords(plug, 0, 0)
+            xtest.fake_input(self.dpy, X.MotionNotify,
+                             x=origin.x + geometry.width // 2,
+                             y=origin.y + geometry.height // 2)
+            self.dpy.flush()
+
+            extra = {"workspaces": args.workspaces, "rows": args.scroll_rows,
+                     "bursts": args.scroll_bursts,
+                     "burst_length": args.scroll_burst_length}
+            expected = wm.current
+
+            def scroll():
+                # wheel spins in every direction, as fast as the X
+                # server takes them: each one has to end up as at most
+                # one switch, to where the clicks add up to
+                bursts_over = 0
+                wrong_workspace = 0
+                expected_workspace = expected
+                for i in range(args.scroll_bursts):
+                    direction = SCROLL_BURSTS[i % len(SCROLL_BURSTS)]
+                    requests = wm.requests
+                    for j in range(args.scroll_burst_length):
+                        expected_workspace = scroll_step(expected_workspace, direction,
+                                                         args.workspaces, args.scroll_rows)
+                        xtest.fake_input(self.dpy, X.ButtonPress, SCROLL_BUTTONS[direction])
+                        xtest.fake_input(self.dpy, X.ButtonRelease, SCROLL_BUTTONS[direction])
+                    self.dpy.flush()
+                    time.sleep(0.3)
+                    if wm.requests - requests > 1:
+                        bursts_over += 1
+                    if wm.current != expected_workspace:
+                        wrong_workspace += 1
+                extra["switch_requests"] = wm.requests
+                extra["requests_per_burst"] = (round(wm.requests / float(args.scroll_bursts), 1)
+                                               if args.scroll_bursts else None)
+                extra["final_workspace"] = wm.current
+                extra["expected_workspace"] = expected_workspace
+                if bursts_over:
+                    self.fail("workspace-scroll", "%d of %d bursts sent more than one "
+                              "switch" % (bursts_over, args.scroll_bursts))
+                if wrong_workspace:
+                    self.fail("workspace-scroll", "%d of %d bursts did not end on the "
+                              "workspace they scrolled to" % (wrong_workspace,
+                                                              args.scroll_bursts))
+
+            self.measure("workspace-scroll", scroll, extra)
+        finally:
+            self.set_id_list("object-id-list", objects)
+            wm.stop()
+
+    SCENARIOS = ["cold-start", "resize", "wallpaper", "tray-icons", "run-dialog",
+                 "add-to-panel", "launch-animation", "launch-storm", "calendar-popup",
+                 "clock-locations", "applet-drag", "autohide-frames", "workspace-scroll"]
+
+    def run(self, scenarios):
+        self.cold_start()
+        steps = {
+            "resize": self.resize_and_orientation,
+            "wallpaper": self.wallpaper,
+            "tray-icons": self.tray_icons,
+            "run-dialog": self.run_dialog,
+            "add-to-panel": self.add_to_panel,
+            "launch-animation": self.launch_animation,
+            "launch-storm": self.launch_storm,
+            "calendar-popup": self.calendar_popup,
+            "clock-locations": self.clock_locations,
+            "applet-drag": self.applet_drag,
+            "autohide-frames": self.autohide_frames,
+            "workspace-scroll": self.workspace_scroll,
+        }
+        for name in scenarios:
+            if name in steps:
+                steps[name]()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--prefix", default="/usr",
+                        help="installation prefix of cafe-panel and its applets")
+    parser.add_argument("--output", default="-",
+                        help="file to write the JSON results to")
+    parser.add_argument("--screen", default="7680x1080",
+                        help="size of the Xvfb screen")
+    parser.add_argument("--toplevels", type=int, default=2)
+    parser.add_argument("--launchers", type=int, default=150)
+    parser.add_argument("--tray-icons", type=int, default=100)
+    parser.add_argument("--addto-applets", type=int, default=200,
+                        help="applets the add-to-panel scenario installs")
+    parser.add_argument("--addto-menus", type=int, default=20,
+                        help="directories of the applications menu of the "
+                        "add-to-panel scenario")
+    parser.add_argument("--addto-entries", type=int, default=50,
+                        help="entries in each of these directories")
+    parser.add_argument("--launches", type=int, default=10,
+                        help="launcher clicks in the launch-animation scenario")
+    parser.add_argument("--max-launch-stall-ms", type=float, default=50,
+                        help="fail if the main loop latency went over this "
+                        "while the launch animation ran (0: no limit)")
+    parser.add_argument("--storm-launches", type=int, default=200,
+                        help="launcher clicks in the launch-storm scenario")
+    parser.add_argument("--calendar-opens", type=int, default=10,
+                        help="times the calendar-popup scenario opens the "
+                        "clock popup")
+    parser.add_argument("--clock-locations", type=int, default=200,
+                        help="locations the clock-locations scenario gives "
+                        "the clock")
+    parser.add_argument("--max-tzset-per-location", type=int, default=10,
+                        help="fail if setting the locations of the "
+                        "clock-locations scenario calls tzset() more than "
+                        "this many times per location")
+    parser.add_argument("--max-tzset-per-change", type=int, default=20,
+                        help="fail if changing one of these locations calls "
+                        "tzset() more than this many times")
+    parser.add_argument("--autohide-toplevels", type=int, default=8,
+                        help="toplevels the autohide-frames scenario hides "
+                        "and shows")
+    parser.add_argument("--autohide-cycles", type=int, default=5,
+                        help="times the autohide-frames scenario hides and "
+                        "shows each of them")
+    parser.add_argument("--workspaces", type=int, default=8,
+                        help="desktops the stub window manager of the "
+                        "workspace-scroll scenario advertises")
+    parser.add_argument("--scroll-rows", type=int, default=2,
+                        help="rows of workspaces in the workspace switcher "
+                        "of the workspace-scroll scenario")
+    parser.add_argument("--scroll-bursts", type=int, default=10,
+                        help="wheel spins in the workspace-scroll scenario")
+    parser.add_argument("--scroll-burst-length", type=int, default=4,
+                        help="wheel clicks per spin in the workspace-scroll "
+                        "scenario")
+    parser.add_argument("--sm-delay", type=float, default=5,
+                        help="run a stub session manager that takes this many "
+                        "seconds to register the panel; the cold start fails "
+                        "if the toplevels wait for it (0: no session manager)")
+    parser.add_argument("--max-stall-ms", type=float, default=100,
+                        help="fail if the main loop latency of any scenario "
+                        "went over this (0: no limit)")
+    parser.add_argument("--scenario", action="append", choices=Bench.SCENARIOS,
+                        help="run only this scenario (may be repeated); the "
+                        "cold start always runs")
+    parser.add_argument("--xtrace", action="store_true",
+                        help="count X round trips by running the panel under xtrace")
+    parser.add_argument("--verbose", action="store_true",
+                        help="let the output of the panel and the X server through")
+    args = parser.parse_args()
+    # the counter costs next to nothing, but only preload it when it
+    # is read
+    args.count_tzset = "clock-locations" in (args.scenario or Bench.SCENARIOS)
+
+    session = Session(args)
+    try:
+        session.start()
+        bench = Bench(session)
+        bench.run(args.scenario or Bench.SCENARIOS)
+        report = {
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+            "screen": args.screen,
+            "xlib": HAVE_XLIB,
+            "scenarios": bench.results,
+            "failures": bench.failures,
+        }
+    finally:
+        session.stop()
+
+    text = json.dumps(report, indent=2) + "\n"
+    if args.output == "-":
+        sys.stdout.write(text)
+    else:
+        with open(args.output, "w") as f:
+            f.write(text)
+
+    for failure in bench.failures:
+        sys.stderr.write(failure + "\n")
+    if bench.failures:
+        sys.exit(1)
+
+    if args.max_stall_ms > 0:
+        over = [result["name"] for result in bench.results
+                if result.get("stall_ms") and
+                result["stall_ms"]["max"] > args.max_stall_ms]
+        if over:
+            sys.stderr.write("main loop stalled for more than %g ms in: %s\n"
+                             % (args.max_stall_ms, ", ".join(over)))
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,90 @@
+/*
+ * tzset-counter.c: count the tzset() calls of the processes it is
+ * preloaded into
+ *
+ * Copyright (C) 2026 CAFE developers
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ *
+ * Built and preloaded by panel-bench.py. Each process keeps its count
+ * in a file of $TZSET_COUNTER_DIR named after its pid and command, as
+ * a native 64-bit integer that the benchmark reads while it runs.
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+static void              (*real_tzset) (void);
+static volatile uint64_t *counter;
+
+__attribute__((constructor))
+static void
+counter_init (void)
+{
+	const char *dir;
+	char        comm[64] = "unknown";
+	char        path[PATH_MAX];
+	void       *map;
+	FILE       *f;
+	int         fd;
+
+	real_tzset = (void (*) (void)) dlsym (RTLD_NEXT, "tzset");
+
+	dir = getenv ("TZSET_COUNTER_DIR");
+	if (dir == NULL)
+		return;
+
+	f = fopen ("/proc/self/comm", "r");
+	if (f != NULL) {
+		if (fgets (comm, sizeof (comm), f) != NULL)
+			comm[strcspn (comm, "\n")] = '\0';
+		fclose (f);
+	}
+
+	snprintf (path, sizeof (path), "%s/%d.%s", dir, (int) getpid (), comm);
+	fd = open (path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return;
+
+	if (ftruncate (fd, sizeof (uint64_t)) == 0) {
+		map = mmap (NULL, sizeof (uint64_t), PROT_READ | PROT_WRITE,
+			    MAP_SHARED, fd, 0);
+		if (map != MAP_FAILED)
+			counter = map;
+	}
+
+	close (fd);
+}
+
+void
+tzset (void)
+{
+	if (counter != NULL)
+		__atomic_fetch_add (counter, 1, __ATOMIC_RELAXED);
+
+	if (real_tzset != NULL)
+		real_tzset ();
+}
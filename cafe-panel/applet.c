@@ -20,6 +20,7 @@
 #include "button-widget.h"
 #include "drawer.h"
 #include "launcher.h"
+#include "menu.h"
 #include "panel-addto.h"
 #include "panel-config-global.h"
 #include "panel-applet-frame.h"
@@ -857,8 +858,10 @@ cafe_panel_applet_stop_loading (const char *id)
 		free_applet_to_load (applet);
 	}
 
-	if (cafe_panel_applets_loading == NULL && cafe_panel_applets_to_load == NULL)
+	if (cafe_panel_applets_loading == NULL && cafe_panel_applets_to_load == NULL) {
 		cafe_panel_applet_queue_initial_unhide_toplevels (NULL);
+		panel_menu_queue_prewarm ();
+	}
 }
 
 static gboolean
@@ -1021,6 +1024,24 @@ cafe_panel_applet_compare (const CafePanelAppletToLoad *a,
 		return a->position - b->position;
 }
 
+static void
+cafe_panel_applet_launchers_prefetched (gpointer user_data)
+{
+	/* on panel startup, we don't care about redraws of the
+	 * toplevels since they are hidden, so we give a higher
+	 * priority to loading of applets */
+	guint id;
+
+	if (GPOINTER_TO_INT (user_data))
+		id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+				      cafe_panel_applet_load_idle_handler,
+				      NULL, NULL);
+	else
+		id = g_idle_add (cafe_panel_applet_load_idle_handler, NULL);
+
+	g_source_set_name_by_id (id, "[cafe-panel] cafe_panel_applet_load_idle_handler");
+}
+
 void
 cafe_panel_applet_load_queued_applets (gboolean initial_load)
 {
@@ -1042,17 +1063,26 @@ cafe_panel_applet_load_queued_applets (gboolean initial_load)
 					      (GCompareFunc) cafe_panel_applet_compare);
 
 	if ( ! cafe_panel_applet_have_load_idle) {
-		/* on panel startup, we don't care about redraws of the
-		 * toplevels since they are hidden, so we give a higher
-		 * priority to loading of applets */
-		if (initial_load)
-			g_idle_add_full (G_PRIORITY_HIGH_IDLE,
-					 cafe_panel_applet_load_idle_handler,
-					 NULL, NULL);
-		else
-			g_idle_add (cafe_panel_applet_load_idle_handler, NULL);
+		GSList *launcher_ids = NULL;
+		GSList *l;
 
 		cafe_panel_applet_have_load_idle = TRUE;
+
+		for (l = cafe_panel_applets_to_load; l; l = l->next) {
+			CafePanelAppletToLoad *applet = l->data;
+
+			if (applet->type == PANEL_OBJECT_LAUNCHER)
+				launcher_ids = g_slist_prepend (launcher_ids,
+								applet->id);
+		}
+
+		/* the launcher desktop files are all looked up and parsed
+		 * in parallel first, so that the load idle only has to
+		 * create the widgets */
+		launcher_prefetch_from_gsettings (launcher_ids,
+						  cafe_panel_applet_launchers_prefetched,
+						  GINT_TO_POINTER (initial_load));
+		g_slist_free (launcher_ids);
 	}
 }
 
@@ -13,6 +13,7 @@
 #include "panel-util.h"
 #include "panel-config-global.h"
 #include "panel-marshal.h"
+#include "panel-memory.h"
 #include "panel-typebuiltins.h"
 #include "panel-globals.h"
 #include "panel-enums.h"
@@ -155,6 +156,8 @@ button_widget_unset_surfaces (ButtonWidget *button)
 	if (button->priv->surface_hc)
 		cairo_surface_destroy (button->priv->surface_hc);
 	button->priv->surface_hc = NULL;
+
+	panel_memory_charge (button, "icon-surfaces", 0);
 }
 
 static void
@@ -195,6 +198,10 @@ button_widget_reload_surface (ButtonWidget *button)
 
 	button->priv->surface_hc = make_hc_surface (button->priv->surface);
 
+	panel_memory_charge (button, "icon-surfaces",
+			     panel_memory_surface_size (button->priv->surface) +
+			     panel_memory_surface_size (button->priv->surface_hc));
+
 	ctk_widget_queue_resize (CTK_WIDGET (button));
 }
 
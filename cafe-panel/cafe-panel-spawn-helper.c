@@ -0,0 +1,199 @@
+/*
+ * cafe-panel-spawn-helper.c: launch applications on behalf of the panel
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* The panel starts this helper once, while it is still small, and
+ * hands it the applications to launch. Forking the panel itself for
+ * every launch gets slower as its resident set grows. */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <glib-unix.h>
+#include <gio/gio.h>
+#include <gio/gdesktopappinfo.h>
+
+#include "panel-spawn-protocol.h"
+
+static GMainLoop *loop = NULL;
+
+static void
+child_exited (GPid     pid,
+	      gint     status G_GNUC_UNUSED,
+	      gpointer user_data G_GNUC_UNUSED)
+{
+	g_spawn_close_pid (pid);
+}
+
+static void
+gather_pid_callback (GDesktopAppInfo *appinfo G_GNUC_UNUSED,
+		     GPid             pid,
+		     gpointer         user_data G_GNUC_UNUSED)
+{
+	/* reap the children ourselves rather than double forking, so
+	 * that pkexec can find its parent:
+	 * https://bugzilla.gnome.org/show_bug.cgi?id=675789 */
+	g_child_watch_add (pid, child_exited, NULL);
+}
+
+static void
+send_reply (guint32     serial,
+	    const char *message)
+{
+	GVariant *reply;
+
+	reply = g_variant_ref_sink (g_variant_new (PANEL_SPAWN_REPLY_TYPE,
+						   serial, message ? message : ""));
+	if (send (PANEL_SPAWN_HELPER_FD,
+		  g_variant_get_data (reply), g_variant_get_size (reply),
+		  MSG_NOSIGNAL) < 0)
+		g_warning ("Cannot reply to the panel: %s", g_strerror (errno));
+	g_variant_unref (reply);
+}
+
+static void
+handle_request (GVariant *request)
+{
+	GDesktopAppInfo   *appinfo = NULL;
+	GAppLaunchContext *context;
+	GVariantIter      *uri_iter;
+	GVariantIter      *env_iter;
+	GList             *uris = NULL;
+	GError            *error = NULL;
+	const char        *path;
+	const char        *contents;
+	const char        *action;
+	const char        *str;
+	guint32            serial;
+
+	g_variant_get (request, "(u&s&s&sasas)",
+		       &serial, &path, &contents, &action, &uri_iter, &env_iter);
+
+	context = g_app_launch_context_new ();
+	while (g_variant_iter_next (env_iter, "&s", &str)) {
+		char **pair;
+
+		pair = g_strsplit (str, "=", 2);
+		if (pair[0] && pair[1])
+			g_app_launch_context_setenv (context, pair[0], pair[1]);
+		g_strfreev (pair);
+	}
+
+	while (g_variant_iter_next (uri_iter, "&s", &str))
+		uris = g_list_prepend (uris, (gpointer) str);
+	uris = g_list_reverse (uris);
+
+	if (path[0]) {
+		appinfo = g_desktop_app_info_new_from_filename (path);
+	} else {
+		GKeyFile *keyfile;
+
+		keyfile = g_key_file_new ();
+		if (g_key_file_load_from_data (keyfile, contents, -1,
+					       G_KEY_FILE_NONE, &error))
+			appinfo = g_desktop_app_info_new_from_keyfile (keyfile);
+		g_key_file_free (keyfile);
+	}
+
+	if (!appinfo) {
+		if (!error)
+			error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+						     "Invalid desktop entry");
+	} else if (action[0]) {
+		g_desktop_app_info_launch_action (appinfo, action, context);
+	} else {
+		g_desktop_app_info_launch_uris_as_manager (appinfo, uris, context,
+							   G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+							   NULL, NULL,
+							   gather_pid_callback, NULL,
+							   &error);
+	}
+
+	send_reply (serial, error ? error->message : NULL);
+
+	g_clear_error (&error);
+	g_clear_object (&appinfo);
+	g_object_unref (context);
+	g_list_free (uris);
+	g_variant_iter_free (uri_iter);
+	g_variant_iter_free (env_iter);
+}
+
+static gboolean
+request_ready (gint         fd,
+	       GIOCondition condition G_GNUC_UNUSED,
+	       gpointer     user_data G_GNUC_UNUSED)
+{
+	GVariant *request;
+	GBytes   *bytes;
+	gssize    size;
+	char     *data;
+
+	/* the real size of the next packet */
+	size = recv (fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+	if (size < 0 && (errno == EINTR || errno == EAGAIN))
+		return G_SOURCE_CONTINUE;
+
+	/* the panel went away */
+	if (size <= 0) {
+		g_main_loop_quit (loop);
+		return G_SOURCE_REMOVE;
+	}
+
+	data = g_malloc (size);
+	size = recv (fd, data, size, 0);
+	if (size <= 0) {
+		g_free (data);
+		return G_SOURCE_CONTINUE;
+	}
+
+	bytes = g_bytes_new_take (data, size);
+	request = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PANEL_SPAWN_REQUEST_TYPE),
+								bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	handle_request (request);
+	g_variant_unref (request);
+
+	return G_SOURCE_CONTINUE;
+}
+
+int
+main (int   argc G_GNUC_UNUSED,
+      char *argv[] G_GNUC_UNUSED)
+{
+	setlocale (LC_ALL, "");
+
+	if (fcntl (PANEL_SPAWN_HELPER_FD, F_SETFD, FD_CLOEXEC) < 0) {
+		g_printerr ("This program is only meant to be started by cafe-panel\n");
+		return 1;
+	}
+
+	loop = g_main_loop_new (NULL, FALSE);
+	g_unix_fd_add (PANEL_SPAWN_HELPER_FD, G_IO_IN | G_IO_HUP | G_IO_ERR,
+		       request_ready, NULL);
+	g_main_loop_run (loop);
+	g_main_loop_unref (loop);
+
+	return 0;
+}
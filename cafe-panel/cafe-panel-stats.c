@@ -0,0 +1,175 @@
+/*
+ * cafe-panel-stats.c: dump the runtime counters of a running panel
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <gio/gio.h>
+
+#include "panel-stats.h"
+
+#define PANEL_DBUS_SERVICE "org.cafe.Panel"
+
+static gboolean  cli_reset = FALSE;
+static gboolean  cli_memory = FALSE;
+static int       cli_interval = 0;
+
+static const GOptionEntry options [] = {
+	{ "reset", 'r', 0, G_OPTION_ARG_NONE, &cli_reset, "Reset the counters", NULL },
+	{ "memory", 'm', 0, G_OPTION_ARG_NONE, &cli_memory, "Dump the memory held by the caches of the panel", NULL },
+	{ "interval", 'i', 0, G_OPTION_ARG_INT, &cli_interval, "Reset, wait SECONDS and dump the counters of that interval", "SECONDS" },
+	{ NULL }
+};
+
+static GVariant *
+call_stats (GDBusConnection  *connection,
+	    const char       *method,
+	    const char       *reply_type,
+	    GError          **error)
+{
+	return g_dbus_connection_call_sync (connection,
+					    PANEL_DBUS_SERVICE,
+					    PANEL_STATS_OBJECT_PATH,
+					    PANEL_STATS_INTERFACE,
+					    method,
+					    NULL,
+					    reply_type ? G_VARIANT_TYPE (reply_type) : NULL,
+					    G_DBUS_CALL_FLAGS_NONE,
+					    -1, NULL, error);
+}
+
+static void
+print_snapshot (GVariant *snapshot)
+{
+	GVariantIter *entries;
+	GVariantIter *counters;
+	guint64       elapsed;
+	const char   *kind;
+	const char   *name;
+
+	g_variant_get (snapshot, "(ta(ssa{st}))", &elapsed, &entries);
+
+	g_print ("# %.1f s since the counters were reset\n",
+		 (double) elapsed / G_USEC_PER_SEC);
+
+	while (g_variant_iter_next (entries, "(&s&sa{st})", &kind, &name, &counters)) {
+		const char *counter;
+		guint64     value;
+
+		g_print ("%s%s%s\n", kind, name[0] ? " " : "", name);
+		while (g_variant_iter_next (counters, "{&st}", &counter, &value))
+			g_print ("  %-20s %12" G_GUINT64_FORMAT "\n", counter, value);
+
+		g_variant_iter_free (counters);
+	}
+
+	g_variant_iter_free (entries);
+}
+
+static void
+print_memory (GVariant *memory)
+{
+	GVariantIter *charges;
+	guint64       total;
+	guint64       budget;
+	guint64       bytes;
+	const char   *kind;
+	const char   *name;
+	const char   *cache;
+
+	g_variant_get (memory, "(tta(ssst))", &total, &budget, &charges);
+
+	if (budget > 0)
+		g_print ("# %" G_GUINT64_FORMAT " KiB held in caches, budget %" G_GUINT64_FORMAT " KiB\n",
+			 total / 1024, budget / 1024);
+	else
+		g_print ("# %" G_GUINT64_FORMAT " KiB held in caches, no budget\n",
+			 total / 1024);
+
+	while (g_variant_iter_next (charges, "(&s&s&st)", &kind, &name, &cache, &bytes))
+		g_print ("%s%s%s: %s %" G_GUINT64_FORMAT "\n",
+			 kind, name[0] ? " " : "", name, cache, bytes);
+
+	g_variant_iter_free (charges);
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext  *context;
+	GDBusConnection *connection;
+	GVariant        *result;
+	GError          *error = NULL;
+
+	context = g_option_context_new ("- dump the performance counters of the running panel");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+	if (!connection) {
+		g_printerr ("Cannot connect to the session bus: %s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	if (cli_memory) {
+		result = call_stats (connection, "GetMemory", "(tta(ssst))", &error);
+		if (result) {
+			print_memory (result);
+			g_variant_unref (result);
+		}
+		goto out;
+	}
+
+	if (cli_reset || cli_interval > 0) {
+		result = call_stats (connection, "Reset", NULL, &error);
+		if (!result)
+			goto out;
+		g_variant_unref (result);
+
+		if (cli_interval <= 0)
+			goto out;
+
+		g_usleep ((gulong) cli_interval * G_USEC_PER_SEC);
+	}
+
+	result = call_stats (connection, "GetSnapshot", "(ta(ssa{st}))", &error);
+	if (result) {
+		print_snapshot (result);
+		g_variant_unref (result);
+	}
+
+out:
+	g_object_unref (connection);
+
+	if (error) {
+		g_printerr ("Cannot query the panel: %s\n", error->message);
+		g_error_free (error);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
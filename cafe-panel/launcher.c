@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gio/gio.h>
 
 #include <libpanel-util/panel-error.h>
@@ -146,25 +147,9 @@ launcher_launch (Launcher  *launcher,
 
 	if (type && !strcmp (type, "Link"))
 		launch_url (launcher);
-	else {
-		GError *error = NULL;
-
+	else
 		panel_launch_key_file (launcher->key_file, NULL,
-				       launcher_get_screen (launcher), action, &error);
-		if (error) {
-			CtkWidget *error_dialog;
-
-			error_dialog = panel_error_dialog (
-						NULL,
-						launcher_get_screen (launcher),
-						"cannot_launch_application",
-						TRUE,
-						_("Could not launch application"),
-						error->message);
-			launcher_register_error_dialog (launcher, error_dialog);
-			g_clear_error (&error);
-		}
-	}
+				       launcher_get_screen (launcher), action, NULL);
 	g_free (type);
 }
 
@@ -178,7 +163,6 @@ drag_data_received_cb (CtkWidget        *widget,
 		       guint             time,
 		       Launcher         *launcher)
 {
-	GError  *error = NULL;
 	char   **uris;
 	int      i;
 	GList   *file_list;
@@ -203,23 +187,11 @@ drag_data_received_cb (CtkWidget        *widget,
 	file_list = g_list_reverse (file_list);
 
 	panel_launch_key_file (launcher->key_file, file_list,
-			       launcher_get_screen (launcher), NULL, &error);
+			       launcher_get_screen (launcher), NULL, NULL);
 
 	g_list_free (file_list);
 	g_strfreev (uris);
 
-	if (error) {
-		CtkWidget *error_dialog;
-		error_dialog = panel_error_dialog (NULL,
-						   launcher_get_screen (launcher),
-						   "cannot_use_dropped_item",
-						   TRUE,
-						   _("Could not use dropped item"),
-						   error->message);
-		launcher_register_error_dialog (launcher, error_dialog);
-		g_clear_error (&error);
-	}
-
 	ctk_drag_finish (context, TRUE, FALSE, time);
 }
 
@@ -438,6 +410,271 @@ clicked_cb (Launcher  *launcher,
 	}
 }
 
+/* Desktop files of the launchers are looked up and parsed in worker
+ * threads before the launchers get created; see
+ * launcher_prefetch_from_gsettings().  The contents are kept around so
+ * that loading the same launcher again only costs a stat(). */
+typedef struct {
+	char     *path;
+	char     *new_location;
+	gint64    mtime;
+	goffset   size;
+	char     *contents;
+	gsize     length;
+	GKeyFile *key_file;
+} LauncherEntry;
+
+typedef struct {
+	char *location;
+	char *personal_path;
+} LauncherPrefetchData;
+
+typedef struct {
+	int                   pending;
+	LauncherPrefetchFunc  func;
+	gpointer              user_data;
+} LauncherPrefetch;
+
+static GHashTable *launcher_entries = NULL;
+
+#define LAUNCHER_KEY_FILE_FLAGS (G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS)
+
+static void
+launcher_entry_free (LauncherEntry *entry)
+{
+	g_free (entry->path);
+	g_free (entry->new_location);
+	g_free (entry->contents);
+	if (entry->key_file)
+		g_key_file_free (entry->key_file);
+	g_free (entry);
+}
+
+static void
+launcher_prefetch_data_free (LauncherPrefetchData *data)
+{
+	g_free (data->location);
+	g_free (data->personal_path);
+	g_free (data);
+}
+
+/* Same lookup as create_launcher(), but without touching anything that
+ * is not thread-safe. */
+static void
+launcher_prefetch_thread (GTask        *task,
+			  gpointer      source_object G_GNUC_UNUSED,
+			  gpointer      task_data,
+			  GCancellable *cancellable G_GNUC_UNUSED)
+{
+	LauncherPrefetchData *data = task_data;
+	LauncherEntry        *entry;
+	GStatBuf              buf;
+	gboolean              loaded;
+
+	entry = g_new0 (LauncherEntry, 1);
+
+	if (data->personal_path) {
+		entry->path = g_strdup (data->personal_path);
+
+		if (!g_file_test (entry->path, G_FILE_TEST_EXISTS)) {
+			g_free (entry->path);
+			entry->path = panel_g_lookup_in_applications_dirs (data->location);
+			entry->new_location = g_strdup (entry->path);
+		}
+	} else {
+		char *scheme;
+
+		scheme = g_uri_parse_scheme (data->location);
+		if (scheme == NULL || !g_ascii_strcasecmp (scheme, "file")) {
+			if (g_path_is_absolute (data->location))
+				entry->path = g_filename_from_utf8 (data->location, -1,
+								    NULL, NULL, NULL);
+			else
+				entry->path = g_filename_from_uri (data->location,
+								   NULL, NULL);
+		}
+		g_free (scheme);
+	}
+
+	if (entry->path) {
+		if (g_stat (entry->path, &buf) == 0) {
+			entry->mtime = buf.st_mtime;
+			entry->size = buf.st_size;
+		}
+		loaded = g_file_get_contents (entry->path, &entry->contents,
+					      &entry->length, NULL);
+	} else if (strchr (data->location, G_DIR_SEPARATOR)) {
+		GFile *file;
+
+		file = g_file_new_for_uri (data->location);
+		loaded = g_file_load_contents (file, NULL, &entry->contents,
+					       &entry->length, NULL, NULL);
+		g_object_unref (file);
+	} else
+		loaded = FALSE;
+
+	if (loaded) {
+		entry->key_file = g_key_file_new ();
+		loaded = g_key_file_load_from_data (entry->key_file,
+						    entry->contents,
+						    entry->length,
+						    LAUNCHER_KEY_FILE_FLAGS,
+						    NULL);
+	}
+
+	/* failures are reported when the launcher is created */
+	if (!loaded) {
+		launcher_entry_free (entry);
+		entry = NULL;
+	}
+
+	g_task_return_pointer (task, entry, (GDestroyNotify) launcher_entry_free);
+}
+
+static void
+launcher_prefetch_done (GObject      *source_object G_GNUC_UNUSED,
+			GAsyncResult *result,
+			gpointer      user_data)
+{
+	LauncherPrefetch *prefetch = user_data;
+	LauncherEntry    *entry;
+	LauncherPrefetchData *data;
+
+	entry = g_task_propagate_pointer (G_TASK (result), NULL);
+	data = g_task_get_task_data (G_TASK (result));
+
+	if (entry)
+		g_hash_table_replace (launcher_entries,
+				      g_strdup (data->location), entry);
+	else
+		g_hash_table_remove (launcher_entries, data->location);
+
+	if (--prefetch->pending > 0)
+		return;
+
+	prefetch->func (prefetch->user_data);
+	g_free (prefetch);
+}
+
+static char *
+launcher_get_location_from_gsettings (const char *id)
+{
+	GSettings *settings;
+	char      *path;
+	char      *location;
+
+	path = g_strdup_printf ("%s%s/", PANEL_OBJECT_PATH, id);
+	settings = g_settings_new_with_path (PANEL_OBJECT_SCHEMA, path);
+	g_free (path);
+
+	location = g_settings_get_string (settings, PANEL_OBJECT_LAUNCHER_LOCATION_KEY);
+	g_object_unref (settings);
+
+	return location;
+}
+
+/* Resolves and parses the desktop files of the launchers with the given
+ * ids concurrently, and calls @func once they are all in the cache. */
+void
+launcher_prefetch_from_gsettings (GSList               *ids,
+				  LauncherPrefetchFunc  func,
+				  gpointer              user_data)
+{
+	LauncherPrefetch *prefetch;
+	GSList           *l;
+
+	if (!launcher_entries)
+		launcher_entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+							  g_free,
+							  (GDestroyNotify) launcher_entry_free);
+
+	prefetch = g_new0 (LauncherPrefetch, 1);
+	prefetch->func = func;
+	prefetch->user_data = user_data;
+	/* guard against the tasks completing before we are done here */
+	prefetch->pending = 1;
+
+	for (l = ids; l; l = l->next) {
+		LauncherPrefetchData *data;
+		GTask                *task;
+		char                 *location;
+
+		location = launcher_get_location_from_gsettings (l->data);
+		if (PANEL_GLIB_STR_EMPTY (location)) {
+			g_free (location);
+			continue;
+		}
+
+		data = g_new0 (LauncherPrefetchData, 1);
+		data->location = location;
+		/* this may create the launchers directory, so it is not
+		 * done in the threads */
+		if (!strchr (location, G_DIR_SEPARATOR))
+			data->personal_path = panel_make_full_path (NULL, location);
+
+		prefetch->pending++;
+
+		task = g_task_new (NULL, NULL, launcher_prefetch_done, prefetch);
+		g_task_set_task_data (task, data,
+				      (GDestroyNotify) launcher_prefetch_data_free);
+		g_task_run_in_thread (task, launcher_prefetch_thread);
+		g_object_unref (task);
+	}
+
+	if (--prefetch->pending > 0)
+		return;
+
+	prefetch->func (prefetch->user_data);
+	g_free (prefetch);
+}
+
+static GKeyFile *
+launcher_get_cached_key_file (const char  *location,
+			      char       **new_location)
+{
+	LauncherEntry *entry;
+	GKeyFile      *key_file;
+	GStatBuf       buf;
+
+	if (!launcher_entries)
+		return NULL;
+
+	entry = g_hash_table_lookup (launcher_entries, location);
+	if (!entry)
+		return NULL;
+
+	if (entry->key_file) {
+		/* just prefetched */
+		key_file = entry->key_file;
+		entry->key_file = NULL;
+	} else {
+		/* a launcher found in the data dirs could since have been
+		 * overridden in the personal dir, so only reuse direct hits
+		 * that did not change */
+		if (entry->new_location ||
+		    !entry->path ||
+		    g_stat (entry->path, &buf) != 0 ||
+		    buf.st_mtime != entry->mtime ||
+		    buf.st_size != entry->size) {
+			g_hash_table_remove (launcher_entries, location);
+			return NULL;
+		}
+
+		key_file = g_key_file_new ();
+		if (!g_key_file_load_from_data (key_file,
+						entry->contents, entry->length,
+						LAUNCHER_KEY_FILE_FLAGS, NULL)) {
+			g_key_file_free (key_file);
+			g_hash_table_remove (launcher_entries, location);
+			return NULL;
+		}
+	}
+
+	*new_location = g_strdup (entry->new_location);
+
+	return key_file;
+}
+
 static Launcher *
 create_launcher (const char *location)
 {
@@ -453,9 +690,11 @@ create_launcher (const char *location)
 	}
 
 	new_location = NULL;
-	key_file = g_key_file_new ();
+	key_file = launcher_get_cached_key_file (location, &new_location);
 
-	if (!strchr (location, G_DIR_SEPARATOR)) {
+	if (key_file)
+		loaded = TRUE;
+	else if (!strchr (location, G_DIR_SEPARATOR)) {
 		/* try to first load a file in our config directory, and if it
 		 * doesn't exist there, try to find it in the xdg data dirs */
 		char *path;
@@ -475,16 +714,20 @@ create_launcher (const char *location)
 				new_location = g_strdup (path);
 		}
 
+		key_file = g_key_file_new ();
+
 		if (path) {
 			loaded = g_key_file_load_from_file (key_file, path,
-							    G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS,
+							    LAUNCHER_KEY_FILE_FLAGS,
 							    &error);
 			g_free (path);
 		}
-	} else
+	} else {
+		key_file = g_key_file_new ();
 		loaded = panel_key_file_load_from_uri (key_file, location,
-						       G_KEY_FILE_KEEP_COMMENTS|G_KEY_FILE_KEEP_TRANSLATIONS,
+						       LAUNCHER_KEY_FILE_FLAGS,
 						       &error);
+	}
 
 	if (!loaded) {
 		g_printerr (_("Unable to open desktop file %s for panel launcher%s%s\n"),
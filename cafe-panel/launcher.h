@@ -31,6 +31,8 @@ typedef struct {
 	gulong             destroy_handler;
 } Launcher;
 
+typedef void (*LauncherPrefetchFunc) (gpointer user_data);
+
 void panel_launcher_create           (PanelToplevel *toplevel,
 				      int            position,
 				      const char    *location);
@@ -58,6 +60,10 @@ void            launcher_load_from_gsettings        (PanelWidget *panel_widget,
 													 gint         position,
 													 const char  *id);
 
+void            launcher_prefetch_from_gsettings (GSList               *ids,
+						  LauncherPrefetchFunc  func,
+						  gpointer              user_data);
+
 void            panel_launcher_delete           (Launcher *launcher);
 
 void		ask_about_launcher		(const char *file,
@@ -31,6 +31,7 @@
 
 #include <panel-applet-frame.h>
 #include <panel-applets-manager.h>
+#include <panel-stats.h>
 
 #include "panel-applet-container.h"
 #include "panel-applet-frame-dbus.h"
@@ -144,9 +145,11 @@ cafe_panel_applet_frame_dbus_init_properties (CafePanelAppletFrame *frame)
 {
 	CafePanelAppletFrameDBus *dbus_frame = CAFE_PANEL_APPLET_FRAME_DBUS (frame);
 
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_get (dbus_frame->priv->container, "flags", NULL,
 					  (GAsyncReadyCallback) cafe_panel_applet_frame_dbus_get_flags_cb,
 					  frame);
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_get (dbus_frame->priv->container, "size-hints", NULL,
 					  (GAsyncReadyCallback) cafe_panel_applet_frame_dbus_get_size_hints_cb,
 					  frame);
@@ -162,9 +165,11 @@ cafe_panel_applet_frame_dbus_sync_menu_state (CafePanelAppletFrame *frame,
 {
 	CafePanelAppletFrameDBus *dbus_frame = CAFE_PANEL_APPLET_FRAME_DBUS (frame);
 
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_set (dbus_frame->priv->container,
 					  "locked", g_variant_new_boolean (lockable && locked),
 					  NULL, NULL, NULL);
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_set (dbus_frame->priv->container,
 					  "locked-down", g_variant_new_boolean (locked_down),
 					  NULL, NULL, NULL);
@@ -177,6 +182,7 @@ cafe_panel_applet_frame_dbus_popup_menu (CafePanelAppletFrame *frame,
 {
 	CafePanelAppletFrameDBus *dbus_frame = CAFE_PANEL_APPLET_FRAME_DBUS (frame);
 
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_popup_menu (dbus_frame->priv->container,
 						 button, timestamp,
 						 NULL, NULL, NULL);
@@ -205,6 +211,7 @@ cafe_panel_applet_frame_dbus_change_orientation (CafePanelAppletFrame *frame,
 {
 	CafePanelAppletFrameDBus *dbus_frame = CAFE_PANEL_APPLET_FRAME_DBUS (frame);
 
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_set (dbus_frame->priv->container,
 					  "orient",
 					  g_variant_new_uint32 (get_cafe_panel_applet_orient (orientation)),
@@ -219,6 +226,7 @@ cafe_panel_applet_frame_dbus_change_size (CafePanelAppletFrame *frame,
 {
 	CafePanelAppletFrameDBus *dbus_frame = CAFE_PANEL_APPLET_FRAME_DBUS (frame);
 
+	panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 	cafe_panel_applet_container_child_set (dbus_frame->priv->container,
 					  "size", g_variant_new_uint32 (size),
 					  NULL, NULL, NULL);
@@ -252,6 +260,7 @@ cafe_panel_applet_frame_dbus_change_background (CafePanelAppletFrame    *frame,
 		if (priv->bg_operation)
 			cafe_panel_applet_container_cancel_operation (priv->container, priv->bg_operation);
 
+		panel_stats_count (frame, PANEL_STATS_DBUS_CALLS);
 		priv->bg_operation = cafe_panel_applet_container_child_set (priv->container,
 						  "background",
 						  g_variant_new_string (bg_str),
@@ -269,6 +278,7 @@ cafe_panel_applet_frame_dbus_flags_changed (CafePanelAppletContainer *container
 					    GVariant                 *value,
 					    CafePanelAppletFrame     *frame)
 {
+	panel_stats_count (frame, PANEL_STATS_DBUS_SIGNALS);
 	cafe_panel_applet_frame_dbus_update_flags (frame, value);
 }
 
@@ -282,6 +292,8 @@ cafe_panel_applet_frame_dbus_size_hints_changed (CafePanelAppletContainer *conta
 	gint       *size_hints = NULL;
 	gsize       n_elements;
 
+	panel_stats_count (frame, PANEL_STATS_DBUS_SIGNALS);
+
 	sz = g_variant_get_fixed_array (value, &n_elements, sizeof (gint32));
 	if (n_elements > 0) {
 		size_hints = g_new (gint32, n_elements);
@@ -302,6 +314,7 @@ static void
 cafe_panel_applet_frame_dbus_applet_remove (CafePanelAppletContainer *container G_GNUC_UNUSED,
 					    CafePanelAppletFrame     *frame)
 {
+	panel_stats_count (frame, PANEL_STATS_DBUS_SIGNALS);
 	_cafe_panel_applet_frame_applet_remove (frame);
 }
 
@@ -309,6 +322,7 @@ static void
 cafe_panel_applet_frame_dbus_applet_move (CafePanelAppletContainer *container G_GNUC_UNUSED,
 					  CafePanelAppletFrame     *frame)
 {
+	panel_stats_count (frame, PANEL_STATS_DBUS_SIGNALS);
 	_cafe_panel_applet_frame_applet_move (frame);
 }
 
@@ -317,6 +331,7 @@ cafe_panel_applet_frame_dbus_applet_lock (CafePanelAppletContainer *container G_
 					  gboolean                  locked,
 					  CafePanelAppletFrame     *frame)
 {
+	panel_stats_count (frame, PANEL_STATS_DBUS_SIGNALS);
 	_cafe_panel_applet_frame_applet_lock (frame, locked);
 }
 
@@ -96,6 +96,15 @@ struct _EggSMClientXSMP
 
   guint idle;
 
+  /* Connecting to the session manager happens in a thread, once the
+   * application is up; the results are handed back to the main loop. */
+  guint connect_idle;
+  GThread *connect_thread;
+  SmcConn new_connection;
+  char *ret_client_id;
+  char error_string[256];
+  GPtrArray *pending_props;
+
   /* Current SaveYourself state */
   guint expecting_initial_save_yourself : 1;
   guint need_save_state : 1;
@@ -104,6 +113,7 @@ struct _EggSMClientXSMP
   guint shutting_down : 1;
 
   /* Todo list */
+  guint connecting : 1;
   guint waiting_to_set_initial_properties : 1;
   guint waiting_to_emit_quit : 1;
   guint waiting_to_emit_quit_cancelled : 1;
@@ -164,6 +174,8 @@ static void do_save_yourself      (EggSMClientXSMP *xsmp);
 static void update_pending_events (EggSMClientXSMP *xsmp);
 
 static void     ice_init             (void);
+static void     ice_connect_begin    (void);
+static void     ice_connect_end      (void);
 static gboolean process_ice_messages (IceConn       ice_conn);
 static void     smc_error_handler    (SmcConn       smc_conn,
 				      Bool          swap,
@@ -314,47 +326,45 @@ sm_client_xsmp_disconnect (EggSMClientXSMP *xsmp)
 }
 
 static void
-sm_client_xsmp_startup (EggSMClient *client,
-			const char  *client_id)
+free_props (GPtrArray *props)
 {
-  EggSMClientXSMP *xsmp = (EggSMClientXSMP *)client;
-  SmcCallbacks callbacks;
-  char *ret_client_id;
-  char error_string_ret[256];
+  guint i;
 
-  xsmp->client_id = g_strdup (client_id);
+  for (i = 0; i < props->len; i++)
+    {
+      SmProp *prop = props->pdata[i];
 
-  ice_init ();
-  SmcSetErrorHandler (smc_error_handler);
+      g_free (prop->vals);
+      g_free (prop);
+    }
+  g_ptr_array_free (props, TRUE);
+}
 
-  callbacks.save_yourself.callback      = xsmp_save_yourself;
-  callbacks.die.callback                = xsmp_die;
-  callbacks.save_complete.callback      = xsmp_save_complete;
-  callbacks.shutdown_cancelled.callback = xsmp_shutdown_cancelled;
+static gboolean
+sm_client_xsmp_connected (gpointer user_data)
+{
+  EggSMClientXSMP *xsmp = user_data;
+  GPtrArray *pending_props;
 
-  callbacks.save_yourself.client_data      = xsmp;
-  callbacks.die.client_data                = xsmp;
-  callbacks.save_complete.client_data      = xsmp;
-  callbacks.shutdown_cancelled.client_data = xsmp;
+  g_thread_join (xsmp->connect_thread);
+  xsmp->connect_thread = NULL;
+  xsmp->connecting = FALSE;
+  ice_connect_end ();
 
-  client_id = NULL;
-  error_string_ret[0] = '\0';
-  xsmp->connection =
-    SmcOpenConnection (NULL, xsmp, SmProtoMajor, SmProtoMinor,
-		       SmcSaveYourselfProcMask | SmcDieProcMask |
-		       SmcSaveCompleteProcMask |
-		       SmcShutdownCancelledProcMask,
-		       &callbacks,
-		       xsmp->client_id, &ret_client_id,
-		       sizeof (error_string_ret), error_string_ret);
+  pending_props = xsmp->pending_props;
+  xsmp->pending_props = NULL;
+
+  xsmp->connection = xsmp->new_connection;
+  xsmp->new_connection = NULL;
 
   if (!xsmp->connection)
     {
       g_warning ("Failed to connect to the session manager: %s\n",
-		 error_string_ret[0] ?
-		 error_string_ret : "no error message given");
+		 xsmp->error_string[0] ?
+		 xsmp->error_string : "no error message given");
       xsmp->state = XSMP_STATE_CONNECTION_CLOSED;
-      return;
+      xsmp->waiting_to_set_initial_properties = FALSE;
+      goto out;
     }
 
   /* We expect a pointless initial SaveYourself if either (a) we
@@ -362,14 +372,15 @@ sm_client_xsmp_startup (EggSMClient *client,
    * client ID, but the server rejected it and gave us a new one.
    */
   if (!xsmp->client_id ||
-      (ret_client_id && strcmp (xsmp->client_id, ret_client_id) != 0))
+      (xsmp->ret_client_id && strcmp (xsmp->client_id, xsmp->ret_client_id) != 0))
     xsmp->expecting_initial_save_yourself = TRUE;
 
-  if (ret_client_id)
+  if (xsmp->ret_client_id)
     {
       g_free (xsmp->client_id);
-      xsmp->client_id = g_strdup (ret_client_id);
-      free (ret_client_id);
+      xsmp->client_id = g_strdup (xsmp->ret_client_id);
+      free (xsmp->ret_client_id);
+      xsmp->ret_client_id = NULL;
 
 #ifdef HAVE_X11
       if (CDK_IS_X11_DISPLAY (cdk_display_get_default ()))
@@ -381,14 +392,94 @@ sm_client_xsmp_startup (EggSMClient *client,
 
   xsmp->state = XSMP_STATE_IDLE;
 
-  /* Do not set the initial properties until we reach the main loop,
-   * so that the application has a chance to call
-   * egg_set_desktop_file(). (This may also help the session manager
-   * have a better idea of when the application is fully up and
-   * running.)
+  /* We are in the main loop already, so the application had its
+   * chance to call egg_set_desktop_file(). The properties set while
+   * we were connecting come last, they are the most recent ones.
    */
-  xsmp->waiting_to_set_initial_properties = TRUE;
-  xsmp->idle = g_idle_add (sm_client_xsmp_set_initial_properties, client);
+  sm_client_xsmp_set_initial_properties (xsmp);
+
+  if (pending_props)
+    {
+      g_debug ("Setting %u queued properties", pending_props->len);
+      SmcSetProperties (xsmp->connection, pending_props->len,
+			(SmProp **)pending_props->pdata);
+    }
+
+ out:
+  if (pending_props)
+    free_props (pending_props);
+  g_object_unref (xsmp);
+  return FALSE;
+}
+
+static gpointer
+sm_client_xsmp_connect_thread (gpointer user_data)
+{
+  EggSMClientXSMP *xsmp = user_data;
+  SmcCallbacks callbacks;
+
+  callbacks.save_yourself.callback      = xsmp_save_yourself;
+  callbacks.die.callback                = xsmp_die;
+  callbacks.save_complete.callback      = xsmp_save_complete;
+  callbacks.shutdown_cancelled.callback = xsmp_shutdown_cancelled;
+
+  callbacks.save_yourself.client_data      = xsmp;
+  callbacks.die.client_data                = xsmp;
+  callbacks.save_complete.client_data      = xsmp;
+  callbacks.shutdown_cancelled.client_data = xsmp;
+
+  /* The main thread does not touch libICE until this is over, and it
+   * only looks at the results once it has joined us. */
+  xsmp->error_string[0] = '\0';
+  xsmp->new_connection =
+    SmcOpenConnection (NULL, xsmp, SmProtoMajor, SmProtoMinor,
+		       SmcSaveYourselfProcMask | SmcDieProcMask |
+		       SmcSaveCompleteProcMask |
+		       SmcShutdownCancelledProcMask,
+		       &callbacks,
+		       xsmp->client_id, &xsmp->ret_client_id,
+		       sizeof (xsmp->error_string), xsmp->error_string);
+
+  g_idle_add (sm_client_xsmp_connected, xsmp);
+
+  return NULL;
+}
+
+static gboolean
+sm_client_xsmp_start_connect (gpointer user_data)
+{
+  EggSMClientXSMP *xsmp = user_data;
+
+  xsmp->connect_idle = 0;
+
+  g_debug ("Connecting to the session manager");
+
+  ice_connect_begin ();
+  xsmp->connect_thread = g_thread_new ("egg-sm-client",
+				       sm_client_xsmp_connect_thread,
+				       g_object_ref (xsmp));
+  return FALSE;
+}
+
+static void
+sm_client_xsmp_startup (EggSMClient *client,
+			const char  *client_id)
+{
+  EggSMClientXSMP *xsmp = (EggSMClientXSMP *)client;
+
+  xsmp->client_id = g_strdup (client_id);
+
+  ice_init ();
+  SmcSetErrorHandler (smc_error_handler);
+
+  /* The ICE handshake can take a while when the session manager is
+   * busy: do not make the application wait for it, and let it get
+   * its windows on screen first.
+   */
+  xsmp->connecting = TRUE;
+  xsmp->connect_idle = g_idle_add_full (G_PRIORITY_LOW,
+					sm_client_xsmp_start_connect,
+					xsmp, NULL);
 }
 
 static void
@@ -479,6 +570,7 @@ sm_client_xsmp_end_session (EggSMClient         *client,
       switch (xsmp->state)
 	{
 	case XSMP_STATE_CONNECTION_CLOSED:
+	  /* also while still connecting */
 	  return FALSE;
 
 	case XSMP_STATE_SAVE_YOURSELF:
@@ -1071,6 +1163,43 @@ generate_command (char **restart_command, const char *client_id,
   return cmd;
 }
 
+/* Copies @prop and its values into a single block of memory, which
+ * free_props() can release like the ones built by the *_prop()
+ * functions below.
+ */
+static SmProp *
+copy_prop (SmProp *prop)
+{
+  SmProp *copy;
+  gsize size;
+  char *data;
+  int i;
+
+  size = sizeof (SmPropValue) * prop->num_vals;
+  for (i = 0; i < prop->num_vals; i++)
+    size += prop->vals[i].length;
+  size += strlen (prop->name) + 1 + strlen (prop->type) + 1;
+
+  copy = g_new (SmProp, 1);
+  copy->num_vals = prop->num_vals;
+  copy->vals = g_malloc (size);
+  data = (char *)(copy->vals + prop->num_vals);
+
+  for (i = 0; i < prop->num_vals; i++)
+    {
+      copy->vals[i].length = prop->vals[i].length;
+      copy->vals[i].value = data;
+      memcpy (data, prop->vals[i].value, prop->vals[i].length);
+      data += prop->vals[i].length;
+    }
+
+  copy->name = strcpy (data, prop->name);
+  data += strlen (prop->name) + 1;
+  copy->type = strcpy (data, prop->type);
+
+  return copy;
+}
+
 /* Takes a NULL-terminated list of SmProp * values, created by
  * array_prop, ptrarray_prop, string_prop, card8_prop, sets them, and
  * frees them.
@@ -1095,14 +1224,17 @@ set_properties (EggSMClientXSMP *xsmp, ...)
       SmcSetProperties (xsmp->connection, props->len,
 			(SmProp **)props->pdata);
     }
-
-  for (i = 0; i < props->len; i++)
+  else if (xsmp->connecting)
     {
-      prop = props->pdata[i];
-      g_free (prop->vals);
-      g_free (prop);
+      /* The values are not ours, keep copies until we are connected */
+      if (!xsmp->pending_props)
+	xsmp->pending_props = g_ptr_array_new ();
+
+      for (i = 0; i < props->len; i++)
+	g_ptr_array_add (xsmp->pending_props, copy_prop (props->pdata[i]));
     }
-  g_ptr_array_free (props, TRUE);
+
+  free_props (props);
 }
 
 /* Takes a NULL-terminated list of property names and deletes them. */
@@ -1281,6 +1413,33 @@ ice_init (void)
   IceAddConnectionWatch (ice_connection_watch, NULL);
 }
 
+/* While the connection thread runs, a new ICE connection is only
+ * noted, and watched from the main loop once the thread is done.
+ */
+static gboolean     ice_connecting = FALSE;
+static IceConn      ice_pending_conn = NULL;
+static IcePointer  *ice_pending_watch_data = NULL;
+
+static guint        ice_add_watch        (IceConn        ice_conn);
+
+static void
+ice_connect_begin (void)
+{
+  ice_connecting = TRUE;
+}
+
+static void
+ice_connect_end (void)
+{
+  ice_connecting = FALSE;
+
+  if (ice_pending_conn)
+    *ice_pending_watch_data = GUINT_TO_POINTER (ice_add_watch (ice_pending_conn));
+
+  ice_pending_conn = NULL;
+  ice_pending_watch_data = NULL;
+}
+
 static gboolean
 process_ice_messages (IceConn ice_conn)
 {
@@ -1313,6 +1472,22 @@ ice_iochannel_watch (GIOChannel   *channel G_GNUC_UNUSED,
   return process_ice_messages (client_data);
 }
 
+static guint
+ice_add_watch (IceConn ice_conn)
+{
+  GIOChannel *channel;
+  guint watch_id;
+  int fd = IceConnectionNumber (ice_conn);
+
+  fcntl (fd, F_SETFD, fcntl (fd, F_GETFD, 0) | FD_CLOEXEC);
+  channel = g_io_channel_unix_new (fd);
+  watch_id = g_io_add_watch (channel, G_IO_IN | G_IO_ERR,
+			     ice_iochannel_watch, ice_conn);
+  g_io_channel_unref (channel);
+
+  return watch_id;
+}
+
 static void
 ice_connection_watch (IceConn     ice_conn,
 		      IcePointer  client_data G_GNUC_UNUSED,
@@ -1323,21 +1498,28 @@ ice_connection_watch (IceConn     ice_conn,
 
   if (opening)
     {
-      GIOChannel *channel;
-      int fd = IceConnectionNumber (ice_conn);
-
-      fcntl (fd, F_SETFD, fcntl (fd, F_GETFD, 0) | FD_CLOEXEC);
-      channel = g_io_channel_unix_new (fd);
-      watch_id = g_io_add_watch (channel, G_IO_IN | G_IO_ERR,
-				 ice_iochannel_watch, ice_conn);
-      g_io_channel_unref (channel);
+      if (ice_connecting)
+	{
+	  /* called from the connection thread */
+	  ice_pending_conn = ice_conn;
+	  ice_pending_watch_data = watch_data;
+	  *watch_data = NULL;
+	  return;
+	}
 
-      *watch_data = GUINT_TO_POINTER (watch_id);
+      *watch_data = GUINT_TO_POINTER (ice_add_watch (ice_conn));
     }
   else
     {
+      if (ice_conn == ice_pending_conn)
+	{
+	  ice_pending_conn = NULL;
+	  ice_pending_watch_data = NULL;
+	}
+
       watch_id = GPOINTER_TO_UINT (*watch_data);
-      g_source_remove (watch_id);
+      if (watch_id)
+	g_source_remove (watch_id);
     }
 }
 
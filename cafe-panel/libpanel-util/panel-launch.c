@@ -22,7 +22,12 @@
  *	Vincent Untz <vuntz@gnome.org>
  */
 
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include <glib/gi18n.h>
+#include <glib-unix.h>
 #include <gio/gio.h>
 #include <gio/gdesktopappinfo.h>
 
@@ -33,6 +38,20 @@
 #include "panel-glib.h"
 
 #include "panel-launch.h"
+#include "panel-spawn-protocol.h"
+
+typedef struct {
+	char              *name;
+	CdkScreen         *screen;
+	GAppLaunchContext *context;
+	char              *startup_id;
+} PanelLaunchPending;
+
+/* socket to the spawn helper, -1 when launching in process */
+static int         spawn_helper_fd = -1;
+static guint       spawn_helper_watch = 0;
+static guint32     spawn_helper_serial = 0;
+static GHashTable *spawn_helper_pending = NULL;
 
 static void
 _panel_launch_error_dialog (const gchar *name,
@@ -94,27 +113,286 @@ gather_pid_callback (GDesktopAppInfo   *gapp G_GNUC_UNUSED,
 	g_child_watch_add (pid, dummy_child_watch, NULL);
 }
 
-gboolean
-panel_app_info_launch_uris (GDesktopAppInfo   *appinfo,
-			    GList      *uris,
-			    CdkScreen  *screen,
-			    const gchar *action,
-			    guint32     timestamp,
-			    GError    **error)
+static void
+panel_launch_pending_free (PanelLaunchPending *pending)
+{
+	g_free (pending->name);
+	g_object_unref (pending->screen);
+	g_object_unref (pending->context);
+	g_free (pending->startup_id);
+	g_slice_free (PanelLaunchPending, pending);
+}
+
+static void
+spawn_helper_stop (void)
+{
+	if (spawn_helper_fd == -1)
+		return;
+
+	g_source_remove (spawn_helper_watch);
+	spawn_helper_watch = 0;
+
+	close (spawn_helper_fd);
+	spawn_helper_fd = -1;
+
+	/* the outcome of those launches is unknown */
+	g_hash_table_destroy (spawn_helper_pending);
+	spawn_helper_pending = NULL;
+}
+
+static void
+spawn_helper_handle_reply (GVariant *reply)
+{
+	PanelLaunchPending *pending;
+	const char         *message;
+	guint32             serial;
+
+	g_variant_get (reply, "(u&s)", &serial, &message);
+
+	pending = g_hash_table_lookup (spawn_helper_pending,
+				       GUINT_TO_POINTER (serial));
+	if (!pending)
+		return;
+
+	if (message[0]) {
+		if (pending->startup_id)
+			g_app_launch_context_launch_failed (pending->context,
+							    pending->startup_id);
+		_panel_launch_error_dialog (pending->name, pending->screen, message);
+	}
+
+	g_hash_table_remove (spawn_helper_pending, GUINT_TO_POINTER (serial));
+}
+
+static gboolean
+spawn_helper_reply_ready (gint         fd,
+			  GIOCondition condition G_GNUC_UNUSED,
+			  gpointer     user_data G_GNUC_UNUSED)
+{
+	for (;;) {
+		GVariant *reply;
+		GBytes   *bytes;
+		gssize    size;
+		char     *data;
+
+		size = recv (fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size < 0 && errno == EAGAIN)
+			return G_SOURCE_CONTINUE;
+
+		if (size <= 0) {
+			g_warning ("The spawn helper went away, launching applications from the panel");
+			spawn_helper_watch = 0;
+			spawn_helper_stop ();
+			return G_SOURCE_REMOVE;
+		}
+
+		data = g_malloc (size);
+		size = recv (fd, data, size, 0);
+		if (size <= 0) {
+			g_free (data);
+			continue;
+		}
+
+		bytes = g_bytes_new_take (data, size);
+		reply = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PANEL_SPAWN_REPLY_TYPE),
+								      bytes, FALSE));
+		g_bytes_unref (bytes);
+
+		spawn_helper_handle_reply (reply);
+		g_variant_unref (reply);
+	}
+}
+
+void
+panel_launch_start_helper (void)
+{
+	GSubprocessLauncher *launcher;
+	GSubprocess         *helper;
+	GError              *error = NULL;
+	int                  fds[2];
+
+	if (spawn_helper_fd != -1)
+		return;
+
+	if (socketpair (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0) {
+		g_warning ("Cannot create a socket for the spawn helper: %s",
+			   g_strerror (errno));
+		return;
+	}
+
+	launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+	g_subprocess_launcher_take_fd (launcher, fds[1], PANEL_SPAWN_HELPER_FD);
+	helper = g_subprocess_launcher_spawn (launcher, &error,
+					      LIBEXECDIR "/cafe-panel-spawn-helper",
+					      NULL);
+	g_object_unref (launcher);
+
+	if (!helper) {
+		g_warning ("Cannot start the spawn helper: %s", error->message);
+		g_error_free (error);
+		close (fds[0]);
+		return;
+	}
+
+	/* it exits when we close our end of the socket */
+	g_object_unref (helper);
+
+	spawn_helper_fd = fds[0];
+	g_unix_set_fd_nonblocking (spawn_helper_fd, TRUE, NULL);
+	spawn_helper_watch = g_unix_fd_add (spawn_helper_fd,
+					    G_IO_IN | G_IO_HUP | G_IO_ERR,
+					    spawn_helper_reply_ready, NULL);
+	spawn_helper_pending = g_hash_table_new_full (NULL, NULL, NULL,
+						      (GDestroyNotify) panel_launch_pending_free);
+}
+
+/* Hands the launch to the spawn helper; returns FALSE if it could not
+ * take it, and the application has to be launched in process. */
+static gboolean
+panel_launch_with_helper (GDesktopAppInfo     *appinfo,
+			  GKeyFile            *keyfile,
+			  GList               *uris,
+			  CdkAppLaunchContext *context,
+			  CdkScreen           *screen,
+			  const gchar         *action)
+{
+	PanelLaunchPending *pending;
+	GVariantBuilder     uri_builder;
+	GVariantBuilder     env_builder;
+	GVariant           *request;
+	GList              *files = NULL;
+	GList              *l;
+	const char         *path;
+	char               *contents = NULL;
+	char               *program;
+	char               *display;
+	char               *variable;
+	char               *startup_id = NULL;
+	gssize              sent;
+
+	if (spawn_helper_fd == -1)
+		return FALSE;
+
+	/* let GLib report a missing program right away */
+	if (action == NULL) {
+		const char *executable;
+
+		executable = g_app_info_get_executable (G_APP_INFO (appinfo));
+		if (!executable)
+			return FALSE;
+
+		program = g_find_program_in_path (executable);
+		if (!program)
+			return FALSE;
+		g_free (program);
+	}
+
+	path = g_desktop_app_info_get_filename (appinfo);
+	if (!path) {
+		if (!keyfile)
+			return FALSE;
+		contents = g_key_file_to_data (keyfile, NULL, NULL);
+	}
+
+	g_variant_builder_init (&uri_builder, G_VARIANT_TYPE_STRING_ARRAY);
+	for (l = uris; l; l = l->next) {
+		g_variant_builder_add (&uri_builder, "s", (const char *) l->data);
+		files = g_list_prepend (files, g_file_new_for_uri (l->data));
+	}
+	files = g_list_reverse (files);
+
+	/* the helper has no display connection: the startup notification
+	 * is sent from here, as GLib would */
+	g_variant_builder_init (&env_builder, G_VARIANT_TYPE_STRING_ARRAY);
+
+	display = g_app_launch_context_get_display (G_APP_LAUNCH_CONTEXT (context),
+						    G_APP_INFO (appinfo), files);
+	if (display) {
+		variable = g_strconcat ("DISPLAY=", display, NULL);
+		g_variant_builder_add (&env_builder, "s", variable);
+		g_free (variable);
+	}
+
+	if (g_desktop_app_info_get_boolean (appinfo, "StartupNotify"))
+		startup_id = g_app_launch_context_get_startup_notify_id (G_APP_LAUNCH_CONTEXT (context),
+									 G_APP_INFO (appinfo), files);
+	if (startup_id) {
+		variable = g_strconcat ("DESKTOP_STARTUP_ID=", startup_id, NULL);
+		g_variant_builder_add (&env_builder, "s", variable);
+		g_free (variable);
+	}
+
+	g_list_free_full (files, g_object_unref);
+	g_free (display);
+
+	request = g_variant_ref_sink (g_variant_new (PANEL_SPAWN_REQUEST_TYPE,
+						     ++spawn_helper_serial,
+						     path ? path : "",
+						     contents ? contents : "",
+						     action ? action : "",
+						     &uri_builder,
+						     &env_builder));
+	g_free (contents);
+
+	sent = send (spawn_helper_fd,
+		     g_variant_get_data (request), g_variant_get_size (request),
+		     MSG_NOSIGNAL);
+	g_variant_unref (request);
+
+	if (sent < 0) {
+		if (errno != EAGAIN && errno != EINTR) {
+			g_warning ("Cannot talk to the spawn helper: %s",
+				   g_strerror (errno));
+			spawn_helper_stop ();
+		}
+
+		if (startup_id)
+			g_app_launch_context_launch_failed (G_APP_LAUNCH_CONTEXT (context),
+							    startup_id);
+		g_free (startup_id);
+
+		return FALSE;
+	}
+
+	pending = g_slice_new (PanelLaunchPending);
+	pending->name = g_strdup (g_app_info_get_name (G_APP_INFO (appinfo)));
+	pending->screen = g_object_ref (screen);
+	pending->context = g_object_ref (G_APP_LAUNCH_CONTEXT (context));
+	pending->startup_id = startup_id;
+	g_hash_table_insert (spawn_helper_pending,
+			     GUINT_TO_POINTER (spawn_helper_serial), pending);
+
+	return TRUE;
+}
+
+static gboolean
+panel_app_info_launch_uris_internal (GDesktopAppInfo *appinfo,
+				     GKeyFile        *keyfile,
+				     GList           *uris,
+				     CdkScreen       *screen,
+				     const gchar     *action,
+				     guint32          timestamp,
+				     GError         **error)
 {
 	CdkAppLaunchContext *context;
 	GError              *local_error;
 	gboolean             retval;
 
-	g_return_val_if_fail (G_IS_DESKTOP_APP_INFO (appinfo), FALSE);
-	g_return_val_if_fail (CDK_IS_SCREEN (screen), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-
 	CdkDisplay *display = cdk_display_get_default ();
 	context = cdk_display_get_app_launch_context (display);
 	cdk_app_launch_context_set_screen (context, screen);
 	cdk_app_launch_context_set_timestamp (context, timestamp);
 
+	/* the helper reports failures asynchronously, with a dialog: the
+	 * error is only set when the launch happens in process */
+	if (panel_launch_with_helper (appinfo, keyfile, uris,
+				      context, screen, action)) {
+		g_object_unref (context);
+		return TRUE;
+	}
+
 	local_error = NULL;
 	if (action == NULL) {
 		retval = g_desktop_app_info_launch_uris_as_manager (appinfo, uris,
@@ -136,6 +414,22 @@ panel_app_info_launch_uris (GDesktopAppInfo   *appinfo,
 					   screen, local_error, error);
 }
 
+gboolean
+panel_app_info_launch_uris (GDesktopAppInfo   *appinfo,
+			    GList      *uris,
+			    CdkScreen  *screen,
+			    const gchar *action,
+			    guint32     timestamp,
+			    GError    **error)
+{
+	g_return_val_if_fail (G_IS_DESKTOP_APP_INFO (appinfo), FALSE);
+	g_return_val_if_fail (CDK_IS_SCREEN (screen), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	return panel_app_info_launch_uris_internal (appinfo, NULL, uris, screen,
+						    action, timestamp, error);
+}
+
 gboolean
 panel_app_info_launch_uri (GDesktopAppInfo     *appinfo,
 			   const gchar  *uri,
@@ -180,10 +474,10 @@ panel_launch_key_file (GKeyFile   *keyfile,
 	if (appinfo == NULL)
 		return FALSE;
 
-	retval = panel_app_info_launch_uris (appinfo,
-					     uri_list, screen, action,
-					     ctk_get_current_event_time (),
-					     error);
+	retval = panel_app_info_launch_uris_internal (appinfo, keyfile,
+						      uri_list, screen, action,
+						      ctk_get_current_event_time (),
+						      error);
 
 	g_object_unref (appinfo);
 	return retval;
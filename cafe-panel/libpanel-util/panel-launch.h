@@ -32,6 +32,10 @@
 extern "C" {
 #endif
 
+/* Starts the helper that launches applications for the panel; until
+ * then, or if it fails, they are launched from the calling process. */
+void     panel_launch_start_helper  (void);
+
 gboolean panel_app_info_launch_uris (GDesktopAppInfo   *appinfo,
 				     GList      *uris,
 				     CdkScreen  *screen,
@@ -0,0 +1,229 @@
+/*
+ * panel-memory.c: account for the memory held by the panel caches
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <gio/gio.h>
+
+#include "panel-memory.h"
+
+typedef struct {
+	gpointer    owner;
+	const char *cache;
+	gsize       bytes;
+} PanelMemoryCharge;
+
+/* there are a few charges per toplevel and per launcher, a linear
+ * search is good enough */
+static GArray *memory_charges = NULL;
+static GSList *memory_shrinkers = NULL;
+static gsize   memory_total = 0;
+static gsize   memory_budget = 0;
+static guint   memory_enforce_id = 0;
+
+static gboolean
+panel_memory_enforce_budget (gpointer data G_GNUC_UNUSED)
+{
+	GSList *l;
+
+	memory_enforce_id = 0;
+
+	/* the shrinkers update their charges, stop as soon as the
+	 * budget is met */
+	for (l = memory_shrinkers; l; l = l->next) {
+		PanelMemoryShrinkFunc func = l->data;
+
+		if (memory_budget == 0 || memory_total <= memory_budget)
+			break;
+
+		func ();
+	}
+
+	if (memory_budget != 0 && memory_total > memory_budget)
+		g_debug ("Panel holds %" G_GSIZE_FORMAT " bytes in its caches, over the budget of %" G_GSIZE_FORMAT,
+			 memory_total, memory_budget);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+panel_memory_queue_enforce_budget (void)
+{
+	if (memory_budget == 0 || memory_total <= memory_budget ||
+	    memory_enforce_id != 0)
+		return;
+
+	memory_enforce_id = g_idle_add_full (G_PRIORITY_LOW,
+					     panel_memory_enforce_budget,
+					     NULL, NULL);
+	g_source_set_name_by_id (memory_enforce_id, "[cafe-panel] panel_memory_enforce_budget");
+}
+
+void
+panel_memory_charge (gpointer    owner,
+		     const char *cache,
+		     gsize       bytes)
+{
+	PanelMemoryCharge *charge;
+	guint              i;
+
+	g_return_if_fail (cache != NULL);
+
+	if (!memory_charges)
+		memory_charges = g_array_new (FALSE, FALSE, sizeof (PanelMemoryCharge));
+
+	for (i = 0; i < memory_charges->len; i++) {
+		charge = &g_array_index (memory_charges, PanelMemoryCharge, i);
+
+		if (charge->owner == owner && charge->cache == cache)
+			break;
+	}
+
+	if (i == memory_charges->len) {
+		PanelMemoryCharge new_charge = { owner, cache, 0 };
+
+		if (bytes == 0)
+			return;
+
+		g_array_append_val (memory_charges, new_charge);
+		charge = &g_array_index (memory_charges, PanelMemoryCharge, i);
+	}
+
+	memory_total -= charge->bytes;
+	memory_total += bytes;
+
+	if (bytes == 0) {
+		g_array_remove_index_fast (memory_charges, i);
+		return;
+	}
+
+	if (bytes > charge->bytes) {
+		charge->bytes = bytes;
+		panel_memory_queue_enforce_budget ();
+	} else
+		charge->bytes = bytes;
+}
+
+void
+panel_memory_add_shrinker (PanelMemoryShrinkFunc func)
+{
+	memory_shrinkers = g_slist_append (memory_shrinkers, func);
+}
+
+void
+panel_memory_set_budget (gsize budget)
+{
+	memory_budget = budget;
+
+	panel_memory_queue_enforce_budget ();
+}
+
+static void
+panel_memory_budget_changed (GSettings  *settings,
+			     const char *key,
+			     gpointer    user_data G_GNUC_UNUSED)
+{
+	panel_memory_set_budget ((gsize) g_settings_get_int (settings, key) * 1024);
+}
+
+/* Applets in their own process have their own caches to keep within
+ * the budget. */
+void
+panel_memory_follow_budget_setting (void)
+{
+	static gboolean        following = FALSE;
+	GSettingsSchemaSource *source;
+	GSettingsSchema       *schema;
+	GSettings             *settings;
+
+	if (following)
+		return;
+
+	following = TRUE;
+
+	source = g_settings_schema_source_get_default ();
+	if (!source)
+		return;
+
+	schema = g_settings_schema_source_lookup (source, "org.cafe.panel", TRUE);
+	if (!schema)
+		return;
+
+	if (g_settings_schema_has_key (schema, "memory-budget")) {
+		/* lives as long as the process */
+		settings = g_settings_new_full (schema, NULL, NULL);
+		g_signal_connect (settings, "changed::memory-budget",
+				  G_CALLBACK (panel_memory_budget_changed),
+				  NULL);
+		panel_memory_budget_changed (settings, "memory-budget", NULL);
+	}
+
+	g_settings_schema_unref (schema);
+}
+
+gsize
+panel_memory_get_budget (void)
+{
+	return memory_budget;
+}
+
+gsize
+panel_memory_get_total (void)
+{
+	return memory_total;
+}
+
+void
+panel_memory_foreach (PanelMemoryForeachFunc func,
+		      gpointer               user_data)
+{
+	guint i;
+
+	if (!memory_charges)
+		return;
+
+	for (i = 0; i < memory_charges->len; i++) {
+		PanelMemoryCharge *charge;
+
+		charge = &g_array_index (memory_charges, PanelMemoryCharge, i);
+		func (charge->owner, charge->cache, charge->bytes, user_data);
+	}
+}
+
+gsize
+panel_memory_pixbuf_size (GdkPixbuf *pixbuf)
+{
+	if (!pixbuf)
+		return 0;
+
+	return gdk_pixbuf_get_byte_length (pixbuf);
+}
+
+/* Only image surfaces live in our address space; the others are
+ * accounted by whoever holds their backing store. */
+gsize
+panel_memory_surface_size (cairo_surface_t *surface)
+{
+	if (!surface ||
+	    cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE)
+		return 0;
+
+	return (gsize) cairo_image_surface_get_stride (surface) *
+		cairo_image_surface_get_height (surface);
+}
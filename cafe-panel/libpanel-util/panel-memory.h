@@ -0,0 +1,67 @@
+/*
+ * panel-memory.h: account for the memory held by the panel caches
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_MEMORY_H__
+#define __PANEL_MEMORY_H__
+
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Drops whatever the cache can rebuild on demand. */
+typedef void (*PanelMemoryShrinkFunc)   (void);
+
+typedef void (*PanelMemoryForeachFunc)  (gpointer    owner,
+					 const char *cache,
+					 gsize       bytes,
+					 gpointer    user_data);
+
+/* Sets the number of bytes @owner holds in @cache, replacing the
+ * previous value; 0 forgets about it. @cache must be a static string.
+ * @owner is a PanelToplevel, an applet widget, another object, or NULL
+ * for memory that belongs to the process as a whole. */
+void  panel_memory_charge         (gpointer               owner,
+				   const char            *cache,
+				   gsize                  bytes);
+
+void  panel_memory_add_shrinker   (PanelMemoryShrinkFunc  func);
+
+/* 0 means no budget */
+void  panel_memory_set_budget     (gsize                  budget);
+gsize panel_memory_get_budget     (void);
+gsize panel_memory_get_total      (void);
+
+/* For the applets: keeps the budget to the memory-budget key of the
+ * panel settings. Does nothing the second time. */
+void  panel_memory_follow_budget_setting (void);
+
+void  panel_memory_foreach        (PanelMemoryForeachFunc func,
+				   gpointer               user_data);
+
+gsize panel_memory_pixbuf_size    (GdkPixbuf             *pixbuf);
+gsize panel_memory_surface_size   (cairo_surface_t       *surface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_MEMORY_H__ */
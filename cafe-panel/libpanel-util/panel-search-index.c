@@ -0,0 +1,214 @@
+/*
+ * panel-search-index.c: case insensitive substring search over many rows
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "panel-search-index.h"
+
+typedef struct {
+	GPtrArray *texts;
+	gboolean   matched;
+} PanelSearchRow;
+
+struct _PanelSearchIndex {
+	GHashTable *rows;
+	/* the rows matching the query, when there is one */
+	GPtrArray  *matches;
+	char       *query;
+	guint       n_lowered;
+};
+
+/* Lowers each character on its own, as panel_g_utf8_strstrcase() does,
+ * so that a substring of the lowered text is a match. */
+static char *
+panel_search_index_lower (PanelSearchIndex *index,
+			  const char       *text)
+{
+	GString    *lowered;
+	const char *p;
+
+	if (text == NULL || text[0] == '\0')
+		return NULL;
+
+	index->n_lowered++;
+
+	lowered = g_string_sized_new (strlen (text));
+
+	for (p = text; *p; p = g_utf8_next_char (p)) {
+		gunichar c;
+
+		c = g_utf8_get_char_validated (p, -1);
+		if (c == (gunichar) -1 || c == (gunichar) -2)
+			break;
+
+		g_string_append_unichar (lowered, g_unichar_tolower (c));
+	}
+
+	return g_string_free (lowered, FALSE);
+}
+
+static gboolean
+panel_search_row_matches (PanelSearchRow *row,
+			  const char     *query)
+{
+	guint i;
+
+	for (i = 0; i < row->texts->len; i++)
+		if (strstr (g_ptr_array_index (row->texts, i), query) != NULL)
+			return TRUE;
+
+	return FALSE;
+}
+
+static void
+panel_search_row_free (PanelSearchRow *row)
+{
+	g_ptr_array_free (row->texts, TRUE);
+	g_slice_free (PanelSearchRow, row);
+}
+
+PanelSearchIndex *
+panel_search_index_new (void)
+{
+	PanelSearchIndex *index;
+
+	index = g_slice_new0 (PanelSearchIndex);
+	index->rows = g_hash_table_new_full (NULL, NULL, NULL,
+					     (GDestroyNotify) panel_search_row_free);
+	index->matches = g_ptr_array_new ();
+
+	return index;
+}
+
+void
+panel_search_index_free (PanelSearchIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	g_hash_table_destroy (index->rows);
+	g_ptr_array_free (index->matches, TRUE);
+	g_free (index->query);
+	g_slice_free (PanelSearchIndex, index);
+}
+
+void
+panel_search_index_add (PanelSearchIndex *index,
+			gconstpointer     key,
+			const char       *text)
+{
+	PanelSearchRow *row;
+	char           *lowered;
+
+	g_return_if_fail (index != NULL);
+
+	row = g_hash_table_lookup (index->rows, key);
+	if (row == NULL) {
+		row = g_slice_new (PanelSearchRow);
+		row->texts = g_ptr_array_new_with_free_func (g_free);
+		row->matched = (index->query == NULL);
+		g_hash_table_insert (index->rows, (gpointer) key, row);
+	}
+
+	lowered = panel_search_index_lower (index, text);
+	if (lowered == NULL)
+		return;
+
+	g_ptr_array_add (row->texts, lowered);
+
+	if (index->query != NULL && !row->matched &&
+	    strstr (lowered, index->query) != NULL) {
+		row->matched = TRUE;
+		g_ptr_array_add (index->matches, row);
+	}
+}
+
+void
+panel_search_index_set_query (PanelSearchIndex *index,
+			      const char       *query)
+{
+	GHashTableIter  iter;
+	PanelSearchRow *row;
+	char           *lowered;
+	guint           i;
+
+	g_return_if_fail (index != NULL);
+
+	lowered = panel_search_index_lower (index, query);
+
+	if (g_strcmp0 (lowered, index->query) == 0) {
+		g_free (lowered);
+		return;
+	}
+
+	if (lowered != NULL && index->query != NULL &&
+	    strstr (lowered, index->query) != NULL) {
+		/* the query grew: only the previous matches can match */
+		i = 0;
+		while (i < index->matches->len) {
+			row = g_ptr_array_index (index->matches, i);
+
+			if (panel_search_row_matches (row, lowered)) {
+				i++;
+				continue;
+			}
+
+			row->matched = FALSE;
+			g_ptr_array_remove_index_fast (index->matches, i);
+		}
+	} else {
+		g_ptr_array_set_size (index->matches, 0);
+
+		g_hash_table_iter_init (&iter, index->rows);
+		while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &row)) {
+			row->matched = (lowered == NULL ||
+					panel_search_row_matches (row, lowered));
+			if (lowered != NULL && row->matched)
+				g_ptr_array_add (index->matches, row);
+		}
+	}
+
+	g_free (index->query);
+	index->query = lowered;
+}
+
+gboolean
+panel_search_index_matches (PanelSearchIndex *index,
+			    gconstpointer     key)
+{
+	PanelSearchRow *row;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+
+	row = g_hash_table_lookup (index->rows, key);
+	if (row == NULL)
+		return index->query == NULL;
+
+	return row->matched;
+}
+
+guint
+panel_search_index_get_n_lowered (PanelSearchIndex *index)
+{
+	g_return_val_if_fail (index != NULL, 0);
+
+	return index->n_lowered;
+}
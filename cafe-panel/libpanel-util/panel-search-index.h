@@ -0,0 +1,56 @@
+/*
+ * panel-search-index.h: case insensitive substring search over many rows
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef PANEL_SEARCH_INDEX_H
+#define PANEL_SEARCH_INDEX_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Matches the same rows as panel_g_utf8_strstrcase(), but the text of
+ * each row is lowered once when it is added, and a query that contains
+ * the previous one only looks at the rows the previous one matched. */
+typedef struct _PanelSearchIndex PanelSearchIndex;
+
+PanelSearchIndex *panel_search_index_new       (void);
+void              panel_search_index_free      (PanelSearchIndex *index);
+
+/* Adds @text to the texts of the row identified by @key; the row
+ * matches when any of its texts does. NULL texts are ignored. */
+void              panel_search_index_add       (PanelSearchIndex *index,
+						gconstpointer     key,
+						const char       *text);
+
+/* An empty or NULL query matches every row. */
+void              panel_search_index_set_query (PanelSearchIndex *index,
+						const char       *query);
+gboolean          panel_search_index_matches   (PanelSearchIndex *index,
+						gconstpointer     key);
+
+/* How many texts and queries were lowered so far, for the tests. */
+guint             panel_search_index_get_n_lowered (PanelSearchIndex *index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PANEL_SEARCH_INDEX_H */
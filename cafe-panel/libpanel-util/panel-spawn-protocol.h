@@ -0,0 +1,34 @@
+/*
+ * panel-spawn-protocol.h: messages between the panel and its spawn helper
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef PANEL_SPAWN_PROTOCOL_H
+#define PANEL_SPAWN_PROTOCOL_H
+
+/* The helper gets one end of a SOCK_SEQPACKET socketpair as this file
+ * descriptor; every packet is one serialized GVariant. */
+#define PANEL_SPAWN_HELPER_FD 3
+
+/* serial, desktop file path, desktop file contents (when there is no
+ * path), action (or ""), URIs, VARIABLE=value for the environment */
+#define PANEL_SPAWN_REQUEST_TYPE "(usssasas)"
+
+/* serial, error message (or "" when the launch succeeded) */
+#define PANEL_SPAWN_REPLY_TYPE   "(us)"
+
+#endif /* PANEL_SPAWN_PROTOCOL_H */
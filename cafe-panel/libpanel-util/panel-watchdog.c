@@ -0,0 +1,441 @@
+/*
+ * panel-watchdog.c: report main loop stalls
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+/* A high priority source notes when the main loop wakes up (check) and
+ * when it goes back to sleep (prepare). A helper thread waits for the
+ * loop to wake up, and if it is still busy with the same iteration once
+ * the threshold is over, it can interrupt the main thread with a signal
+ * whose handler records the source being dispatched and a backtrace.
+ * Everything is logged from the helper thread when the stall is over. */
+
+#include <config.h>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#ifdef G_OS_UNIX
+#include <pthread.h>
+#endif
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include "panel-watchdog.h"
+
+#if defined (G_OS_UNIX) && defined (SIGRTMIN)
+#define PANEL_WATCHDOG_CAN_INTERRUPT
+#define PANEL_WATCHDOG_SIGNAL      (SIGRTMIN + 1)
+#endif
+
+#define PANEL_WATCHDOG_MAX_FRAMES  24
+/* panel_watchdog_capture() and the signal trampoline */
+#define PANEL_WATCHDOG_SKIP_FRAMES 2
+
+static const guint histogram_limits [] = { 100, 250, 500, 1000, 2500, 5000 };
+#define PANEL_WATCHDOG_N_BUCKETS   (G_N_ELEMENTS (histogram_limits) + 1)
+
+static GMutex    watchdog_lock;
+static GCond     watchdog_cond;
+static GThread  *watchdog_thread = NULL;
+static GSource  *watchdog_source = NULL;
+
+/* protected by watchdog_lock */
+static gboolean  watchdog_running = FALSE;
+static gboolean  watchdog_idle_wait = FALSE;
+static gboolean  watchdog_stalled = FALSE;
+static gint64    watchdog_threshold = 0;
+static gint64    watchdog_busy_since = 0;
+static gint64    watchdog_stall_duration = 0;
+static guint     watchdog_iteration = 0;
+static gboolean  watchdog_interrupt = FALSE;
+
+/* only used by the helper thread */
+static guint     watchdog_histogram [PANEL_WATCHDOG_N_BUCKETS];
+
+#ifdef PANEL_WATCHDOG_CAN_INTERRUPT
+/* capture_state hands the capture_* variables over between the helper
+ * thread, which requests a capture and reads it, and the signal
+ * handler, which fills it in on the main thread */
+enum {
+	CAPTURE_IDLE,
+	CAPTURE_REQUESTED,
+	CAPTURE_WRITING,
+	CAPTURE_DONE
+};
+
+/* only used by the main thread */
+static gboolean          handler_installed = FALSE;
+static struct sigaction  previous_action;
+
+static pthread_t         main_thread;
+static gint              capture_state = CAPTURE_IDLE;
+static guint             capture_iteration = 0;
+static char              capture_source [128];
+static int               capture_priority = 0;
+#ifdef HAVE_EXECINFO_H
+static void             *capture_frames [PANEL_WATCHDOG_MAX_FRAMES];
+static int               capture_n_frames = 0;
+#endif
+
+static void
+panel_watchdog_capture (int signum G_GNUC_UNUSED)
+{
+	GSource    *source;
+	const char *name;
+
+	/* the request may have been given up already */
+	if (!g_atomic_int_compare_and_exchange (&capture_state,
+						CAPTURE_REQUESTED,
+						CAPTURE_WRITING))
+		return;
+
+	/* we interrupted the main thread in the middle of the slow
+	 * callback: only copy things around, do not allocate or lock.
+	 * watchdog_iteration is only written by this thread. */
+	source = g_main_current_source ();
+	if (source) {
+		name = g_source_get_name (source);
+		capture_priority = g_source_get_priority (source);
+	} else {
+		name = "(none)";
+		capture_priority = 0;
+	}
+
+	g_strlcpy (capture_source, name ? name : "(unnamed)",
+		   sizeof (capture_source));
+#ifdef HAVE_EXECINFO_H
+	capture_n_frames = backtrace (capture_frames, PANEL_WATCHDOG_MAX_FRAMES);
+#endif
+	capture_iteration = watchdog_iteration;
+	g_atomic_int_set (&capture_state, CAPTURE_DONE);
+}
+
+/* returns whether the capture of iteration can be read, in which case
+ * it has to be released with panel_watchdog_release_capture() */
+static gboolean
+panel_watchdog_claim_capture (guint iteration)
+{
+	/* a handler that did not run yet will find nothing to do */
+	if (g_atomic_int_compare_and_exchange (&capture_state,
+					       CAPTURE_REQUESTED,
+					       CAPTURE_IDLE))
+		return FALSE;
+
+	/* the handler runs on the main thread and never blocks */
+	while (g_atomic_int_get (&capture_state) == CAPTURE_WRITING)
+		g_thread_yield ();
+
+	if (g_atomic_int_get (&capture_state) != CAPTURE_DONE)
+		return FALSE;
+
+	if (capture_iteration != iteration) {
+		g_atomic_int_set (&capture_state, CAPTURE_IDLE);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+panel_watchdog_release_capture (void)
+{
+	g_atomic_int_set (&capture_state, CAPTURE_IDLE);
+}
+
+static gboolean
+panel_watchdog_install_handler (void)
+{
+	struct sigaction action;
+
+	if (handler_installed)
+		return TRUE;
+
+	/* leave the signal alone if the process uses it */
+	if (sigaction (PANEL_WATCHDOG_SIGNAL, NULL, &previous_action) != 0 ||
+	    (previous_action.sa_flags & SA_SIGINFO) ||
+	    previous_action.sa_handler != SIG_DFL)
+		return FALSE;
+
+	main_thread = pthread_self ();
+
+	memset (&action, 0, sizeof (action));
+	action.sa_handler = panel_watchdog_capture;
+	action.sa_flags = SA_RESTART;
+	sigemptyset (&action.sa_mask);
+	if (sigaction (PANEL_WATCHDOG_SIGNAL, &action, NULL) != 0)
+		return FALSE;
+
+	handler_installed = TRUE;
+
+#ifdef HAVE_EXECINFO_H
+	{
+		void *frame;
+
+		/* the first call loads the unwinder, which must not happen
+		 * from the signal handler */
+		backtrace (&frame, 1);
+	}
+#endif
+
+	return TRUE;
+}
+
+/* the helper thread must have been joined: a signal it sent has been
+ * delivered by then */
+static void
+panel_watchdog_remove_handler (void)
+{
+	if (!handler_installed)
+		return;
+
+	sigaction (PANEL_WATCHDOG_SIGNAL, &previous_action, NULL);
+	handler_installed = FALSE;
+	g_atomic_int_set (&capture_state, CAPTURE_IDLE);
+}
+#endif /* PANEL_WATCHDOG_CAN_INTERRUPT */
+
+static void
+panel_watchdog_log (gint64 duration,
+		    guint  iteration)
+{
+	GString *report;
+	guint    i;
+
+	report = g_string_new (NULL);
+	g_string_append_printf (report, "Main loop blocked for %" G_GINT64_FORMAT " ms",
+				duration / G_TIME_SPAN_MILLISECOND);
+
+#ifdef PANEL_WATCHDOG_CAN_INTERRUPT
+	if (panel_watchdog_claim_capture (iteration)) {
+		g_string_append_printf (report, " in source %s (priority %d)",
+					capture_source, capture_priority);
+#ifdef HAVE_EXECINFO_H
+		if (capture_n_frames > PANEL_WATCHDOG_SKIP_FRAMES) {
+			char **symbols;
+			int    n;
+
+			n = capture_n_frames - PANEL_WATCHDOG_SKIP_FRAMES;
+			symbols = backtrace_symbols (capture_frames + PANEL_WATCHDOG_SKIP_FRAMES, n);
+			for (i = 0; symbols && i < (guint) n; i++)
+				g_string_append_printf (report, "\n  #%u %s", i, symbols [i]);
+			free (symbols);
+		}
+#endif
+		panel_watchdog_release_capture ();
+	}
+#else
+	(void) iteration;
+#endif
+
+	g_string_append (report, "\nStalls so far:");
+	for (i = 0; i < G_N_ELEMENTS (histogram_limits); i++)
+		g_string_append_printf (report, " <%u ms: %u,",
+					histogram_limits [i], watchdog_histogram [i]);
+	g_string_append_printf (report, " more: %u",
+				watchdog_histogram [PANEL_WATCHDOG_N_BUCKETS - 1]);
+
+	g_warning ("%s", report->str);
+	g_string_free (report, TRUE);
+}
+
+static void
+panel_watchdog_add_to_histogram (gint64 duration)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (histogram_limits); i++)
+		if (duration < histogram_limits [i] * G_TIME_SPAN_MILLISECOND)
+			break;
+
+	watchdog_histogram [i]++;
+}
+
+static gpointer
+panel_watchdog_thread (gpointer data G_GNUC_UNUSED)
+{
+	g_mutex_lock (&watchdog_lock);
+
+	while (watchdog_running) {
+		gint64 since;
+		gint64 duration;
+		guint  iteration;
+
+		if (!watchdog_busy_since) {
+			watchdog_idle_wait = TRUE;
+			g_cond_wait (&watchdog_cond, &watchdog_lock);
+			watchdog_idle_wait = FALSE;
+			continue;
+		}
+
+		since = watchdog_busy_since;
+		iteration = watchdog_iteration;
+
+		g_cond_wait_until (&watchdog_cond, &watchdog_lock,
+				   since + watchdog_threshold);
+
+		if (!watchdog_running ||
+		    !watchdog_busy_since ||
+		    watchdog_iteration != iteration ||
+		    g_get_monotonic_time () < since + watchdog_threshold)
+			continue;
+
+		/* still in the same iteration: the loop is stuck */
+		watchdog_stalled = TRUE;
+#ifdef PANEL_WATCHDOG_CAN_INTERRUPT
+		if (watchdog_interrupt) {
+			g_atomic_int_set (&capture_state, CAPTURE_REQUESTED);
+			pthread_kill (main_thread, PANEL_WATCHDOG_SIGNAL);
+		}
+#endif
+
+		while (watchdog_running &&
+		       watchdog_busy_since &&
+		       watchdog_iteration == iteration)
+			g_cond_wait (&watchdog_cond, &watchdog_lock);
+
+		watchdog_stalled = FALSE;
+		duration = watchdog_stall_duration;
+
+		if (!watchdog_running)
+			break;
+
+		g_mutex_unlock (&watchdog_lock);
+
+		panel_watchdog_add_to_histogram (duration);
+		panel_watchdog_log (duration, iteration);
+
+		g_mutex_lock (&watchdog_lock);
+	}
+
+	g_mutex_unlock (&watchdog_lock);
+
+	return NULL;
+}
+
+static gboolean
+panel_watchdog_source_prepare (GSource *source G_GNUC_UNUSED,
+			       gint    *timeout)
+{
+	g_mutex_lock (&watchdog_lock);
+
+	if (watchdog_stalled) {
+		watchdog_stall_duration = g_get_monotonic_time () - watchdog_busy_since;
+		g_cond_signal (&watchdog_cond);
+	}
+	watchdog_busy_since = 0;
+
+	g_mutex_unlock (&watchdog_lock);
+
+	*timeout = -1;
+
+	return FALSE;
+}
+
+static gboolean
+panel_watchdog_source_check (GSource *source G_GNUC_UNUSED)
+{
+	g_mutex_lock (&watchdog_lock);
+
+	watchdog_busy_since = g_get_monotonic_time ();
+	watchdog_iteration++;
+	if (watchdog_idle_wait)
+		g_cond_signal (&watchdog_cond);
+
+	g_mutex_unlock (&watchdog_lock);
+
+	return FALSE;
+}
+
+static gboolean
+panel_watchdog_source_dispatch (GSource     *source G_GNUC_UNUSED,
+				GSourceFunc  callback G_GNUC_UNUSED,
+				gpointer     user_data G_GNUC_UNUSED)
+{
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs panel_watchdog_source_funcs = {
+	panel_watchdog_source_prepare,
+	panel_watchdog_source_check,
+	panel_watchdog_source_dispatch,
+	NULL
+};
+
+static void
+panel_watchdog_stop (void)
+{
+	if (!watchdog_thread)
+		return;
+
+	g_source_destroy (watchdog_source);
+	g_source_unref (watchdog_source);
+	watchdog_source = NULL;
+
+	g_mutex_lock (&watchdog_lock);
+	watchdog_running = FALSE;
+	g_cond_signal (&watchdog_cond);
+	g_mutex_unlock (&watchdog_lock);
+
+	g_thread_join (watchdog_thread);
+	watchdog_thread = NULL;
+
+#ifdef PANEL_WATCHDOG_CAN_INTERRUPT
+	panel_watchdog_remove_handler ();
+#endif
+	watchdog_interrupt = FALSE;
+}
+
+void
+panel_watchdog_set_threshold (guint    threshold_ms,
+			      gboolean interrupt)
+{
+	if (threshold_ms == 0) {
+		panel_watchdog_stop ();
+		return;
+	}
+
+#ifdef PANEL_WATCHDOG_CAN_INTERRUPT
+	/* the handler stays until the watchdog stops */
+	if (interrupt)
+		interrupt = panel_watchdog_install_handler ();
+#else
+	interrupt = FALSE;
+#endif
+
+	g_mutex_lock (&watchdog_lock);
+	watchdog_threshold = threshold_ms * G_TIME_SPAN_MILLISECOND;
+	watchdog_interrupt = interrupt;
+	g_mutex_unlock (&watchdog_lock);
+
+	if (watchdog_thread)
+		return;
+
+	watchdog_running = TRUE;
+	watchdog_busy_since = 0;
+
+	watchdog_source = g_source_new (&panel_watchdog_source_funcs, sizeof (GSource));
+	g_source_set_priority (watchdog_source, G_PRIORITY_HIGH);
+	g_source_set_name (watchdog_source, "[panel] watchdog");
+	g_source_attach (watchdog_source, NULL);
+
+	watchdog_thread = g_thread_new ("panel-watchdog", panel_watchdog_thread, NULL);
+}
@@ -0,0 +1,46 @@
+/*
+ * panel-watchdog.h: report main loop stalls
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef PANEL_WATCHDOG_H
+#define PANEL_WATCHDOG_H
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Must be called from the thread running the default main context. A
+ * threshold of 0 stops the watchdog; any other value starts it, or
+ * changes the threshold of the running one.
+ *
+ * With interrupt, the main thread is interrupted with a signal when it
+ * stalls, to report the source and backtrace it is stuck in. The
+ * signal handler is process-wide, so this is only for processes that
+ * own all of their code, and it is skipped if the signal already has a
+ * handler. */
+G_GNUC_INTERNAL
+void panel_watchdog_set_threshold (guint    threshold_ms,
+				   gboolean interrupt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PANEL_WATCHDOG_H */
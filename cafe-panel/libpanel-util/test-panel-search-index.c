@@ -0,0 +1,242 @@
+/*
+ * test-panel-search-index.c: tests for the search index of the dialogs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "panel-glib.h"
+#include "panel-search-index.h"
+
+typedef struct {
+	const char *name;
+	const char *description;
+} TestRow;
+
+static const TestRow rows [] = {
+	{ "Terminal",           "Use the command line" },
+	{ "Text Editor",        "Edit text files" },
+	{ "Éditeur de texte",   NULL },
+	{ "Straße",             "Karten und Routen" },
+	{ "ÅNGSTRÖM",           "Units of length" },
+	{ "System Monitor",     "View current processes and monitor system state" },
+	{ "Character Map",      "Insert special characters into documents" },
+	{ NULL,                 "A row with a description only" },
+	{ NULL,                 NULL },
+	{ "Disks",              "" },
+};
+
+#define ROW_KEY(i) GINT_TO_POINTER ((i) + 1)
+
+static PanelSearchIndex *
+create_index (void)
+{
+	PanelSearchIndex *index;
+	guint             n_texts = 0;
+	guint             i;
+
+	index = panel_search_index_new ();
+
+	for (i = 0; i < G_N_ELEMENTS (rows); i++) {
+		panel_search_index_add (index, ROW_KEY (i), rows[i].name);
+		panel_search_index_add (index, ROW_KEY (i), rows[i].description);
+
+		n_texts += !PANEL_GLIB_STR_EMPTY (rows[i].name);
+		n_texts += !PANEL_GLIB_STR_EMPTY (rows[i].description);
+	}
+
+	/* each text is lowered once, when it is added */
+	g_assert_cmpuint (panel_search_index_get_n_lowered (index), ==, n_texts);
+
+	return index;
+}
+
+/* what the dialogs did before the index existed */
+static gboolean
+linear_matches (const TestRow *row,
+		const char    *query)
+{
+	if (query == NULL || query[0] == '\0')
+		return TRUE;
+
+	return (panel_g_utf8_strstrcase (row->name, query) != NULL ||
+		panel_g_utf8_strstrcase (row->description, query) != NULL);
+}
+
+static guint
+assert_same_as_linear (PanelSearchIndex *index,
+		       const char       *query)
+{
+	guint matched = 0;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (rows); i++) {
+		gboolean expected;
+
+		expected = linear_matches (&rows[i], query);
+		if (panel_search_index_matches (index, ROW_KEY (i)) != expected)
+			g_error ("row %u: expected %s for query '%s'",
+				 i, expected ? "a match" : "no match", query);
+
+		if (expected)
+			matched++;
+	}
+
+	return matched;
+}
+
+/* a keystroke lowers the query, never the texts of the rows again */
+static void
+set_query_lowering_once (PanelSearchIndex *index,
+			 const char       *query)
+{
+	guint n_lowered;
+
+	n_lowered = panel_search_index_get_n_lowered (index);
+	panel_search_index_set_query (index, query);
+	g_assert_cmpuint (panel_search_index_get_n_lowered (index) - n_lowered, <=, 1);
+}
+
+static void
+test_linear (void)
+{
+	PanelSearchIndex *index;
+	const char       *queries [] = {
+		"", "t", "te", "TE", "text", "x", "é", "ÉDIT", "straße",
+		"STRASSE", "ö", "ångström", "monitor system", "", "e", "zzz",
+		"units", "ap",
+	};
+	guint             i;
+
+	index = create_index ();
+
+	assert_same_as_linear (index, NULL);
+
+	for (i = 0; i < G_N_ELEMENTS (queries); i++) {
+		panel_search_index_set_query (index, queries[i]);
+		assert_same_as_linear (index, queries[i]);
+	}
+
+	panel_search_index_set_query (index, NULL);
+	assert_same_as_linear (index, NULL);
+
+	panel_search_index_free (index);
+}
+
+/* typing: each longer prefix only keeps rows of the previous one */
+static void
+test_narrowing (void)
+{
+	PanelSearchIndex *index;
+	const char       *typed = "terminal";
+	gboolean          before [G_N_ELEMENTS (rows)];
+	guint             previous;
+	guint             len;
+	guint             i;
+
+	index = create_index ();
+	previous = G_N_ELEMENTS (rows);
+
+	for (len = 1; len <= strlen (typed); len++) {
+		char  *query;
+		guint  matched;
+
+		for (i = 0; i < G_N_ELEMENTS (rows); i++)
+			before[i] = panel_search_index_matches (index, ROW_KEY (i));
+
+		query = g_strndup (typed, len);
+		set_query_lowering_once (index, query);
+
+		for (i = 0; i < G_N_ELEMENTS (rows); i++)
+			if (panel_search_index_matches (index, ROW_KEY (i)))
+				g_assert_true (before[i]);
+
+		matched = assert_same_as_linear (index, query);
+		g_assert_cmpuint (matched, <=, previous);
+		previous = matched;
+
+		g_free (query);
+	}
+
+	g_assert_cmpuint (previous, ==, 1);
+
+	panel_search_index_free (index);
+}
+
+/* deleting characters has to bring back the rows the longer query
+ * dropped */
+static void
+test_backspace (void)
+{
+	PanelSearchIndex *index;
+	const char       *typed [] = {
+		"s", "st", "sta", "stat", "state", "stat", "sta", "st", "s", "",
+		"e", "ed", "edi", "ed", "e", "ex", "e", "",
+	};
+	guint             i;
+
+	index = create_index ();
+
+	for (i = 0; i < G_N_ELEMENTS (typed); i++) {
+		set_query_lowering_once (index, typed[i]);
+		assert_same_as_linear (index, typed[i]);
+	}
+
+	panel_search_index_free (index);
+}
+
+/* the Add to Panel dialog keeps adding rows while the user types */
+static void
+test_add_after_query (void)
+{
+	PanelSearchIndex *index;
+	guint             i;
+
+	index = panel_search_index_new ();
+	panel_search_index_set_query (index, "te");
+
+	for (i = 0; i < G_N_ELEMENTS (rows); i++) {
+		panel_search_index_add (index, ROW_KEY (i), rows[i].name);
+		panel_search_index_add (index, ROW_KEY (i), rows[i].description);
+	}
+	assert_same_as_linear (index, "te");
+
+	panel_search_index_set_query (index, "tex");
+	assert_same_as_linear (index, "tex");
+
+	panel_search_index_set_query (index, "t");
+	assert_same_as_linear (index, "t");
+
+	panel_search_index_free (index);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/search-index/linear", test_linear);
+	g_test_add_func ("/search-index/narrowing", test_narrowing);
+	g_test_add_func ("/search-index/backspace", test_backspace);
+	g_test_add_func ("/search-index/add-after-query", test_add_after_query);
+
+	return g_test_run ();
+}
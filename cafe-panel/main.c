@@ -19,6 +19,7 @@
 
 #include <libpanel-util/panel-cleanup.h>
 #include <libpanel-util/panel-glib.h>
+#include <libpanel-util/panel-launch.h>
 
 #include "panel-profile.h"
 #include "panel-config-global.h"
@@ -167,6 +168,9 @@ main (int argc, char **argv)
 		return -1;
 	}
 
+	/* while the panel is still small */
+	panel_launch_start_helper ();
+
 	display = cdk_display_get_default ();
 
 #ifdef HAVE_X11
@@ -45,6 +45,7 @@
 #include "panel-action-button.h"
 #include "panel-profile.h"
 #include "panel-menu-button.h"
+#include "panel-menu-bar.h"
 #include "panel-menu-items.h"
 #include "panel-globals.h"
 #include "panel-run-dialog.h"
@@ -903,6 +904,9 @@ submenu_to_display (CtkWidget *menu)
 					     "panel-menu-append-callback-data");
 	if (append_callback)
 		append_callback (menu, append_data);
+
+	/* whatever was not picked up again by the repopulation is gone */
+	g_object_set_data (G_OBJECT (menu), "panel-menu-reusable-submenus", NULL);
 }
 
 static gboolean
@@ -949,6 +953,7 @@ create_fake_menu (CafeMenuTreeDirectory *directory)
 				   submenu_to_display_in_idle,
 				   menu,
 				   NULL);
+	g_source_set_name_by_id (idle_id, "[cafe-panel] submenu_to_display_in_idle");
 	g_object_set_data_full (G_OBJECT (menu),
 				"panel-menu-idle-id",
 				GUINT_TO_POINTER (idle_id),
@@ -977,6 +982,250 @@ panel_image_menu_item_new (void)
 	return menuitem;
 }
 
+/* Subtrees that survive a menu tree reload.
+ *
+ * When the tree changes, the submenus of the top level are kept aside
+ * together with a signature of the directory they were built from; a
+ * submenu is then re-attached as is if the reloaded directory has the
+ * same signature, so that only the categories that really changed get
+ * rebuilt (and lose their loaded icons).
+ */
+typedef struct {
+	CtkWidget *submenu;
+	char      *signature;
+} ReusableSubmenu;
+
+static void append_directory_signature (GString            *signature,
+					CafeMenuTreeDirectory *directory);
+
+static void
+append_icon_signature (GString *signature,
+		       GIcon   *gicon)
+{
+	char *icon;
+
+	icon = gicon ? g_icon_to_string (gicon) : NULL;
+	g_string_append (signature, icon ? icon : "");
+	g_string_append_c (signature, '\x1f');
+	g_free (icon);
+}
+
+static void
+append_string_signature (GString    *signature,
+			 const char *str)
+{
+	g_string_append (signature, str ? str : "");
+	g_string_append_c (signature, '\x1f');
+}
+
+static void
+append_entry_signature (GString            *signature,
+			CafeMenuTreeEntry     *entry)
+{
+	GDesktopAppInfo *ginfo;
+
+	ginfo = cafemenu_tree_entry_get_app_info (entry);
+
+	g_string_append_c (signature, 'e');
+	append_string_signature (signature, cafemenu_tree_entry_get_desktop_file_path (entry));
+	append_string_signature (signature, g_app_info_get_name (G_APP_INFO (ginfo)));
+	append_string_signature (signature, g_app_info_get_description (G_APP_INFO (ginfo)));
+	append_string_signature (signature, g_desktop_app_info_get_generic_name (ginfo));
+	append_string_signature (signature, g_app_info_get_commandline (G_APP_INFO (ginfo)));
+	append_icon_signature (signature, g_app_info_get_icon (G_APP_INFO (ginfo)));
+}
+
+static void
+append_directory_header_signature (GString            *signature,
+				   CafeMenuTreeDirectory *directory)
+{
+	append_string_signature (signature, cafemenu_tree_directory_get_name (directory));
+	append_string_signature (signature, cafemenu_tree_directory_get_comment (directory));
+	append_icon_signature (signature, cafemenu_tree_directory_get_icon (directory));
+}
+
+static void
+append_alias_signature (GString        *signature,
+			CafeMenuTreeAlias *alias)
+{
+	gpointer item;
+
+	g_string_append_c (signature, 'a');
+
+	item = cafemenu_tree_alias_get_directory (alias);
+	append_directory_header_signature (signature, item);
+
+	switch (cafemenu_tree_alias_get_aliased_item_type (alias)) {
+	case CAFEMENU_TREE_ITEM_DIRECTORY:
+		append_directory_signature (signature, item);
+		break;
+
+	case CAFEMENU_TREE_ITEM_ENTRY: {
+		gpointer entry;
+
+		entry = cafemenu_tree_alias_get_aliased_entry (alias);
+		append_entry_signature (signature, entry);
+		cafemenu_tree_item_unref (entry);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	cafemenu_tree_item_unref (item);
+}
+
+static void
+append_directory_signature (GString            *signature,
+			    CafeMenuTreeDirectory *directory)
+{
+	CafeMenuTreeIter     *iter;
+	CafeMenuTreeItemType  type;
+
+	g_string_append_c (signature, 'd');
+	append_directory_header_signature (signature, directory);
+
+	iter = cafemenu_tree_directory_iter (directory);
+	while ((type = cafemenu_tree_iter_next (iter)) != CAFEMENU_TREE_ITEM_INVALID) {
+		gpointer item;
+
+		switch (type) {
+		case CAFEMENU_TREE_ITEM_DIRECTORY:
+			item = cafemenu_tree_iter_get_directory (iter);
+			append_directory_signature (signature, item);
+			cafemenu_tree_item_unref (item);
+			break;
+
+		case CAFEMENU_TREE_ITEM_ENTRY:
+			item = cafemenu_tree_iter_get_entry (iter);
+			append_entry_signature (signature, item);
+			cafemenu_tree_item_unref (item);
+			break;
+
+		case CAFEMENU_TREE_ITEM_SEPARATOR:
+			g_string_append_c (signature, 's');
+			break;
+
+		case CAFEMENU_TREE_ITEM_ALIAS:
+			item = cafemenu_tree_iter_get_alias (iter);
+			append_alias_signature (signature, item);
+			cafemenu_tree_item_unref (item);
+			break;
+
+		case CAFEMENU_TREE_ITEM_HEADER: {
+			CafeMenuTreeDirectory *header_directory;
+
+			item = cafemenu_tree_iter_get_header (iter);
+			header_directory = cafemenu_tree_header_get_directory (item);
+			g_string_append_c (signature, 'h');
+			append_directory_header_signature (signature, header_directory);
+			cafemenu_tree_item_unref (header_directory);
+			cafemenu_tree_item_unref (item);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+	cafemenu_tree_iter_unref (iter);
+
+	g_string_append_c (signature, '\x1e');
+}
+
+static char *
+get_directory_signature (CafeMenuTreeDirectory *directory)
+{
+	GString *signature;
+
+	signature = g_string_new (NULL);
+	append_directory_signature (signature, directory);
+
+	return g_string_free (signature, FALSE);
+}
+
+static void
+reusable_submenu_free (ReusableSubmenu *reusable)
+{
+	if (reusable->submenu) {
+		ctk_widget_destroy (reusable->submenu);
+		g_object_unref (reusable->submenu);
+	}
+
+	g_free (reusable->signature);
+	g_free (reusable);
+}
+
+static void
+keep_reusable_submenu (GHashTable  *reusables,
+		       CtkMenuItem *menuitem)
+{
+	ReusableSubmenu    *reusable;
+	CafeMenuTreeDirectory *directory;
+	CtkWidget          *submenu;
+	const char         *menu_id;
+
+	submenu = ctk_menu_item_get_submenu (menuitem);
+	if (!submenu)
+		return;
+
+	directory = g_object_get_data (G_OBJECT (submenu),
+				       "panel-menu-tree-directory");
+	if (!directory)
+		return;
+
+	menu_id = cafemenu_tree_directory_get_menu_id (directory);
+	if (!menu_id || g_hash_table_contains (reusables, menu_id))
+		return;
+
+	reusable = g_new0 (ReusableSubmenu, 1);
+	reusable->submenu = g_object_ref (submenu);
+	reusable->signature = get_directory_signature (directory);
+
+	/* detach it, or it would be destroyed along with its menu item */
+	ctk_menu_item_set_submenu (menuitem, NULL);
+
+	g_hash_table_insert (reusables, g_strdup (menu_id), reusable);
+}
+
+static CtkWidget *
+take_reusable_submenu (CtkWidget          *menu,
+		       CafeMenuTreeDirectory *directory)
+{
+	ReusableSubmenu *reusable;
+	GHashTable      *reusables;
+	CtkWidget       *submenu;
+	const char      *menu_id;
+	char            *signature;
+
+	reusables = g_object_get_data (G_OBJECT (menu),
+				       "panel-menu-reusable-submenus");
+	if (!reusables)
+		return NULL;
+
+	menu_id = cafemenu_tree_directory_get_menu_id (directory);
+	if (!menu_id)
+		return NULL;
+
+	reusable = g_hash_table_lookup (reusables, menu_id);
+	if (!reusable)
+		return NULL;
+
+	signature = get_directory_signature (directory);
+	if (strcmp (signature, reusable->signature) != 0) {
+		g_free (signature);
+		return NULL;
+	}
+	g_free (signature);
+
+	submenu = reusable->submenu;
+	reusable->submenu = NULL;
+	g_hash_table_remove (reusables, menu_id);
+
+	return submenu;
+}
+
 static CtkWidget *
 create_submenu_entry (CtkWidget          *menu,
 		      CafeMenuTreeDirectory *directory)
@@ -1012,6 +1261,7 @@ create_submenu (CtkWidget          *menu,
 {
 	CtkWidget *menuitem;
 	CtkWidget *submenu;
+	CtkWidget *reused;
 	gboolean   force_categories_icon;
 
 	if (alias_directory)
@@ -1019,10 +1269,17 @@ create_submenu (CtkWidget          *menu,
 	else
 		menuitem = create_submenu_entry (menu, directory);
 
-	submenu = create_fake_menu (directory);
+	reused = NULL;
+	if (!alias_directory)
+		reused = take_reusable_submenu (menu, directory);
+
+	submenu = reused ? reused : create_fake_menu (directory);
 
 	ctk_menu_item_set_submenu (CTK_MENU_ITEM (menuitem), submenu);
 
+	if (reused)
+		g_object_unref (reused);
+
 	/* Keep the infor that we force (or not) the icons to be visible */
 	force_categories_icon = g_object_get_data (G_OBJECT (menu),
 						   "panel-menu-force-icon-for-categories") != NULL;
@@ -1175,13 +1432,26 @@ handle_cafemenu_tree_changed (CafeMenuTree *tree,
 {
 	GError *error = NULL;
 	guint idle_id;
+	GHashTable *reusables;
+
+	reusables = g_hash_table_new_full (g_str_hash, g_str_equal,
+					   g_free,
+					   (GDestroyNotify) reusable_submenu_free);
 
 	GList *list, *l;
 	list = ctk_container_get_children (CTK_CONTAINER (menu));
-	for (l = list; l; l = l->next)
+	for (l = list; l; l = l->next) {
+		if (CTK_IS_MENU_ITEM (l->data))
+			keep_reusable_submenu (reusables, CTK_MENU_ITEM (l->data));
 		ctk_widget_destroy (l->data);
+	}
 	g_list_free (list);
 
+	g_object_set_data_full (G_OBJECT (menu),
+				"panel-menu-reusable-submenus",
+				reusables,
+				(GDestroyNotify) g_hash_table_destroy);
+
 	if (! cafemenu_tree_load_sync (tree, &error)) {
 		g_warning("Menu tree reload got error:%s\n", error->message);
 		g_error_free(error);
@@ -1199,10 +1469,14 @@ handle_cafemenu_tree_changed (CafeMenuTree *tree,
 				   submenu_to_display_in_idle,
 				   menu,
 				   NULL);
+	g_source_set_name_by_id (idle_id, "[cafe-panel] submenu_to_display_in_idle");
 	g_object_set_data_full (G_OBJECT (menu),
 				"panel-menu-idle-id",
 				GUINT_TO_POINTER (idle_id),
 				remove_submenu_to_display_idle);
+
+	if (g_object_get_data (G_OBJECT (menu), "panel-menu-prewarm"))
+		panel_menu_prewarm (menu);
 }
 
 static void
@@ -1260,6 +1534,7 @@ create_applications_menu (const char *menu_file,
 				   submenu_to_display_in_idle,
 				   menu,
 				   NULL);
+	g_source_set_name_by_id (idle_id, "[cafe-panel] submenu_to_display_in_idle");
 	g_object_set_data_full (G_OBJECT (menu),
 				"panel-menu-idle-id",
 				GUINT_TO_POINTER (idle_id),
@@ -1391,6 +1666,241 @@ CtkWidget* create_main_menu(PanelWidget* panel)
 	return main_menu;
 }
 
+/* Menu pre-warming.
+ *
+ * With the prewarm-menus setting, the main menus are fully built once
+ * startup is done: every submenu is populated and sized, which resolves
+ * the styles and loads the icons of all the items, so that the first
+ * popup does not have to do any of it. This is done one submenu per
+ * low priority idle to stay out of the way of everything else.
+ */
+
+#define PANEL_MENU_PREWARM_DELAY 2 /* seconds */
+
+typedef struct {
+	GQueue menus;
+	guint  idle_id;
+} MenuPrewarm;
+
+static CtkWidget *prewarmed_main_menu = NULL;
+
+static void
+menu_prewarm_free (MenuPrewarm *prewarm)
+{
+	CtkWidget *menu;
+
+	if (prewarm->idle_id)
+		g_source_remove (prewarm->idle_id);
+
+	while ((menu = g_queue_pop_head (&prewarm->menus)))
+		g_object_unref (menu);
+
+	g_free (prewarm);
+}
+
+static gboolean
+menu_prewarm_step (gpointer data)
+{
+	MenuPrewarm *prewarm;
+	CtkWidget   *menu;
+	GList       *children, *l;
+
+	prewarm = g_object_get_data (G_OBJECT (data), "panel-menu-prewarm");
+
+	menu = g_queue_pop_head (&prewarm->menus);
+	if (!menu) {
+		prewarm->idle_id = 0;
+		return FALSE;
+	}
+
+	/* a menu without a toplevel has been destroyed since it was
+	 * queued, eg. by a reload of the menu tree */
+	if (ctk_widget_get_parent (menu) != NULL) {
+		submenu_to_display (menu);
+
+		children = ctk_container_get_children (CTK_CONTAINER (menu));
+		for (l = children; l; l = l->next) {
+			CtkWidget *submenu;
+
+			if (!CTK_IS_MENU_ITEM (l->data))
+				continue;
+
+			submenu = ctk_menu_item_get_submenu (CTK_MENU_ITEM (l->data));
+			if (submenu)
+				g_queue_push_tail (&prewarm->menus,
+						   g_object_ref (submenu));
+		}
+		g_list_free (children);
+
+		ctk_widget_get_preferred_size (menu, NULL, NULL);
+	}
+
+	g_object_unref (menu);
+
+	if (g_queue_is_empty (&prewarm->menus)) {
+		prewarm->idle_id = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+menu_prewarm_destroyed (CtkWidget *menu,
+			gpointer   data G_GNUC_UNUSED)
+{
+	g_object_set_data (G_OBJECT (menu), "panel-menu-prewarm", NULL);
+}
+
+void
+panel_menu_prewarm (CtkWidget *menu)
+{
+	MenuPrewarm *prewarm;
+
+	g_return_if_fail (CTK_IS_MENU (menu));
+
+	prewarm = g_object_get_data (G_OBJECT (menu), "panel-menu-prewarm");
+	if (!prewarm) {
+		prewarm = g_new0 (MenuPrewarm, 1);
+		g_queue_init (&prewarm->menus);
+
+		g_object_set_data_full (G_OBJECT (menu),
+					"panel-menu-prewarm",
+					prewarm,
+					(GDestroyNotify) menu_prewarm_free);
+		g_signal_connect (menu, "destroy",
+				  G_CALLBACK (menu_prewarm_destroyed), NULL);
+	}
+
+	/* start over from the top: menus that are already warm are
+	 * cheap to walk again */
+	g_queue_push_head (&prewarm->menus, g_object_ref (menu));
+
+	if (!prewarm->idle_id)
+		prewarm->idle_id = g_idle_add_full (G_PRIORITY_LOW,
+						    menu_prewarm_step,
+						    menu, NULL);
+}
+
+static void
+drop_prewarmed_main_menu (gpointer data G_GNUC_UNUSED)
+{
+	if (prewarmed_main_menu)
+		ctk_widget_destroy (prewarmed_main_menu);
+}
+
+CtkWidget *
+panel_menu_get_main_menu (PanelWidget *panel)
+{
+	static gboolean lockdown_monitored = FALSE;
+
+	if (!panel_global_config_get_prewarm_menus ())
+		return create_main_menu (panel);
+
+	if (prewarmed_main_menu &&
+	    g_object_get_data (G_OBJECT (prewarmed_main_menu), "menu_panel") != panel)
+		ctk_widget_destroy (prewarmed_main_menu);
+
+	if (prewarmed_main_menu)
+		return prewarmed_main_menu;
+
+	/* the lockdown settings change the content of the menu */
+	if (!lockdown_monitored) {
+		panel_lockdown_notify_add (G_CALLBACK (drop_prewarmed_main_menu),
+					   NULL);
+		lockdown_monitored = TRUE;
+	}
+
+	prewarmed_main_menu = create_main_menu (panel);
+	g_object_add_weak_pointer (G_OBJECT (prewarmed_main_menu),
+				   (gpointer *) &prewarmed_main_menu);
+
+	panel_menu_prewarm (prewarmed_main_menu);
+
+	return prewarmed_main_menu;
+}
+
+static gboolean
+panel_menu_prewarm_timeout (gpointer data G_GNUC_UNUSED)
+{
+	GSList  *l;
+	gboolean found = FALSE;
+
+	/* warm up what the main menu shortcut would open */
+	for (l = cafe_panel_applet_list_applets (); l; l = l->next) {
+		AppletInfo *info = l->data;
+
+		if (info->type == PANEL_OBJECT_MENU_BAR) {
+			panel_menu_bar_prewarm (PANEL_MENU_BAR (info->widget));
+			found = TRUE;
+		} else if (info->type == PANEL_OBJECT_MENU) {
+			panel_menu_button_prewarm (PANEL_MENU_BUTTON (info->widget));
+			found = TRUE;
+		}
+	}
+
+	if (!found && panels)
+		panel_menu_get_main_menu (panels->data);
+
+	return FALSE;
+}
+
+void
+panel_menu_queue_prewarm (void)
+{
+	static gboolean queued = FALSE;
+
+	if (queued || !panel_global_config_get_prewarm_menus ())
+		return;
+
+	queued = TRUE;
+	g_timeout_add_seconds (PANEL_MENU_PREWARM_DELAY,
+			       panel_menu_prewarm_timeout, NULL);
+}
+
+/* Latency probe: logs the time from the popup request to the first
+ * paint of the menu, run with G_MESSAGES_DEBUG=all to see it. */
+static gboolean
+menu_probe_draw (CtkWidget *menu,
+		 cairo_t   *cr G_GNUC_UNUSED,
+		 gpointer   data G_GNUC_UNUSED)
+{
+	gint64 *start;
+
+	start = g_object_get_data (G_OBJECT (menu), "panel-menu-probe-start");
+	if (!start)
+		return FALSE;
+
+	g_debug ("Menu painted %.1f ms after the popup request (%s)",
+		 (g_get_monotonic_time () - *start) / 1000.0,
+		 g_object_get_data (G_OBJECT (menu), "panel-menu-prewarm") ?
+			"prewarmed" : "cold");
+
+	g_object_set_data (G_OBJECT (menu), "panel-menu-probe-start", NULL);
+
+	return FALSE;
+}
+
+void
+panel_menu_probe_first_paint (CtkWidget *menu)
+{
+	gint64 *start;
+
+	g_return_if_fail (CTK_IS_MENU (menu));
+
+	if (!g_object_get_data (G_OBJECT (menu), "panel-menu-probe")) {
+		g_signal_connect_after (menu, "draw",
+					G_CALLBACK (menu_probe_draw), NULL);
+		g_object_set_data (G_OBJECT (menu), "panel-menu-probe",
+				   GINT_TO_POINTER (TRUE));
+	}
+
+	start = g_new (gint64, 1);
+	*start = g_get_monotonic_time ();
+	g_object_set_data_full (G_OBJECT (menu), "panel-menu-probe-start",
+				start, g_free);
+}
+
 static gboolean
 panel_menu_key_press_handler (CtkWidget   *widget,
 			      CdkEventKey *event)
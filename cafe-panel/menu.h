@@ -47,6 +47,11 @@ CtkWidget      *create_applications_menu  (const char  *menu_file,
 					   gboolean    always_show_image);
 CtkWidget      *create_main_menu          (PanelWidget *panel);
 
+CtkWidget      *panel_menu_get_main_menu     (PanelWidget *panel);
+void            panel_menu_prewarm           (CtkWidget   *menu);
+void            panel_menu_queue_prewarm     (void);
+void            panel_menu_probe_first_paint (CtkWidget   *menu);
+
 void		setup_internal_applet_drag (CtkWidget             *menuitem,
 					    PanelActionButtonType  type);
 void            setup_uri_drag             (CtkWidget  *menuitem,
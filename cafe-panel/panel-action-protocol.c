@@ -80,7 +80,9 @@ panel_action_protocol_main_menu (CdkScreen *screen,
 	}
 
 	panel_widget = panels->data;
-	menu = create_main_menu (panel_widget);
+	menu = panel_menu_get_main_menu (panel_widget);
+
+	panel_menu_probe_first_paint (menu);
 
 	panel_toplevel_push_autohide_disabler (panel_widget->toplevel);
 
@@ -31,6 +31,7 @@
 #include <cafemenu-tree.h>
 
 #include <libpanel-util/panel-glib.h>
+#include <libpanel-util/panel-search-index.h>
 #include <libpanel-util/panel-show.h>
 #include <libpanel-util/panel-ctk.h>
 
@@ -51,6 +52,7 @@
 #include "panel-addto.h"
 #include "panel-icon-names.h"
 #include "panel-schemas.h"
+#include "panel-stats.h"
 #include "panel-stock-icons.h"
 
 #ifdef HAVE_X11
@@ -82,8 +84,18 @@ typedef struct {
 
 	gchar        *search_text;
 	gchar        *applet_search_text;
+	PanelSearchIndex *search_index;
 
 	int           insertion_position;
+
+	/* the models are filled in batches, see panel_addto_populate() */
+	guint         populate_id;
+	gboolean      applets_queried;
+	GSList       *pending_applets;
+	int           applet_row_offset;
+	guint         next_menu;
+	const char   *menu_file;
+	GSList       *menu_stack;
 } PanelAddtoDialog;
 
 static GQuark panel_addto_dialog_quark = 0;
@@ -119,6 +131,22 @@ typedef struct {
 	PanelAddtoItemInfo  item_info;
 } PanelAddtoAppList;
 
+/* a directory of the menu tree being walked */
+typedef struct {
+	CafeMenuTreeIter   *iter;
+	CtkTreeIter         row;
+	gboolean            has_row;
+	GSList            **list;
+} PanelAddtoMenuLevel;
+
+/* rows added to the models per main loop iteration */
+#define PANEL_ADDTO_BATCH_SIZE 32
+
+static const char *addto_menu_files [] = {
+	"cafe-applications.menu",
+	"cafe-settings.menu"
+};
+
 static PanelAddtoItemInfo special_addto_items [] = {
 
 	{ PANEL_ADDTO_LAUNCHER_NEW,
@@ -214,6 +242,7 @@ enum {
 
 static void panel_addto_present_applications (PanelAddtoDialog *dialog);
 static void panel_addto_present_applets      (PanelAddtoDialog *dialog);
+static void panel_addto_queue_populate       (PanelAddtoDialog *dialog);
 static gboolean panel_addto_filter_func (CtkTreeModel *model,
 					 CtkTreeIter  *iter,
 					 gpointer      data);
@@ -445,41 +474,48 @@ panel_addto_query_applets (GSList *list)
 }
 
 static void
-panel_addto_append_item (PanelAddtoDialog   *dialog G_GNUC_UNUSED,
+panel_addto_insert_item (PanelAddtoDialog   *dialog,
 			 CtkListStore       *model,
+			 int                 position,
 			 PanelAddtoItemInfo *applet)
 {
-	CtkTreeIter iter;
-
 	if (applet == NULL) {
-		ctk_list_store_append (model, &iter);
-		ctk_list_store_set (model, &iter,
-				    COLUMN_ICON_NAME, NULL,
-				    COLUMN_TEXT, NULL,
-				    COLUMN_DATA, NULL,
-				    COLUMN_SEARCH, NULL,
-				    COLUMN_ENABLED, TRUE,
-				    -1);
+		ctk_list_store_insert_with_values (model, NULL, position,
+						   COLUMN_ICON_NAME, NULL,
+						   COLUMN_TEXT, NULL,
+						   COLUMN_DATA, NULL,
+						   COLUMN_SEARCH, NULL,
+						   COLUMN_ENABLED, TRUE,
+						   -1);
 	} else {
 		char *text;
 
-		ctk_list_store_append (model, &iter);
-
 		text = panel_addto_make_text (applet->name,
 					      applet->description);
 
-		ctk_list_store_set (model, &iter,
-				    COLUMN_ICON_NAME, applet->icon,
-				    COLUMN_TEXT, text,
-				    COLUMN_DATA, applet,
-				    COLUMN_SEARCH, applet->name,
-				    COLUMN_ENABLED, applet->enabled,
-				    -1);
+		panel_search_index_add (dialog->search_index, applet, applet->name);
+		panel_search_index_add (dialog->search_index, applet, applet->description);
+
+		ctk_list_store_insert_with_values (model, NULL, position,
+						   COLUMN_ICON_NAME, applet->icon,
+						   COLUMN_TEXT, text,
+						   COLUMN_DATA, applet,
+						   COLUMN_SEARCH, applet->name,
+						   COLUMN_ENABLED, applet->enabled,
+						   -1);
 
 		g_free (text);
 	}
 }
 
+static void
+panel_addto_append_item (PanelAddtoDialog   *dialog,
+			 CtkListStore       *model,
+			 PanelAddtoItemInfo *applet)
+{
+	panel_addto_insert_item (dialog, model, -1, applet);
+}
+
 static void
 panel_addto_append_special_applets (PanelAddtoDialog *dialog,
 				    CtkListStore *model)
@@ -512,10 +548,12 @@ panel_addto_make_applet_model (PanelAddtoDialog *dialog)
 	if (dialog->filter_applet_model != NULL)
 		return;
 
-	if (panel_profile_id_lists_are_writable ()) {
-		dialog->applet_list = panel_addto_query_applets (dialog->applet_list);
+	/* the internal applets are shown right away, the others are
+	 * queried and merged from panel_addto_populate() */
+	if (panel_profile_id_lists_are_writable ())
 		dialog->applet_list = panel_addto_prepend_internal_applets (dialog->applet_list);
-	}
+	else
+		dialog->applets_queried = TRUE;
 
 	dialog->applet_list = g_slist_sort (dialog->applet_list,
 					    (GCompareFunc) panel_addto_applet_info_sort_func);
@@ -533,6 +571,8 @@ panel_addto_make_applet_model (PanelAddtoDialog *dialog)
 			panel_addto_append_item (dialog, model, NULL);
 	}
 
+	dialog->applet_row_offset = ctk_tree_model_iter_n_children (CTK_TREE_MODEL (model), NULL);
+
 	for (l = dialog->applet_list; l; l = l->next)
 		panel_addto_append_item (dialog, model, l->data);
 
@@ -542,19 +582,132 @@ panel_addto_make_applet_model (PanelAddtoDialog *dialog)
 	ctk_tree_model_filter_set_visible_func (CTK_TREE_MODEL_FILTER (dialog->filter_applet_model),
 						panel_addto_filter_func,
 						dialog, NULL);
+
+	if (!dialog->applets_queried)
+		panel_addto_queue_populate (dialog);
+}
+
+/* Keeps dialog->applet_list and the model sorted. */
+static void
+panel_addto_insert_applet (PanelAddtoDialog   *dialog,
+			   PanelAddtoItemInfo *applet)
+{
+	GSList **link;
+	int      position;
+
+	position = dialog->applet_row_offset;
+	for (link = &dialog->applet_list; *link; link = &(*link)->next) {
+		if (panel_addto_applet_info_sort_func ((*link)->data, applet) > 0)
+			break;
+		position++;
+	}
+
+	*link = g_slist_prepend (*link, applet);
+
+	panel_addto_insert_item (dialog, CTK_LIST_STORE (dialog->applet_model),
+				 position, applet);
+	panel_stats_count (NULL, PANEL_STATS_ADDTO_APPLET_ROWS);
+}
+
+/* Returns TRUE once every applet is in the model. */
+static gboolean
+panel_addto_populate_applets (PanelAddtoDialog *dialog)
+{
+	int n;
+
+	if (!dialog->applets_queried) {
+		dialog->pending_applets = panel_addto_query_applets (NULL);
+		dialog->pending_applets = g_slist_sort (dialog->pending_applets,
+							(GCompareFunc) panel_addto_applet_info_sort_func);
+		dialog->applets_queried = TRUE;
+		return FALSE;
+	}
+
+	for (n = 0; dialog->pending_applets && n < PANEL_ADDTO_BATCH_SIZE; n++) {
+		PanelAddtoItemInfo *applet;
+
+		applet = dialog->pending_applets->data;
+		dialog->pending_applets = g_slist_delete_link (dialog->pending_applets,
+							       dialog->pending_applets);
+
+		panel_addto_insert_applet (dialog, applet);
+	}
+
+	return dialog->pending_applets == NULL;
+}
+
+static void
+panel_addto_push_menu_level (PanelAddtoDialog      *dialog,
+			     CafeMenuTreeDirectory *directory,
+			     CtkTreeIter           *row,
+			     GSList               **list)
+{
+	PanelAddtoMenuLevel *level;
+
+	level = g_new0 (PanelAddtoMenuLevel, 1);
+	level->iter = cafemenu_tree_directory_iter (directory);
+	if (row) {
+		level->row = *row;
+		level->has_row = TRUE;
+	}
+	level->list = list;
+
+	dialog->menu_stack = g_slist_prepend (dialog->menu_stack, level);
 }
 
-static void panel_addto_make_application_list (GSList             **parent_list,
-					       CafeMenuTreeDirectory  *directory,
-					       const char          *filename);
+static void
+panel_addto_pop_menu_level (PanelAddtoDialog *dialog)
+{
+	PanelAddtoMenuLevel *level;
+
+	level = dialog->menu_stack->data;
+	dialog->menu_stack = g_slist_delete_link (dialog->menu_stack,
+						  dialog->menu_stack);
+
+	cafemenu_tree_iter_unref (level->iter);
+	g_free (level);
+}
+
+static void
+panel_addto_append_application (PanelAddtoDialog    *dialog,
+				PanelAddtoMenuLevel *level,
+				PanelAddtoAppList   *data,
+				CtkTreeIter         *row)
+{
+	char *text;
+
+	*level->list = g_slist_prepend (*level->list, data);
+
+	panel_search_index_add (dialog->search_index, &(data->item_info),
+				data->item_info.name);
+	panel_search_index_add (dialog->search_index, &(data->item_info),
+				data->item_info.description);
+
+	text = panel_addto_make_text (data->item_info.name,
+				      data->item_info.description);
+	ctk_tree_store_insert_with_values (CTK_TREE_STORE (dialog->application_model),
+					   row,
+					   level->has_row ? &level->row : NULL,
+					   -1,
+					   COLUMN_ICON_NAME, data->item_info.icon,
+					   COLUMN_TEXT, text,
+					   COLUMN_DATA, &(data->item_info),
+					   COLUMN_SEARCH, data->item_info.name,
+					   COLUMN_ENABLED, data->item_info.enabled,
+					   -1);
+	g_free (text);
+
+	panel_stats_count (NULL, PANEL_STATS_ADDTO_MENU_ROWS);
+}
 
 static void
-panel_addto_prepend_directory (GSList             **parent_list,
-			       CafeMenuTreeDirectory  *directory,
-			       const char          *filename)
+panel_addto_append_directory (PanelAddtoDialog      *dialog,
+			      PanelAddtoMenuLevel   *level,
+			      CafeMenuTreeDirectory *directory)
 {
 	PanelAddtoAppList *data;
 	GIcon              *gicon;
+	CtkTreeIter         row;
 
 	data = g_new0 (PanelAddtoAppList, 1);
 	gicon = cafemenu_tree_directory_get_icon (directory);
@@ -563,7 +716,7 @@ panel_addto_prepend_directory (GSList             **parent_list,
 	data->item_info.name          = g_strdup (cafemenu_tree_directory_get_name (directory));
 	data->item_info.description   = g_strdup (cafemenu_tree_directory_get_comment (directory));
 	data->item_info.icon          = gicon ? g_icon_to_string(gicon) : g_strdup(PANEL_ICON_UNKNOWN);
-	data->item_info.menu_filename = g_strdup (filename);
+	data->item_info.menu_filename = g_strdup (dialog->menu_file);
 	data->item_info.menu_path     = cafemenu_tree_directory_make_path (directory, NULL);
 	data->item_info.enabled       = TRUE;
 	data->item_info.static_data   = FALSE;
@@ -576,19 +729,21 @@ panel_addto_prepend_directory (GSList             **parent_list,
 	 * So the iid is built when we select the row.
 	 */
 
-	*parent_list = g_slist_prepend (*parent_list, data);
+	panel_addto_append_application (dialog, level, data, &row);
 
-	panel_addto_make_application_list (&data->children, directory, filename);
+	/* its children come next */
+	panel_addto_push_menu_level (dialog, directory, &row, &data->children);
 }
 
 static void
-panel_addto_prepend_entry (GSList            **parent_list,
-			   CafeMenuTreeEntry  *entry,
-			   const char         *filename G_GNUC_UNUSED)
+panel_addto_append_entry (PanelAddtoDialog    *dialog,
+			  PanelAddtoMenuLevel *level,
+			  CafeMenuTreeEntry   *entry)
 {
 	PanelAddtoAppList *data;
 	GDesktopAppInfo    *ginfo;
 	GIcon              *gicon;
+	CtkTreeIter         row;
 
 	ginfo = cafemenu_tree_entry_get_app_info (entry);
 	gicon = g_app_info_get_icon(G_APP_INFO(ginfo));
@@ -603,30 +758,26 @@ panel_addto_prepend_entry (GSList            **parent_list,
 	data->item_info.enabled       = TRUE;
 	data->item_info.static_data   = FALSE;
 
-	*parent_list = g_slist_prepend (*parent_list, data);
+	panel_addto_append_application (dialog, level, data, &row);
 }
 
 static void
-panel_addto_prepend_alias (GSList         **parent_list,
-			   CafeMenuTreeAlias  *alias,
-			   const char      *filename)
+panel_addto_append_alias (PanelAddtoDialog    *dialog,
+			  PanelAddtoMenuLevel *level,
+			  CafeMenuTreeAlias   *alias)
 {
 	gpointer item;
 
 	switch (cafemenu_tree_alias_get_aliased_item_type (alias)) {
 	case CAFEMENU_TREE_ITEM_DIRECTORY:
 		item = cafemenu_tree_alias_get_directory(alias);
-		panel_addto_prepend_directory (parent_list,
-				item,
-				filename);
+		panel_addto_append_directory (dialog, level, item);
 		cafemenu_tree_item_unref (item);
 		break;
 
 	case CAFEMENU_TREE_ITEM_ENTRY:
 		item = cafemenu_tree_alias_get_aliased_entry(alias);
-		panel_addto_prepend_entry (parent_list,
-				item,
-				filename);
+		panel_addto_append_entry (dialog, level, item);
 		cafemenu_tree_item_unref (item);
 		break;
 
@@ -635,83 +786,115 @@ panel_addto_prepend_alias (GSList         **parent_list,
 	}
 }
 
+/* Adds the next item of the directory being walked, or goes back to
+ * its parent when there is none left. */
 static void
-panel_addto_make_application_list (GSList             **parent_list,
-				   CafeMenuTreeDirectory  *directory,
-				   const char          *filename)
+panel_addto_populate_menu_item (PanelAddtoDialog *dialog)
 {
-	CafeMenuTreeIter *iter;
-	iter = cafemenu_tree_directory_iter (directory);
-	CafeMenuTreeItemType type;
-	while ((type = cafemenu_tree_iter_next (iter)) != CAFEMENU_TREE_ITEM_INVALID) {
-		gpointer item;
-		switch (type) {
-		case CAFEMENU_TREE_ITEM_DIRECTORY:
-			item = cafemenu_tree_iter_get_directory(iter);
-			panel_addto_prepend_directory (parent_list, item, filename);
-			cafemenu_tree_item_unref (item);
-			break;
+	PanelAddtoMenuLevel *level;
+	gpointer             item;
 
-		case CAFEMENU_TREE_ITEM_ENTRY:
-			item = cafemenu_tree_iter_get_entry (iter);
-			panel_addto_prepend_entry (parent_list, item, filename);
-			cafemenu_tree_item_unref (item);
-			break;
+	level = dialog->menu_stack->data;
 
-		case CAFEMENU_TREE_ITEM_ALIAS:
-			item = cafemenu_tree_iter_get_alias(iter);
-			panel_addto_prepend_alias (parent_list, item, filename);
-			cafemenu_tree_item_unref (item);
-			break;
-		default:
-			break;
-		}
-	}
-	cafemenu_tree_iter_unref (iter);
+	switch (cafemenu_tree_iter_next (level->iter)) {
+	case CAFEMENU_TREE_ITEM_INVALID:
+		panel_addto_pop_menu_level (dialog);
+		break;
 
-	*parent_list = g_slist_reverse (*parent_list);
+	case CAFEMENU_TREE_ITEM_DIRECTORY:
+		item = cafemenu_tree_iter_get_directory (level->iter);
+		panel_addto_append_directory (dialog, level, item);
+		cafemenu_tree_item_unref (item);
+		break;
+
+	case CAFEMENU_TREE_ITEM_ENTRY:
+		item = cafemenu_tree_iter_get_entry (level->iter);
+		panel_addto_append_entry (dialog, level, item);
+		cafemenu_tree_item_unref (item);
+		break;
+
+	case CAFEMENU_TREE_ITEM_ALIAS:
+		item = cafemenu_tree_iter_get_alias (level->iter);
+		panel_addto_append_alias (dialog, level, item);
+		cafemenu_tree_item_unref (item);
+		break;
+
+	default:
+		break;
+	}
 }
 
 static void
-panel_addto_populate_application_model (CtkTreeStore *store,
-					CtkTreeIter  *parent,
-					GSList       *app_list)
+panel_addto_load_menu (PanelAddtoDialog *dialog,
+		       guint             index)
 {
-	PanelAddtoAppList *data;
-	CtkTreeIter        iter;
-	GSList            *app;
+	CafeMenuTreeDirectory *root;
+	GError                *error = NULL;
+
+	dialog->menu_file = addto_menu_files [index];
+
+	dialog->menu_tree = cafemenu_tree_new (dialog->menu_file,
+					       CAFEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
+	if (!cafemenu_tree_load_sync (dialog->menu_tree, &error)) {
+		g_warning ("Menu tree %s loading got error:%s\n",
+			   dialog->menu_file, error->message);
+		g_error_free (error);
+		g_clear_object (&dialog->menu_tree);
+		return;
+	}
 
-	for (app = app_list; app != NULL; app = app->next) {
-		char *text;
+	root = cafemenu_tree_get_root_directory (dialog->menu_tree);
+	if (!root)
+		return;
 
-		data = app->data;
-		ctk_tree_store_append (store, &iter, parent);
-
-		text = panel_addto_make_text (data->item_info.name,
-					      data->item_info.description);
-		ctk_tree_store_set (store, &iter,
-				    COLUMN_ICON_NAME, data->item_info.icon,
-				    COLUMN_TEXT, text,
-				    COLUMN_DATA, &(data->item_info),
-				    COLUMN_SEARCH, data->item_info.name,
-				    COLUMN_ENABLED, data->item_info.enabled,
-				    -1);
+	/* the settings come after a separator */
+	if (index > 0)
+		ctk_tree_store_insert_with_values (CTK_TREE_STORE (dialog->application_model),
+						   NULL, NULL, -1,
+						   COLUMN_ICON_NAME, NULL,
+						   COLUMN_TEXT, NULL,
+						   COLUMN_DATA, NULL,
+						   COLUMN_SEARCH, NULL,
+						   COLUMN_ENABLED, TRUE,
+						   -1);
+
+	panel_addto_push_menu_level (dialog, root, NULL,
+				     index == 0 ? &dialog->application_list
+						: &dialog->settings_list);
+	cafemenu_tree_item_unref (root);
+}
 
-		g_free (text);
+/* Returns TRUE once every menu is in the model. */
+static gboolean
+panel_addto_populate_applications (PanelAddtoDialog *dialog)
+{
+	int n;
+
+	for (n = 0; n < PANEL_ADDTO_BATCH_SIZE; n++) {
+		if (dialog->menu_stack) {
+			panel_addto_populate_menu_item (dialog);
+			continue;
+		}
 
-		if (data->children != NULL)
-			panel_addto_populate_application_model (store,
-								&iter,
-								data->children);
+		g_clear_object (&dialog->menu_tree);
+
+		if (dialog->next_menu == G_N_ELEMENTS (addto_menu_files))
+			return TRUE;
+
+		/* loading a menu tree takes a while on its own, give
+		 * it a full iteration */
+		if (n == 0)
+			panel_addto_load_menu (dialog, dialog->next_menu++);
+		break;
 	}
+
+	return FALSE;
 }
 
-static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
+static void
+panel_addto_make_application_model (PanelAddtoDialog *dialog)
 {
-	CtkTreeStore* store;
-	CafeMenuTree* tree;
-	CafeMenuTreeDirectory* root;
-	GError *error = NULL;
+	CtkTreeStore *store;
 
 	if (dialog->filter_application_model != NULL)
 		return;
@@ -723,54 +906,45 @@ static void panel_addto_make_application_model(PanelAddtoDialog* dialog)
 				    G_TYPE_STRING,
 				    G_TYPE_BOOLEAN);
 
-	tree = cafemenu_tree_new ("cafe-applications.menu", CAFEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-	if (! cafemenu_tree_load_sync (tree, &error)) {
-		g_warning("Applications menu tree loading got error:%s\n", error->message);
-		g_error_free(error);
-		g_clear_object(&tree);
-	}
-
-	if ((root = cafemenu_tree_get_root_directory (tree)) != NULL )
-	{
-		panel_addto_make_application_list(&dialog->application_list, root, "cafe-applications.menu");
-		panel_addto_populate_application_model(store, NULL, dialog->application_list);
-
-		cafemenu_tree_item_unref(root);
-	}
+	dialog->application_model = CTK_TREE_MODEL(store);
+	dialog->filter_application_model = ctk_tree_model_filter_new(CTK_TREE_MODEL(dialog->application_model), NULL);
+	ctk_tree_model_filter_set_visible_func(CTK_TREE_MODEL_FILTER(dialog->filter_application_model), panel_addto_filter_func, dialog, NULL);
 
-	g_clear_object(&tree);
+	/* the menus are walked from panel_addto_populate() */
+	panel_addto_queue_populate (dialog);
+}
 
-	tree = cafemenu_tree_new ("cafe-settings.menu", CAFEMENU_TREE_FLAGS_SORT_DISPLAY_NAME);
-	if (! cafemenu_tree_load_sync (tree, &error)) {
-		g_warning("Settings menu tree loading got error:%s\n", error->message);
-		g_error_free(error);
-		g_clear_object(&tree);
+/* The dialog shows up with what is known without any I/O, the applets
+ * and the menus are then added a batch at a time so that the dialog
+ * stays responsive. The menus are only walked once the application
+ * list is asked for. */
+static gboolean
+panel_addto_populate (gpointer user_data)
+{
+	PanelAddtoDialog *dialog = user_data;
+
+	if (!dialog->applets_queried || dialog->pending_applets) {
+		if (!panel_addto_populate_applets (dialog) ||
+		    dialog->application_model != NULL)
+			return G_SOURCE_CONTINUE;
+	} else if (dialog->application_model != NULL) {
+		if (!panel_addto_populate_applications (dialog))
+			return G_SOURCE_CONTINUE;
 	}
 
-	if ((root = cafemenu_tree_get_root_directory(tree)))
-	{
-		CtkTreeIter iter;
-
-		ctk_tree_store_append(store, &iter, NULL);
-		ctk_tree_store_set (store, &iter,
-				    COLUMN_ICON_NAME, NULL,
-				    COLUMN_TEXT, NULL,
-				    COLUMN_DATA, NULL,
-				    COLUMN_SEARCH, NULL,
-				    COLUMN_ENABLED, TRUE,
-				    -1);
-
-		panel_addto_make_application_list(&dialog->settings_list, root, "cafe-settings.menu");
-		panel_addto_populate_application_model(store, NULL, dialog->settings_list);
+	dialog->populate_id = 0;
 
-		cafemenu_tree_item_unref(root);
-	}
+	return G_SOURCE_REMOVE;
+}
 
-	g_object_unref(tree);
+static void
+panel_addto_queue_populate (PanelAddtoDialog *dialog)
+{
+	if (dialog->populate_id != 0)
+		return;
 
-	dialog->application_model = CTK_TREE_MODEL(store);
-	dialog->filter_application_model = ctk_tree_model_filter_new(CTK_TREE_MODEL(dialog->application_model), NULL);
-	ctk_tree_model_filter_set_visible_func(CTK_TREE_MODEL_FILTER(dialog->filter_application_model), panel_addto_filter_func, dialog, NULL);
+	dialog->populate_id = g_idle_add (panel_addto_populate, dialog);
+	g_source_set_name_by_id (dialog->populate_id, "[cafe-panel] panel_addto_populate");
 }
 
 static void
@@ -988,10 +1162,30 @@ panel_addto_name_notify (GSettings        *settings,
 			 gchar            *key,
 			 PanelAddtoDialog *dialog);
 
+static void
+panel_addto_dialog_free_applet_list (GSList *applet_list)
+{
+	GSList *item;
+
+	for (item = applet_list; item != NULL; item = item->next) {
+		PanelAddtoItemInfo *applet;
+
+		applet = (PanelAddtoItemInfo *) item->data;
+		if (!applet->static_data) {
+			panel_addto_dialog_free_item_info (applet);
+			g_free (applet);
+		}
+	}
+	g_slist_free (applet_list);
+}
+
 static void
 panel_addto_dialog_free (PanelAddtoDialog *dialog)
 {
-	GSList      *item;
+	/* the dialog is going away, stop filling it */
+	if (dialog->populate_id != 0)
+		g_source_remove (dialog->populate_id);
+	dialog->populate_id = 0;
 
 	g_signal_handlers_disconnect_by_func(dialog->panel_widget->toplevel->settings,
 					     G_CALLBACK (panel_addto_name_notify),
@@ -1009,16 +1203,11 @@ panel_addto_dialog_free (PanelAddtoDialog *dialog)
 		ctk_widget_destroy (dialog->addto_dialog);
 	dialog->addto_dialog = NULL;
 
-	for (item = dialog->applet_list; item != NULL; item = item->next) {
-		PanelAddtoItemInfo *applet;
+	panel_addto_dialog_free_applet_list (dialog->applet_list);
+	panel_addto_dialog_free_applet_list (dialog->pending_applets);
 
-		applet = (PanelAddtoItemInfo *) item->data;
-		if (!applet->static_data) {
-			panel_addto_dialog_free_item_info (applet);
-			g_free (applet);
-		}
-	}
-	g_slist_free (dialog->applet_list);
+	while (dialog->menu_stack)
+		panel_addto_pop_menu_level (dialog);
 
 	panel_addto_dialog_free_application_list (dialog->application_list);
 	panel_addto_dialog_free_application_list (dialog->settings_list);
@@ -1041,6 +1230,8 @@ panel_addto_dialog_free (PanelAddtoDialog *dialog)
 
 	g_clear_object (&dialog->menu_tree);
 
+	panel_search_index_free (dialog->search_index);
+
 	g_free (dialog);
 }
 
@@ -1108,10 +1299,7 @@ panel_addto_filter_func (CtkTreeModel *model,
 	    ctk_tree_store_iter_depth (CTK_TREE_STORE (model), iter) == 0)
 		return TRUE;
 
-	return (panel_g_utf8_strstrcase (data->name,
-					 dialog->search_text) != NULL ||
-	        panel_g_utf8_strstrcase (data->description,
-					 dialog->search_text) != NULL);
+	return panel_search_index_matches (dialog->search_index, data);
 }
 
 static void
@@ -1136,6 +1324,8 @@ panel_addto_search_entry_changed (CtkWidget        *entry G_GNUC_UNUSED,
 		g_free (dialog->search_text);
 	dialog->search_text = new_text;
 
+	panel_search_index_set_query (dialog->search_index, dialog->search_text);
+
 	model = ctk_tree_view_get_model (CTK_TREE_VIEW (dialog->tree_view));
 	ctk_tree_model_filter_refilter (CTK_TREE_MODEL_FILTER (model));
 
@@ -1301,6 +1491,7 @@ panel_addto_dialog_new (PanelWidget *panel_widget)
 				 (GDestroyNotify) panel_addto_dialog_free);
 
 	dialog->panel_widget = panel_widget;
+	dialog->search_index = panel_search_index_new ();
 
 	g_signal_connect (dialog->panel_widget->toplevel->settings,
 			  "changed::" PANEL_TOPLEVEL_NAME_KEY,
@@ -46,6 +46,7 @@
 #include "xstuff.h"
 #endif
 #include "panel-schemas.h"
+#include "panel-stats.h"
 
 #include "panel-applet-frame.h"
 
@@ -104,6 +105,8 @@ cafe_panel_applet_frame_draw (CtkWidget *widget,
 	CtkStateFlags     state;
 	PanelBackground  *background;
 
+	panel_stats_count (frame, PANEL_STATS_DRAWS);
+
 	if (CTK_WIDGET_CLASS (cafe_panel_applet_frame_parent_class)->draw)
 		CTK_WIDGET_CLASS (cafe_panel_applet_frame_parent_class)->draw (widget, cr);
 
@@ -191,6 +194,8 @@ cafe_panel_applet_frame_get_preferred_width(CtkWidget *widget, gint *minimal_wid
 	frame = CAFE_PANEL_APPLET_FRAME (widget);
 	bin = CTK_BIN (widget);
 
+	panel_stats_count (frame, PANEL_STATS_SIZE_REQUESTS);
+
 	if (!frame->priv->has_handle) {
 		CTK_WIDGET_CLASS (cafe_panel_applet_frame_parent_class)->get_preferred_width (widget, minimal_width, natural_width);
 		return;
@@ -230,6 +235,8 @@ cafe_panel_applet_frame_get_preferred_height(CtkWidget *widget, gint *minimal_he
 	frame = CAFE_PANEL_APPLET_FRAME (widget);
 	bin = CTK_BIN (widget);
 
+	panel_stats_count (frame, PANEL_STATS_SIZE_REQUESTS);
+
 	if (!frame->priv->has_handle) {
 		CTK_WIDGET_CLASS (cafe_panel_applet_frame_parent_class)->get_preferred_height (widget, minimal_height, natural_height);
 		return;
@@ -270,6 +277,8 @@ cafe_panel_applet_frame_size_allocate (CtkWidget     *widget,
 	CtkAllocation     old_allocation;
 	CtkAllocation     widget_allocation;
 
+	panel_stats_count (widget, PANEL_STATS_ALLOCATIONS);
+
 	ctk_widget_get_allocation (widget, &widget_allocation);
 
 	old_allocation.x      = widget_allocation.x;
@@ -530,6 +539,8 @@ cafe_panel_applet_frame_change_background (CafePanelAppletFrame    *frame,
 
 	g_return_if_fail (PANEL_IS_WIDGET (parent));
 
+	panel_stats_count (frame, PANEL_STATS_BACKGROUND_CHANGES);
+
 	if (frame->priv->has_handle) {
 		PanelBackground *background;
 		background = &PANEL_WIDGET (parent)->toplevel->background;
@@ -42,6 +42,7 @@
 #include <libcafe-desktop/cafe-bg.h>
 
 #include "panel-background-monitor.h"
+#include "panel-memory.h"
 #include "panel-util.h"
 
 enum {
@@ -92,6 +93,29 @@ gboolean cdk_window_check_composited_wm(CdkWindow* window)
 	return cdk_screen_is_composited(cdk_window_get_screen(window));
 }
 
+static void
+panel_background_monitor_drop_pixbuf (PanelBackgroundMonitor *monitor)
+{
+	if (monitor->surface)
+		cairo_surface_destroy (monitor->surface);
+	monitor->surface = NULL;
+
+	if (monitor->gdkpixbuf)
+		g_object_unref (monitor->gdkpixbuf);
+	monitor->gdkpixbuf = NULL;
+
+	panel_memory_charge (monitor, "desktop-pixbuf", 0);
+}
+
+/* The full desktop is only needed to cut the panel regions out of it
+ * after a change, it is fetched again when needed. */
+static void
+panel_background_monitor_shrink (void)
+{
+	if (global_background_monitor)
+		panel_background_monitor_drop_pixbuf (global_background_monitor);
+}
+
 static void
 panel_background_monitor_finalize (GObject *object)
 {
@@ -104,13 +128,7 @@ panel_background_monitor_finalize (GObject *object)
 	g_signal_handlers_disconnect_by_func (monitor->screen,
 		panel_background_monitor_changed, monitor);
 
-	if (monitor->surface)
-		cairo_surface_destroy (monitor->surface);
-	monitor->surface= NULL;
-
-	if (monitor->gdkpixbuf)
-		g_object_unref (monitor->gdkpixbuf);
-	monitor->gdkpixbuf = NULL;
+	panel_background_monitor_drop_pixbuf (monitor);
 
 	G_OBJECT_CLASS (panel_background_monitor_parent_class)->finalize (object);
 }
@@ -192,8 +210,15 @@ panel_background_monitor_get_for_screen (CdkScreen *screen)
 	g_return_val_if_fail (CDK_IS_X11_SCREEN (screen), NULL);
 
 	if (!global_background_monitor) {
+		static gboolean shrinker_added = FALSE;
+
 		global_background_monitor = panel_background_monitor_new (screen);
 
+		if (!shrinker_added) {
+			panel_memory_add_shrinker (panel_background_monitor_shrink);
+			shrinker_added = TRUE;
+		}
+
 		g_object_add_weak_pointer (G_OBJECT (global_background_monitor),
 		                           (void **) &global_background_monitor);
 
@@ -206,13 +231,7 @@ panel_background_monitor_get_for_screen (CdkScreen *screen)
 static void
 panel_background_monitor_changed (PanelBackgroundMonitor *monitor)
 {
-	if (monitor->surface)
-		cairo_surface_destroy (monitor->surface);
-	monitor->surface = NULL;
-
-	if (monitor->gdkpixbuf)
-		g_object_unref (monitor->gdkpixbuf);
-	monitor->gdkpixbuf = NULL;
+	panel_background_monitor_drop_pixbuf (monitor);
 
 	g_signal_emit (monitor, signals [CHANGED], 0);
 }
@@ -357,6 +376,9 @@ panel_background_monitor_setup_pixbuf (PanelBackgroundMonitor *monitor)
 		monitor->width  = rwidth;
 		monitor->height = rheight;
 	}
+
+	panel_memory_charge (monitor, "desktop-pixbuf",
+			     panel_memory_pixbuf_size (monitor->gdkpixbuf));
 }
 
 GdkPixbuf *
@@ -366,7 +388,7 @@ panel_background_monitor_get_region (PanelBackgroundMonitor *monitor,
 				     int                     width,
 				     int                     height)
 {
-	GdkPixbuf *pixbuf, *tmpbuf;
+	GdkPixbuf *pixbuf;
 	int        subwidth, subheight;
 	int        subx, suby;
 
@@ -394,17 +416,13 @@ panel_background_monitor_get_region (PanelBackgroundMonitor *monitor,
 		return gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
 				       width, height);
 
-	pixbuf = gdk_pixbuf_new_subpixbuf (
-			monitor->gdkpixbuf, subx, suby, subwidth, subheight);
-
-	if ((subwidth < width) || (subheight < height)) {
-		tmpbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
-					 width, height);
-		gdk_pixbuf_copy_area (pixbuf, 0, 0, subwidth, subheight,
-				      tmpbuf, (x < 0) ? -x : 0, (y < 0) ? -y : 0);
-		g_object_unref (pixbuf);
-		pixbuf = tmpbuf;
-	}
+	/* copy the region rather than taking a sub-pixbuf, which would
+	 * keep the whole desktop alive for as long as the panel uses it */
+	pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB,
+				 gdk_pixbuf_get_has_alpha (monitor->gdkpixbuf),
+				 8, width, height);
+	gdk_pixbuf_copy_area (monitor->gdkpixbuf, subx, suby, subwidth, subheight,
+			      pixbuf, (x < 0) ? -x : 0, (y < 0) ? -y : 0);
 
 	return pixbuf;
 }
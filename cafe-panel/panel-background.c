@@ -27,6 +27,9 @@
 #include "panel-background.h"
 
 #include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
 #include <cdk/cdk.h>
 #include <ctk/ctk.h>
 #include <cairo.h>
@@ -36,11 +39,15 @@
 #include <cairo-xlib.h>
 #endif
 
+#include "panel-memory.h"
 #include "panel-util.h"
+#include "panel-stats.h"
 
 
 static gboolean panel_background_composite (PanelBackground *background);
 static void load_background_file (PanelBackground *background);
+static void panel_background_update_has_alpha (PanelBackground *background);
+static void background_cache_add_user (GdkPixbuf *pixbuf, int delta);
 
 
 static void
@@ -186,6 +193,20 @@ panel_background_prepare (PanelBackground *background)
 	return TRUE;
 }
 
+static void
+panel_background_charge_pattern (PanelBackground *background)
+{
+	cairo_surface_t *surface;
+	gsize            bytes = 0;
+
+	if (background->composited_pattern &&
+	    cairo_pattern_get_surface (background->composited_pattern,
+				       &surface) == CAIRO_STATUS_SUCCESS)
+		bytes = panel_memory_surface_size (surface);
+
+	panel_memory_charge (background->user_data, "background-pattern", bytes);
+}
+
 static void
 free_composited_resources (PanelBackground *background)
 {
@@ -194,10 +215,19 @@ free_composited_resources (PanelBackground *background)
 	if (background->composited_pattern)
 		cairo_pattern_destroy (background->composited_pattern);
 	background->composited_pattern = NULL;
+
+	panel_background_charge_pattern (background);
 }
 
 #ifdef HAVE_X11
 
+static void
+panel_background_charge_desktop (PanelBackground *background)
+{
+	panel_memory_charge (background->user_data, "desktop-region",
+			     panel_memory_pixbuf_size (background->desktop));
+}
+
 static void _panel_background_transparency (CdkScreen       *screen G_GNUC_UNUSED,
 					    PanelBackground *background)
 {
@@ -224,6 +254,7 @@ background_changed (PanelBackgroundMonitor *monitor G_GNUC_UNUSED,
 	if (tmp)
 		g_object_unref (tmp);
 
+	panel_background_charge_desktop (background);
 	panel_background_composite (background);
 }
 
@@ -266,6 +297,7 @@ composite_image_onto_desktop (PanelBackground *background)
 	int              width, height;
 	cairo_t         *cr;
 	cairo_surface_t *surface;
+	cairo_surface_t *image;
 	cairo_pattern_t *pattern;
 
 	width  = background->region.width;
@@ -299,7 +331,10 @@ composite_image_onto_desktop (PanelBackground *background)
 	}
 #endif // HAVE_X11
 
-	cdk_cairo_set_source_pixbuf (cr, background->transformed_image, 0, 0);
+	image = cdk_cairo_surface_create_from_pixbuf (background->transformed_image,
+						      background->transformed_scale,
+						      NULL);
+	cairo_set_source_surface (cr, image, 0, 0);
 	pattern = cairo_get_source (cr);
 	cairo_pattern_set_extend (pattern, CAIRO_EXTEND_REPEAT);
 
@@ -307,6 +342,7 @@ composite_image_onto_desktop (PanelBackground *background)
 	cairo_fill (cr);
 
 	cairo_destroy (cr);
+	cairo_surface_destroy (image);
 
 	pattern = cairo_pattern_create_for_surface (surface);
 	cairo_surface_destroy (surface);
@@ -407,6 +443,10 @@ panel_background_composite (PanelBackground *background)
 
 	background->composited = TRUE;
 
+	panel_background_charge_pattern (background);
+#ifdef HAVE_X11
+	panel_background_charge_desktop (background);
+#endif // HAVE_X11
 
 	panel_background_prepare (background);
 
@@ -420,44 +460,186 @@ free_transformed_resources (PanelBackground *background)
 
 	background->transformed = FALSE;
 
+	if (background->load_cancellable) {
+		g_cancellable_cancel (background->load_cancellable);
+		g_object_unref (background->load_cancellable);
+		background->load_cancellable = NULL;
+	}
+
 	if (background->type != PANEL_BACK_IMAGE)
 		return;
 
-	if (background->transformed_image)
+	if (background->transformed_image) {
+		background_cache_add_user (background->transformed_image, -1);
 		g_object_unref (background->transformed_image);
+	}
 	background->transformed_image = NULL;
 }
 
-static GdkPixbuf *
-get_scaled_and_rotated_pixbuf (PanelBackground *background)
+/* Number of decoded background images kept around; enough for a couple
+ * of panels and an orientation flip without holding on to many
+ * screen-sized pixbufs. */
+#define BACKGROUND_CACHE_SIZE 4
+
+typedef struct {
+	char      *key;
+	GdkPixbuf *pixbuf;
+	int        scale;
+	guint      users;  /* backgrounds showing pixbuf */
+} BackgroundCacheEntry;
+
+typedef struct {
+	char           *image;
+	char           *key;
+	int             panel_width;
+	int             panel_height;
+	int             scale;
+	CtkOrientation  orientation;
+	guint           fit_image : 1;
+	guint           stretch_image : 1;
+	guint           rotate_image : 1;
+} BackgroundLoadData;
+
+static GQueue background_cache = G_QUEUE_INIT;
+
+static void
+background_cache_entry_free (BackgroundCacheEntry *entry)
 {
-	GdkPixbuf *scaled;
-	GdkPixbuf *retval;
-	int        orig_width, orig_height;
-	int        panel_width, panel_height;
-	int        width, height;
+	g_free (entry->key);
+	if (entry->pixbuf)
+		g_object_unref (entry->pixbuf);
+	g_free (entry);
+}
 
-	load_background_file (background);
-	if (!background->loaded_image)
-		return NULL;
+static BackgroundCacheEntry *
+background_cache_lookup (const char *key)
+{
+	GList *l;
+
+	for (l = background_cache.head; l; l = l->next) {
+		BackgroundCacheEntry *entry = l->data;
+
+		if (strcmp (entry->key, key) != 0)
+			continue;
+
+		/* move to the front, the tail is evicted first */
+		g_queue_unlink (&background_cache, l);
+		g_queue_push_head_link (&background_cache, l);
+
+		return entry;
+	}
+
+	return NULL;
+}
+
+/* Counts the backgrounds showing each cached image. An image evicted
+ * while in use is not counted any more, it is not in the cache. */
+static void
+background_cache_add_user (GdkPixbuf *pixbuf,
+			   int        delta)
+{
+	GList *l;
+
+	if (!pixbuf)
+		return;
 
-	orig_width  = gdk_pixbuf_get_width  (background->loaded_image);
-	orig_height = gdk_pixbuf_get_height (background->loaded_image);
+	for (l = background_cache.head; l; l = l->next) {
+		BackgroundCacheEntry *entry = l->data;
 
-	panel_width  = background->region.width;
-	panel_height = background->region.height;
+		if (entry->pixbuf == pixbuf) {
+			entry->users += delta;
+			return;
+		}
+	}
+}
+
+static void
+background_cache_charge (void)
+{
+	GList *l;
+	gsize  bytes = 0;
+
+	for (l = background_cache.head; l; l = l->next) {
+		BackgroundCacheEntry *entry = l->data;
+
+		bytes += panel_memory_pixbuf_size (entry->pixbuf);
+	}
+
+	panel_memory_charge (NULL, "background-images", bytes);
+}
+
+/* Drops the images no background is showing; the others would not be
+ * freed anyway. */
+static void
+background_cache_shrink (void)
+{
+	GList *l, *next;
+
+	for (l = background_cache.head; l; l = next) {
+		BackgroundCacheEntry *entry = l->data;
+
+		next = l->next;
+
+		if (entry->users > 0)
+			continue;
+
+		background_cache_entry_free (entry);
+		g_queue_delete_link (&background_cache, l);
+	}
+
+	background_cache_charge ();
+}
+
+static void
+background_cache_insert (BackgroundCacheEntry *entry)
+{
+	static gboolean shrinker_added = FALSE;
+
+	if (!shrinker_added) {
+		panel_memory_add_shrinker (background_cache_shrink);
+		shrinker_added = TRUE;
+	}
+
+	g_queue_push_head (&background_cache, entry);
+
+	while (g_queue_get_length (&background_cache) > BACKGROUND_CACHE_SIZE)
+		background_cache_entry_free (g_queue_pop_tail (&background_cache));
+
+	background_cache_charge ();
+}
+
+static void
+background_load_data_free (BackgroundLoadData *data)
+{
+	g_free (data->image);
+	g_free (data->key);
+	g_free (data);
+}
+
+static void
+get_transformed_size (BackgroundLoadData *data,
+		      int                 orig_width,
+		      int                 orig_height,
+		      int                *width_out,
+		      int                *height_out)
+{
+	int panel_width, panel_height;
+	int width, height;
+
+	panel_width  = data->panel_width;
+	panel_height = data->panel_height;
 
 	width  = orig_width;
 	height = orig_height;
 
-	if (background->fit_image) {
-		switch (background->orientation) {
+	if (data->fit_image) {
+		switch (data->orientation) {
 		case CTK_ORIENTATION_HORIZONTAL:
 			width  = orig_width * panel_height / orig_height;
 			height = panel_height;
 			break;
 		case CTK_ORIENTATION_VERTICAL:
-			if (background->rotate_image) {
+			if (data->rotate_image) {
 				width  = orig_width * panel_width / orig_height;
 				height = panel_width;
 			} else {
@@ -469,86 +651,283 @@ get_scaled_and_rotated_pixbuf (PanelBackground *background)
 			g_assert_not_reached ();
 			break;
 		}
-	} else if (background->stretch_image) {
-		if (background->orientation == CTK_ORIENTATION_VERTICAL &&
-		    background->rotate_image) {
+	} else if (data->stretch_image) {
+		if (data->orientation == CTK_ORIENTATION_VERTICAL &&
+		    data->rotate_image) {
 			width  = panel_height;
 			height = panel_width;
 		} else {
 			width  = panel_width;
 			height = panel_height;
 		}
-	} else if (background->orientation == CTK_ORIENTATION_VERTICAL &&
-		   background->rotate_image) {
+	} else if (data->orientation == CTK_ORIENTATION_VERTICAL &&
+		   data->rotate_image) {
 		int tmp = width;
 		width = height;
 		height = tmp;
 	}
 
-	if (width == orig_width &&
-	    height == orig_height) {
-		scaled = background->loaded_image;
-		g_object_ref (scaled);
+	*width_out  = MAX (width, 1);
+	*height_out = MAX (height, 1);
+}
+
+static GdkPixbuf *
+rotate_pixbuf (GdkPixbuf *scaled)
+{
+	GdkPixbuf *retval;
+	int        width, height;
+
+	width  = gdk_pixbuf_get_width  (scaled);
+	height = gdk_pixbuf_get_height (scaled);
+
+	if (!gdk_pixbuf_get_has_alpha (scaled)) {
+		guchar *dest;
+		guchar *src;
+		int     x, y;
+		int     destrowstride;
+		int     srcrowstride;
+
+		retval = gdk_pixbuf_new (
+			GDK_COLORSPACE_RGB, FALSE, 8, height, width);
+
+		dest          = gdk_pixbuf_get_pixels (retval);
+		destrowstride = gdk_pixbuf_get_rowstride (retval);
+		src           = gdk_pixbuf_get_pixels (scaled);
+		srcrowstride  = gdk_pixbuf_get_rowstride (scaled);
+
+		for (y = 0; y < height; y++)
+			for (x = 0; x < width; x++) {
+				guchar *dstptr = & ( dest [3*y + destrowstride * (width - x - 1)] );
+				guchar *srcptr = & ( src [y * srcrowstride + 3*x] );
+				dstptr[0] = srcptr[0];
+				dstptr[1] = srcptr[1];
+				dstptr[2] = srcptr[2];
+			}
 	} else {
-		scaled = gdk_pixbuf_scale_simple (
-				background->loaded_image,
-				width, height,
-				GDK_INTERP_BILINEAR);
+		guint32 *dest;
+		guint32 *src;
+		int     x, y;
+		int     destrowstride;
+		int     srcrowstride;
+
+		retval = gdk_pixbuf_new (
+			GDK_COLORSPACE_RGB, TRUE, 8, height, width);
+
+		dest          = (guint32 *) gdk_pixbuf_get_pixels (retval);
+		destrowstride =             gdk_pixbuf_get_rowstride (retval) / 4;
+		src           = (guint32 *) gdk_pixbuf_get_pixels (scaled);
+		srcrowstride  =             gdk_pixbuf_get_rowstride (scaled) / 4;
+
+		for (y = 0; y < height; y++)
+			for (x = 0; x < width; x++)
+				dest [y + destrowstride * (width - x - 1)] =
+					src [y * srcrowstride + x];
 	}
 
-	if (background->rotate_image &&
-	    background->orientation == CTK_ORIENTATION_VERTICAL) {
-		if (!background->has_alpha) {
-			guchar *dest;
-			guchar *src;
-			int     x, y;
-			int     destrowstride;
-			int     srcrowstride;
-
-			retval = gdk_pixbuf_new (
-				GDK_COLORSPACE_RGB, FALSE, 8, height, width);
-
-			dest          = gdk_pixbuf_get_pixels (retval);
-			destrowstride = gdk_pixbuf_get_rowstride (retval);
-			src           = gdk_pixbuf_get_pixels (scaled);
-			srcrowstride  = gdk_pixbuf_get_rowstride (scaled);
-
-			for (y = 0; y < height; y++)
-				for (x = 0; x < width; x++) {
-					guchar *dstptr = & ( dest [3*y + destrowstride * (width - x - 1)] );
-					guchar *srcptr = & ( src [y * srcrowstride + 3*x] );
-					dstptr[0] = srcptr[0];
-					dstptr[1] = srcptr[1];
-					dstptr[2] = srcptr[2];
-				}
-
-			g_object_unref (scaled);
-		} else {
-			guint32 *dest;
-			guint32 *src;
-			int     x, y;
-			int     destrowstride;
-			int     srcrowstride;
-
-			retval = gdk_pixbuf_new (
-				GDK_COLORSPACE_RGB, TRUE, 8, height, width);
-
-			dest          = (guint32 *) gdk_pixbuf_get_pixels (retval);
-			destrowstride =             gdk_pixbuf_get_rowstride (retval) / 4;
-			src           = (guint32 *) gdk_pixbuf_get_pixels (scaled);
-			srcrowstride  =             gdk_pixbuf_get_rowstride (scaled) / 4;
-
-			for (y = 0; y < height; y++)
-				for (x = 0; x < width; x++)
-					dest [y + destrowstride * (width - x - 1)] =
-						src [y * srcrowstride + x];
-
-			g_object_unref (scaled);
+	return retval;
+}
+
+/* Runs in a worker thread: only touches the copied load data. */
+static void
+background_load_thread (GTask        *task,
+			gpointer      source_object G_GNUC_UNUSED,
+			gpointer      task_data,
+			GCancellable *cancellable G_GNUC_UNUSED)
+{
+	BackgroundLoadData   *data = task_data;
+	BackgroundCacheEntry *entry;
+	GdkPixbuf            *scaled;
+	GError               *error = NULL;
+	int                   orig_width, orig_height;
+	int                   width, height;
+	int                   scale;
+
+	/* images that are scaled to the panel are rendered at device
+	 * resolution, tiled images keep their natural size */
+	scale = (data->fit_image || data->stretch_image) ? data->scale : 1;
+
+	if (gdk_pixbuf_get_file_info (data->image, &orig_width, &orig_height)) {
+		get_transformed_size (data, orig_width, orig_height,
+				      &width, &height);
+
+		/* passing the target size lets the loader decode a
+		 * reduced image instead of the full resolution one */
+		if (width * scale == orig_width && height * scale == orig_height)
+			scaled = gdk_pixbuf_new_from_file (data->image, &error);
+		else
+			scaled = gdk_pixbuf_new_from_file_at_scale (data->image,
+								    width * scale,
+								    height * scale,
+								    FALSE,
+								    &error);
+	} else {
+		GdkPixbuf *loaded;
+
+		loaded = gdk_pixbuf_new_from_file (data->image, &error);
+		scaled = NULL;
+
+		if (loaded) {
+			get_transformed_size (data,
+					      gdk_pixbuf_get_width (loaded),
+					      gdk_pixbuf_get_height (loaded),
+					      &width, &height);
+			scaled = gdk_pixbuf_scale_simple (loaded,
+							  width * scale,
+							  height * scale,
+							  GDK_INTERP_BILINEAR);
+			g_object_unref (loaded);
 		}
+	}
+
+	if (!scaled) {
+		/* gdk_pixbuf_scale_simple() fails without an error */
+		if (!error)
+			error = g_error_new_literal (GDK_PIXBUF_ERROR,
+						     GDK_PIXBUF_ERROR_INSUFFICIENT_MEMORY,
+						     "Cannot scale the background image");
+		g_task_return_error (task, error);
+		return;
+	}
+
+	entry = g_new0 (BackgroundCacheEntry, 1);
+	entry->key   = g_strdup (data->key);
+	entry->scale = scale;
+
+	if (data->rotate_image &&
+	    data->orientation == CTK_ORIENTATION_VERTICAL) {
+		entry->pixbuf = rotate_pixbuf (scaled);
+		g_object_unref (scaled);
 	} else
-		retval = scaled;
+		entry->pixbuf = scaled;
 
-	return retval;
+	g_task_return_pointer (task, entry,
+			       (GDestroyNotify) background_cache_entry_free);
+}
+
+static void
+panel_background_set_transformed_image (PanelBackground *background,
+					GdkPixbuf       *pixbuf,
+					int              scale)
+{
+	if (pixbuf) {
+		g_object_ref (pixbuf);
+		background_cache_add_user (pixbuf, 1);
+	}
+	if (background->transformed_image) {
+		background_cache_add_user (background->transformed_image, -1);
+		g_object_unref (background->transformed_image);
+	}
+	background->transformed_image = pixbuf;
+	background->transformed_scale = scale;
+
+	background->transformed = TRUE;
+
+	panel_background_update_has_alpha (background);
+	panel_background_composite (background);
+}
+
+static void
+background_image_loaded (GObject      *source_object G_GNUC_UNUSED,
+			 GAsyncResult *result,
+			 gpointer      user_data)
+{
+	PanelBackground      *background = user_data;
+	BackgroundCacheEntry *entry;
+	GError               *error = NULL;
+
+	entry = g_task_propagate_pointer (G_TASK (result), &error);
+
+	/* the background may already be gone when we were cancelled */
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		return;
+	}
+
+	g_clear_object (&background->load_cancellable);
+
+	if (!entry) {
+		g_warning (G_STRLOC ": unable to open '%s': %s",
+			   background->image, error->message);
+		g_error_free (error);
+
+		panel_background_set_transformed_image (background, NULL, 1);
+		return;
+	}
+
+	background_cache_insert (entry);
+	panel_background_set_transformed_image (background,
+						entry->pixbuf,
+						entry->scale);
+}
+
+/* Decodes the background image at the size it will be drawn at.  The
+ * previous background stays on the window until the new image has
+ * been loaded, as nothing is prepared while we are not transformed. */
+static void
+load_background_file (PanelBackground *background)
+{
+	BackgroundCacheEntry *entry;
+	BackgroundLoadData   *data;
+	GStatBuf              buf;
+	GTask                *task;
+	gboolean              scaled;
+	int                   scale;
+	char                 *key;
+
+	if (!background->image ||
+	    g_stat (background->image, &buf) != 0 ||
+	    !S_ISREG (buf.st_mode)) {
+		panel_background_set_transformed_image (background, NULL, 1);
+		return;
+	}
+
+	scale = background->window ?
+		cdk_window_get_scale_factor (background->window) : 1;
+	scaled = background->fit_image || background->stretch_image;
+
+	//FIXME add a monitor on the file so that we reload the background
+	//when it changes; for now the mtime is part of the cache key
+	key = g_strdup_printf ("%s:%" G_GINT64_FORMAT ":%dx%d@%d:%d%d%d%d",
+			       background->image,
+			       (gint64) buf.st_mtime,
+			       scaled ? background->region.width : 0,
+			       scaled ? background->region.height : 0,
+			       scale,
+			       background->fit_image,
+			       background->stretch_image,
+			       background->rotate_image,
+			       background->orientation == CTK_ORIENTATION_VERTICAL);
+
+	entry = background_cache_lookup (key);
+	panel_stats_count (NULL, entry ? PANEL_STATS_IMAGE_CACHE_HITS
+				       : PANEL_STATS_IMAGE_CACHE_MISSES);
+	if (entry) {
+		g_free (key);
+		panel_background_set_transformed_image (background,
+							entry->pixbuf,
+							entry->scale);
+		return;
+	}
+
+	data = g_new0 (BackgroundLoadData, 1);
+	data->image         = g_strdup (background->image);
+	data->key           = key;
+	data->panel_width   = background->region.width;
+	data->panel_height  = background->region.height;
+	data->scale         = scale;
+	data->orientation   = background->orientation;
+	data->fit_image     = background->fit_image;
+	data->stretch_image = background->stretch_image;
+	data->rotate_image  = background->rotate_image;
+
+	background->load_cancellable = g_cancellable_new ();
+
+	task = g_task_new (NULL, background->load_cancellable,
+			   background_image_loaded, background);
+	g_task_set_task_data (task, data,
+			      (GDestroyNotify) background_load_data_free);
+	g_task_run_in_thread (task, background_load_thread);
+	g_object_unref (task);
 }
 
 static gboolean
@@ -559,9 +938,11 @@ panel_background_transform (PanelBackground *background)
 
 	free_transformed_resources (background);
 
-	if (background->type == PANEL_BACK_IMAGE)
-		background->transformed_image =
-			get_scaled_and_rotated_pixbuf (background);
+	if (background->type == PANEL_BACK_IMAGE) {
+		/* finishes transforming, possibly asynchronously */
+		load_background_file (background);
+		return TRUE;
+	}
 
 	background->transformed = TRUE;
 
@@ -586,6 +967,7 @@ disconnect_background_monitor (PanelBackground *background)
 	if (background->desktop)
 		g_object_unref (background->desktop);
 	background->desktop = NULL;
+	panel_background_charge_desktop (background);
 }
 #endif // HAVE_X11
 
@@ -598,8 +980,8 @@ panel_background_update_has_alpha (PanelBackground *background)
 		has_alpha = (background->color.alpha < 1.);
 
 	else if (background->type == PANEL_BACK_IMAGE &&
-		 background->loaded_image)
-		has_alpha = gdk_pixbuf_get_has_alpha (background->loaded_image);
+		 background->transformed_image)
+		has_alpha = gdk_pixbuf_get_has_alpha (background->transformed_image);
 
 	background->has_alpha = has_alpha;
 
@@ -611,28 +993,6 @@ panel_background_update_has_alpha (PanelBackground *background)
 #endif // HAVE_X11
 }
 
-static void
-load_background_file (PanelBackground *background)
-{
-	GError *error = NULL;
-
-	if (!g_file_test (background->image, G_FILE_TEST_IS_REGULAR))
-		return;
-
-	//FIXME add a monitor on the file so that we reload the background
-	//when it changes
-	background->loaded_image =
-		gdk_pixbuf_new_from_file (background->image, &error);
-	if (!background->loaded_image) {
-		g_assert (error != NULL);
-		g_warning (G_STRLOC ": unable to open '%s': %s",
-			   background->image, error->message);
-		g_error_free (error);
-	}
-
-	panel_background_update_has_alpha (background);
-}
-
 void
 panel_background_set_type (PanelBackground     *background,
 			   PanelBackgroundType  type)
@@ -700,10 +1060,6 @@ static void
 panel_background_set_image_no_update (PanelBackground *background,
 				      const char      *image)
 {
-	if (background->loaded_image)
-		g_object_unref (background->loaded_image);
-	background->loaded_image = NULL;
-
 	if (background->image)
 		g_free (background->image);
 	background->image = NULL;
@@ -908,6 +1264,7 @@ panel_background_change_region (PanelBackground *background,
 	if (background->desktop)
 		g_object_unref (background->desktop);
 	background->desktop = NULL;
+	panel_background_charge_desktop (background);
 #endif // HAVE_X11
 
 	if (need_to_retransform || ! background->transformed)
@@ -938,8 +1295,8 @@ panel_background_init (PanelBackground              *background,
 	background->color.green = 0.;
 	background->color.alpha = 1.;
 
-	background->image        = NULL;
-	background->loaded_image = NULL;
+	background->image            = NULL;
+	background->load_cancellable = NULL;
 
 	background->orientation       = CTK_ORIENTATION_HORIZONTAL;
 	background->region.x          = -1;
@@ -947,6 +1304,7 @@ panel_background_init (PanelBackground              *background,
 	background->region.width      = -1;
 	background->region.height     = -1;
 	background->transformed_image = NULL;
+	background->transformed_scale = 1;
 	background->composited_pattern = NULL;
 
 #ifdef HAVE_X11
@@ -989,10 +1347,6 @@ panel_background_free (PanelBackground *background)
 		g_free (background->image);
 	background->image = NULL;
 
-	if (background->loaded_image)
-		g_object_unref (background->loaded_image);
-	background->loaded_image = NULL;
-
 #ifdef HAVE_X11
 	if (background->monitor)
 		g_object_unref (background->monitor);
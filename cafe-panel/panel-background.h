@@ -52,11 +52,12 @@ struct _PanelBackground {
 	CdkRGBA                 color;
 
 	char                   *image;
-	GdkPixbuf              *loaded_image;
+	GCancellable           *load_cancellable;
 
 	CtkOrientation          orientation;
 	CdkRectangle            region;
 	GdkPixbuf              *transformed_image;
+	int                     transformed_scale;
 	cairo_pattern_t        *composited_pattern;
 
 #ifdef HAVE_X11
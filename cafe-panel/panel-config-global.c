@@ -32,6 +32,8 @@
 #include <gio/gio.h>
 
 #include "panel-globals.h"
+#include "panel-memory.h"
+#include "panel-watchdog.h"
 
 typedef struct {
 	guint               tooltips_enabled : 1;
@@ -39,6 +41,7 @@ typedef struct {
 	guint               drawer_auto_close : 1;
 	guint               confirm_panel_remove : 1;
 	guint               highlight_when_over : 1;
+	guint               prewarm_menus : 1;
 } GlobalConfig;
 
 static GlobalConfig global_config = { 0, };
@@ -85,6 +88,14 @@ panel_global_config_get_confirm_panel_remove (void)
 	return global_config.confirm_panel_remove;
 }
 
+gboolean
+panel_global_config_get_prewarm_menus (void)
+{
+	g_assert (global_config_initialised == TRUE);
+
+	return global_config.prewarm_menus;
+}
+
 static void
 panel_global_config_set_entry (GSettings *settings, gchar *key)
 {
@@ -110,6 +121,16 @@ panel_global_config_set_entry (GSettings *settings, gchar *key)
 	else if (strcmp (key, "highlight-launchers-on-mouseover") == 0)
 		global_config.highlight_when_over =
 			g_settings_get_boolean (settings, key);
+
+	else if (strcmp (key, "prewarm-menus") == 0)
+		global_config.prewarm_menus =
+			g_settings_get_boolean (settings, key);
+
+	else if (strcmp (key, "watchdog-threshold") == 0)
+		panel_watchdog_set_threshold (g_settings_get_int (settings, key), TRUE);
+
+	else if (strcmp (key, "memory-budget") == 0)
+		panel_memory_set_budget ((gsize) g_settings_get_int (settings, key) * 1024);
 }
 
 static void
@@ -39,6 +39,7 @@ gboolean panel_global_config_get_enable_animations    (void);
 gboolean panel_global_config_get_drawer_auto_close    (void);
 gboolean panel_global_config_get_tooltips_enabled     (void);
 gboolean panel_global_config_get_confirm_panel_remove (void);
+gboolean panel_global_config_get_prewarm_menus        (void);
 
 #ifdef __cplusplus
 }
@@ -26,6 +26,8 @@
 #include <libpanel-util/panel-color.h>
 
 #include "panel-frame.h"
+#include "panel-memory.h"
+#include "panel-stats.h"
 #include "panel-typebuiltins.h"
 
 G_DEFINE_TYPE (PanelFrame, panel_frame, CTK_TYPE_BIN)
@@ -162,47 +164,112 @@ panel_frame_size_allocate (CtkWidget     *widget,
 		ctk_widget_size_allocate (child, &child_allocation);
 }
 
-void
-panel_frame_draw (CtkWidget      *widget,
-		  cairo_t *cr,
-		  PanelFrameEdge  edges)
-{
-	PanelFrame       *frame = (PanelFrame *) widget;
-	CtkStyleContext  *context;
+/* The edges are cached as one strip per edge, so that a redraw only
+ * paints surfaces and does not need to look at the style. The cache
+ * is dropped when the style changes. */
+enum {
+	PANEL_FRAME_STRIP_BOTTOM,
+	PANEL_FRAME_STRIP_RIGHT,
+	PANEL_FRAME_STRIP_TOP,
+	PANEL_FRAME_STRIP_LEFT,
+	PANEL_FRAME_N_STRIPS
+};
+
+typedef struct {
+	CtkWidget        *widget;
+	int               width;
+	int               height;
+	PanelFrameEdge    edges;
 	CtkStateFlags     state;
-	CdkRGBA          *bg;
-	CdkRGBA           dark, light;
-	CtkBorder         padding;
-	int               x, y, width, height;
+	cairo_surface_t  *strips [PANEL_FRAME_N_STRIPS];
+	CdkRectangle      rects [PANEL_FRAME_N_STRIPS];
+} PanelFrameCache;
 
+static GQuark panel_frame_cache_quark = 0;
 
-	if (edges == PANEL_EDGE_NONE)
-		return;
+static void
+panel_frame_cache_clear (PanelFrameCache *cache)
+{
+	int i;
 
-	context = ctk_widget_get_style_context (widget);
-	state = ctk_widget_get_state_flags (widget);
+	for (i = 0; i < PANEL_FRAME_N_STRIPS; i++) {
+		if (cache->strips [i])
+			cairo_surface_destroy (cache->strips [i]);
+		cache->strips [i] = NULL;
+	}
 
-	width = ctk_widget_get_allocated_width (widget);
-	height = ctk_widget_get_allocated_height (widget);
+	cache->edges = PANEL_EDGE_NONE;
+	cache->width = cache->height = -1;
 
-	ctk_style_context_get (context, state,
-	                       "background-color", &bg,
-	                       NULL);
+	panel_memory_charge (cache->widget, "frame-edges", 0);
+}
 
-	ctk_style_shade (bg, &dark, 0.7);
-	ctk_style_shade (bg, &light, 1.3);
+static void
+panel_frame_cache_free (gpointer data)
+{
+	PanelFrameCache *cache = data;
+
+	panel_frame_cache_clear (cache);
+	g_free (cache);
+}
 
-	ctk_style_context_get_padding (context, state, &padding);
+static void
+panel_frame_style_updated (CtkWidget *widget,
+			   gpointer   data G_GNUC_UNUSED)
+{
+	PanelFrameCache *cache;
+
+	cache = g_object_get_qdata (G_OBJECT (widget), panel_frame_cache_quark);
+	if (cache)
+		panel_frame_cache_clear (cache);
+}
+
+static PanelFrameCache *
+panel_frame_get_cache (CtkWidget *widget)
+{
+	PanelFrameCache *cache;
+
+	if (!panel_frame_cache_quark)
+		panel_frame_cache_quark = g_quark_from_static_string ("panel-frame-cache");
+
+	cache = g_object_get_qdata (G_OBJECT (widget), panel_frame_cache_quark);
+	if (cache)
+		return cache;
+
+	/* panel_frame_draw() takes any widget, so keep this on the
+	 * widget rather than in PanelFrame */
+	cache = g_new0 (PanelFrameCache, 1);
+	cache->widget = widget;
+	cache->width = cache->height = -1;
+	g_object_set_qdata_full (G_OBJECT (widget), panel_frame_cache_quark,
+				 cache, panel_frame_cache_free);
+	g_signal_connect (widget, "style-updated",
+			  G_CALLBACK (panel_frame_style_updated), NULL);
+
+	return cache;
+}
 
-	/* Copied from ctk_default_draw_shadow() */
+/* Copied from ctk_default_draw_shadow() */
+static void
+panel_frame_render_edge (cairo_t        *cr,
+			 int             strip,
+			 int             size,
+			 int             width,
+			 int             height,
+			 const CdkRGBA  *bg,
+			 const CdkRGBA  *dark,
+			 const CdkRGBA  *light)
+{
+	int x, y;
 
 	x = y = 0;
 
 	cairo_set_line_width (cr, 1);
 
-	if (frame->edges & PANEL_EDGE_BOTTOM && padding.bottom > 0) {
-		if (padding.bottom > 1) {
-			cdk_cairo_set_source_rgba (cr, &dark);
+	switch (strip) {
+	case PANEL_FRAME_STRIP_BOTTOM:
+		if (size > 1) {
+			cdk_cairo_set_source_rgba (cr, dark);
 			cairo_move_to (cr, x + .5, y + height - 2 + .5);
 			cairo_line_to (cr, x + width - 1 - .5, y + height - 2 + .5);
 			cairo_stroke (cr);
@@ -212,16 +279,16 @@ panel_frame_draw (CtkWidget      *widget,
 			cairo_line_to (cr, x + width - 1 - .5, y + height - 1 - .5);
 			cairo_stroke (cr);
 		} else {
-			cdk_cairo_set_source_rgba (cr, &dark);
+			cdk_cairo_set_source_rgba (cr, dark);
 			cairo_move_to (cr, x + .5, y + height - 1 - .5);
 			cairo_line_to (cr, x + width - 1 - .5, y + height - 1 - .5);
 			cairo_stroke (cr);
 		}
-	}
+		break;
 
-	if (frame->edges & PANEL_EDGE_RIGHT && padding.right > 0) {
-		if (padding.right > 1) {
-			cdk_cairo_set_source_rgba (cr, &dark);
+	case PANEL_FRAME_STRIP_RIGHT:
+		if (size > 1) {
+			cdk_cairo_set_source_rgba (cr, dark);
 			cairo_move_to (cr, x + width - 2 - .5, y + .5);
 			cairo_line_to (cr, x + width - 2 - .5, y + height - 1 - .5);
 			cairo_stroke (cr);
@@ -231,44 +298,180 @@ panel_frame_draw (CtkWidget      *widget,
 			cairo_line_to (cr, x + width - 1 - .5, y + height - 1 - .5);
 			cairo_stroke (cr);
 		} else {
-			cdk_cairo_set_source_rgba (cr, &dark);
+			cdk_cairo_set_source_rgba (cr, dark);
 			cairo_move_to (cr, x + width - 1 - .5, y + .5);
 			cairo_line_to (cr, x + width - 1 - .5, y + height - 1 - .5);
 			cairo_stroke (cr);
 		}
-	}
+		break;
 
-	if (frame->edges & PANEL_EDGE_TOP && padding.top > 0) {
-		cdk_cairo_set_source_rgba (cr, &light);
+	case PANEL_FRAME_STRIP_TOP:
+		cdk_cairo_set_source_rgba (cr, light);
 		cairo_move_to (cr, x + .5, y + .5);
 		cairo_line_to (cr, x + width - 1 - .5, y + .5);
 		cairo_stroke (cr);
 
-		if (padding.top > 1) {
+		if (size > 1) {
 			cdk_cairo_set_source_rgba (cr, bg);
 			cairo_move_to (cr, x + .5, y + 1 + .5);
 			cairo_line_to (cr, x + width - 1 - .5, y + 1 + .5);
 			cairo_stroke (cr);
 		}
-	}
+		break;
 
-	if (frame->edges & PANEL_EDGE_LEFT && padding.left > 0) {
-		cdk_cairo_set_source_rgba (cr, &light);
+	case PANEL_FRAME_STRIP_LEFT:
+		cdk_cairo_set_source_rgba (cr, light);
 		cairo_move_to (cr, x + .5, y + .5);
 		cairo_line_to (cr, x + .5, y + height - 1 - .5);
 		cairo_stroke (cr);
 
-		if (padding.left > 1) {
+		if (size > 1) {
 			cdk_cairo_set_source_rgba (cr, bg);
 			cairo_move_to (cr, x + 1 + .5, y + .5);
 			cairo_line_to (cr, x + 1 + .5, y + height - 1 - .5);
 			cairo_stroke (cr);
 		}
+		break;
+
+	default:
+		g_assert_not_reached ();
+		break;
+	}
+}
+
+static void
+panel_frame_cache_render (CtkWidget       *widget,
+			  cairo_t         *cr,
+			  PanelFrameCache *cache)
+{
+	CtkStyleContext *context;
+	CdkRGBA         *bg;
+	CdkRGBA          dark, light;
+	CtkBorder        padding;
+	gsize            bytes = 0;
+	int              sizes [PANEL_FRAME_N_STRIPS];
+	int              width, height;
+	int              i;
+
+	context = ctk_widget_get_style_context (widget);
+	width = cache->width;
+	height = cache->height;
+
+	ctk_style_context_get (context, cache->state,
+	                       "background-color", &bg,
+	                       NULL);
+
+	ctk_style_shade (bg, &dark, 0.7);
+	ctk_style_shade (bg, &light, 1.3);
+
+	ctk_style_context_get_padding (context, cache->state, &padding);
+
+	sizes [PANEL_FRAME_STRIP_BOTTOM] = (cache->edges & PANEL_EDGE_BOTTOM) ? padding.bottom : 0;
+	sizes [PANEL_FRAME_STRIP_RIGHT]  = (cache->edges & PANEL_EDGE_RIGHT)  ? padding.right  : 0;
+	sizes [PANEL_FRAME_STRIP_TOP]    = (cache->edges & PANEL_EDGE_TOP)    ? padding.top    : 0;
+	sizes [PANEL_FRAME_STRIP_LEFT]   = (cache->edges & PANEL_EDGE_LEFT)   ? padding.left   : 0;
+
+	/* the edges are at most two pixels wide */
+	cache->rects [PANEL_FRAME_STRIP_BOTTOM].x = 0;
+	cache->rects [PANEL_FRAME_STRIP_BOTTOM].y = MAX (height - 2, 0);
+	cache->rects [PANEL_FRAME_STRIP_BOTTOM].width = width;
+	cache->rects [PANEL_FRAME_STRIP_BOTTOM].height = MIN (height, 2);
+
+	cache->rects [PANEL_FRAME_STRIP_RIGHT].x = MAX (width - 2, 0);
+	cache->rects [PANEL_FRAME_STRIP_RIGHT].y = 0;
+	cache->rects [PANEL_FRAME_STRIP_RIGHT].width = MIN (width, 2);
+	cache->rects [PANEL_FRAME_STRIP_RIGHT].height = height;
+
+	cache->rects [PANEL_FRAME_STRIP_TOP].x = 0;
+	cache->rects [PANEL_FRAME_STRIP_TOP].y = 0;
+	cache->rects [PANEL_FRAME_STRIP_TOP].width = width;
+	cache->rects [PANEL_FRAME_STRIP_TOP].height = MIN (height, 2);
+
+	cache->rects [PANEL_FRAME_STRIP_LEFT].x = 0;
+	cache->rects [PANEL_FRAME_STRIP_LEFT].y = 0;
+	cache->rects [PANEL_FRAME_STRIP_LEFT].width = MIN (width, 2);
+	cache->rects [PANEL_FRAME_STRIP_LEFT].height = height;
+
+	for (i = 0; i < PANEL_FRAME_N_STRIPS; i++) {
+		CdkRectangle *rect = &cache->rects [i];
+		cairo_t      *strip_cr;
+
+		if (sizes [i] <= 0 || rect->width <= 0 || rect->height <= 0)
+			continue;
+
+		cache->strips [i] = cairo_surface_create_similar (cairo_get_target (cr),
+								  CAIRO_CONTENT_COLOR_ALPHA,
+								  rect->width, rect->height);
+
+		strip_cr = cairo_create (cache->strips [i]);
+		cairo_translate (strip_cr, -rect->x, -rect->y);
+		panel_frame_render_edge (strip_cr, i, sizes [i], width, height,
+					 bg, &dark, &light);
+		cairo_destroy (strip_cr);
+
+		/* the strips are usually xlib surfaces, which
+		 * panel_memory_surface_size() does not see into: count
+		 * 32 bits per pixel held by the X server */
+		bytes += (gsize) rect->width * rect->height * 4;
 	}
 
+	panel_memory_charge (widget, "frame-edges", bytes);
+
 	cdk_rgba_free (bg);
 }
 
+void
+panel_frame_draw (CtkWidget      *widget,
+		  cairo_t *cr,
+		  PanelFrameEdge  edges)
+{
+	PanelFrameCache  *cache;
+	CtkStateFlags     state;
+	gint64            start = 0;
+	int               width, height;
+	int               i;
+
+	if (edges == PANEL_EDGE_NONE)
+		return;
+
+	if (panel_stats_enabled ())
+		start = g_get_monotonic_time ();
+
+	state = ctk_widget_get_state_flags (widget);
+	width = ctk_widget_get_allocated_width (widget);
+	height = ctk_widget_get_allocated_height (widget);
+
+	cache = panel_frame_get_cache (widget);
+
+	if (cache->width != width || cache->height != height ||
+	    cache->edges != edges || cache->state != state) {
+		panel_frame_cache_clear (cache);
+
+		cache->width = width;
+		cache->height = height;
+		cache->edges = edges;
+		cache->state = state;
+
+		panel_frame_cache_render (widget, cr, cache);
+	}
+
+	for (i = 0; i < PANEL_FRAME_N_STRIPS; i++) {
+		if (!cache->strips [i])
+			continue;
+
+		cairo_set_source_surface (cr, cache->strips [i],
+					  cache->rects [i].x, cache->rects [i].y);
+		cdk_cairo_rectangle (cr, &cache->rects [i]);
+		cairo_fill (cr);
+	}
+
+	if (start) {
+		panel_stats_count (NULL, PANEL_STATS_FRAME_DRAWS);
+		panel_stats_add (NULL, PANEL_STATS_FRAME_DRAW_US,
+				 g_get_monotonic_time () - start);
+	}
+}
+
 static gboolean panel_frame_expose(CtkWidget* widget, cairo_t* cr)
 {
 	PanelFrame *frame = (PanelFrame *) widget;
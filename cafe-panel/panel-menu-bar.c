@@ -407,6 +407,13 @@ void panel_menu_bar_invoke_menu(PanelMenuBar* menubar, const char* callback_name
 	}
 }
 
+void panel_menu_bar_prewarm (PanelMenuBar *menubar)
+{
+	g_return_if_fail(PANEL_IS_MENU_BAR(menubar));
+
+	panel_menu_prewarm(menubar->priv->applications_menu);
+}
+
 void panel_menu_bar_popup_menu (PanelMenuBar *menubar,
 				guint32       activate_time G_GNUC_UNUSED)
 {
@@ -417,6 +424,8 @@ void panel_menu_bar_popup_menu (PanelMenuBar *menubar,
 
 	menu = CTK_MENU(menubar->priv->applications_menu);
 
+	panel_menu_probe_first_paint(CTK_WIDGET(menu));
+
 	/*
 	 * We need to call _ctk_menu_shell_activate() here as is done in
 	 * window_key_press_handler in ctkmenubar.c which pops up menu
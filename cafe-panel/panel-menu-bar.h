@@ -67,6 +67,7 @@ void       panel_menu_bar_load_from_gsettings  (PanelWidget  *panel,
 void       panel_menu_bar_invoke_menu      (PanelMenuBar *menubar,
 					    const char   *callback_name);
 
+void       panel_menu_bar_prewarm          (PanelMenuBar *menubar);
 void       panel_menu_bar_popup_menu       (PanelMenuBar *menubar,
 					    guint32       activate_time);
 
@@ -435,6 +435,15 @@ panel_menu_button_recreate_menu (PanelMenuButton *button)
 	button->priv->menu = NULL;
 }
 
+void
+panel_menu_button_prewarm (PanelMenuButton *button)
+{
+	g_return_if_fail (PANEL_IS_MENU_BUTTON (button));
+
+	if (panel_menu_button_create_menu (button))
+		panel_menu_prewarm (button->priv->menu);
+}
+
 void
 panel_menu_button_popup_menu (PanelMenuButton *button,
 			      guint            n_button G_GNUC_UNUSED,
@@ -446,6 +455,8 @@ panel_menu_button_popup_menu (PanelMenuButton *button,
 
 	panel_menu_button_create_menu (button);
 
+	panel_menu_probe_first_paint (button->priv->menu);
+
 	panel_toplevel_push_autohide_disabler (button->priv->toplevel);
 
 	button_widget_set_ignore_leave (BUTTON_WIDGET (button), TRUE);
@@ -85,6 +85,7 @@ void       panel_menu_button_load_from_gsettings     (PanelWidget      *panel,
 void       panel_menu_button_invoke_menu         (PanelMenuButton  *button,
 						  const char       *callback_name);
 
+void       panel_menu_button_prewarm             (PanelMenuButton  *button);
 void       panel_menu_button_popup_menu          (PanelMenuButton  *button,
 						  guint             n_button,
 						  guint32           activate_time);
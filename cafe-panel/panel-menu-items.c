@@ -28,8 +28,6 @@
  *   + drag and drop loses icon for URIs
  *   + drag and drop of bookmarks/network places/removable media should create
  *     a menu button
- *   + if a menu is open and gets updated, it should reappear and not just
- *     disappear
  */
 
 #include <config.h>
@@ -59,16 +57,31 @@
 
 #define MAX_BOOKMARK_ITEMS      100
 
+/* A run of items in the places menu that is updated in place: the items
+ * follow the anchor item, or live in a submenu when there are too many
+ * of them. */
+typedef struct {
+	CtkWidget   *anchor;
+	CtkWidget   *submenu_item;
+	GHashTable  *items;
+} PanelPlaceSection;
+
 struct _PanelPlaceMenuItemPrivate {
 	CtkWidget   *menu;
 	PanelWidget *panel;
 
+	PanelPlaceSection bookmarks_section;
+	PanelPlaceSection local_section;
+	PanelPlaceSection remote_section;
+
+	GSList       *bookmarks;
+	GCancellable *bookmarks_cancellable;
+	guint         gio_update_id;
+
 	GSettings   *baul_desktop_settings;
 	GSettings   *baul_prefs_settings;
 	GSettings   *menubar_settings;
 
-	CtkRecentManager *recent_manager;
-
 	GFileMonitor *bookmarks_monitor;
 
 	GVolumeMonitor *volume_monitor;
@@ -273,7 +286,7 @@ panel_menu_items_append_from_desktop (CtkWidget *menu,
 		g_free (path_freeme);
 }
 
-static void
+static CtkWidget *
 panel_menu_items_append_place_item (const char *icon_name,
 				    GIcon      *gicon,
 				    const char *title,
@@ -304,6 +317,8 @@ panel_menu_items_append_place_item (const char *icon_name,
 
 	if (g_str_has_prefix (uri, "file:")) /*Links only work for local files*/
 		setup_uri_drag (item, uri, icon_name, CDK_ACTION_LINK);
+
+	return item;
 }
 
 static CtkWidget *
@@ -344,15 +359,45 @@ panel_menu_items_create_action_item (PanelActionButtonType action_type)
 							 NULL, NULL);
 }
 
+typedef struct {
+	char  *full_uri;
+	char  *label;
+	char  *fallback_label;
+	char  *tooltip;
+	char  *icon;
+	/* only used while the bookmarks are read */
+	GFile *file;
+	GIcon *gicon;
+} PanelBookmark;
+
+static void
+panel_bookmark_free (PanelBookmark *bookmark)
+{
+	g_clear_object (&bookmark->file);
+	g_clear_object (&bookmark->gicon);
+	g_free (bookmark->full_uri);
+	g_free (bookmark->label);
+	g_free (bookmark->fallback_label);
+	g_free (bookmark->tooltip);
+	g_free (bookmark->icon);
+	g_slice_free (PanelBookmark, bookmark);
+}
+
 static void
-panel_place_menu_item_append_ctk_bookmarks (CtkWidget *menu, guint max_items_or_submenu)
+panel_bookmark_list_free (GSList *bookmarks)
 {
-	typedef struct {
-		char *full_uri;
-		char *label;
-	} PanelBookmark;
+	g_slist_free_full (bookmarks, (GDestroyNotify) panel_bookmark_free);
+}
 
-	CtkWidget   *add_menu;
+/* Runs in a worker thread: reads the bookmarks file and does the
+ * blocking file lookups, the icon queries included; the mount names
+ * and icons, and the icon theme, are left to the main thread. */
+static void
+panel_place_menu_item_read_bookmarks_thread (GTask        *task,
+					     gpointer      source_object G_GNUC_UNUSED,
+					     gpointer      task_data G_GNUC_UNUSED,
+					     GCancellable *cancellable)
+{
 	char        *filename;
 	GIOChannel  *io_channel;
 	GHashTable  *table;
@@ -367,8 +412,10 @@ panel_place_menu_item_append_ctk_bookmarks (CtkWidget *menu, guint max_items_or_
 	io_channel = g_io_channel_new_file (filename, "r", NULL);
 	g_free (filename);
 
-	if (!io_channel)
+	if (!io_channel) {
+		g_task_return_pointer (task, NULL, NULL);
 		return;
+	}
 
 	/* We use a hard limit to avoid having users shooting their
 	 * own feet, and to avoid crashing the system if a misbehaving
@@ -398,9 +445,6 @@ panel_place_menu_item_append_ctk_bookmarks (CtkWidget *menu, guint max_items_or_
 	g_io_channel_shutdown (io_channel, FALSE, NULL);
 	g_io_channel_unref (io_channel);
 
-	if (!lines)
-		return;
-
 	lines = g_slist_reverse (lines);
 
 	table = g_hash_table_new (g_str_hash, g_str_equal);
@@ -409,10 +453,14 @@ panel_place_menu_item_append_ctk_bookmarks (CtkWidget *menu, guint max_items_or_
 	for (l = lines; l; l = l->next) {
 		char *line = (char*) l->data;
 
+		if (g_cancellable_is_cancelled (cancellable))
+			break;
+
 		if (line[0] && !g_hash_table_lookup (table, line)) {
 			GFile    *file;
 			char     *space;
 			char     *label;
+			char     *display_name;
 			gboolean  keep;
 
 			g_hash_table_insert (table, line, line);
@@ -420,7 +468,11 @@ panel_place_menu_item_append_ctk_bookmarks (CtkWidget *menu, guint max_items_or_
 			space = strchr (line, ' ');
 			if (space) {
 				*space = '\0';
-				label = g_strdup (space + 1);
+				label = g_strdup (g_strstrip (space + 1));
+				if (!label [0]) {
+					g_free (label);
+					label = NULL;
+				}
 			} else {
 				label = NULL;
 			}
@@ -430,115 +482,138 @@ panel_place_menu_item_append_ctk_bookmarks (CtkWidget *menu, guint max_items_or_
 			if (g_str_has_prefix (line, "x-baul-search:"))
 				keep = TRUE;
 
-			if (!keep) {
-				file = g_file_new_for_uri (line);
+			file = g_file_new_for_uri (line);
+
+			if (!keep)
 				keep = !g_file_is_native (file) ||
 				       g_file_query_exists (file, NULL);
-				g_object_unref (file);
-			}
 
 			if (!keep) {
-				if (label)
-					g_free (label);
+				g_object_unref (file);
+				g_free (label);
 				continue;
 			}
 
-			bookmark = g_malloc (sizeof (PanelBookmark));
+			bookmark = g_slice_new0 (PanelBookmark);
 			bookmark->full_uri = g_strdup (line);
 			bookmark->label = label;
+
+			display_name = g_file_get_parse_name (file);
+			bookmark->file = file;
+			/* Translators: %s is a URI */
+			bookmark->tooltip = g_strdup_printf (_("Open '%s'"), display_name);
+			g_free (display_name);
+
+			/* mounts take precedence, they are looked up in the
+			 * main thread */
+			if (!label)
+				bookmark->fallback_label = panel_util_get_label_for_uri_no_mount (line);
+			bookmark->icon = panel_util_get_icon_for_uri_no_mount (line, &bookmark->gicon);
+
 			add_bookmarks = g_slist_prepend (add_bookmarks, bookmark);
 		}
 	}
 
 	g_hash_table_destroy (table);
-	g_slist_foreach (lines, (GFunc) g_free, NULL);
-	g_slist_free (lines);
+	g_slist_free_full (lines, g_free);
 
 	add_bookmarks = g_slist_reverse (add_bookmarks);
 
-	if (g_slist_length (add_bookmarks) <= max_items_or_submenu) {
-		add_menu = menu;
-	} else {
-		CtkWidget *item;
+	g_task_return_pointer (task, add_bookmarks,
+			       (GDestroyNotify) panel_bookmark_list_free);
+}
 
-		item = ctk_image_menu_item_new ();
-		setup_menuitem_with_icon (item, panel_menu_icon_get_size (),
-					  NULL, PANEL_ICON_BOOKMARKS,
-					  _("Bookmarks"));
+static void panel_place_menu_item_update_bookmarks (PanelPlaceMenuItem *place_item);
 
-		ctk_menu_shell_append (CTK_MENU_SHELL (menu), item);
-		ctk_widget_show (item);
+static void
+panel_place_menu_item_bookmarks_read (GObject      *source_object,
+				      GAsyncResult *result,
+				      gpointer      user_data G_GNUC_UNUSED)
+{
+	PanelPlaceMenuItem *place_item;
+	GSList             *bookmarks;
+	GSList             *l;
+	GList              *mounts, *ml;
+	GList              *roots = NULL;
+	GError             *error = NULL;
 
-		add_menu = create_empty_menu ();
-		ctk_menu_item_set_submenu (CTK_MENU_ITEM (item), add_menu);
+	place_item = PANEL_PLACE_MENU_ITEM (source_object);
+
+	bookmarks = g_task_propagate_pointer (G_TASK (result), &error);
+	if (error) {
+		/* a newer read of the bookmarks is on its way */
+		g_error_free (error);
+		return;
 	}
 
-	for (l = add_bookmarks; l; l = l->next) {
-		char *display_name;
-		char *tooltip;
-		char *label;
-		char *icon;
-		GFile *file;
-		GIcon *gicon;
+	g_clear_object (&place_item->priv->bookmarks_cancellable);
 
-		bookmark = l->data;
+	/* see panel_util_get_label_for_uri() and
+	 * panel_util_get_icon_for_uri(): mounts come first */
+	mounts = g_volume_monitor_get_mounts (place_item->priv->volume_monitor);
+	for (ml = mounts; ml; ml = ml->next)
+		roots = g_list_prepend (roots, g_mount_get_root (ml->data));
+	roots = g_list_reverse (roots);
 
-		file = g_file_new_for_uri (bookmark->full_uri);
-		display_name = g_file_get_parse_name (file);
-		g_object_unref (file);
-		/* Translators: %s is a URI */
-		tooltip = g_strdup_printf (_("Open '%s'"), display_name);
-		g_free (display_name);
-
-		label = NULL;
-		if (bookmark->label) {
-			label = g_strdup (g_strstrip (bookmark->label));
-			if (!label [0]) {
-				g_free (label);
-				label = NULL;
-			}
-		}
+	for (l = bookmarks; l; l = l->next) {
+		PanelBookmark *bookmark = l->data;
+		GList         *rl;
 
-		if (!label) {
-			label = panel_util_get_label_for_uri (bookmark->full_uri);
+		for (ml = mounts, rl = roots; ml; ml = ml->next, rl = rl->next) {
+			GIcon *gicon;
 
-			if (!label) {
-				g_free (tooltip);
-				g_free (bookmark->full_uri);
-				if (bookmark->label)
-					g_free (bookmark->label);
-				g_free (bookmark);
+			if (!g_file_equal (bookmark->file, rl->data))
 				continue;
+
+			if (!bookmark->label)
+				bookmark->label = g_mount_get_name (ml->data);
+
+			if (!bookmark->icon) {
+				gicon = g_mount_get_icon (ml->data);
+				bookmark->icon = panel_util_get_icon_name_from_g_icon (gicon);
+				g_object_unref (gicon);
 			}
+			break;
 		}
 
-		icon = panel_util_get_icon_for_uri (bookmark->full_uri);
+		if (!bookmark->icon && bookmark->gicon)
+			bookmark->icon = panel_util_get_icon_name_from_g_icon (bookmark->gicon);
 		/*FIXME: we should probably get a GIcon if possible, so that we
 		 * have customized icons for cd-rom, eg */
-		if (!icon)
-			icon = g_strdup (PANEL_ICON_FOLDER);
+		if (!bookmark->icon)
+			bookmark->icon = g_strdup (PANEL_ICON_FOLDER);
 
-		gicon = g_themed_icon_new_with_default_fallbacks (icon);
+		if (!bookmark->label)
+			bookmark->label = g_strdup (bookmark->fallback_label);
 
-		//FIXME: drag and drop will be broken for x-baul-search uris
-		panel_menu_items_append_place_item (icon, gicon,
-						    label,
-						    tooltip,
-						    add_menu,
-						    G_CALLBACK (activate_uri),
-						    bookmark->full_uri);
+		g_clear_object (&bookmark->file);
+		g_clear_object (&bookmark->gicon);
+	}
 
-		g_free (icon);
-		g_object_unref (gicon);
-		g_free (tooltip);
-		g_free (label);
-		g_free (bookmark->full_uri);
-		if (bookmark->label)
-			g_free (bookmark->label);
-		g_free (bookmark);
+	g_list_free_full (roots, g_object_unref);
+	g_list_free_full (mounts, g_object_unref);
+
+	panel_bookmark_list_free (place_item->priv->bookmarks);
+	place_item->priv->bookmarks = bookmarks;
+
+	panel_place_menu_item_update_bookmarks (place_item);
+}
+
+static void
+panel_place_menu_item_load_bookmarks (PanelPlaceMenuItem *place_item)
+{
+	GTask *task;
+
+	if (place_item->priv->bookmarks_cancellable) {
+		g_cancellable_cancel (place_item->priv->bookmarks_cancellable);
+		g_object_unref (place_item->priv->bookmarks_cancellable);
 	}
+	place_item->priv->bookmarks_cancellable = g_cancellable_new ();
 
-	g_slist_free (add_bookmarks);
+	task = g_task_new (place_item, place_item->priv->bookmarks_cancellable,
+			   panel_place_menu_item_bookmarks_read, NULL);
+	g_task_run_in_thread (task, panel_place_menu_item_read_bookmarks_thread);
+	g_object_unref (task);
 }
 
 static void
@@ -582,7 +657,7 @@ panel_menu_item_rescan_drive (CtkWidget *menuitem,
 				menuitem_to_screen (menuitem));
 }
 
-static void
+static CtkWidget *
 panel_menu_item_append_drive (CtkWidget *menu,
 			      GDrive    *drive)
 {
@@ -616,6 +691,8 @@ panel_menu_item_append_drive (CtkWidget *menu,
 
 	g_signal_connect (G_OBJECT (item), "button_press_event",
 			  G_CALLBACK (menu_dummy_button_press_event), NULL);
+
+	return item;
 }
 
 typedef struct {
@@ -682,7 +759,7 @@ panel_menu_item_mount_volume (CtkWidget *menuitem,
 			volume_mount_cb, mount_data);
 }
 
-static void
+static CtkWidget *
 panel_menu_item_append_volume (CtkWidget *menu,
 			       GVolume   *volume)
 {
@@ -716,16 +793,19 @@ panel_menu_item_append_volume (CtkWidget *menu,
 
 	g_signal_connect (G_OBJECT (item), "button_press_event",
 			  G_CALLBACK (menu_dummy_button_press_event), NULL);
+
+	return item;
 }
 
-static void
+static CtkWidget *
 panel_menu_item_append_mount (CtkWidget *menu,
 			      GMount    *mount)
 {
-	GFile  *root;
-	GIcon  *icon;
-	char   *display_name;
-	char   *activation_uri;
+	CtkWidget *item;
+	GFile     *root;
+	GIcon     *icon;
+	char      *display_name;
+	char      *activation_uri;
 
 	icon = g_mount_get_icon (mount);
 	display_name = g_mount_get_name (mount);
@@ -734,22 +814,25 @@ panel_menu_item_append_mount (CtkWidget *menu,
 	activation_uri = g_file_get_uri (root);
 	g_object_unref (root);
 
-	panel_menu_items_append_place_item (NULL, icon,
-					    display_name,
-					    display_name, //FIXME tooltip
-					    menu,
-					    G_CALLBACK (activate_uri),
-					    activation_uri);
+	item = panel_menu_items_append_place_item (NULL, icon,
+						   display_name,
+						   display_name, //FIXME tooltip
+						   menu,
+						   G_CALLBACK (activate_uri),
+						   activation_uri);
 
 	g_object_unref (icon);
 	g_free (display_name);
 	g_free (activation_uri);
+
+	return item;
 }
 
 typedef enum {
 	PANEL_GIO_DRIVE,
 	PANEL_GIO_VOLUME,
-	PANEL_GIO_MOUNT
+	PANEL_GIO_MOUNT,
+	PANEL_GIO_BOOKMARK
 } PanelGioItemType;
 
 typedef struct {
@@ -758,13 +841,297 @@ typedef struct {
 		GDrive *drive;
 		GVolume *volume;
 		GMount *mount;
+		PanelBookmark *bookmark;
 	} u;
 } PanelGioItem;
 
+static void
+panel_gio_item_free (PanelGioItem *item)
+{
+	switch (item->type) {
+	case PANEL_GIO_DRIVE:
+		g_object_unref (item->u.drive);
+		break;
+	case PANEL_GIO_VOLUME:
+		g_object_unref (item->u.volume);
+		break;
+	case PANEL_GIO_MOUNT:
+		g_object_unref (item->u.mount);
+		break;
+	case PANEL_GIO_BOOKMARK:
+		/* owned by the bookmarks list */
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+	g_slice_free (PanelGioItem, item);
+}
+
+static char *
+panel_gio_item_get_key_for_object (const char *type,
+				   gpointer    object,
+				   char       *name,
+				   GIcon      *icon)
+{
+	char *icon_string;
+	char *key;
+
+	icon_string = icon ? g_icon_to_string (icon) : NULL;
+	key = g_strdup_printf ("%s:%p:%s:%s", type, object,
+			       name ? name : "",
+			       icon_string ? icon_string : "");
+
+	g_free (icon_string);
+	g_free (name);
+	if (icon)
+		g_object_unref (icon);
+
+	return key;
+}
+
+/* The key identifies an item together with everything that is
+ * displayed for it: an item whose key changed gets a new menu item. */
+static char *
+panel_gio_item_get_key (PanelGioItem *item)
+{
+	switch (item->type) {
+	case PANEL_GIO_DRIVE:
+		return panel_gio_item_get_key_for_object ("drive", item->u.drive,
+							  g_drive_get_name (item->u.drive),
+							  g_drive_get_icon (item->u.drive));
+	case PANEL_GIO_VOLUME:
+		return panel_gio_item_get_key_for_object ("volume", item->u.volume,
+							  g_volume_get_name (item->u.volume),
+							  g_volume_get_icon (item->u.volume));
+	case PANEL_GIO_MOUNT:
+		return panel_gio_item_get_key_for_object ("mount", item->u.mount,
+							  g_mount_get_name (item->u.mount),
+							  g_mount_get_icon (item->u.mount));
+	case PANEL_GIO_BOOKMARK:
+		return g_strdup_printf ("bookmark:%s:%s:%s",
+					item->u.bookmark->full_uri,
+					item->u.bookmark->label,
+					item->u.bookmark->icon);
+	default:
+		g_assert_not_reached ();
+	}
+
+	return NULL;
+}
+
+static CtkWidget *
+panel_gio_item_append (PanelGioItem *item,
+		       CtkWidget    *menu)
+{
+	CtkWidget     *widget;
+	PanelBookmark *bookmark;
+	GIcon         *gicon;
+
+	switch (item->type) {
+	case PANEL_GIO_DRIVE:
+		return panel_menu_item_append_drive (menu, item->u.drive);
+	case PANEL_GIO_VOLUME:
+		return panel_menu_item_append_volume (menu, item->u.volume);
+	case PANEL_GIO_MOUNT:
+		return panel_menu_item_append_mount (menu, item->u.mount);
+	case PANEL_GIO_BOOKMARK:
+		bookmark = item->u.bookmark;
+		gicon = g_themed_icon_new_with_default_fallbacks (bookmark->icon);
+
+		//FIXME: drag and drop will be broken for x-baul-search uris
+		widget = panel_menu_items_append_place_item (bookmark->icon, gicon,
+							     bookmark->label,
+							     bookmark->tooltip,
+							     menu,
+							     G_CALLBACK (activate_uri),
+							     bookmark->full_uri);
+		g_object_unref (gicon);
+
+		return widget;
+	default:
+		g_assert_not_reached ();
+	}
+
+	return NULL;
+}
+
+static void
+panel_place_section_init (PanelPlaceSection *section)
+{
+	section->anchor = NULL;
+	section->submenu_item = NULL;
+	section->items = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, NULL);
+}
+
+/* Forgets about the menu items; used when the whole menu goes away. */
+static void
+panel_place_section_reset (PanelPlaceSection *section)
+{
+	section->anchor = NULL;
+	section->submenu_item = NULL;
+	g_hash_table_remove_all (section->items);
+}
+
+static void
+panel_place_section_destroy_item (gpointer key G_GNUC_UNUSED,
+				  gpointer value,
+				  gpointer user_data G_GNUC_UNUSED)
+{
+	ctk_widget_destroy (CTK_WIDGET (value));
+}
+
+static void
+panel_place_section_clear (PanelPlaceSection *section)
+{
+	g_hash_table_foreach (section->items,
+			      panel_place_section_destroy_item, NULL);
+	g_hash_table_remove_all (section->items);
+
+	if (section->submenu_item)
+		ctk_widget_destroy (section->submenu_item);
+	section->submenu_item = NULL;
+}
+
+static int
+panel_place_section_get_start (PanelPlaceSection *section,
+			       CtkWidget         *menu)
+{
+	GList *children;
+	int    position;
+
+	children = ctk_container_get_children (CTK_CONTAINER (menu));
+	position = g_list_index (children, section->anchor) + 1;
+	g_list_free (children);
+
+	return position;
+}
+
+/* Applies the difference between the items currently in the section
+ * and @items: unchanged entries keep their menu item and are only
+ * reordered, new or changed ones are created and the rest destroyed.
+ * Consumes @items. */
+static void
+panel_place_section_update (PanelPlaceMenuItem *place_item,
+			    PanelPlaceSection  *section,
+			    GSList             *items,
+			    const char         *submenu_icon,
+			    const char         *submenu_label)
+{
+	CtkWidget  *menu;
+	GHashTable *new_items;
+	GSList     *sl;
+	gboolean    use_submenu;
+	int         position;
+
+	menu = place_item->priv->menu;
+
+	if (!menu || !section->anchor) {
+		g_slist_free_full (items, (GDestroyNotify) panel_gio_item_free);
+		return;
+	}
+
+	use_submenu = g_slist_length (items) > g_settings_get_uint (place_item->priv->menubar_settings, PANEL_MENU_BAR_MAX_ITEMS_OR_SUBMENU);
+
+	if (use_submenu != (section->submenu_item != NULL))
+		panel_place_section_clear (section);
+
+	if (use_submenu && !section->submenu_item) {
+		CtkWidget *submenu;
+
+		section->submenu_item = ctk_image_menu_item_new ();
+		setup_menuitem_with_icon (section->submenu_item,
+					  panel_menu_icon_get_size (),
+					  NULL, submenu_icon, submenu_label);
+
+		ctk_menu_shell_insert (CTK_MENU_SHELL (menu),
+				       section->submenu_item,
+				       panel_place_section_get_start (section, menu));
+		ctk_widget_show (section->submenu_item);
+
+		submenu = create_empty_menu ();
+		ctk_menu_item_set_submenu (CTK_MENU_ITEM (section->submenu_item),
+					   submenu);
+	}
+
+	if (use_submenu) {
+		menu = ctk_menu_item_get_submenu (CTK_MENU_ITEM (section->submenu_item));
+		position = 0;
+	} else
+		position = panel_place_section_get_start (section, menu);
+
+	new_items = g_hash_table_new_full (g_str_hash, g_str_equal,
+					   g_free, NULL);
+
+	for (sl = items; sl; sl = sl->next) {
+		PanelGioItem *item = sl->data;
+		CtkWidget    *widget;
+		char         *key;
+
+		key = panel_gio_item_get_key (item);
+
+		if (g_hash_table_contains (new_items, key)) {
+			g_free (key);
+			continue;
+		}
+
+		widget = g_hash_table_lookup (section->items, key);
+		if (widget)
+			g_hash_table_remove (section->items, key);
+		else
+			widget = panel_gio_item_append (item, menu);
+
+		ctk_menu_reorder_child (CTK_MENU (menu), widget, position++);
+		g_hash_table_insert (new_items, key, widget);
+	}
+
+	/* what is left was removed or has changed */
+	g_hash_table_foreach (section->items,
+			      panel_place_section_destroy_item, NULL);
+	g_hash_table_destroy (section->items);
+	section->items = new_items;
+
+	g_slist_free_full (items, (GDestroyNotify) panel_gio_item_free);
+
+	if (place_item->priv->panel)
+		cafe_panel_applet_menu_set_recurse (CTK_MENU (place_item->priv->menu),
+						    "menu_panel",
+						    place_item->priv->panel);
+}
+
+static void
+panel_place_menu_item_update_bookmarks (PanelPlaceMenuItem *place_item)
+{
+	GSList       *items;
+	GSList       *l;
+	PanelGioItem *item;
+
+	items = NULL;
+
+	for (l = place_item->priv->bookmarks; l; l = l->next) {
+		PanelBookmark *bookmark = l->data;
+
+		if (!bookmark->label)
+			continue;
+
+		item = g_slice_new (PanelGioItem);
+		item->type = PANEL_GIO_BOOKMARK;
+		item->u.bookmark = bookmark;
+		items = g_slist_prepend (items, item);
+	}
+
+	items = g_slist_reverse (items);
+
+	panel_place_section_update (place_item,
+				    &place_item->priv->bookmarks_section,
+				    items,
+				    PANEL_ICON_BOOKMARKS,
+				    _("Bookmarks"));
+}
+
 /* this is loosely based on update_places() from baul-places-sidebar.c */
 static void
-panel_place_menu_item_append_local_gio (PanelPlaceMenuItem *place_item,
-					CtkWidget          *menu)
+panel_place_menu_item_update_local_gio (PanelPlaceMenuItem *place_item)
 {
 	GList   *l;
 	GList   *ll;
@@ -775,9 +1142,7 @@ panel_place_menu_item_append_local_gio (PanelPlaceMenuItem *place_item,
 	GList   *mounts;
 	GMount  *mount;
 	GSList       *items;
-	GSList       *sl;
 	PanelGioItem *item;
-	CtkWidget *add_menu;
 
 	items = NULL;
 
@@ -897,64 +1262,27 @@ panel_place_menu_item_append_local_gio (PanelPlaceMenuItem *place_item,
 	}
 	g_list_free (mounts);
 
-	/* now that we have everything, add the items inline or in a submenu */
 	items = g_slist_reverse (items);
 
-	if (g_slist_length (items) <= g_settings_get_uint (place_item->priv->menubar_settings, PANEL_MENU_BAR_MAX_ITEMS_OR_SUBMENU)) {
-		add_menu = menu;
-	} else {
-		CtkWidget  *item;
-
-		item = ctk_image_menu_item_new ();
-		setup_menuitem_with_icon (item, panel_menu_icon_get_size (),
-					  NULL,
-					  PANEL_ICON_REMOVABLE_MEDIA,
-					   _("Removable Media"));
-
-		ctk_menu_shell_append (CTK_MENU_SHELL (menu), item);
-		ctk_widget_show (item);
-
-		add_menu = create_empty_menu ();
-		ctk_menu_item_set_submenu (CTK_MENU_ITEM (item), add_menu);
-	}
-
-	for (sl = items; sl; sl = sl->next) {
-		item = sl->data;
-		switch (item->type) {
-		case PANEL_GIO_DRIVE:
-			panel_menu_item_append_drive (add_menu, item->u.drive);
-			g_object_unref (item->u.drive);
-			break;
-		case PANEL_GIO_VOLUME:
-			panel_menu_item_append_volume (add_menu, item->u.volume);
-			g_object_unref (item->u.volume);
-			break;
-		case PANEL_GIO_MOUNT:
-			panel_menu_item_append_mount (add_menu, item->u.mount);
-			g_object_unref (item->u.mount);
-			break;
-		default:
-			g_assert_not_reached ();
-		}
-		g_slice_free (PanelGioItem, item);
-	}
-
-	g_slist_free (items);
+	panel_place_section_update (place_item,
+				    &place_item->priv->local_section,
+				    items,
+				    PANEL_ICON_REMOVABLE_MEDIA,
+				    _("Removable Media"));
 }
 
 /* this is loosely based on update_places() from baul-places-sidebar.c */
 static void
-panel_place_menu_item_append_remote_gio (PanelPlaceMenuItem *place_item,
-					 CtkWidget          *menu)
+panel_place_menu_item_update_remote_gio (PanelPlaceMenuItem *place_item)
 {
-	CtkWidget *add_menu;
-	GList     *mounts, *l;
-	GMount    *mount;
-	GSList    *add_mounts, *sl;
+	GList        *mounts, *l;
+	GMount       *mount;
+	GSList       *items;
+	PanelGioItem *item;
 
 	/* add mounts that has no volume (/etc/mtab mounts, ftp, sftp,...) */
 	mounts = g_volume_monitor_get_mounts (place_item->priv->volume_monitor);
-	add_mounts = NULL;
+	items = NULL;
 
 	for (l = mounts; l; l = l->next) {
 		GVolume *volume;
@@ -982,40 +1310,22 @@ panel_place_menu_item_append_remote_gio (PanelPlaceMenuItem *place_item,
 		}
 		g_object_unref (root);
 
-
-		add_mounts = g_slist_prepend (add_mounts, mount);
-	}
-	add_mounts = g_slist_reverse (add_mounts);
-
-	if (g_slist_length (add_mounts) <= g_settings_get_uint (place_item->priv->menubar_settings, PANEL_MENU_BAR_MAX_ITEMS_OR_SUBMENU)) {
-		add_menu = menu;
-	} else {
-		CtkWidget  *item;
-
-		item = panel_image_menu_item_new ();
-		setup_menuitem_with_icon (item, panel_menu_icon_get_size (),
-					  NULL,
-					  PANEL_ICON_NETWORK_SERVER,
-					  _("Network Places"));
-
-		ctk_menu_shell_append (CTK_MENU_SHELL (menu), item);
-		ctk_widget_show (item);
-
-		add_menu = create_empty_menu ();
-		ctk_menu_item_set_submenu (CTK_MENU_ITEM (item), add_menu);
+		item = g_slice_new (PanelGioItem);
+		item->type = PANEL_GIO_MOUNT;
+		item->u.mount = mount;
+		items = g_slist_prepend (items, item);
 	}
+	g_list_free (mounts);
 
-	for (sl = add_mounts; sl; sl = sl->next) {
-		mount = sl->data;
-		panel_menu_item_append_mount (add_menu, mount);
-		g_object_unref (mount);
-	}
+	items = g_slist_reverse (items);
 
-	g_slist_free (add_mounts);
-	g_list_free (mounts);
+	panel_place_section_update (place_item,
+				    &place_item->priv->remote_section,
+				    items,
+				    PANEL_ICON_NETWORK_SERVER,
+				    _("Network Places"));
 }
 
-
 static CtkWidget *
 panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 {
@@ -1033,12 +1343,13 @@ panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 	name = panel_util_get_label_for_uri (uri);
 	g_object_unref (file);
 
-	panel_menu_items_append_place_item (PANEL_ICON_HOME, NULL,
-					    name,
-					    _("Open your personal folder"),
-					    places_menu,
-					    G_CALLBACK (activate_home_uri),
-					    uri);
+	item = panel_menu_items_append_place_item (PANEL_ICON_HOME, NULL,
+						   name,
+						   _("Open your personal folder"),
+						   places_menu,
+						   G_CALLBACK (activate_home_uri),
+						   uri);
+	place_item->priv->bookmarks_section.anchor = item;
 	g_free (name);
 	g_free (uri);
 
@@ -1049,7 +1360,7 @@ panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 		uri = g_file_get_uri (file);
 		g_object_unref (file);
 
-		panel_menu_items_append_place_item (
+		item = panel_menu_items_append_place_item (
 				PANEL_ICON_DESKTOP, NULL,
 				/* Translators: Desktop is used here as in
 				 * "Desktop Folder" (this is not the Desktop
@@ -1060,10 +1371,10 @@ panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 				G_CALLBACK (activate_desktop_uri),
 				/* FIXME: if the dir changes, we'd need to update the drag data since the uri is not the same */
 				uri);
+		place_item->priv->bookmarks_section.anchor = item;
 		g_free (uri);
 	}
 
-	panel_place_menu_item_append_ctk_bookmarks (places_menu, g_settings_get_uint (place_item->priv->menubar_settings, PANEL_MENU_BAR_MAX_ITEMS_OR_SUBMENU));
 	add_menu_separator (places_menu);
 
 	if (place_item->priv->baul_desktop_settings != NULL)
@@ -1075,7 +1386,7 @@ panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 		gsettings_name = g_strdup (_("Computer"));
 	}
 
-	panel_menu_items_append_place_item (
+	item = panel_menu_items_append_place_item (
 			PANEL_ICON_COMPUTER, NULL,
 			gsettings_name,
 			_("Browse all local and remote disks and folders accessible from this computer"),
@@ -1083,20 +1394,21 @@ panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 			G_CALLBACK (activate_uri),
 			"computer://");
 
+	place_item->priv->local_section.anchor = item;
+
 	if (gsettings_name)
 		g_free (gsettings_name);
 
-	panel_place_menu_item_append_local_gio (place_item, places_menu);
 	add_menu_separator (places_menu);
 
-	panel_menu_items_append_place_item (
+	item = panel_menu_items_append_place_item (
 			PANEL_ICON_NETWORK, NULL,
 			_("Network"),
 			_("Browse bookmarked and local network locations"),
 			places_menu,
 			G_CALLBACK (activate_uri),
 			"network://");
-	panel_place_menu_item_append_remote_gio (place_item, places_menu);
+	place_item->priv->remote_section.anchor = item;
 
 	if (panel_is_program_in_path ("baul-connect-server") ||
 	    panel_is_program_in_path ("nautilus-connect-server") ||
@@ -1120,14 +1432,19 @@ panel_place_menu_item_create_menu (PanelPlaceMenuItem *place_item)
 						      NULL,
 						      FALSE);
 
-	panel_recent_append_documents_menu (places_menu,
-					    place_item->priv->recent_manager);
+	panel_recent_append_documents_menu (places_menu);
 /* Fix any failures of compiz/other wm's to communicate with ctk for transparency */
 	CtkWidget *toplevel = ctk_widget_get_toplevel (places_menu);
 	CdkScreen *screen = ctk_widget_get_screen(CTK_WIDGET(toplevel));
 	CdkVisual *visual = cdk_screen_get_rgba_visual(screen);
 	ctk_widget_set_visual(CTK_WIDGET(toplevel), visual);
 
+	/* the sections are filled in place, now that their anchors exist */
+	place_item->priv->menu = places_menu;
+	panel_place_menu_item_update_bookmarks (place_item);
+	panel_place_menu_item_update_local_gio (place_item);
+	panel_place_menu_item_update_remote_gio (place_item);
+
 	return places_menu;
 }
 
@@ -1143,6 +1460,12 @@ panel_place_menu_item_recreate_menu (CtkWidget *widget)
 
 	if (place_item->priv->menu) {
 		ctk_widget_destroy (place_item->priv->menu);
+		place_item->priv->menu = NULL;
+
+		panel_place_section_reset (&place_item->priv->bookmarks_section);
+		panel_place_section_reset (&place_item->priv->local_section);
+		panel_place_section_reset (&place_item->priv->remote_section);
+
 		place_item->priv->menu = panel_place_menu_item_create_menu (place_item);
 		ctk_menu_item_set_submenu (CTK_MENU_ITEM (place_item),
 					   place_item->priv->menu);
@@ -1167,7 +1490,32 @@ panel_place_menu_item_ctk_bookmarks_changed (GFileMonitor *handle G_GNUC_UNUSED,
 					     GFileMonitorEvent event G_GNUC_UNUSED,
 					     gpointer      user_data)
 {
-	panel_place_menu_item_recreate_menu (CTK_WIDGET (user_data));
+	panel_place_menu_item_load_bookmarks (PANEL_PLACE_MENU_ITEM (user_data));
+}
+
+static gboolean
+panel_place_menu_item_update_gio_idle (gpointer user_data)
+{
+	PanelPlaceMenuItem *place_item = user_data;
+
+	place_item->priv->gio_update_id = 0;
+
+	panel_place_menu_item_update_local_gio (place_item);
+	panel_place_menu_item_update_remote_gio (place_item);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Volume monitor signals come in bursts (a drive, its volumes and their
+ * mounts), so they are all handled in one go. */
+static void
+panel_place_menu_item_queue_gio_update (PanelPlaceMenuItem *place_item)
+{
+	if (place_item->priv->gio_update_id)
+		return;
+
+	place_item->priv->gio_update_id =
+		g_idle_add (panel_place_menu_item_update_gio_idle, place_item);
 }
 
 static void
@@ -1175,7 +1523,7 @@ panel_place_menu_item_drives_changed (GVolumeMonitor *monitor G_GNUC_UNUSED,
 				      GDrive         *drive G_GNUC_UNUSED,
 				      CtkWidget      *place_menu)
 {
-	panel_place_menu_item_recreate_menu (place_menu);
+	panel_place_menu_item_queue_gio_update (PANEL_PLACE_MENU_ITEM (place_menu));
 }
 
 static void
@@ -1183,7 +1531,7 @@ panel_place_menu_item_volumes_changed (GVolumeMonitor *monitor G_GNUC_UNUSED,
 				       GVolume        *volume G_GNUC_UNUSED,
 				       CtkWidget      *place_menu)
 {
-	panel_place_menu_item_recreate_menu (place_menu);
+	panel_place_menu_item_queue_gio_update (PANEL_PLACE_MENU_ITEM (place_menu));
 }
 
 static void
@@ -1191,7 +1539,7 @@ panel_place_menu_item_mounts_changed (GVolumeMonitor *monitor G_GNUC_UNUSED,
 				      GMount         *mount G_GNUC_UNUSED,
 				      CtkWidget      *place_menu)
 {
-	panel_place_menu_item_recreate_menu (place_menu);
+	panel_place_menu_item_queue_gio_update (PANEL_PLACE_MENU_ITEM (place_menu));
 }
 
 static void
@@ -1328,6 +1676,19 @@ panel_place_menu_item_finalize (GObject *object)
 		g_object_unref (menuitem->priv->volume_monitor);
 	menuitem->priv->volume_monitor = NULL;
 
+	if (menuitem->priv->gio_update_id)
+		g_source_remove (menuitem->priv->gio_update_id);
+	menuitem->priv->gio_update_id = 0;
+
+	g_clear_object (&menuitem->priv->bookmarks_cancellable);
+
+	panel_bookmark_list_free (menuitem->priv->bookmarks);
+	menuitem->priv->bookmarks = NULL;
+
+	g_hash_table_destroy (menuitem->priv->bookmarks_section.items);
+	g_hash_table_destroy (menuitem->priv->local_section.items);
+	g_hash_table_destroy (menuitem->priv->remote_section.items);
+
 	G_OBJECT_CLASS (panel_place_menu_item_parent_class)->finalize (object);
 }
 
@@ -1351,6 +1712,10 @@ panel_place_menu_item_init (PanelPlaceMenuItem *menuitem)
 
 	menuitem->priv = panel_place_menu_item_get_instance_private (menuitem);
 
+	panel_place_section_init (&menuitem->priv->bookmarks_section);
+	panel_place_section_init (&menuitem->priv->local_section);
+	panel_place_section_init (&menuitem->priv->remote_section);
+
 	if (cafe_gsettings_schema_exists (BAUL_DESKTOP_SCHEMA)) {
 		menuitem->priv->baul_desktop_settings = g_settings_new (BAUL_DESKTOP_SCHEMA);
 		g_signal_connect (menuitem->priv->baul_desktop_settings,
@@ -1381,8 +1746,6 @@ panel_place_menu_item_init (PanelPlaceMenuItem *menuitem)
 			G_CALLBACK (panel_place_menu_item_key_changed),
 			G_OBJECT (menuitem));
 
-	menuitem->priv->recent_manager = ctk_recent_manager_get_default ();
-
 	bookmarks_filename = g_build_filename (g_get_user_config_dir (),
 					       "ctk-3.0", "bookmarks", NULL);
 	bookmark = g_file_new_for_path (bookmarks_filename);
@@ -1446,6 +1809,9 @@ panel_place_menu_item_init (PanelPlaceMenuItem *menuitem)
 							     G_CALLBACK (panel_place_menu_item_mounts_changed),
 							     menuitem);
 
+	/* read off the main thread; the bookmarks show up in the menu
+	 * once they are ready */
+	panel_place_menu_item_load_bookmarks (menuitem);
 }
 
 static void
@@ -34,6 +34,7 @@
 
 #include "panel-multimonitor.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 // The number of logical monitors we are keeping track of
@@ -49,6 +50,24 @@ static gboolean       initialized = FALSE;
 static gboolean       have_randr  = FALSE;
 static guint          reinit_id   = 0;
 
+// The size of the X screen, which the bottom and right struts are
+// relative to
+static int            screen_width  = 0;
+static int            screen_height = 0;
+
+// Spatial index over the geometries: the distinct x and y edges of the
+// monitors cut the screen into cells, each cell knowing the monitor
+// covering it (or -1), so a point is looked up with two binary searches
+static int           *index_xs    = NULL;
+static int            n_index_xs  = 0;
+static int           *index_ys    = NULL;
+static int            n_index_ys  = 0;
+static int           *index_cells = NULL;
+
+// Hotplugging a dock delivers a burst of screen and monitor events;
+// wait for them to settle before taking a new snapshot
+#define PANEL_MULTIMONITOR_SETTLE_DELAY 250 /* ms */
+
 #ifdef HAVE_X11
 #ifdef HAVE_RANDR
 static gboolean
@@ -362,22 +381,30 @@ panel_multimonitor_compress_overlapping_monitors (int           *num_monitors_in
 }
 
 static gboolean
-panel_multimonitor_reinit_idle (gpointer data G_GNUC_UNUSED)
+panel_multimonitor_reinit_timeout (gpointer data G_GNUC_UNUSED)
 {
-	panel_multimonitor_reinit ();
 	reinit_id = 0;
+	panel_multimonitor_reinit ();
 
 	return FALSE;
 }
 
 static void
-panel_multimonitor_handle_screen_changed (CdkScreen *screen G_GNUC_UNUSED,
-					  gpointer   user_data G_GNUC_UNUSED)
+panel_multimonitor_queue_reinit (void)
 {
 	if (reinit_id)
-		return;
+		g_source_remove (reinit_id);
 
-	reinit_id = g_idle_add (panel_multimonitor_reinit_idle, NULL);
+	reinit_id = g_timeout_add (PANEL_MULTIMONITOR_SETTLE_DELAY,
+				   panel_multimonitor_reinit_timeout, NULL);
+	g_source_set_name_by_id (reinit_id, "[cafe-panel] panel_multimonitor_reinit_timeout");
+}
+
+static void
+panel_multimonitor_handle_screen_changed (CdkScreen *screen G_GNUC_UNUSED,
+					  gpointer   user_data G_GNUC_UNUSED)
+{
+	panel_multimonitor_queue_reinit ();
 }
 
 static void
@@ -385,20 +412,115 @@ panel_multimonitor_handle_monitor_changed (CdkDisplay *display G_GNUC_UNUSED,
 					   CdkMonitor *monitor G_GNUC_UNUSED,
 					   gpointer    user_data G_GNUC_UNUSED)
 {
-	if (reinit_id)
-		return;
-
-	reinit_id = g_idle_add (panel_multimonitor_reinit_idle, NULL);
+	panel_multimonitor_queue_reinit ();
 }
 
 static void
 panel_multimonitor_handle_monitor_invalidate (CdkMonitor *monitor G_GNUC_UNUSED,
 					      gpointer    user_data G_GNUC_UNUSED)
 {
-	if (reinit_id)
-		return;
+	panel_multimonitor_queue_reinit ();
+}
+
+static int
+compare_ints (gconstpointer a,
+	      gconstpointer b)
+{
+	int ia = *(const int *) a;
+	int ib = *(const int *) b;
 
-	reinit_id = g_idle_add (panel_multimonitor_reinit_idle, NULL);
+	return (ia > ib) - (ia < ib);
+}
+
+static int *
+collect_edges (gboolean  vertical,
+	       int      *n_edges_ret)
+{
+	int *edges;
+	int  n_edges;
+	int  i, j;
+
+	edges = g_new (int, 2 * MAX (monitor_count, 1));
+
+	for (i = 0; i < monitor_count; i++) {
+		if (vertical) {
+			edges [2 * i]     = geometries [i].y;
+			edges [2 * i + 1] = geometries [i].y + geometries [i].height;
+		} else {
+			edges [2 * i]     = geometries [i].x;
+			edges [2 * i + 1] = geometries [i].x + geometries [i].width;
+		}
+	}
+
+	qsort (edges, 2 * monitor_count, sizeof (int), compare_ints);
+
+	n_edges = 0;
+	for (j = 0; j < 2 * monitor_count; j++)
+		if (n_edges == 0 || edges [n_edges - 1] != edges [j])
+			edges [n_edges++] = edges [j];
+
+	*n_edges_ret = n_edges;
+
+	return edges;
+}
+
+/* returns the cell c such that edges[c] <= p < edges[c + 1], or -1 */
+static int
+find_cell (const int *edges,
+	   int        n_edges,
+	   int        p)
+{
+	int lo, hi;
+
+	if (n_edges < 2 || p < edges [0] || p >= edges [n_edges - 1])
+		return -1;
+
+	lo = 0;
+	hi = n_edges - 1;
+	while (hi - lo > 1) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (edges [mid] <= p)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void
+panel_multimonitor_build_index (void)
+{
+	int n_cells;
+	int i;
+
+	g_free (index_xs);
+	g_free (index_ys);
+	g_free (index_cells);
+
+	index_xs = collect_edges (FALSE, &n_index_xs);
+	index_ys = collect_edges (TRUE, &n_index_ys);
+
+	n_cells = MAX (n_index_xs - 1, 0) * MAX (n_index_ys - 1, 0);
+	index_cells = g_new (int, MAX (n_cells, 1));
+	for (i = 0; i < n_cells; i++)
+		index_cells [i] = -1;
+
+	/* backwards, so that the first monitor containing a point wins */
+	for (i = monitor_count - 1; i >= 0; i--) {
+		int x0, y0, cx, cy;
+
+		if (geometries [i].width <= 0 || geometries [i].height <= 0)
+			continue;
+
+		x0 = find_cell (index_xs, n_index_xs, geometries [i].x);
+		y0 = find_cell (index_ys, n_index_ys, geometries [i].y);
+
+		for (cy = y0; cy < n_index_ys - 1 && index_ys [cy] < geometries [i].y + geometries [i].height; cy++)
+			for (cx = x0; cx < n_index_xs - 1 && index_xs [cx] < geometries [i].x + geometries [i].width; cx++)
+				index_cells [cy * (n_index_xs - 1) + cx] = i;
+	}
 }
 
 #ifdef HAVE_X11
@@ -483,27 +605,92 @@ panel_multimonitor_init (void)
 
 	panel_multimonitor_get_raw_monitors (&monitor_count, &geometries);
 	panel_multimonitor_compress_overlapping_monitors (&monitor_count, &geometries);
+	panel_multimonitor_build_index ();
+
+	screen_width = screen_height = 0;
+#ifdef HAVE_X11
+	if (CDK_IS_X11_DISPLAY (display)) {
+		screen_width  = WidthOfScreen (cdk_x11_screen_get_xscreen (screen));
+		screen_height = HeightOfScreen (cdk_x11_screen_get_xscreen (screen));
+	}
+#endif // HAVE_X11
 
 	initialized = TRUE;
 }
 
+static guint
+get_visible_extremes (const CdkRectangle *geoms,
+		      int                 n_geoms,
+		      int                 n_monitor);
+
+/* whether what a toplevel on n_monitor sees of the layout is different */
+static gboolean
+panel_multimonitor_monitor_changed (int                 n_monitor,
+				    const CdkRectangle *old_geometries,
+				    int                 old_count)
+{
+	if (n_monitor >= old_count || n_monitor >= monitor_count)
+		return TRUE;
+
+	if (!cdk_rectangle_equal (&old_geometries [n_monitor], &geometries [n_monitor]))
+		return TRUE;
+
+	/* the struts depend on which edges of the screen the monitor is on */
+	return get_visible_extremes (old_geometries, old_count, n_monitor) !=
+	       get_visible_extremes (geometries, monitor_count, n_monitor);
+}
+
 void
 panel_multimonitor_reinit (void)
 {
-	GList      *toplevels, *l;
+	GList        *toplevels, *l;
+	CdkRectangle *old_geometries;
+	int           old_count;
+	int           old_width, old_height;
+	gboolean      resized;
+
+	if (reinit_id) {
+		g_source_remove (reinit_id);
+		reinit_id = 0;
+	}
 
-	if (geometries)
-		g_free (geometries);
+	old_geometries = geometries;
+	old_count = monitor_count;
+	old_width = screen_width;
+	old_height = screen_height;
+	geometries = NULL;
 
 	initialized = FALSE;
 	panel_multimonitor_init ();
 
+	resized = old_width != screen_width || old_height != screen_height;
+
+	if (!resized &&
+	    old_count == monitor_count &&
+	    (monitor_count == 0 ||
+	     memcmp (old_geometries, geometries, monitor_count * sizeof (CdkRectangle)) == 0)) {
+		g_free (old_geometries);
+		return;
+	}
+
 	toplevels = ctk_window_list_toplevels ();
 
-	for (l = toplevels; l; l = l->next)
-		ctk_widget_queue_resize (l->data);
+	/* panels only need to relayout if their own monitor changed, or
+	 * if the screen size that their struts are relative to did */
+	for (l = toplevels; l; l = l->next) {
+		int monitor = -1;
+
+		if (g_object_class_find_property (G_OBJECT_GET_CLASS (l->data), "monitor"))
+			g_object_get (l->data, "monitor", &monitor, NULL);
+
+		if (monitor < 0 || resized ||
+		    panel_multimonitor_monitor_changed (monitor, old_geometries, old_count))
+			ctk_widget_queue_resize (l->data);
+	}
 
 	g_list_free (toplevels);
+
+	g_free (old_geometries);
 }
 
 int
@@ -573,9 +760,16 @@ int
 panel_multimonitor_get_monitor_at_point (int x, int y)
 {
 	int i;
+	int cx, cy;
 	int min_dist_squared;
 	int closest_monitor;
 
+	cx = find_cell (index_xs, n_index_xs, x);
+	cy = find_cell (index_ys, n_index_ys, y);
+	if (cx >= 0 && cy >= 0 && index_cells [cy * (n_index_xs - 1) + cx] >= 0)
+		return index_cells [cy * (n_index_xs - 1) + cx];
+
+	/* the point is outside all monitors, find the closest one */
 	min_dist_squared = G_MAXINT32;
 	closest_monitor = 0;
 
@@ -586,9 +780,6 @@ panel_multimonitor_get_monitor_at_point (int x, int y)
 		dist_x = axis_distance (x, geometries[i].x, geometries[i].width);
 		dist_y = axis_distance (y, geometries[i].y, geometries[i].height);
 
-		if (dist_x == 0 && dist_y == 0)
-			return i;
-
 		dist_squared = dist_x * dist_x + dist_y * dist_y;
 
 		if (dist_squared < min_dist_squared) {
@@ -608,67 +799,93 @@ typedef struct {
 } MonitorBounds;
 
 static inline void
-get_monitor_bounds (int            n_monitor,
-		    MonitorBounds *bounds)
+get_monitor_bounds (const CdkRectangle *geometry,
+		    MonitorBounds      *bounds)
 {
-	g_return_if_fail (n_monitor >= 0 || n_monitor < monitor_count);
 	g_return_if_fail (bounds != NULL);
 
-	bounds->x0 = geometries [n_monitor].x;
-	bounds->y0 = geometries [n_monitor].y;
-	bounds->x1 = bounds->x0 + geometries [n_monitor].width;
-	bounds->y1 = bounds->y0 + geometries [n_monitor].height;
+	bounds->x0 = geometry->x;
+	bounds->y0 = geometry->y;
+	bounds->x1 = bounds->x0 + geometry->width;
+	bounds->y1 = bounds->y0 + geometry->height;
 }
 
-/* determines whether a given monitor is along the visible
- * edge of the logical screen.
- */
-void
-panel_multimonitor_is_at_visible_extreme (int        n_monitor,
-					  gboolean  *leftmost,
-					  gboolean  *rightmost,
-					  gboolean  *topmost,
-					  gboolean  *bottommost)
+enum {
+	EXTREME_LEFT   = 1 << 0,
+	EXTREME_RIGHT  = 1 << 1,
+	EXTREME_TOP    = 1 << 2,
+	EXTREME_BOTTOM = 1 << 3
+};
+
+static guint
+get_visible_extremes (const CdkRectangle *geoms,
+		      int                 n_geoms,
+		      int                 n_monitor)
 {
 	MonitorBounds monitor;
+	guint         extremes;
 	int           i;
 
-	*leftmost   = TRUE;
-	*rightmost  = TRUE;
-	*topmost    = TRUE;
-	*bottommost = TRUE;
+	extremes = EXTREME_LEFT | EXTREME_RIGHT | EXTREME_TOP | EXTREME_BOTTOM;
 
-	g_return_if_fail (n_monitor >= 0 && n_monitor < monitor_count);
-
-	get_monitor_bounds (n_monitor, &monitor);
+	get_monitor_bounds (&geoms [n_monitor], &monitor);
 
 	/* go through each monitor and try to find one either right,
 	 * below, above, or left of the specified monitor
 	 */
 
-	for (i = 0; i < monitor_count; i++) {
+	for (i = 0; i < n_geoms; i++) {
 		MonitorBounds iter;
 
 		if (i == n_monitor) continue;
 
-		get_monitor_bounds (i, &iter);
+		get_monitor_bounds (&geoms [i], &iter);
 
 		if ((iter.y0 >= monitor.y0 && iter.y0 <  monitor.y1) ||
 		    (iter.y1 >  monitor.y0 && iter.y1 <= monitor.y1)) {
 			if (iter.x0 < monitor.x0)
-				*leftmost = FALSE;
+				extremes &= ~EXTREME_LEFT;
 			if (iter.x1 > monitor.x1)
-				*rightmost = FALSE;
+				extremes &= ~EXTREME_RIGHT;
 		}
 
 		if ((iter.x0 >= monitor.x0 && iter.x0 <  monitor.x1) ||
 		    (iter.x1 >  monitor.x0 && iter.x1 <= monitor.x1)) {
 			if (iter.y0 < monitor.y0)
-				*topmost = FALSE;
+				extremes &= ~EXTREME_TOP;
 			if (iter.y1 > monitor.y1)
-				*bottommost = FALSE;
+				extremes &= ~EXTREME_BOTTOM;
 		}
 	}
+
+	return extremes;
+}
+
+/* determines whether a given monitor is along the visible
+ * edge of the logical screen.
+ */
+void
+panel_multimonitor_is_at_visible_extreme (int        n_monitor,
+					  gboolean  *leftmost,
+					  gboolean  *rightmost,
+					  gboolean  *topmost,
+					  gboolean  *bottommost)
+{
+	guint extremes;
+
+	*leftmost   = TRUE;
+	*rightmost  = TRUE;
+	*topmost    = TRUE;
+	*bottommost = TRUE;
+
+	g_return_if_fail (n_monitor >= 0 && n_monitor < monitor_count);
+
+	extremes = get_visible_extremes (geometries, monitor_count, n_monitor);
+
+	*leftmost   = (extremes & EXTREME_LEFT) != 0;
+	*rightmost  = (extremes & EXTREME_RIGHT) != 0;
+	*topmost    = (extremes & EXTREME_TOP) != 0;
+	*bottommost = (extremes & EXTREME_BOTTOM) != 0;
 }
 
 void
@@ -30,6 +30,7 @@
 #include <gio/gio.h>
 
 #include <libpanel-util/panel-error.h>
+#include <libpanel-util/panel-glib.h>
 #include <libpanel-util/panel-show.h>
 #include <libpanel-util/panel-ctk.h>
 
@@ -40,6 +41,41 @@
 #include "panel-stock-icons.h"
 #include "panel-icon-names.h"
 
+/* Only the most recent items are kept, the rest of the file is just
+ * counted while it is parsed. */
+#define PANEL_RECENT_MAX_ITEMS     20
+#define PANEL_RECENT_RELOAD_DELAY  500  /* ms */
+#define PANEL_RECENT_READ_SIZE     65536
+
+typedef struct {
+	char   *uri;
+	char   *title;
+	char   *mime_type;
+	char   *modified;
+	guint   is_private : 1;
+} PanelRecentItem;
+
+typedef struct {
+	GPtrArray       *items;
+	int              n_items;
+	PanelRecentItem *current;
+	GString         *text;
+	guint            in_title : 1;
+} PanelRecentParser;
+
+typedef struct {
+	GPtrArray *items;
+	int        n_items;
+} PanelRecentResult;
+
+static GFileMonitor *recent_monitor = NULL;
+static GCancellable *recent_cancellable = NULL;
+static guint         recent_reload_id = 0;
+static GPtrArray    *recent_items = NULL;
+static int           recent_n_items = 0;
+static guint         recent_generation = 0;
+static GSList       *recent_menus = NULL;
+
 static gboolean
 show_uri (const char *uri, const char *mime_type, CdkScreen *screen,
 	  GError **error)
@@ -51,27 +87,24 @@ show_uri (const char *uri, const char *mime_type, CdkScreen *screen,
 
 
 static void
-recent_documents_activate_cb (CtkRecentChooser *chooser,
-			      gpointer          data G_GNUC_UNUSED)
+recent_documents_activate_cb (CtkWidget *menuitem,
+			      gpointer   data G_GNUC_UNUSED)
 {
-	CtkRecentInfo *recent_info;
 	const char    *uri;
 	const char    *mime_type;
 	CdkScreen     *screen;
 	GError        *error = NULL;
 
-	screen = ctk_widget_get_screen (CTK_WIDGET (chooser));
+	screen = ctk_widget_get_screen (menuitem);
 
-	recent_info = ctk_recent_chooser_get_current_item (chooser);
-	uri = ctk_recent_info_get_uri (recent_info);
-	mime_type = ctk_recent_info_get_mime_type (recent_info);
-	//FIXME ctk_recent_info_get_application_info() could be useful
+	uri = g_object_get_data (G_OBJECT (menuitem), "panel-recent-uri");
+	mime_type = g_object_get_data (G_OBJECT (menuitem), "panel-recent-mime-type");
 
 	if (show_uri (uri, mime_type, screen, &error) != TRUE) {
 		char *uri_utf8;
 
 		uri_utf8 = g_filename_to_utf8 (uri, -1, NULL, NULL, NULL);
-		//FIXME this could fail... Maybe we want ctk_recent_info_get_display_name()
+		//FIXME this could fail... Maybe we want the display name
 
 		if (error) {
 			char *primary;
@@ -98,38 +131,437 @@ recent_documents_activate_cb (CtkRecentChooser *chooser,
 
 		g_free (uri_utf8);
 	}
+}
+
+static void
+panel_recent_item_free (PanelRecentItem *item)
+{
+	g_free (item->uri);
+	g_free (item->title);
+	g_free (item->mime_type);
+	g_free (item->modified);
+	g_slice_free (PanelRecentItem, item);
+}
+
+/* The timestamps are ISO 8601 in UTC, so they sort as strings. */
+static int
+panel_recent_item_compare_time (PanelRecentItem *a,
+				PanelRecentItem *b)
+{
+	return g_strcmp0 (a->modified, b->modified);
+}
+
+/* Keeps the items sorted, most recently modified first. */
+static void
+panel_recent_parser_add_item (PanelRecentParser *parser,
+			      PanelRecentItem   *item)
+{
+	GPtrArray *items = parser->items;
+	guint      i;
+
+	parser->n_items++;
+
+	if (items->len == PANEL_RECENT_MAX_ITEMS &&
+	    panel_recent_item_compare_time (g_ptr_array_index (items, items->len - 1), item) >= 0) {
+		panel_recent_item_free (item);
+		return;
+	}
+
+	for (i = 0; i < items->len; i++)
+		if (panel_recent_item_compare_time (g_ptr_array_index (items, i), item) < 0)
+			break;
+
+	g_ptr_array_insert (items, i, item);
+
+	if (items->len > PANEL_RECENT_MAX_ITEMS)
+		g_ptr_array_remove_index (items, items->len - 1);
+}
+
+static void
+panel_recent_parser_start_element (GMarkupParseContext  *context G_GNUC_UNUSED,
+				   const char           *element_name,
+				   const char          **attribute_names,
+				   const char          **attribute_values,
+				   gpointer              user_data,
+				   GError              **error G_GNUC_UNUSED)
+{
+	PanelRecentParser *parser = user_data;
+	int                i;
+
+	if (strcmp (element_name, "bookmark") == 0) {
+		if (parser->current)
+			panel_recent_item_free (parser->current);
+		parser->current = g_slice_new0 (PanelRecentItem);
+
+		for (i = 0; attribute_names[i]; i++) {
+			if (strcmp (attribute_names[i], "href") == 0)
+				parser->current->uri = g_strdup (attribute_values[i]);
+			else if (strcmp (attribute_names[i], "modified") == 0)
+				parser->current->modified = g_strdup (attribute_values[i]);
+		}
+	} else if (!parser->current) {
+		return;
+	} else if (strcmp (element_name, "title") == 0) {
+		parser->in_title = TRUE;
+		g_string_truncate (parser->text, 0);
+	} else if (strcmp (element_name, "mime:mime-type") == 0) {
+		for (i = 0; attribute_names[i]; i++)
+			if (strcmp (attribute_names[i], "type") == 0) {
+				g_free (parser->current->mime_type);
+				parser->current->mime_type = g_strdup (attribute_values[i]);
+			}
+	} else if (strcmp (element_name, "bookmark:private") == 0) {
+		parser->current->is_private = TRUE;
+	}
+}
+
+static void
+panel_recent_parser_end_element (GMarkupParseContext  *context G_GNUC_UNUSED,
+				 const char           *element_name,
+				 gpointer              user_data,
+				 GError              **error G_GNUC_UNUSED)
+{
+	PanelRecentParser *parser = user_data;
+	PanelRecentItem   *item;
+
+	if (!parser->current)
+		return;
+
+	if (strcmp (element_name, "title") == 0 && parser->in_title) {
+		parser->in_title = FALSE;
+		g_free (parser->current->title);
+		parser->current->title = g_strdup (parser->text->str);
+		return;
+	}
+
+	if (strcmp (element_name, "bookmark") != 0)
+		return;
+
+	item = parser->current;
+	parser->current = NULL;
+
+	/* private items only belong to the applications that added them */
+	if (!item->uri || item->is_private) {
+		panel_recent_item_free (item);
+		return;
+	}
+
+	panel_recent_parser_add_item (parser, item);
+}
+
+static void
+panel_recent_parser_text (GMarkupParseContext  *context G_GNUC_UNUSED,
+			  const char           *text,
+			  gsize                 text_len,
+			  gpointer              user_data,
+			  GError              **error G_GNUC_UNUSED)
+{
+	PanelRecentParser *parser = user_data;
+
+	if (parser->in_title)
+		g_string_append_len (parser->text, text, text_len);
+}
 
-	/* we can unref it only after having used the data we fetched from it */
-	ctk_recent_info_unref (recent_info);
+static const GMarkupParser panel_recent_markup_parser = {
+	panel_recent_parser_start_element,
+	panel_recent_parser_end_element,
+	panel_recent_parser_text,
+	NULL,
+	NULL
+};
+
+static void
+panel_recent_result_free (PanelRecentResult *result)
+{
+	g_ptr_array_unref (result->items);
+	g_free (result);
 }
 
+/* Runs in a worker thread: the file is fed to the parser in chunks, so
+ * only the retained items are ever held in memory. */
 static void
-panel_recent_manager_changed_cb (CtkRecentManager *manager,
-				 CtkWidget        *menu_item)
+panel_recent_read_thread (GTask        *task,
+			  gpointer      source_object G_GNUC_UNUSED,
+			  gpointer      task_data,
+			  GCancellable *cancellable)
 {
-	int size;
+	GFile               *file = task_data;
+	GFileInputStream    *stream;
+	GMarkupParseContext *context;
+	PanelRecentParser    parser;
+	PanelRecentResult   *result;
+	char                *buffer;
+	gssize               n_read;
+	GError              *error = NULL;
+
+	parser.items = g_ptr_array_new_with_free_func ((GDestroyNotify) panel_recent_item_free);
+	parser.n_items = 0;
+	parser.current = NULL;
+	parser.text = g_string_new (NULL);
+	parser.in_title = FALSE;
+
+	stream = g_file_read (file, cancellable, &error);
+
+	if (stream) {
+		context = g_markup_parse_context_new (&panel_recent_markup_parser,
+						      0, &parser, NULL);
+		buffer = g_malloc (PANEL_RECENT_READ_SIZE);
+
+		while ((n_read = g_input_stream_read (G_INPUT_STREAM (stream),
+						      buffer, PANEL_RECENT_READ_SIZE,
+						      cancellable, &error)) > 0) {
+			if (!g_markup_parse_context_parse (context, buffer,
+							   n_read, &error))
+				break;
+		}
+
+		if (!error)
+			g_markup_parse_context_end_parse (context, &error);
+
+		g_free (buffer);
+		g_markup_parse_context_free (context);
+		g_object_unref (stream);
+	}
+
+	if (parser.current)
+		panel_recent_item_free (parser.current);
+	g_string_free (parser.text, TRUE);
 
-	g_object_get (manager, "size", &size, NULL);
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_ptr_array_unref (parser.items);
+		g_task_return_error (task, error);
+		return;
+	}
+
+	/* a missing or broken file is just an empty list; keep whatever
+	 * could be parsed */
+	if (error)
+		g_error_free (error);
+
+	result = g_new0 (PanelRecentResult, 1);
+	result->items = parser.items;
+	result->n_items = parser.n_items;
 
-	ctk_widget_set_sensitive (menu_item, size > 0);
+	g_task_return_pointer (task, result,
+			       (GDestroyNotify) panel_recent_result_free);
+}
+
+static void
+panel_recent_menu_fill (CtkWidget *recent_menu)
+{
+	GList *children, *l;
+	guint  i;
+
+	children = ctk_container_get_children (CTK_CONTAINER (recent_menu));
+	for (l = children; l; l = l->next)
+		if (g_object_get_data (G_OBJECT (l->data), "panel-recent-uri"))
+			ctk_widget_destroy (CTK_WIDGET (l->data));
+	g_list_free (children);
+
+	for (i = 0; recent_items && i < recent_items->len; i++) {
+		PanelRecentItem *item;
+		CtkWidget       *menu_item;
+		GIcon           *icon;
+		GFile           *file;
+		char            *label;
+		char            *tooltip;
+
+		item = g_ptr_array_index (recent_items, i);
+
+		file = g_file_new_for_uri (item->uri);
+		tooltip = g_file_get_parse_name (file);
+		g_object_unref (file);
+
+		if (!PANEL_GLIB_STR_EMPTY (item->title)) {
+			label = g_strdup (item->title);
+		} else
+			label = g_path_get_basename (tooltip);
+
+		/* icons are only looked up once the menu is shown */
+		icon = NULL;
+		if (item->mime_type) {
+			char *content_type;
+
+			content_type = g_content_type_from_mime_type (item->mime_type);
+			if (content_type)
+				icon = g_content_type_get_icon (content_type);
+			g_free (content_type);
+		}
+
+		menu_item = ctk_image_menu_item_new ();
+		setup_menuitem_with_icon (menu_item,
+					  panel_menu_icon_get_size (),
+					  icon, icon ? NULL : "text-x-generic",
+					  label);
+		panel_util_set_tooltip_text (menu_item, tooltip);
+
+		g_object_set_data_full (G_OBJECT (menu_item), "panel-recent-uri",
+					g_strdup (item->uri), g_free);
+		g_object_set_data_full (G_OBJECT (menu_item), "panel-recent-mime-type",
+					g_strdup (item->mime_type), g_free);
+		g_signal_connect (menu_item, "activate",
+				  G_CALLBACK (recent_documents_activate_cb), NULL);
+
+		ctk_menu_shell_insert (CTK_MENU_SHELL (recent_menu), menu_item, i);
+
+		if (icon)
+			g_object_unref (icon);
+		g_free (label);
+		g_free (tooltip);
+	}
+
+	g_object_set_data (G_OBJECT (recent_menu), "panel-recent-generation",
+			   GUINT_TO_POINTER (recent_generation));
+}
+
+static void
+panel_recent_menu_show_cb (CtkWidget *recent_menu,
+			   gpointer   data G_GNUC_UNUSED)
+{
+	guint generation;
+
+	generation = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (recent_menu),
+							  "panel-recent-generation"));
+	if (generation != recent_generation)
+		panel_recent_menu_fill (recent_menu);
+}
+
+static void
+panel_recent_menu_update (CtkWidget *recent_menu)
+{
+	CtkWidget *menu_item;
+
+	menu_item = ctk_menu_get_attach_widget (CTK_MENU (recent_menu));
+	if (menu_item)
+		ctk_widget_set_sensitive (menu_item, recent_n_items > 0);
+
+	if (ctk_widget_get_visible (recent_menu))
+		panel_recent_menu_fill (recent_menu);
+}
+
+static void
+panel_recent_read_cb (GObject      *source_object G_GNUC_UNUSED,
+		      GAsyncResult *res,
+		      gpointer      user_data G_GNUC_UNUSED)
+{
+	PanelRecentResult *result;
+	GError            *error = NULL;
+
+	result = g_task_propagate_pointer (G_TASK (res), &error);
+	if (!result) {
+		/* cancelled: a newer read is on its way */
+		g_error_free (error);
+		return;
+	}
+
+	g_clear_object (&recent_cancellable);
+
+	if (recent_items)
+		g_ptr_array_unref (recent_items);
+	recent_items = g_ptr_array_ref (result->items);
+	recent_n_items = result->n_items;
+	recent_generation++;
+
+	panel_recent_result_free (result);
+
+	g_slist_foreach (recent_menus, (GFunc) panel_recent_menu_update, NULL);
+}
+
+static GFile *
+panel_recent_get_file (void)
+{
+	GFile *file;
+	char  *filename;
+
+	filename = g_build_filename (g_get_user_data_dir (),
+				     "recently-used.xbel", NULL);
+	file = g_file_new_for_path (filename);
+	g_free (filename);
+
+	return file;
+}
+
+static gboolean
+panel_recent_reload (gpointer data G_GNUC_UNUSED)
+{
+	GTask *task;
+
+	recent_reload_id = 0;
+
+	if (recent_cancellable) {
+		g_cancellable_cancel (recent_cancellable);
+		g_object_unref (recent_cancellable);
+	}
+	recent_cancellable = g_cancellable_new ();
+
+	task = g_task_new (NULL, recent_cancellable, panel_recent_read_cb, NULL);
+	g_task_set_task_data (task, panel_recent_get_file (), g_object_unref);
+	g_task_run_in_thread (task, panel_recent_read_thread);
+	g_object_unref (task);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Applications tend to rewrite the file several times in a row. */
+static void
+panel_recent_file_changed_cb (GFileMonitor      *monitor G_GNUC_UNUSED,
+			      GFile             *file G_GNUC_UNUSED,
+			      GFile             *other_file G_GNUC_UNUSED,
+			      GFileMonitorEvent  event G_GNUC_UNUSED,
+			      gpointer           data G_GNUC_UNUSED)
+{
+	if (recent_reload_id)
+		g_source_remove (recent_reload_id);
+
+	recent_reload_id = g_timeout_add (PANEL_RECENT_RELOAD_DELAY,
+					  panel_recent_reload, NULL);
+}
+
+static void
+panel_recent_ensure_monitor (void)
+{
+	GFile *file;
+
+	if (recent_monitor)
+		return;
+
+	file = panel_recent_get_file ();
+	recent_monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE,
+					      NULL, NULL);
+	g_object_unref (file);
+
+	if (recent_monitor)
+		g_signal_connect (recent_monitor, "changed",
+				  G_CALLBACK (panel_recent_file_changed_cb), NULL);
+
+	panel_recent_reload (NULL);
+}
+
+static void
+panel_recent_menu_destroyed (CtkWidget *recent_menu,
+			     gpointer   data G_GNUC_UNUSED)
+{
+	recent_menus = g_slist_remove (recent_menus, recent_menu);
 }
 
 static CtkWidget *clear_recent_dialog = NULL;
 
 static void
-clear_dialog_response (CtkWidget        *widget,
-		       int               response,
-		       CtkRecentManager *manager)
+clear_dialog_response (CtkWidget *widget,
+		       int        response,
+		       gpointer   data G_GNUC_UNUSED)
 {
+	/* the manager parses the whole file, only get it when needed */
         if (response == CTK_RESPONSE_ACCEPT)
-		ctk_recent_manager_purge_items (manager, NULL);
+		ctk_recent_manager_purge_items (ctk_recent_manager_get_default (),
+						NULL);
 
 	ctk_widget_destroy (widget);
 }
 
 static void
-recent_documents_clear_cb (CtkMenuItem      *menuitem,
-                           CtkRecentManager *manager)
+recent_documents_clear_cb (CtkMenuItem *menuitem,
+                           gpointer     data G_GNUC_UNUSED)
 {
 	gpointer tmp;
 
@@ -169,7 +601,7 @@ recent_documents_clear_cb (CtkMenuItem      *menuitem,
 					  FALSE);
 
 	g_signal_connect (clear_recent_dialog, "response",
-			  G_CALLBACK (clear_dialog_response), manager);
+			  G_CALLBACK (clear_dialog_response), NULL);
 
 	g_signal_connect (clear_recent_dialog, "destroy",
 			  G_CALLBACK (ctk_widget_destroyed),
@@ -184,12 +616,12 @@ recent_documents_clear_cb (CtkMenuItem      *menuitem,
 }
 
 void
-panel_recent_append_documents_menu (CtkWidget        *top_menu,
-				    CtkRecentManager *manager)
+panel_recent_append_documents_menu (CtkWidget *top_menu)
 {
 	CtkWidget      *recent_menu;
 	CtkWidget      *menu_item;
-	int             size;
+
+	panel_recent_ensure_monitor ();
 
 	menu_item = ctk_image_menu_item_new ();
 	setup_menuitem_with_icon (menu_item,
@@ -197,7 +629,7 @@ panel_recent_append_documents_menu (CtkWidget        *top_menu,
 				  NULL,
 				  PANEL_ICON_RECENT,
 				  _("Recent Documents"));
-	recent_menu = ctk_recent_chooser_menu_new_for_manager (manager);
+	recent_menu = create_empty_menu ();
 	ctk_menu_item_set_submenu (CTK_MENU_ITEM (menu_item), recent_menu);
 
 	g_signal_connect (G_OBJECT (recent_menu), "button_press_event",
@@ -206,27 +638,18 @@ panel_recent_append_documents_menu (CtkWidget        *top_menu,
 	ctk_menu_shell_append (CTK_MENU_SHELL (top_menu), menu_item);
 	ctk_widget_show_all (menu_item);
 
-	ctk_recent_chooser_set_local_only (CTK_RECENT_CHOOSER (recent_menu),
-					   FALSE);
-	ctk_recent_chooser_set_show_tips (CTK_RECENT_CHOOSER (recent_menu),
-					  TRUE);
-	ctk_recent_chooser_set_sort_type (CTK_RECENT_CHOOSER (recent_menu),
-					  CTK_RECENT_SORT_MRU);
+	g_signal_connect (recent_menu, "show",
+			  G_CALLBACK (panel_recent_menu_show_cb), NULL);
+	g_signal_connect (recent_menu, "destroy",
+			  G_CALLBACK (panel_recent_menu_destroyed), NULL);
+	recent_menus = g_slist_prepend (recent_menus, recent_menu);
 
-	g_signal_connect (CTK_RECENT_CHOOSER (recent_menu),
-			  "item-activated",
-			  G_CALLBACK (recent_documents_activate_cb),
-			  NULL);
+	ctk_widget_set_sensitive (menu_item, recent_n_items > 0);
 
-	//FIXME this is not possible with CtkRecent...: egg_recent_view_ctk_set_icon_size (view, panel_menu_icon_get_size ());
-
-	g_signal_connect_object (manager, "changed",
-				 G_CALLBACK (panel_recent_manager_changed_cb),
-				 menu_item, 0);
-
-	size = 0;
-	g_object_get (manager, "size", &size, NULL);
-	ctk_widget_set_sensitive (menu_item, size > 0);
+	/* the generation data is unset, so the items are added when the
+	 * menu is first shown */
+	g_object_set_data (G_OBJECT (recent_menu), "panel-recent-generation",
+			   GUINT_TO_POINTER (G_MAXUINT));
 
 	add_menu_separator (recent_menu);
 
@@ -242,5 +665,5 @@ panel_recent_append_documents_menu (CtkWidget        *top_menu,
 
 	g_signal_connect (menu_item, "activate",
 			  G_CALLBACK (recent_documents_clear_cb),
-			  manager);
+			  NULL);
 }
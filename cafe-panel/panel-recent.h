@@ -31,8 +31,7 @@
 extern "C" {
 #endif
 
-void panel_recent_append_documents_menu (CtkWidget        *menu,
-					 CtkRecentManager *manager);
+void panel_recent_append_documents_menu (CtkWidget *menu);
 
 #ifdef __cplusplus
 }
@@ -49,6 +49,7 @@
 #include <libpanel-util/panel-glib.h>
 #include <libpanel-util/panel-ctk.h>
 #include <libpanel-util/panel-keyfile.h>
+#include <libpanel-util/panel-search-index.h>
 #include <libpanel-util/panel-show.h>
 
 #include "panel-util.h"
@@ -84,6 +85,8 @@ typedef struct {
 	long              changed_id;
 
 	CtkListStore     *program_list_store;
+	/* the rows of program_list_store, keyed by their position + 1 */
+	PanelSearchIndex *program_search_index;
 
 	GHashTable       *dir_hash;
 	GList		 *possible_executables;
@@ -238,6 +241,9 @@ panel_run_dialog_destroy (PanelRunDialog *dialog)
 		g_source_remove (dialog->find_command_idle_id);
 	dialog->find_command_idle_id = 0;
 
+	panel_search_index_free (dialog->program_search_index);
+	dialog->program_search_index = NULL;
+
 	if (dialog->settings != NULL)
 		g_object_unref (dialog->settings);
 	dialog->settings = NULL;
@@ -684,6 +690,7 @@ panel_run_dialog_find_command_idle (PanelRunDialog *dialog)
 	GIcon        *found_icon;
 	char         *found_name;
 	gboolean      fuzzy;
+	int           row;
 
 	model = CTK_TREE_MODEL (dialog->program_list_store);
 	path = ctk_tree_path_new_first ();
@@ -702,20 +709,26 @@ panel_run_dialog_find_command_idle (PanelRunDialog *dialog)
 	found_icon = NULL;
 	found_name = NULL;
 	fuzzy = FALSE;
+	row = 0;
+
+	panel_search_index_set_query (dialog->program_search_index, text);
 
 	do {
 		char *exec = NULL;
 		GIcon *icon = NULL;
 		char *name = NULL;
-		char *comment = NULL;
+		gboolean was_visible;
+		gboolean visible;
 
 		ctk_tree_model_get (model, &iter,
 				    COLUMN_EXEC,      &exec,
 				    COLUMN_GICON,     &icon,
 				    COLUMN_NAME,      &name,
-				    COLUMN_COMMENT,   &comment,
+				    COLUMN_VISIBLE,   &was_visible,
 				    -1);
 
+		row++;
+
 		if (!fuzzy && exec && icon &&
 		    fuzzy_command_match (text, exec, &fuzzy)) {
 			g_clear_object (&found_icon);
@@ -724,29 +737,23 @@ panel_run_dialog_find_command_idle (PanelRunDialog *dialog)
 			found_icon = g_object_ref (icon);
 			found_name = g_strdup (name);
 
-			ctk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_VISIBLE, TRUE,
-					    -1);
-		} else if (panel_g_utf8_strstrcase (exec, text) != NULL ||
-			   panel_g_utf8_strstrcase (name, text) != NULL ||
-			   panel_g_utf8_strstrcase (comment, text) != NULL) {
-			ctk_list_store_set (dialog->program_list_store,
-					    &iter,
-					    COLUMN_VISIBLE, TRUE,
-					    -1);
+			visible = TRUE;
 		} else {
+			visible = panel_search_index_matches (dialog->program_search_index,
+							      GINT_TO_POINTER (row));
+		}
+
+		/* every change makes the filter model look at the row again */
+		if (visible != was_visible)
 			ctk_list_store_set (dialog->program_list_store,
 					    &iter,
-					    COLUMN_VISIBLE, FALSE,
+					    COLUMN_VISIBLE, visible,
 					    -1);
-		}
 
 		g_free (exec);
 		if (icon != NULL)
 			g_object_unref (icon);
 		g_free (name);
-		g_free (comment);
 
         } while (ctk_tree_model_iter_next (model, &iter));
 
@@ -888,6 +895,7 @@ panel_run_dialog_add_items_idle (PanelRunDialog *dialog)
 	GSList            *l;
 	GSList            *next;
 	const char        *prev_name;
+	int                row;
 
 	/* create list store */
 	dialog->program_list_store = ctk_list_store_new (NUM_COLUMNS,
@@ -898,6 +906,8 @@ panel_run_dialog_add_items_idle (PanelRunDialog *dialog)
 							 G_TYPE_STRING,
 							 G_TYPE_BOOLEAN);
 
+	dialog->program_search_index = panel_search_index_new ();
+
 	all_applications = get_all_applications ();
 
 	/* Strip duplicates */
@@ -920,6 +930,7 @@ panel_run_dialog_add_items_idle (PanelRunDialog *dialog)
 		}
 	}
 
+	row = 0;
 	for (l = all_applications; l; l = l->next) {
 		CafeMenuTreeEntry *entry = l->data;
 		CtkTreeIter    iter;
@@ -929,6 +940,14 @@ panel_run_dialog_add_items_idle (PanelRunDialog *dialog)
 		ginfo = cafemenu_tree_entry_get_app_info (entry);
 		gicon = g_app_info_get_icon(G_APP_INFO(ginfo));
 
+		row++;
+		panel_search_index_add (dialog->program_search_index, GINT_TO_POINTER (row),
+					g_app_info_get_commandline (G_APP_INFO (ginfo)));
+		panel_search_index_add (dialog->program_search_index, GINT_TO_POINTER (row),
+					g_app_info_get_display_name (G_APP_INFO (ginfo)));
+		panel_search_index_add (dialog->program_search_index, GINT_TO_POINTER (row),
+					g_app_info_get_description (G_APP_INFO (ginfo)));
+
 		ctk_list_store_append (dialog->program_list_store, &iter);
 		ctk_list_store_set (dialog->program_list_store, &iter,
 				    COLUMN_GICON,     gicon,
@@ -1150,6 +1169,8 @@ panel_run_dialog_setup_program_list (PanelRunDialog *dialog,
 		dialog->add_items_idle_id =
 			g_idle_add_full (G_PRIORITY_LOW, (GSourceFunc) panel_run_dialog_add_items_idle,
 					 dialog, NULL);
+		g_source_set_name_by_id (dialog->add_items_idle_id,
+					 "[cafe-panel] panel_run_dialog_add_items_idle");
 	}
 }
 
@@ -34,6 +34,7 @@
 
 #include "panel-profile.h"
 #include "panel-session.h"
+#include "panel-stats.h"
 
 #include "panel-shell.h"
 
@@ -129,6 +130,7 @@ panel_shell_register (gboolean replace)
 						    G_DBUS_SIGNAL_FLAGS_NONE,
 						    (GDBusSignalCallback)panel_shell_on_name_lost,
 						    NULL, NULL);
+		panel_stats_register (dbus_connection);
 		break;
 	case 2: /* DBUS_REQUEST_NAME_REPLY_IN_QUEUE */
 	case 3: /* DBUS_REQUEST_NAME_REPLY_EXISTS */
@@ -0,0 +1,339 @@
+/*
+ * panel-stats.c: runtime counters of the panel
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "panel-stats.h"
+
+#include "applet.h"
+#include "panel-memory.h"
+#include "panel-profile.h"
+#include "panel-toplevel.h"
+
+/* a main loop iteration longer than this misses a frame at 60 Hz */
+#define PANEL_STATS_SLOW_ITERATION (16 * G_TIME_SPAN_MILLISECOND)
+
+static const char *counter_names [PANEL_STATS_N_COUNTERS] = {
+	"size-requests",
+	"allocations",
+	"draws",
+	"background-changes",
+	"dbus-calls",
+	"dbus-signals",
+	"image-cache-hits",
+	"image-cache-misses",
+	"slow-iterations",
+	"addto-applet-rows",
+	"addto-menu-rows",
+	"frame-draws",
+	"frame-draw-us"
+};
+
+typedef struct {
+	guint64 counters [PANEL_STATS_N_COUNTERS];
+} PanelStatsEntry;
+
+typedef struct {
+	GSource source;
+	gint64  woken;
+} PanelStatsSource;
+
+/* GObject -> PanelStatsEntry; NULL until the interface is exported, so
+ * that counting costs nothing when nobody can read the counters */
+static GHashTable      *stats_entries = NULL;
+static PanelStatsEntry  stats_global;
+static gint64           stats_reset_time = 0;
+
+static void
+panel_stats_object_finalized (gpointer  data G_GNUC_UNUSED,
+			      GObject  *where_the_object_was)
+{
+	g_hash_table_remove (stats_entries, where_the_object_was);
+}
+
+gboolean
+panel_stats_enabled (void)
+{
+	return stats_entries != NULL;
+}
+
+void
+panel_stats_count (gpointer          object,
+		   PanelStatsCounter counter)
+{
+	panel_stats_add (object, counter, 1);
+}
+
+void
+panel_stats_add (gpointer          object,
+		 PanelStatsCounter counter,
+		 guint64           value)
+{
+	PanelStatsEntry *entry;
+
+	if (!stats_entries)
+		return;
+
+	if (!object) {
+		entry = &stats_global;
+	} else if (!(entry = g_hash_table_lookup (stats_entries, object))) {
+		entry = g_new0 (PanelStatsEntry, 1);
+		g_hash_table_insert (stats_entries, object, entry);
+		g_object_weak_ref (G_OBJECT (object),
+				   panel_stats_object_finalized, NULL);
+	}
+
+	entry->counters [counter] += value;
+}
+
+static void
+panel_stats_reset (void)
+{
+	GHashTableIter   iter;
+	PanelStatsEntry *entry;
+
+	g_hash_table_iter_init (&iter, stats_entries);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+		memset (entry, 0, sizeof (PanelStatsEntry));
+
+	memset (&stats_global, 0, sizeof (PanelStatsEntry));
+	stats_reset_time = g_get_monotonic_time ();
+}
+
+static void
+panel_stats_describe (GObject     *object,
+		      const char **kind,
+		      const char **name)
+{
+	*kind = "panel";
+	*name = NULL;
+
+	if (!object)
+		return;
+
+	if (PANEL_IS_TOPLEVEL (object)) {
+		*kind = "toplevel";
+		*name = panel_profile_get_toplevel_id (PANEL_TOPLEVEL (object));
+	} else if (CTK_IS_WIDGET (object) &&
+		   (*name = cafe_panel_applet_get_id_by_widget (CTK_WIDGET (object)))) {
+		*kind = "applet";
+	} else
+		*kind = G_OBJECT_TYPE_NAME (object);
+}
+
+static void
+panel_stats_add_entry (GVariantBuilder *builder,
+		       const char      *kind,
+		       const char      *name,
+		       PanelStatsEntry *entry)
+{
+	GVariantBuilder counters;
+	int             i;
+
+	g_variant_builder_init (&counters, G_VARIANT_TYPE ("a{st}"));
+	for (i = 0; i < PANEL_STATS_N_COUNTERS; i++)
+		if (entry->counters [i] > 0)
+			g_variant_builder_add (&counters, "{st}",
+					       counter_names [i],
+					       entry->counters [i]);
+
+	g_variant_builder_add (builder, "(ssa{st})",
+			       kind, name ? name : "", &counters);
+}
+
+static GVariant *
+panel_stats_snapshot (void)
+{
+	GVariantBuilder  builder;
+	GHashTableIter   iter;
+	GObject         *object;
+	PanelStatsEntry *entry;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssa{st})"));
+
+	panel_stats_add_entry (&builder, "panel", NULL, &stats_global);
+
+	g_hash_table_iter_init (&iter, stats_entries);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &object, (gpointer *) &entry)) {
+		const char *kind;
+		const char *name;
+
+		panel_stats_describe (object, &kind, &name);
+		panel_stats_add_entry (&builder, kind, name, entry);
+	}
+
+	return g_variant_new ("(ta(ssa{st}))",
+			      (guint64) (g_get_monotonic_time () - stats_reset_time),
+			      &builder);
+}
+
+static void
+panel_stats_add_charge (gpointer    owner,
+			const char *cache,
+			gsize       bytes,
+			gpointer    user_data)
+{
+	GVariantBuilder *builder = user_data;
+	const char      *kind;
+	const char      *name;
+
+	panel_stats_describe (owner, &kind, &name);
+	g_variant_builder_add (builder, "(ssst)",
+			       kind, name ? name : "", cache, (guint64) bytes);
+}
+
+static GVariant *
+panel_stats_memory (void)
+{
+	GVariantBuilder builder;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssst)"));
+	panel_memory_foreach (panel_stats_add_charge, &builder);
+
+	return g_variant_new ("(tta(ssst))",
+			      (guint64) panel_memory_get_total (),
+			      (guint64) panel_memory_get_budget (),
+			      &builder);
+}
+
+static gboolean
+panel_stats_source_prepare (GSource *source,
+			    gint    *timeout)
+{
+	PanelStatsSource *stats_source = (PanelStatsSource *) source;
+
+	/* the main loop is going back to sleep: everything dispatched
+	 * since it woke up was one iteration */
+	if (stats_source->woken &&
+	    g_get_monotonic_time () - stats_source->woken > PANEL_STATS_SLOW_ITERATION)
+		panel_stats_count (NULL, PANEL_STATS_SLOW_ITERATIONS);
+
+	stats_source->woken = 0;
+	*timeout = -1;
+
+	return FALSE;
+}
+
+static gboolean
+panel_stats_source_check (GSource *source)
+{
+	PanelStatsSource *stats_source = (PanelStatsSource *) source;
+
+	stats_source->woken = g_get_monotonic_time ();
+
+	return FALSE;
+}
+
+static gboolean
+panel_stats_source_dispatch (GSource     *source G_GNUC_UNUSED,
+			     GSourceFunc  callback G_GNUC_UNUSED,
+			     gpointer     user_data G_GNUC_UNUSED)
+{
+	return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs panel_stats_source_funcs = {
+	panel_stats_source_prepare,
+	panel_stats_source_check,
+	panel_stats_source_dispatch,
+	NULL
+};
+
+static void
+method_call_cb (GDBusConnection       *connection G_GNUC_UNUSED,
+		const gchar           *sender G_GNUC_UNUSED,
+		const gchar           *object_path G_GNUC_UNUSED,
+		const gchar           *interface_name G_GNUC_UNUSED,
+		const gchar           *method_name,
+		GVariant              *parameters G_GNUC_UNUSED,
+		GDBusMethodInvocation *invocation,
+		gpointer               user_data G_GNUC_UNUSED)
+{
+	if (g_strcmp0 (method_name, "GetSnapshot") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       panel_stats_snapshot ());
+	} else if (g_strcmp0 (method_name, "GetMemory") == 0) {
+		g_dbus_method_invocation_return_value (invocation,
+						       panel_stats_memory ());
+	} else if (g_strcmp0 (method_name, "Reset") == 0) {
+		panel_stats_reset ();
+		g_dbus_method_invocation_return_value (invocation, NULL);
+	}
+}
+
+static const gchar introspection_xml[] =
+	"<node>"
+	    "<interface name='org.cafe.Panel.Stats'>"
+	      "<method name='GetSnapshot'>"
+	        "<arg name='elapsed' type='t' direction='out'/>"
+	        "<arg name='entries' type='a(ssa{st})' direction='out'/>"
+	      "</method>"
+	      "<method name='GetMemory'>"
+	        "<arg name='total' type='t' direction='out'/>"
+	        "<arg name='budget' type='t' direction='out'/>"
+	        "<arg name='charges' type='a(ssst)' direction='out'/>"
+	      "</method>"
+	      "<method name='Reset'/>"
+	    "</interface>"
+	  "</node>";
+
+static const GDBusInterfaceVTable interface_vtable = {
+	method_call_cb,
+	NULL,
+	NULL
+};
+
+void
+panel_stats_register (GDBusConnection *connection)
+{
+	GDBusNodeInfo *introspection_data;
+	GSource       *source;
+	GError        *error = NULL;
+
+	if (stats_entries)
+		return;
+
+	introspection_data = g_dbus_node_info_new_for_xml (introspection_xml, NULL);
+	g_dbus_connection_register_object (connection,
+					   PANEL_STATS_OBJECT_PATH,
+					   introspection_data->interfaces[0],
+					   &interface_vtable,
+					   NULL, NULL,
+					   &error);
+	g_dbus_node_info_unref (introspection_data);
+
+	if (error) {
+		g_printerr ("Failed to register object %s: %s\n",
+			    PANEL_STATS_OBJECT_PATH, error->message);
+		g_error_free (error);
+		return;
+	}
+
+	stats_entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					       NULL, g_free);
+	stats_reset_time = g_get_monotonic_time ();
+
+	source = g_source_new (&panel_stats_source_funcs, sizeof (PanelStatsSource));
+	g_source_set_priority (source, G_PRIORITY_HIGH);
+	g_source_set_name (source, "[cafe-panel] stats");
+	g_source_attach (source, NULL);
+	g_source_unref (source);
+}
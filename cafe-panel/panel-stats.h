@@ -0,0 +1,67 @@
+/*
+ * panel-stats.h: runtime counters of the panel
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_STATS_H__
+#define __PANEL_STATS_H__
+
+#include <gio/gio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PANEL_STATS_OBJECT_PATH "/org/cafe/Panel/Stats"
+#define PANEL_STATS_INTERFACE   "org.cafe.Panel.Stats"
+
+typedef enum {
+	PANEL_STATS_SIZE_REQUESTS,
+	PANEL_STATS_ALLOCATIONS,
+	PANEL_STATS_DRAWS,
+	PANEL_STATS_BACKGROUND_CHANGES,
+	PANEL_STATS_DBUS_CALLS,
+	PANEL_STATS_DBUS_SIGNALS,
+	PANEL_STATS_IMAGE_CACHE_HITS,
+	PANEL_STATS_IMAGE_CACHE_MISSES,
+	PANEL_STATS_SLOW_ITERATIONS,
+	PANEL_STATS_ADDTO_APPLET_ROWS,
+	PANEL_STATS_ADDTO_MENU_ROWS,
+	PANEL_STATS_FRAME_DRAWS,
+	PANEL_STATS_FRAME_DRAW_US,
+	PANEL_STATS_N_COUNTERS
+} PanelStatsCounter;
+
+void panel_stats_register (GDBusConnection   *connection);
+
+/* object is a PanelToplevel, an applet frame, or NULL for the counters
+ * of the panel process as a whole */
+void panel_stats_count    (gpointer           object,
+			   PanelStatsCounter  counter);
+void panel_stats_add      (gpointer           object,
+			   PanelStatsCounter  counter,
+			   guint64            value);
+
+/* whether anybody can read the counters, to skip measuring what would
+ * be thrown away */
+gboolean panel_stats_enabled (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_STATS_H__ */
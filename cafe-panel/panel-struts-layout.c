@@ -0,0 +1,203 @@
+/*
+ * panel-struts-layout.c: place the struts of one monitor against each other
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "panel-struts-layout.h"
+
+void
+panel_strut_rect_set_geometry (PanelStrutRect     *rect,
+			       const CdkRectangle *monitor,
+			       int                 scale)
+{
+	switch (rect->orientation) {
+	case PANEL_ORIENTATION_TOP:
+		rect->geometry.x      = rect->strut_start;
+		rect->geometry.y      = monitor->y;
+		rect->geometry.width  = rect->strut_end - rect->strut_start + 1;
+		rect->geometry.height = rect->strut_size / scale;
+		if (scale > 1)
+			rect->geometry.width -= (rect->strut_size / scale);
+		break;
+	case PANEL_ORIENTATION_BOTTOM:
+		rect->geometry.x      = rect->strut_start;
+		rect->geometry.y      = monitor->y + monitor->height - rect->strut_size;
+		rect->geometry.width  = rect->strut_end - rect->strut_start + 1;
+		rect->geometry.height = rect->strut_size / scale;
+		if (scale > 1)
+			rect->geometry.width -= (rect->strut_size / scale);
+		break;
+	case PANEL_ORIENTATION_LEFT:
+		rect->geometry.x      = monitor->x;
+		rect->geometry.y      = rect->strut_start;
+		rect->geometry.width  = rect->strut_size / scale;
+		rect->geometry.height = rect->strut_end - rect->strut_start + 1;
+		if (scale > 1)
+			rect->geometry.height -= (rect->strut_size / scale);
+		break;
+	case PANEL_ORIENTATION_RIGHT:
+		rect->geometry.x      = monitor->x + monitor->width - rect->strut_size;
+		rect->geometry.y      = rect->strut_start;
+		rect->geometry.width  = rect->strut_size / scale;
+		rect->geometry.height = rect->strut_end - rect->strut_start + 1;
+		if (scale > 1)
+			rect->geometry.height -= (rect->strut_size / scale);
+		break;
+	}
+}
+
+static PanelStrutRect *
+panel_strut_rects_intersect (PanelStrutRect **rects,
+			     int              n_rects,
+			     CdkRectangle    *geometry,
+			     int              skip)
+{
+	int i, j;
+
+	j = 0;
+	for (i = 0; i < n_rects; i++) {
+		PanelStrutRect *rect = rects [i];
+		int             x1, y1, x2, y2;
+
+		x1 = MAX (rect->allocated_geometry.x, geometry->x);
+		y1 = MAX (rect->allocated_geometry.y, geometry->y);
+
+		x2 = MIN (rect->allocated_geometry.x + rect->allocated_geometry.width,
+			  geometry->x + geometry->width);
+		y2 = MIN (rect->allocated_geometry.y + rect->allocated_geometry.height,
+			  geometry->y + geometry->height);
+
+		if (x2 - x1 > 0 && y2 - y1 > 0 && ++j > skip)
+			return rect;
+	}
+
+	return NULL;
+}
+
+static int
+panel_strut_rect_overlapped (PanelStrutRect *rect,
+			     PanelStrutRect *overlap,
+			     CdkRectangle   *geometry,
+			     gboolean       *moved_down,
+			     int             skip)
+{
+	int overlap_x1, overlap_y1, overlap_x2, overlap_y2;
+
+	overlap_x1 = overlap->allocated_geometry.x;
+	overlap_y1 = overlap->allocated_geometry.y;
+	overlap_x2 = overlap->allocated_geometry.x + overlap->allocated_geometry.width;
+	overlap_y2 = overlap->allocated_geometry.y + overlap->allocated_geometry.height;
+
+	if (rect->orientation == overlap->orientation) {
+		int old_x, old_y;
+
+		old_x = geometry->x;
+		old_y = geometry->y;
+
+		switch (rect->orientation) {
+		case PANEL_ORIENTATION_TOP:
+			geometry->y = overlap_y2;
+			rect->allocated_strut_size += geometry->y - old_y;
+			break;
+		case PANEL_ORIENTATION_BOTTOM:
+			geometry->y = overlap_y1 - geometry->height;
+			rect->allocated_strut_size += old_y - geometry->y;
+			break;
+		case PANEL_ORIENTATION_LEFT:
+			geometry->x = overlap_x2;
+			rect->allocated_strut_size += geometry->x - old_x;
+			break;
+		case PANEL_ORIENTATION_RIGHT:
+			geometry->x = overlap_x1 - geometry->width;
+			rect->allocated_strut_size += old_x - geometry->x;
+			break;
+		default:
+			g_assert_not_reached ();
+			break;
+		}
+	} else {
+		if (rect->orientation & PANEL_HORIZONTAL_MASK ||
+		    overlap->orientation & PANEL_VERTICAL_MASK)
+			return ++skip;
+
+		switch (overlap->orientation) {
+		case PANEL_ORIENTATION_TOP:
+			geometry->y = overlap_y2;
+			*moved_down = TRUE;
+			break;
+		case PANEL_ORIENTATION_BOTTOM:
+			if (!*moved_down)
+				geometry->y = overlap_y1 - geometry->height;
+			else if (overlap_y1 > geometry->y)
+				geometry->height = overlap_y1 - geometry->y;
+			else
+				return ++skip;
+			break;
+		default:
+			g_assert_not_reached ();
+			break;
+		}
+
+		rect->allocated_strut_start = geometry->y;
+		rect->allocated_strut_end   = geometry->y + geometry->height - 1;
+	}
+
+	return skip;
+}
+
+void
+panel_strut_rects_allocate (PanelStrutRect    **rects,
+			    int                 n_rects,
+			    const CdkRectangle *monitor)
+{
+	int i;
+
+	for (i = 0; i < n_rects; i++) {
+		PanelStrutRect *rect = rects [i];
+		PanelStrutRect *overlap;
+		CdkRectangle    geometry;
+		gboolean        moved_down;
+		int             skip;
+
+		rect->allocated_strut_size  = rect->strut_size;
+		rect->allocated_strut_start = rect->strut_start;
+		rect->allocated_strut_end   = rect->strut_end;
+
+		geometry = rect->geometry;
+
+		/* only the rects before this one are allocated yet */
+		moved_down = FALSE;
+		skip = 0;
+		while ((overlap = panel_strut_rects_intersect (rects, i, &geometry, skip)))
+			skip = panel_strut_rect_overlapped (
+				rect, overlap, &geometry, &moved_down, skip);
+
+		if (rect->orientation & PANEL_VERTICAL_MASK) {
+			if (geometry.y < monitor->y) {
+				geometry.height = geometry.y + geometry.height - monitor->y;
+				geometry.y      = monitor->y;
+			}
+
+			if (geometry.y + geometry.height > monitor->y + monitor->height)
+				geometry.height = monitor->y + monitor->height - geometry.y;
+		}
+
+		rect->allocated_geometry = geometry;
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ * panel-struts-layout.h: place the struts of one monitor against each other
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#ifndef __PANEL_STRUTS_LAYOUT_H__
+#define __PANEL_STRUTS_LAYOUT_H__
+
+#include <cdk/cdk.h>
+
+#include "panel-enums.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The part of a strut that is plain rectangle arithmetic, so that it
+ * can be tested without a display. */
+typedef struct {
+	PanelOrientation  orientation;
+	CdkRectangle      geometry;
+	int               strut_size;
+	int               strut_start;
+	int               strut_end;
+
+	CdkRectangle      allocated_geometry;
+	int               allocated_strut_size;
+	int               allocated_strut_start;
+	int               allocated_strut_end;
+} PanelStrutRect;
+
+/* Sets rect->geometry from the requested strut on the given monitor. */
+void panel_strut_rect_set_geometry (PanelStrutRect     *rect,
+				    const CdkRectangle *monitor,
+				    int                 scale);
+
+/* Sets the allocated_* fields of the rects, which must be in the
+ * order of panel_struts_compare(): each one is moved out of the way of
+ * the ones before it. */
+void panel_strut_rects_allocate    (PanelStrutRect    **rects,
+				    int                 n_rects,
+				    const CdkRectangle *monitor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PANEL_STRUTS_LAYOUT_H__ */
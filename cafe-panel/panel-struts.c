@@ -27,9 +27,12 @@
 #error file should only be compiled when HAVE_X11 is enabled
 #endif
 
+#include <string.h>
+
 #include <cdk/cdkx.h>
 
 #include "panel-struts.h"
+#include "panel-struts-layout.h"
 
 #include "panel-multimonitor.h"
 #include "panel-xutils.h"
@@ -41,35 +44,62 @@ typedef struct {
 	CdkScreen        *screen;
 	int               monitor;
 
-        PanelOrientation  orientation;
-	CdkRectangle      geometry;
-        int               strut_size;
-        int               strut_start;
-        int               strut_end;
-
-	CdkRectangle      allocated_geometry;
-        int               allocated_strut_size;
-        int               allocated_strut_start;
-        int               allocated_strut_end;
+	PanelStrutRect    rect;
 } PanelStrut;
 
 
-static GSList *panel_struts_list = NULL;
+typedef struct {
+	PanelOrientation  orientation;
+	int               strut_size;
+	int               strut_start;
+	int               strut_end;
+} PanelStrutHint;
+
+#define PANEL_STRUT_HINT_PENDING "panel-strut-hint-pending"
+#define PANEL_STRUT_HINT_WRITTEN "panel-strut-hint-written"
+
+
+/* PanelToplevel -> PanelStrut */
+static GHashTable *panel_struts_table = NULL;
+/* monitor -> GPtrArray of the struts on it, kept sorted */
+static GHashTable *panel_struts_monitors = NULL;
+
+/* CdkWindows (referenced) with a strut hint waiting to be written */
+static GSList     *panel_struts_pending_hints = NULL;
+static guint       panel_struts_flush_id = 0;
 
 
 static inline PanelStrut *
 panel_struts_find_strut (PanelToplevel *toplevel)
 {
-	GSList *l;
+	if (!panel_struts_table)
+		return NULL;
 
-	for (l = panel_struts_list; l; l = l->next) {
-		PanelStrut *strut = l->data;
+	return g_hash_table_lookup (panel_struts_table, toplevel);
+}
 
-		if (strut->toplevel == toplevel)
-			break;
+static GPtrArray *
+panel_struts_get_monitor_struts (int      monitor,
+				 gboolean create)
+{
+	GPtrArray *struts;
+
+	if (!panel_struts_monitors) {
+		if (!create)
+			return NULL;
+
+		panel_struts_monitors = g_hash_table_new_full (
+			g_direct_hash, g_direct_equal,
+			NULL, (GDestroyNotify) g_ptr_array_unref);
+	}
+
+	struts = g_hash_table_lookup (panel_struts_monitors, GINT_TO_POINTER (monitor));
+	if (!struts && create) {
+		struts = g_ptr_array_new ();
+		g_hash_table_insert (panel_struts_monitors, GINT_TO_POINTER (monitor), struts);
 	}
 
-	return l ? l->data : NULL;
+	return struts;
 }
 
 static void
@@ -85,170 +115,146 @@ panel_struts_get_monitor_geometry (int        monitor,
         *height = panel_multimonitor_height (monitor);
 }
 
-static PanelStrut *
-panel_struts_intersect (GSList       *struts,
-			CdkRectangle *geometry,
-			int           skip)
+/* Only the struts of one monitor can push each other around, so only
+ * that monitor is reallocated. The struts are sorted, and each one is
+ * placed against the ones before it in the array.
+ */
+static gboolean
+panel_struts_allocate_struts (PanelToplevel *toplevel,
+			      CdkScreen     *screen,
+			      int            monitor)
 {
-	GSList *l;
-	int     i;
+	GPtrArray       *struts;
+	PanelStrut     **on_screen;
+	PanelStrutRect **rects;
+	CdkRectangle    *old_geometries;
+	CdkRectangle     monitor_geometry;
+	int              n_rects;
+	guint            i;
+	int              j;
+	gboolean         toplevel_changed = FALSE;
+
+	if (!(struts = panel_struts_get_monitor_struts (monitor, FALSE)))
+		return FALSE;
 
-	i = 0;
-	for (l = struts; l; l = l->next) {
-		PanelStrut *strut = l->data;
-		int         x1, y1, x2, y2;
+	on_screen = g_new (PanelStrut *, MAX (struts->len, 1));
+	rects = g_new (PanelStrutRect *, MAX (struts->len, 1));
+	old_geometries = g_new (CdkRectangle, MAX (struts->len, 1));
+	n_rects = 0;
 
-		x1 = MAX (strut->allocated_geometry.x, geometry->x);
-		y1 = MAX (strut->allocated_geometry.y, geometry->y);
+	for (i = 0; i < struts->len; i++) {
+		PanelStrut *strut = g_ptr_array_index (struts, i);
 
-		x2 = MIN (strut->allocated_geometry.x + strut->allocated_geometry.width,
-			  geometry->x + geometry->width);
-		y2 = MIN (strut->allocated_geometry.y + strut->allocated_geometry.height,
-			  geometry->y + geometry->height);
+		if (strut->screen != screen)
+			continue;
 
-		if (x2 - x1 > 0 && y2 - y1 > 0 && ++i > skip)
-			break;
+		on_screen [n_rects] = strut;
+		rects [n_rects] = &strut->rect;
+		old_geometries [n_rects] = strut->rect.allocated_geometry;
+		n_rects++;
 	}
 
-	return l ? l->data : NULL;
-}
-
-static int
-panel_struts_allocation_overlapped (PanelStrut   *strut,
-				    PanelStrut   *overlap,
-				    CdkRectangle *geometry,
-				    gboolean     *moved_down,
-				    int           skip)
-{
-	int overlap_x1, overlap_y1, overlap_x2, overlap_y2;
-
-	overlap_x1 = overlap->allocated_geometry.x;
-	overlap_y1 = overlap->allocated_geometry.y;
-	overlap_x2 = overlap->allocated_geometry.x + overlap->allocated_geometry.width;
-	overlap_y2 = overlap->allocated_geometry.y + overlap->allocated_geometry.height;
-
-	if (strut->orientation == overlap->orientation) {
-		int old_x, old_y;
-
-		old_x = geometry->x;
-		old_y = geometry->y;
-
-		switch (strut->orientation) {
-		case PANEL_ORIENTATION_TOP:
-			geometry->y = overlap_y2;
-			strut->allocated_strut_size += geometry->y - old_y;
-			break;
-		case PANEL_ORIENTATION_BOTTOM:
-			geometry->y = overlap_y1 - geometry->height;
-			strut->allocated_strut_size += old_y - geometry->y;
-			break;
-		case PANEL_ORIENTATION_LEFT:
-			geometry->x = overlap_x2;
-			strut->allocated_strut_size += geometry->x - old_x;
-			break;
-		case PANEL_ORIENTATION_RIGHT:
-			geometry->x = overlap_x1 - geometry->width;
-			strut->allocated_strut_size += old_x - geometry->x;
-			break;
-		default:
-			g_assert_not_reached ();
-			break;
-		}
-	} else {
-		if (strut->orientation & PANEL_HORIZONTAL_MASK ||
-		    overlap->orientation & PANEL_VERTICAL_MASK)
-			return ++skip;
-
-		switch (overlap->orientation) {
-		case PANEL_ORIENTATION_TOP:
-			geometry->y = overlap_y2;
-			*moved_down = TRUE;
-			break;
-		case PANEL_ORIENTATION_BOTTOM:
-			if (!*moved_down)
-				geometry->y = overlap_y1 - geometry->height;
-			else if (overlap_y1 > geometry->y)
-				geometry->height = overlap_y1 - geometry->y;
-			else
-				return ++skip;
-			break;
-		default:
-			g_assert_not_reached ();
-			break;
-		}
+	panel_struts_get_monitor_geometry (monitor,
+					   &monitor_geometry.x, &monitor_geometry.y,
+					   &monitor_geometry.width, &monitor_geometry.height);
 
-		strut->allocated_strut_start = geometry->y;
-		strut->allocated_strut_end   = geometry->y + geometry->height - 1;
-	}
+	panel_strut_rects_allocate (rects, n_rects, &monitor_geometry);
 
-	return skip;
-}
+	for (j = 0; j < n_rects; j++) {
+		PanelStrut *strut = on_screen [j];
 
-static gboolean
-panel_struts_allocate_struts (PanelToplevel *toplevel,
-			      CdkScreen     *screen,
-			      int            monitor)
-{
-	GSList   *allocated = NULL;
-	GSList   *l;
-	gboolean  toplevel_changed = FALSE;
-
-	for (l = panel_struts_list; l; l = l->next) {
-		PanelStrut   *strut = l->data;
-		PanelStrut   *overlap;
-		CdkRectangle  geometry;
-		int           monitor_x, monitor_y;
-		int           monitor_width, monitor_height;
-		gboolean      moved_down;
-		int           skip;
-
-		if (strut->screen != screen || strut->monitor != monitor)
+		if (cdk_rectangle_equal (&old_geometries [j], &strut->rect.allocated_geometry))
 			continue;
 
-		panel_struts_get_monitor_geometry (strut->monitor,
-						   &monitor_x, &monitor_y,
-						   &monitor_width, &monitor_height);
+		if (strut->toplevel == toplevel)
+			toplevel_changed = TRUE;
+		else
+			ctk_widget_queue_resize (CTK_WIDGET (strut->toplevel));
+	}
 
-		strut->allocated_strut_size  = strut->strut_size;
-		strut->allocated_strut_start = strut->strut_start;
-		strut->allocated_strut_end   = strut->strut_end;
+	g_free (on_screen);
+	g_free (rects);
+	g_free (old_geometries);
 
-		geometry = strut->geometry;
+	return toplevel_changed;
+}
 
-		moved_down = FALSE;
-		skip = 0;
-		while ((overlap = panel_struts_intersect (allocated, &geometry, skip)))
-			skip = panel_struts_allocation_overlapped (
-				strut, overlap, &geometry, &moved_down, skip);
+static gboolean
+panel_struts_flush_hints (gpointer data G_GNUC_UNUSED)
+{
+	GSList *pending;
+	GSList *l;
 
-		if (strut->orientation & PANEL_VERTICAL_MASK) {
-			if (geometry.y < monitor_y) {
-				geometry.height = geometry.y + geometry.height - monitor_y;
-				geometry.y      = monitor_y;
+	pending = panel_struts_pending_hints;
+	panel_struts_pending_hints = NULL;
+	panel_struts_flush_id = 0;
+
+	for (l = pending; l; l = l->next) {
+		CdkWindow      *window = l->data;
+		PanelStrutHint *hint;
+		PanelStrutHint *written;
+
+		hint = g_object_steal_data (G_OBJECT (window), PANEL_STRUT_HINT_PENDING);
+
+		if (hint && !cdk_window_is_destroyed (window)) {
+			written = g_object_get_data (G_OBJECT (window), PANEL_STRUT_HINT_WRITTEN);
+
+			if (!written || memcmp (written, hint, sizeof (PanelStrutHint)) != 0) {
+				panel_xutils_set_strut (window,
+							hint->orientation,
+							hint->strut_size,
+							hint->strut_start,
+							hint->strut_end);
+				g_object_set_data_full (G_OBJECT (window),
+							PANEL_STRUT_HINT_WRITTEN,
+							hint, g_free);
+				hint = NULL;
 			}
-
-			if (geometry.y + geometry.height > monitor_y + monitor_height)
-				geometry.height = monitor_y + monitor_height - geometry.y;
 		}
 
-		if (strut->allocated_geometry.x      != geometry.x     ||
-		    strut->allocated_geometry.y      != geometry.y     ||
-		    strut->allocated_geometry.width  != geometry.width ||
-		    strut->allocated_geometry.height != geometry.height) {
-			strut->allocated_geometry = geometry;
+		g_free (hint);
+		g_object_unref (window);
+	}
 
-			if (strut->toplevel == toplevel)
-				toplevel_changed = TRUE;
-			else
-				ctk_widget_queue_resize (CTK_WIDGET (strut->toplevel));
-		}
+	g_slist_free (pending);
 
-		allocated = g_slist_append (allocated, strut);
+	return FALSE;
+}
+
+/* Struts are recomputed on every geometry change, including each step
+ * of the autohide animation; only write the last value of each frame to
+ * the X server, and only if it differs from what the window manager
+ * already has.
+ */
+static void
+panel_struts_queue_hint (CdkWindow        *window,
+			 PanelOrientation  orientation,
+			 int               strut_size,
+			 int               strut_start,
+			 int               strut_end)
+{
+	PanelStrutHint *hint;
+
+	hint = g_object_get_data (G_OBJECT (window), PANEL_STRUT_HINT_PENDING);
+	if (!hint) {
+		hint = g_new0 (PanelStrutHint, 1);
+		g_object_set_data_full (G_OBJECT (window),
+					PANEL_STRUT_HINT_PENDING,
+					hint, g_free);
+		panel_struts_pending_hints = g_slist_prepend (panel_struts_pending_hints,
+							      g_object_ref (window));
 	}
 
-	g_slist_free (allocated);
+	hint->orientation = orientation;
+	hint->strut_size  = strut_size;
+	hint->strut_start = strut_start;
+	hint->strut_end   = strut_end;
 
-	return toplevel_changed;
+	/* after the resize, before the redraw */
+	if (!panel_struts_flush_id)
+		panel_struts_flush_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE + 15,
+							 panel_struts_flush_hints,
+							 NULL, NULL);
 }
 
 void
@@ -275,7 +281,7 @@ panel_struts_set_window_hint (PanelToplevel *toplevel)
 	}
 
 	scale = ctk_widget_get_scale_factor (widget);
-	strut_size = strut->allocated_strut_size;
+	strut_size = strut->rect.allocated_strut_size;
 
 	screen_width  = WidthOfScreen (cdk_x11_screen_get_xscreen (strut->screen)) / scale;
 	screen_height = HeightOfScreen (cdk_x11_screen_get_xscreen (strut->screen)) / scale;
@@ -292,7 +298,7 @@ panel_struts_set_window_hint (PanelToplevel *toplevel)
                                                   &topmost,
                                                   &bottommost);
 
-	switch (strut->orientation) {
+	switch (strut->rect.orientation) {
 	case PANEL_ORIENTATION_TOP:
 		if (monitor_y > 0)
 			strut_size += monitor_y;
@@ -318,11 +324,11 @@ panel_struts_set_window_hint (PanelToplevel *toplevel)
 		break;
 	}
 
-	panel_xutils_set_strut (ctk_widget_get_window (widget),
-				strut->orientation,
-				strut_size,
-				strut->allocated_strut_start * scale,
-				strut->allocated_strut_end * scale);
+	panel_struts_queue_hint (ctk_widget_get_window (widget),
+				 strut->rect.orientation,
+				 strut_size,
+				 strut->rect.allocated_strut_start * scale,
+				 strut->rect.allocated_strut_end * scale);
 }
 
 void
@@ -333,7 +339,7 @@ panel_struts_unset_window_hint (PanelToplevel *toplevel)
 	if (!ctk_widget_get_realized (CTK_WIDGET (toplevel)))
 		return;
 
-	panel_xutils_set_strut (ctk_widget_get_window (CTK_WIDGET (toplevel)), 0, 0, 0, 0);
+	panel_struts_queue_hint (ctk_widget_get_window (CTK_WIDGET (toplevel)), 0, 0, 0, 0);
 }
 
 static inline int
@@ -392,19 +398,39 @@ panel_struts_compare (const PanelStrut *s1,
 	if (s1_depth != s2_depth)
 		return s2_depth - s1_depth;
 
-        if (s1->orientation != s2->orientation)
-                return orientation_to_order (s1->orientation) -
-			orientation_to_order (s2->orientation);
+        if (s1->rect.orientation != s2->rect.orientation)
+                return orientation_to_order (s1->rect.orientation) -
+			orientation_to_order (s2->rect.orientation);
 
-        if (s1->strut_start != s2->strut_start)
-                return s1->strut_start - s2->strut_start;
+        if (s1->rect.strut_start != s2->rect.strut_start)
+                return s1->rect.strut_start - s2->rect.strut_start;
 
-        if (s1->strut_end != s2->strut_end)
-                return s2->strut_end - s1->strut_end;
+        if (s1->rect.strut_end != s2->rect.strut_end)
+                return s2->rect.strut_end - s1->rect.strut_end;
 
         return 0;
 }
 
+static void
+panel_struts_insert_sorted (GPtrArray  *struts,
+			    PanelStrut *strut)
+{
+	guint lo, hi;
+
+	lo = 0;
+	hi = struts->len;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (panel_struts_compare (g_ptr_array_index (struts, mid), strut) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	g_ptr_array_insert (struts, lo, strut);
+}
+
 gboolean
 panel_struts_register_strut (PanelToplevel    *toplevel,
 			     CdkScreen        *screen,
@@ -415,9 +441,12 @@ panel_struts_register_strut (PanelToplevel    *toplevel,
 			     int               strut_end,
 			     gint              scale)
 {
-	PanelStrut *strut;
-	gboolean    new_strut = FALSE;
-	int         monitor_x, monitor_y, monitor_width, monitor_height;
+	PanelStrut   *strut;
+	gboolean      new_strut = FALSE;
+	int           old_monitor = -1;
+	CdkScreen    *old_screen = NULL;
+	gboolean      changed;
+	CdkRectangle  monitor_geometry;
 
 	g_return_val_if_fail (CDK_IS_X11_DISPLAY (ctk_widget_get_display (CTK_WIDGET (toplevel))), FALSE);
 
@@ -425,69 +454,50 @@ panel_struts_register_strut (PanelToplevel    *toplevel,
 		strut = g_new0 (PanelStrut, 1);
 		new_strut = TRUE;
 
-	} else if (strut->toplevel    == toplevel    &&
-		   strut->orientation == orientation &&
-		   strut->screen      == screen      &&
-		   strut->monitor     == monitor     &&
-		   strut->strut_size  == strut_size  &&
-		   strut->strut_start == strut_start &&
-		   strut->strut_end   == strut_end)
+	} else if (strut->toplevel         == toplevel    &&
+		   strut->rect.orientation == orientation &&
+		   strut->screen           == screen      &&
+		   strut->monitor          == monitor     &&
+		   strut->rect.strut_size  == strut_size  &&
+		   strut->rect.strut_start == strut_start &&
+		   strut->rect.strut_end   == strut_end)
 		return FALSE;
 
-	strut->toplevel    = toplevel;
-	strut->orientation = orientation;
-	strut->screen      = screen;
-	strut->monitor     = monitor;
-	strut->strut_size  = strut_size;
-	strut->strut_start = strut_start;
-	strut->strut_end   = strut_end;
+	if (!new_strut) {
+		old_monitor = strut->monitor;
+		old_screen  = strut->screen;
+		g_ptr_array_remove (panel_struts_get_monitor_struts (old_monitor, FALSE), strut);
+	}
+
+	strut->toplevel         = toplevel;
+	strut->rect.orientation = orientation;
+	strut->screen           = screen;
+	strut->monitor          = monitor;
+	strut->rect.strut_size  = strut_size;
+	strut->rect.strut_start = strut_start;
+	strut->rect.strut_end   = strut_end;
 
 	panel_struts_get_monitor_geometry (monitor,
-					   &monitor_x, &monitor_y,
-					   &monitor_width, &monitor_height);
+					   &monitor_geometry.x, &monitor_geometry.y,
+					   &monitor_geometry.width, &monitor_geometry.height);
 
-	switch (strut->orientation) {
-	case PANEL_ORIENTATION_TOP:
-		strut->geometry.x      = strut->strut_start;
-		strut->geometry.y      = monitor_y;
-		strut->geometry.width  = strut->strut_end - strut->strut_start + 1;
-		strut->geometry.height = strut->strut_size / scale;
-		if (scale > 1)
-			strut->geometry.width -= (strut->strut_size / scale);
-		break;
-	case PANEL_ORIENTATION_BOTTOM:
-		strut->geometry.x      = strut->strut_start;
-		strut->geometry.y      = monitor_y + monitor_height - strut->strut_size;
-		strut->geometry.width  = strut->strut_end - strut->strut_start + 1;
-		strut->geometry.height = strut->strut_size / scale;
-		if (scale > 1)
-			strut->geometry.width -= (strut->strut_size / scale);
-		break;
-	case PANEL_ORIENTATION_LEFT:
-		strut->geometry.x      = monitor_x;
-		strut->geometry.y      = strut->strut_start;
-		strut->geometry.width  = strut->strut_size / scale;
-		strut->geometry.height = strut->strut_end - strut->strut_start + 1;
-		if (scale > 1)
-			strut->geometry.height -= (strut->strut_size / scale);
-		break;
-	case PANEL_ORIENTATION_RIGHT:
-		strut->geometry.x      = monitor_x + monitor_width - strut->strut_size;
-		strut->geometry.y      = strut->strut_start;
-		strut->geometry.width  = strut->strut_size / scale;
-		strut->geometry.height = strut->strut_end - strut->strut_start + 1;
-		if (scale > 1)
-			strut->geometry.height -= (strut->strut_size / scale);
-		break;
+	panel_strut_rect_set_geometry (&strut->rect, &monitor_geometry, scale);
+
+	if (new_strut) {
+		if (!panel_struts_table)
+			panel_struts_table = g_hash_table_new (g_direct_hash, g_direct_equal);
+		g_hash_table_insert (panel_struts_table, toplevel, strut);
 	}
 
-	if (new_strut)
-		panel_struts_list = g_slist_append (panel_struts_list, strut);
+	panel_struts_insert_sorted (panel_struts_get_monitor_struts (monitor, TRUE), strut);
+
+	changed = panel_struts_allocate_struts (toplevel, screen, monitor);
 
-	panel_struts_list = g_slist_sort (panel_struts_list,
-					  (GCompareFunc) panel_struts_compare);
+	/* the panels left behind may now be able to move back */
+	if (!new_strut && (old_monitor != monitor || old_screen != screen))
+		panel_struts_allocate_struts (toplevel, old_screen, old_monitor);
 
-	return panel_struts_allocate_struts (toplevel, screen, monitor);
+	return changed;
 }
 
 void
@@ -505,7 +515,8 @@ panel_struts_unregister_strut (PanelToplevel *toplevel)
 	screen  = strut->screen;
 	monitor = strut->monitor;
 
-	panel_struts_list = g_slist_remove (panel_struts_list, strut);
+	g_hash_table_remove (panel_struts_table, toplevel);
+	g_ptr_array_remove (panel_struts_get_monitor_struts (monitor, FALSE), strut);
 	g_free (strut);
 
 	panel_struts_allocate_struts (toplevel, screen, monitor);
@@ -527,13 +538,13 @@ panel_struts_update_toplevel_geometry (PanelToplevel *toplevel,
 	if (!(strut = panel_struts_find_strut (toplevel)))
 		return FALSE;
 
-	*x += strut->allocated_geometry.x - strut->geometry.x;
-	*y += strut->allocated_geometry.y - strut->geometry.y;
+	*x += strut->rect.allocated_geometry.x - strut->rect.geometry.x;
+	*y += strut->rect.allocated_geometry.y - strut->rect.geometry.y;
 
 	if (width != NULL && *width != -1)
-		*width  += strut->allocated_geometry.width  - strut->geometry.width;
+		*width  += strut->rect.allocated_geometry.width  - strut->rect.geometry.width;
 	if (height != NULL && *height != -1)
-		*height += strut->allocated_geometry.height - strut->geometry.height;
+		*height += strut->rect.allocated_geometry.height - strut->rect.geometry.height;
 
 	return TRUE;
 }
@@ -51,6 +51,7 @@
 #include "panel-config-global.h"
 #include "panel-lockdown.h"
 #include "panel-schemas.h"
+#include "panel-stats.h"
 
 #ifdef HAVE_X11
 #include "xstuff.h"
@@ -89,6 +90,8 @@ struct _PanelToplevelPrivate {
 
 	gboolean                expand;
 	PanelOrientation        orientation;
+	/* the orientation the style classes are set for, 0 for none */
+	PanelOrientation        style_orientation;
 	int                     size;
 	gint                    scale;
 
@@ -262,6 +265,11 @@ update_style_classes (PanelToplevel *toplevel)
 {
 	CtkStyleContext *context;
 
+	if (toplevel->priv->style_orientation == toplevel->priv->orientation)
+		return;
+
+	toplevel->priv->style_orientation = toplevel->priv->orientation;
+
 	context = ctk_widget_get_style_context (CTK_WIDGET (toplevel));
 
 	/*ensure the panel BG can always be themed*/
@@ -3178,6 +3186,8 @@ panel_toplevel_size_request (CtkWidget      *widget,
 	toplevel = PANEL_TOPLEVEL (widget);
 	bin = CTK_BIN (widget);
 
+	panel_stats_count (toplevel, PANEL_STATS_SIZE_REQUESTS);
+
 	/* we get a size request when there are new monitors, so first try to
 	 * see if we need to move to a new monitor */
 	panel_toplevel_update_monitor (toplevel);
@@ -3271,6 +3281,8 @@ panel_toplevel_size_allocate (CtkWidget     *widget,
 	CtkAllocation    challoc;
 	CtkAllocation    child_allocation;
 
+	panel_stats_count (toplevel, PANEL_STATS_ALLOCATIONS);
+
 	ctk_widget_set_allocation (widget, allocation);
 
 	if (toplevel->priv->expand ||
@@ -3348,11 +3360,15 @@ static gboolean panel_toplevel_draw(CtkWidget* widget, cairo_t* cr)
 	if (!ctk_widget_is_drawable (widget))
 		return retval;
 
+	panel_stats_count (toplevel, PANEL_STATS_DRAWS);
+
 	if (CTK_WIDGET_CLASS (panel_toplevel_parent_class)->draw)
 		retval = CTK_WIDGET_CLASS (panel_toplevel_parent_class)->draw (widget, cr);
 
+	/* the edges only make room for the handles: the toplevels never
+	 * drew a bevel, panel_frame_draw() used to read the edges of a
+	 * PanelFrame and found none here */
 	edges = toplevel->priv->edges;
-	panel_frame_draw (widget, cr, edges);
 
 	if (toplevel->priv->expand ||
 	    toplevel->priv->buttons_enabled ||
@@ -4724,6 +4740,7 @@ static void
 background_changed (PanelBackground *background G_GNUC_UNUSED,
 		    PanelToplevel   *toplevel)
 {
+	panel_stats_count (toplevel, PANEL_STATS_BACKGROUND_CHANGES);
 	panel_toplevel_update_edges (toplevel);
 	panel_widget_emit_background_changed (toplevel->priv->panel_widget);
 }
@@ -5051,9 +5068,10 @@ panel_toplevel_set_orientation (PanelToplevel    *toplevel,
 	}
 
 	toplevel->priv->orientation = orientation;
-	update_style_classes (toplevel);
 
-	ctk_widget_reset_style (CTK_WIDGET (toplevel));
+	/* adding and removing classes already invalidates the style of
+	 * the toplevel and of whatever depends on them below it */
+	update_style_classes (toplevel);
 
 	panel_toplevel_update_hide_buttons (toplevel);
 
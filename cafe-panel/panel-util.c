@@ -804,7 +804,7 @@ panel_util_get_gfile_root (GFile *file)
 	return parent_old;
 }
 
-static char *
+char *
 panel_util_get_icon_name_from_g_icon (GIcon *gicon)
 {
 	const char * const *names;
@@ -1042,8 +1042,6 @@ panel_util_get_label_for_uri (const char *text_uri)
 {
 	GFile *file;
 	char  *label;
-	GFile *root;
-	char  *root_display;
 
 	/* Here's what we do:
 	 *  + x-baul-search: URI
@@ -1067,10 +1065,29 @@ panel_util_get_label_for_uri (const char *text_uri)
 	file = g_file_new_for_uri (text_uri);
 
 	label = panel_util_get_file_display_name_if_mount (file);
-	if (label) {
-		g_object_unref (file);
+	g_object_unref (file);
+
+	if (label)
 		return label;
-	}
+
+	return panel_util_get_label_for_uri_no_mount (text_uri);
+}
+
+/* Same as panel_util_get_label_for_uri(), without the mount lookup: the
+ * volume monitor may only be used from the main thread, while this can
+ * be called from any thread. */
+char *
+panel_util_get_label_for_uri_no_mount (const char *text_uri)
+{
+	GFile *file;
+	char  *label;
+	GFile *root;
+	char  *root_display;
+
+	if (g_str_has_prefix (text_uri, "x-baul-search:"))
+		return g_strdup (_("Search"));
+
+	file = g_file_new_for_uri (text_uri);
 
 	if (g_str_has_prefix (text_uri, "file:")) {
 		label = panel_util_get_file_display_for_common_files (file);
@@ -1128,7 +1145,6 @@ panel_util_get_icon_for_uri (const char *text_uri)
 {
 	const char *icon;
 	GFile      *file;
-	GFileInfo  *info;
 	GIcon      *gicon;
 	char       *retval;
 
@@ -1157,9 +1173,47 @@ panel_util_get_icon_for_uri (const char *text_uri)
 	file = g_file_new_for_uri (text_uri);
 
 	retval = panel_util_get_file_icon_name_if_mount (file);
+	g_object_unref (file);
 	if (retval)
 		return retval;
 
+	gicon = NULL;
+	retval = panel_util_get_icon_for_uri_no_mount (text_uri, &gicon);
+	if (retval || !gicon)
+		return retval;
+
+	retval = panel_util_get_icon_name_from_g_icon (gicon);
+	g_object_unref (gicon);
+
+	return retval;
+}
+
+/* Same as panel_util_get_icon_for_uri(), without the mount lookup, so
+ * that it can be called from any thread. When the URI has no fixed
+ * icon, the icon of the file is returned in @gicon instead: finding a
+ * name for it needs the icon theme, which belongs to the main thread. */
+char *
+panel_util_get_icon_for_uri_no_mount (const char  *text_uri,
+				      GIcon      **gicon)
+{
+	const char *icon;
+	GFile      *file;
+	GFileInfo  *info;
+
+	*gicon = NULL;
+
+	/* this only checks file: URI */
+	icon = panel_util_get_icon_for_uri_known_folders (text_uri);
+	if (icon)
+		return g_strdup (icon);
+
+	if (g_str_has_prefix (text_uri, "x-baul-search:"))
+		return g_strdup (PANEL_ICON_SAVED_SEARCH);
+	if (g_str_has_prefix (text_uri, "burn:"))
+		return g_strdup (PANEL_ICON_BURNER);
+
+	file = g_file_new_for_uri (text_uri);
+
 	/* gvfs doesn't give us a nice icon for subfolders of the trash, so
 	 * overriding */
 	if (g_str_has_prefix (text_uri, "trash:")) {
@@ -1177,11 +1231,11 @@ panel_util_get_icon_for_uri (const char *text_uri)
 	if (!info)
 		return NULL;
 
-	gicon = g_file_info_get_icon (info);
-	retval = panel_util_get_icon_name_from_g_icon (gicon);
+	if (g_file_info_get_icon (info))
+		*gicon = g_object_ref (g_file_info_get_icon (info));
 	g_object_unref (info);
 
-	return retval;
+	return NULL;
 }
 
 static gboolean
@@ -59,7 +59,11 @@ char *guess_icon_from_exec (CtkIconTheme *icon_theme,
 
 const char *panel_util_get_vfs_method_display_name (const char *method);
 char *panel_util_get_label_for_uri (const char *text_uri);
+char *panel_util_get_label_for_uri_no_mount (const char *text_uri);
 char *panel_util_get_icon_for_uri (const char *text_uri);
+char *panel_util_get_icon_for_uri_no_mount (const char  *text_uri,
+					    GIcon      **gicon);
+char *panel_util_get_icon_name_from_g_icon (GIcon *gicon);
 
 void panel_util_set_tooltip_text (CtkWidget  *widget,
 				  const char *text);
@@ -103,10 +103,180 @@ static gboolean panel_widget_push_applet_left  (PanelWidget *panel,
 /************************
  convenience functions
  ************************/
-static int
-applet_data_compare (AppletData *ad1, AppletData *ad2)
+/* panel->applet_index holds the links of panel->applet_list in the
+ * same order, so that applets can be looked up by position with a
+ * binary search instead of walking the list (or the panel pixel by
+ * pixel). It is updated along with the list: the links that are
+ * added, removed or moved are found with a binary search too. */
+#define APPLET_INDEX_LINK(index, i) ((GList *) g_ptr_array_index ((index), (i)))
+#define APPLET_INDEX_DATA(index, i) ((AppletData *) APPLET_INDEX_LINK ((index), (i))->data)
+
+/* returns the number of applets starting at or before pos, looking at
+ * either the constrained or the requested positions. The list is sorted
+ * on the start of the applets, but not on their end: packed applets
+ * may overlap, so an applet before the result can still reach pos. */
+static guint
+applet_index_search (GPtrArray *index,
+		     int        pos,
+		     gboolean   constrained)
+{
+	guint lo = 0;
+	guint hi = index->len;
+
+	while (lo < hi) {
+		guint       mid = lo + (hi - lo) / 2;
+		AppletData *ad = APPLET_INDEX_DATA (index, mid);
+		int         start;
+
+		start = constrained ? ad->constrained : ad->pos;
+		if (start <= pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* returns the first applet that may end after pos, to start a walk to
+ * the right from there. Once allocated, the constrained applets do not
+ * overlap, so their ends are sorted like their starts; an applet that
+ * grew since the last allocation may be missed, until the allocation
+ * pushes its neighbours away. */
+static guint
+applet_index_search_end (GPtrArray *index,
+			 int        pos)
+{
+	guint i;
+
+	for (i = applet_index_search (index, pos, TRUE); i > 0; i--) {
+		AppletData *ad = APPLET_INDEX_DATA (index, i - 1);
+
+		if (ad->constrained + ad->cells <= pos)
+			break;
+	}
+
+	return i;
+}
+
+/* the position of @link in the index; the applet must not have been
+ * moved yet, or the index would not be sorted any more */
+static guint
+applet_index_find (PanelWidget *panel,
+		   GList       *link)
+{
+	GPtrArray  *index = panel->applet_index;
+	AppletData *ad = link->data;
+	guint       i;
+
+	for (i = applet_index_search (index, ad->pos, FALSE); i > 0; i--) {
+		if (APPLET_INDEX_LINK (index, i - 1) == link)
+			return i - 1;
+		if (APPLET_INDEX_DATA (index, i - 1)->pos != ad->pos)
+			break;
+	}
+
+	/* only if the list was not sorted */
+	for (i = 0; i < index->len; i++) {
+		if (APPLET_INDEX_LINK (index, i) == link)
+			return i;
+	}
+
+	g_assert_not_reached ();
+	return 0;
+}
+
+static void
+applet_index_remove (PanelWidget *panel,
+		     GList       *link)
+{
+	g_ptr_array_remove_index (panel->applet_index,
+				  applet_index_find (panel, link));
+}
+
+/* @link has been put back in the list: put it back in the index
+ * after the applet before it */
+static void
+applet_index_insert (PanelWidget *panel,
+		     GList       *link)
 {
-	return ad1->pos - ad2->pos;
+	guint i;
+
+	i = link->prev ? applet_index_find (panel, link->prev) + 1 : 0;
+	g_ptr_array_insert (panel->applet_index, i, link);
+}
+
+/* the applets at i and i + 1 have been swapped in the list */
+static void
+applet_index_swap (PanelWidget *panel,
+		   guint        i)
+{
+	gpointer *pdata = panel->applet_index->pdata;
+	gpointer  tmp;
+
+	tmp = pdata [i];
+	pdata [i] = pdata [i + 1];
+	pdata [i + 1] = tmp;
+}
+
+/* inserts the detached @link in the list and the index, before the
+ * applets starting at or after its position, as g_list_insert_sorted()
+ * on ad->pos would */
+static void
+applet_index_insert_sorted (PanelWidget *panel,
+			    GList       *link)
+{
+	GPtrArray  *index = panel->applet_index;
+	AppletData *ad = link->data;
+	guint       i;
+
+	i = applet_index_search (index, ad->pos - 1, FALSE);
+	if (i < index->len)
+		panel->applet_list = panel_g_list_insert_before (panel->applet_list,
+								 APPLET_INDEX_LINK (index, i),
+								 link);
+	else if (i > 0)
+		panel->applet_list = panel_g_list_insert_after (panel->applet_list,
+								APPLET_INDEX_LINK (index, i - 1),
+								link);
+	else
+		panel->applet_list = link;
+
+	g_ptr_array_insert (index, i, link);
+}
+
+static GList *
+panel_widget_find_applet_link (PanelWidget *panel,
+			       AppletData  *ad)
+{
+	GPtrArray *index;
+	guint      i;
+
+	index = panel->applet_index;
+	for (i = applet_index_search (index, ad->pos, FALSE); i > 0; i--) {
+		AppletData *other = APPLET_INDEX_DATA (index, i - 1);
+
+		if (other == ad)
+			return APPLET_INDEX_LINK (index, i - 1);
+		if (other->pos != ad->pos)
+			break;
+	}
+
+	return g_list_find (panel->applet_list, ad);
+}
+
+static void
+panel_widget_remove_applet_data (PanelWidget *panel,
+				 AppletData  *ad)
+{
+	GList *link;
+
+	link = panel_widget_find_applet_link (panel, ad);
+	if (!link)
+		return;
+
+	applet_index_remove (panel, link);
+	panel->applet_list = g_list_delete_link (panel->applet_list, link);
 }
 
 static void
@@ -592,7 +762,7 @@ panel_widget_cremove (CtkContainer *container, CtkWidget *widget)
 		(* CTK_CONTAINER_CLASS (panel_widget_parent_class)->remove) (container,
 								widget);
 	if (ad)
-		panel->applet_list = g_list_remove (panel->applet_list, ad);
+		panel_widget_remove_applet_data (panel, ad);
 
 	g_signal_emit (G_OBJECT (container),
 		       panel_widget_signals[APPLET_REMOVED_SIGNAL],
@@ -606,18 +776,28 @@ static GList *
 get_applet_list_pos (PanelWidget *panel,
 		     int          pos)
 {
-	GList *l;
+	GPtrArray *index;
+	guint      i, n;
 
 	g_return_val_if_fail (PANEL_IS_WIDGET (panel), NULL);
 
-	for (l = panel->applet_list; l; l = l->next) {
-		AppletData *ad = l->data;
+	index = panel->applet_index;
+	n = applet_index_search (index, pos, FALSE);
 
-		if (ad->pos <= pos) {
-		       if (ad->pos + ad->cells > pos)
-			       return l;
-		} else
-			return NULL;
+	/* usually the last applet starting before pos is the one */
+	if (n > 0) {
+		AppletData *ad = APPLET_INDEX_DATA (index, n - 1);
+
+		if (ad->pos + ad->cells > pos)
+			return APPLET_INDEX_LINK (index, n - 1);
+	}
+
+	/* the search missed: an applet further back may overlap pos */
+	for (i = 0; i < n; i++) {
+		AppletData *ad = APPLET_INDEX_DATA (index, i);
+
+		if (ad->pos + ad->cells > pos)
+			return APPLET_INDEX_LINK (index, i);
 	}
 
 	return NULL;
@@ -638,7 +818,7 @@ panel_widget_is_applet_stuck (PanelWidget *panel_widget,
 		GList *applet_list, *l;
 		int    end_pos = -1;
 
-		applet_list = g_list_find (panel_widget->applet_list, applet);
+		applet_list = panel_widget_find_applet_link (panel_widget, applet);
 
 		for (l = applet_list; l; l = l->next) {
 			applet = l->data;
@@ -704,9 +884,11 @@ panel_widget_jump_applet_right (PanelWidget *panel,
 	}
 
  jump_right:
+	applet_index_remove (panel, list);
 	ad->pos = ad->constrained = pos;
 	panel->applet_list = g_list_remove_link (panel->applet_list, list);
 	panel->applet_list = panel_g_list_insert_before (panel->applet_list, next, list);
+	applet_index_insert (panel, list);
 	ctk_widget_queue_resize (CTK_WIDGET (panel));
 	emit_applet_moved (panel, ad);
 }
@@ -717,6 +899,7 @@ panel_widget_switch_applet_right (PanelWidget *panel,
 {
 	AppletData *ad;
 	AppletData *nad = NULL;
+	guint       i;
 
 	g_assert (list != NULL);
 
@@ -742,9 +925,11 @@ panel_widget_switch_applet_right (PanelWidget *panel,
 		return;
 	}
 
+	i = applet_index_find (panel, list);
 	nad->constrained = nad->pos = ad->constrained;
 	ad->constrained = ad->pos = ad->constrained + nad->min_cells;
 	panel->applet_list = panel_g_list_swap_next (panel->applet_list, list);
+	applet_index_swap (panel, i);
 
 	ctk_widget_queue_resize (CTK_WIDGET (panel));
 
@@ -780,9 +965,11 @@ panel_widget_jump_applet_left (PanelWidget *panel,
 	}
 
  jump_left:
+	applet_index_remove (panel, list);
 	ad->pos = ad->constrained = pos;
 	panel->applet_list = g_list_remove_link (panel->applet_list, list);
 	panel->applet_list = panel_g_list_insert_after (panel->applet_list, prev, list);
+	applet_index_insert (panel, list);
 	ctk_widget_queue_resize (CTK_WIDGET (panel));
 	emit_applet_moved (panel, ad);
 }
@@ -793,6 +980,7 @@ panel_widget_switch_applet_left (PanelWidget *panel,
 {
 	AppletData *ad;
 	AppletData *pad = NULL;
+	guint       i;
 
 	ad = list->data;
 	if (ad->constrained <= 0)
@@ -816,9 +1004,11 @@ panel_widget_switch_applet_left (PanelWidget *panel,
 		return;
 	}
 
+	i = applet_index_find (panel, list);
 	ad->constrained = ad->pos = pad->constrained;
 	pad->constrained = pad->pos = ad->constrained + ad->min_cells;
 	panel->applet_list = panel_g_list_swap_prev (panel->applet_list, list);
+	applet_index_swap (panel, i - 1);
 
 	ctk_widget_queue_resize (CTK_WIDGET (panel));
 
@@ -1132,7 +1322,7 @@ panel_widget_push_move (PanelWidget *panel,
 	if (moveby == 0)
 		return;
 
-	list = g_list_find (panel->applet_list, ad);
+	list = panel_widget_find_applet_link (panel, ad);
 	g_return_if_fail (list != NULL);
 
 	finalpos = ad->constrained + moveby;
@@ -1610,6 +1800,7 @@ panel_widget_finalize (GObject *obj)
 		g_free (panel->applets_using_hint);
 	panel->applets_using_hint = NULL;
 
+	g_ptr_array_unref (panel->applet_index);
 
 	G_OBJECT_CLASS (panel_widget_parent_class)->finalize (obj);
 }
@@ -1679,6 +1870,7 @@ panel_widget_init (PanelWidget *panel)
 	panel->orient        = CTK_ORIENTATION_HORIZONTAL;
 	panel->size          = 0;
 	panel->applet_list   = NULL;
+	panel->applet_index  = g_ptr_array_new ();
 	panel->master_widget = NULL;
 	panel->drop_widget   = widget;
 	panel->open_dialogs  = NULL;
@@ -1890,51 +2082,16 @@ panel_widget_get_moveby (PanelWidget *panel, int pos, int offset)
 	return panel_widget_get_cursorloc (panel) - offset - pos;
 }
 
-static GList *
-walk_up_to (int pos, GList *list)
-{
-	AppletData *ad;
-
-	g_return_val_if_fail (list != NULL, NULL);
-
-	ad = list->data;
-
-	if (ad->constrained <= pos &&
-	    ad->constrained + ad->cells > pos)
-		return list;
-	while (list->next != NULL &&
-	       ad->constrained + ad->cells <= pos) {
-		list = list->next;
-		ad = list->data;
-	}
-	while (list->prev != NULL &&
-	       ad->constrained > pos) {
-		list = list->prev;
-		ad = list->data;
-	}
-	return list;
-}
-
-static CtkWidget *
-is_in_applet (int pos, AppletData *ad)
-{
-	g_return_val_if_fail (ad != NULL, NULL);
-
-	if (ad->constrained <= pos &&
-	    ad->constrained + ad->cells > pos)
-		return ad->applet;
-	return NULL;
-}
-
 static int
 panel_widget_get_free_spot (PanelWidget *panel,
 			    AppletData  *ad,
 			    int          place)
 {
-	int i, e;
+	GPtrArray *index;
+	int i, limit;
+	int cursor;
 	int start;
 	int right = -1, left = -1;
-	GList *list;
 
 	g_return_val_if_fail (PANEL_IS_WIDGET (panel), -1);
 	g_return_val_if_fail (ad != NULL, -1);
@@ -1949,45 +2106,38 @@ panel_widget_get_free_spot (PanelWidget *panel,
 			return place;
 	}
 
-	list = panel->applet_list;
+	index = panel->applet_index;
 
-	start = place - ad->drag_off;
-	if (start < 0)
-		start = 0;
-	for (e = 0, i = start; i < panel->size; i++) {
-		CtkWidget *applet;
-		list = walk_up_to (i, list);
-		applet = is_in_applet (i, list->data);
-		if (applet == NULL ||
-		    applet == ad->applet) {
-			e++;
-			if (e >= ad->min_cells) {
-				right = i - e + 1;
-				break;
-			}
-		} else {
-			e = 0;
-		}
-	}
+	/* walk the gaps between applets rather than the pixels, the
+	 * dragged applet itself counting as free space */
+	cursor = MAX (place - ad->drag_off, 0);
+	for (i = (int) applet_index_search_end (index, cursor); i < (int) index->len; i++) {
+		AppletData *other = APPLET_INDEX_DATA (index, i);
 
-	start = place + ad->drag_off;
-	if (start >= panel->size)
-		start = panel->size - 1;
-	for (e = 0, i = start; i >= 0; i--) {
-		CtkWidget *applet;
-		list = walk_up_to (i, list);
-		applet = is_in_applet (i, list->data);
-		if (applet == NULL ||
-		    applet == ad->applet) {
-			e++;
-			if (e >= ad->min_cells) {
-				left = i;
-				break;
-			}
-		} else {
-			e=0;
-		}
+		if (other == ad)
+			continue;
+		if (other->constrained - cursor >= ad->min_cells)
+			break;
+		cursor = MAX (cursor, other->constrained + other->cells);
 	}
+	limit = i < (int) index->len ? APPLET_INDEX_DATA (index, i)->constrained : panel->size;
+	if (MIN (limit, panel->size) - cursor >= ad->min_cells)
+		right = cursor;
+
+	/* cursor is the end of the free space here, exclusive */
+	cursor = MIN (place + ad->drag_off, panel->size - 1) + 1;
+	for (i = (int) applet_index_search (index, cursor - 1, TRUE) - 1; i >= 0; i--) {
+		AppletData *other = APPLET_INDEX_DATA (index, i);
+
+		if (other == ad)
+			continue;
+		if (cursor - (other->constrained + other->cells) >= ad->min_cells)
+			break;
+		cursor = MIN (cursor, other->constrained);
+	}
+	limit = i >= 0 ? APPLET_INDEX_DATA (index, i)->constrained + APPLET_INDEX_DATA (index, i)->cells : 0;
+	if (cursor - MAX (limit, 0) >= ad->min_cells)
+		left = cursor - ad->min_cells;
 
 	start = place - ad->drag_off;
 
@@ -2010,6 +2160,8 @@ panel_widget_nice_move (PanelWidget *panel,
 			AppletData  *ad,
 			int          pos)
 {
+	GList *link;
+
 	g_return_if_fail (PANEL_IS_WIDGET (panel));
 	g_return_if_fail (ad != NULL);
 
@@ -2017,11 +2169,13 @@ panel_widget_nice_move (PanelWidget *panel,
 	if (pos < 0 || pos == ad->pos)
 		return;
 
+	link = panel_widget_find_applet_link (panel, ad);
+	applet_index_remove (panel, link);
+	panel->applet_list = g_list_remove_link (panel->applet_list, link);
+
 	ad->pos = ad->constrained = pos;
 
-	panel->applet_list =
-		panel_g_list_resort_item (panel->applet_list, ad,
-					  (GCompareFunc)applet_data_compare);
+	applet_index_insert_sorted (panel, link);
 
 	ctk_widget_queue_resize (CTK_WIDGET (panel));
 
@@ -2365,7 +2519,7 @@ panel_widget_applet_destroy (CtkWidget *applet,
 		if (panel->currently_dragged_applet == ad)
 			panel_widget_applet_drag_end (panel);
 
-		panel->applet_list = g_list_remove (panel->applet_list,ad);
+		panel_widget_remove_applet_data (panel, ad);
 	}
 
 	g_free (ad->size_hints);
@@ -2412,9 +2566,10 @@ bind_top_applet_events (CtkWidget *widget)
 static int
 panel_widget_find_empty_pos(PanelWidget *panel, int pos)
 {
+	GPtrArray *index;
 	int i;
+	int cursor;
 	int right=-1,left=-1;
-	GList *list;
 
 	g_return_val_if_fail(PANEL_IS_WIDGET(panel),-1);
 
@@ -2427,23 +2582,31 @@ panel_widget_find_empty_pos(PanelWidget *panel, int pos)
 	if(!panel->applet_list)
 		return pos;
 
-	list = panel->applet_list;
+	index = panel->applet_index;
+
+	/* skip over the applets touching pos on each side */
+	cursor = pos;
+	for (i = (int) applet_index_search_end (index, cursor); i < (int) index->len; i++) {
+		AppletData *ad = APPLET_INDEX_DATA (index, i);
 
-	for (i = pos; i < panel->size; i++) {
-		list = walk_up_to (i, list);
-		if ( ! is_in_applet (i, list->data)) {
-			right = i;
+		if (ad->constrained > cursor)
 			break;
-		}
+		cursor = MAX (cursor, ad->constrained + ad->cells);
 	}
+	if (cursor < panel->size)
+		right = cursor;
 
-	for(i = pos; i >= 0; i--) {
-		list = walk_up_to (i, list);
-		if ( ! is_in_applet (i, list->data)) {
-			left = i;
+	cursor = pos;
+	for (i = (int) applet_index_search (index, cursor, TRUE) - 1; i >= 0; i--) {
+		AppletData *ad = APPLET_INDEX_DATA (index, i);
+
+		if (ad->constrained > cursor ||
+		    ad->constrained + ad->cells <= cursor)
 			break;
-		}
+		cursor = ad->constrained - 1;
 	}
+	if (cursor >= 0)
+		left = cursor;
 
 	if (left == -1) {
 		if (right == -1)
@@ -2526,9 +2689,7 @@ panel_widget_add (PanelWidget *panel,
 		bind_top_applet_events (applet);
 	}
 
-	panel->applet_list =
-		g_list_insert_sorted(panel->applet_list,ad,
-				     (GCompareFunc)applet_data_compare);
+	applet_index_insert_sorted (panel, g_list_prepend (NULL, ad));
 
 	/*this will get done right on size allocate!*/
 	if(panel->orient == CTK_ORIENTATION_HORIZONTAL)
@@ -2881,19 +3042,31 @@ panel_widget_set_applet_size_hints (PanelWidget *panel,
 	AppletData *ad;
 
 	ad = g_object_get_data (G_OBJECT (applet), CAFE_PANEL_APPLET_DATA);
-	if (!ad)
+	if (!ad) {
+		g_free (size_hints);
 		return;
+	}
 
-	g_free (ad->size_hints);
+	if (size_hints_len <= 0 || (size_hints_len % 2 != 0)) {
+		g_free (size_hints);
+		size_hints = NULL;
+		size_hints_len = 0;
+	}
 
-	if (size_hints_len > 0 && (size_hints_len % 2 == 0)) {
-		ad->size_hints     = size_hints;
-		ad->size_hints_len = size_hints_len;
-	} else {
+	/* Applets resend their hints on every allocation, and a relayout of
+	 * the whole panel is not cheap */
+	if (size_hints_len == (ad->size_hints ? ad->size_hints_len : 0) &&
+	    (size_hints_len == 0 ||
+	     memcmp (size_hints, ad->size_hints, size_hints_len * sizeof (int)) == 0)) {
 		g_free (size_hints);
-		ad->size_hints = NULL;
+		return;
 	}
 
+	g_free (ad->size_hints);
+
+	ad->size_hints     = size_hints;
+	ad->size_hints_len = size_hints_len;
+
 	ctk_widget_queue_resize (CTK_WIDGET (panel));
 }
 
@@ -88,6 +88,7 @@ struct _PanelWidget
 	CtkFixed        fixed;
 
 	GList          *applet_list;
+	GPtrArray      *applet_index;    /* links of applet_list, in order */
 
 	GSList         *open_dialogs;
 
@@ -0,0 +1,161 @@
+/*
+ * test-panel-struts.c: tests for the placement of struts on a monitor
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "panel-struts-layout.h"
+
+static const CdkRectangle monitor = { 0, 0, 1000, 800 };
+
+static void
+init_rect (PanelStrutRect   *rect,
+	   PanelOrientation  orientation,
+	   int               strut_size,
+	   int               strut_start,
+	   int               strut_end)
+{
+	memset (rect, 0, sizeof (PanelStrutRect));
+	rect->orientation = orientation;
+	rect->strut_size  = strut_size;
+	rect->strut_start = strut_start;
+	rect->strut_end   = strut_end;
+
+	panel_strut_rect_set_geometry (rect, &monitor, 1);
+}
+
+static void
+assert_allocated (PanelStrutRect *rect,
+		  int             x,
+		  int             y,
+		  int             width,
+		  int             height)
+{
+	g_assert_cmpint (rect->allocated_geometry.x,      ==, x);
+	g_assert_cmpint (rect->allocated_geometry.y,      ==, y);
+	g_assert_cmpint (rect->allocated_geometry.width,  ==, width);
+	g_assert_cmpint (rect->allocated_geometry.height, ==, height);
+}
+
+static void
+test_geometry (void)
+{
+	PanelStrutRect rect;
+
+	init_rect (&rect, PANEL_ORIENTATION_BOTTOM, 24, 100, 299);
+	g_assert_cmpint (rect.geometry.x,      ==, 100);
+	g_assert_cmpint (rect.geometry.y,      ==, 776);
+	g_assert_cmpint (rect.geometry.width,  ==, 200);
+	g_assert_cmpint (rect.geometry.height, ==, 24);
+
+	init_rect (&rect, PANEL_ORIENTATION_RIGHT, 40, 0, 799);
+	g_assert_cmpint (rect.geometry.x,      ==, 960);
+	g_assert_cmpint (rect.geometry.y,      ==, 0);
+	g_assert_cmpint (rect.geometry.width,  ==, 40);
+	g_assert_cmpint (rect.geometry.height, ==, 800);
+}
+
+/* side by side on the same edge: nothing moves */
+static void
+test_adjacent (void)
+{
+	PanelStrutRect  a, b;
+	PanelStrutRect *rects [] = { &a, &b };
+
+	init_rect (&a, PANEL_ORIENTATION_TOP, 24, 0, 99);
+	init_rect (&b, PANEL_ORIENTATION_TOP, 24, 100, 199);
+
+	panel_strut_rects_allocate (rects, G_N_ELEMENTS (rects), &monitor);
+
+	assert_allocated (&a, 0, 0, 100, 24);
+	assert_allocated (&b, 100, 0, 100, 24);
+	g_assert_cmpint (b.allocated_strut_size, ==, 24);
+}
+
+/* overlapping on the same edge: the second one goes below the first */
+static void
+test_overlapping (void)
+{
+	PanelStrutRect  a, b;
+	PanelStrutRect *rects [] = { &a, &b };
+
+	init_rect (&a, PANEL_ORIENTATION_TOP, 24, 0, 199);
+	init_rect (&b, PANEL_ORIENTATION_TOP, 30, 100, 299);
+
+	panel_strut_rects_allocate (rects, G_N_ELEMENTS (rects), &monitor);
+
+	assert_allocated (&a, 0, 0, 200, 24);
+	assert_allocated (&b, 100, 24, 200, 30);
+	g_assert_cmpint (a.allocated_strut_size, ==, 24);
+	g_assert_cmpint (b.allocated_strut_size, ==, 54);
+}
+
+/* a side panel between a top and a bottom panel is shortened to fit */
+static void
+test_stacked (void)
+{
+	PanelStrutRect  top, bottom, left;
+	PanelStrutRect *rects [] = { &top, &bottom, &left };
+
+	init_rect (&top,    PANEL_ORIENTATION_TOP,    24, 0, 999);
+	init_rect (&bottom, PANEL_ORIENTATION_BOTTOM, 24, 0, 999);
+	init_rect (&left,   PANEL_ORIENTATION_LEFT,   40, 0, 799);
+
+	panel_strut_rects_allocate (rects, G_N_ELEMENTS (rects), &monitor);
+
+	assert_allocated (&top, 0, 0, 1000, 24);
+	assert_allocated (&bottom, 0, 776, 1000, 24);
+	assert_allocated (&left, 0, 24, 40, 752);
+	g_assert_cmpint (left.allocated_strut_size,  ==, 40);
+	g_assert_cmpint (left.allocated_strut_start, ==, 24);
+	g_assert_cmpint (left.allocated_strut_end,   ==, 775);
+}
+
+/* a side panel does not push a top panel around */
+static void
+test_stacked_side_first (void)
+{
+	PanelStrutRect  left, top;
+	PanelStrutRect *rects [] = { &left, &top };
+
+	init_rect (&left, PANEL_ORIENTATION_LEFT, 40, 0, 799);
+	init_rect (&top,  PANEL_ORIENTATION_TOP,  24, 0, 999);
+
+	panel_strut_rects_allocate (rects, G_N_ELEMENTS (rects), &monitor);
+
+	assert_allocated (&left, 0, 0, 40, 800);
+	assert_allocated (&top, 0, 0, 1000, 24);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/struts/geometry", test_geometry);
+	g_test_add_func ("/struts/adjacent", test_adjacent);
+	g_test_add_func ("/struts/overlapping", test_overlapping);
+	g_test_add_func ("/struts/stacked", test_stacked);
+	g_test_add_func ("/struts/stacked-side-first", test_stacked_side_first);
+
+	return g_test_run ();
+}
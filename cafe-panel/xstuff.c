@@ -20,7 +20,6 @@
 #endif
 
 #include <string.h>
-#include <unistd.h>
 
 #include <cdk/cdk.h>
 #include <cdk/cdkx.h>
@@ -36,36 +35,49 @@ static int (* xstuff_old_x_error_handler)   (Display *, XErrorEvent *);
 static gboolean xstuff_display_is_dead = FALSE;
 
 /* Zoom animation */
-#define MINIATURIZE_ANIMATION_FRAMES_Z   1
 #define MINIATURIZE_ANIMATION_STEPS_Z    6
-/* the delay per draw */
-#define MINIATURIZE_ANIMATION_DELAY_Z    10
 
-/* zoom factor, steps and delay if composited (factor must be odd) */
+/* zoom factor and steps if composited (factor must be odd) */
 #define ZOOM_FACTOR 5
 #define ZOOM_STEPS  14
-#define ZOOM_DELAY 10
+
+/* both animations show one step per frame at 60 Hz */
+#define ZOOM_FRAME_TIME (G_USEC_PER_SEC / 60)
 
 gboolean is_using_x11 ()
 {
 	return CDK_IS_X11_DISPLAY (cdk_display_get_default ());
 }
 
+/* Launch feedback, driven by the frame clock of its popup window.  When
+ * composited, the icon grows and fades out; the steps are scaled once
+ * into an atlas, side by side.  Otherwise, a shaped window draws the
+ * outline of a rectangle growing from the launcher to the monitor. */
 typedef struct {
-	int size;
-	int size_start;
-	int size_end;
+	int              n_steps;
+	int              step;
+	gint64           start_time;
+
+	/* composited */
 	PanelOrientation orientation;
-	double opacity;
-	GdkPixbuf *pixbuf;
-	guint timeout_id;
-} CompositedZoomData;
+	cairo_surface_t *atlas;
+	int             *sizes;
+	int             *offsets;
 
-static gboolean
-zoom_timeout (CtkWidget *window)
+	/* outline */
+	CdkRectangle     from;
+	CdkRectangle     to;
+} ZoomAnimation;
+
+static void
+zoom_animation_free (ZoomAnimation *zoom)
 {
-	ctk_widget_queue_draw (window);
-	return TRUE;
+	if (zoom->atlas)
+		cairo_surface_destroy (zoom->atlas);
+	g_free (zoom->sizes);
+	g_free (zoom->offsets);
+
+	g_slice_free (ZoomAnimation, zoom);
 }
 
 static gboolean
@@ -76,109 +88,215 @@ idle_destroy (gpointer data)
 	return FALSE;
 }
 
+static void
+zoom_build_atlas (ZoomAnimation   *zoom,
+		  cairo_surface_t *surface,
+		  int              size_start,
+		  int              size_end)
+{
+	cairo_t *cr;
+	double   x_scale, y_scale;
+	int      width, height;
+	int      total = 0;
+	int      i;
+
+	zoom->sizes   = g_new (int, zoom->n_steps);
+	zoom->offsets = g_new (int, zoom->n_steps);
+
+	for (i = 0; i < zoom->n_steps; i++) {
+		zoom->sizes [i] = size_start + (size_end - size_start) * (i + 1) / zoom->n_steps;
+		zoom->offsets [i] = total;
+		total += zoom->sizes [i];
+	}
+
+	zoom->atlas = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						  total, size_end);
+
+	cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
+	width  = cairo_image_surface_get_width (surface) / x_scale;
+	height = cairo_image_surface_get_height (surface) / y_scale;
+
+	cr = cairo_create (zoom->atlas);
+	for (i = 0; i < zoom->n_steps; i++) {
+		cairo_save (cr);
+		cairo_translate (cr, zoom->offsets [i], 0);
+		cairo_scale (cr,
+			     (double) zoom->sizes [i] / width,
+			     (double) zoom->sizes [i] / height);
+		cairo_set_source_surface (cr, surface, 0, 0);
+		cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_GOOD);
+		cairo_paint (cr);
+		cairo_restore (cr);
+	}
+	cairo_destroy (cr);
+}
+
 static gboolean
-zoom_draw (CtkWidget *widget,
-	     cairo_t *cr,
-	     gpointer        user_data)
+zoom_draw (CtkWidget     *widget,
+	   cairo_t       *cr,
+	   ZoomAnimation *zoom)
 {
-	CompositedZoomData *zoom;
+	int width, height;
+	int size;
+	int x = 0, y = 0;
 
-	zoom = user_data;
+	if (!zoom->atlas) {
+		/* only the outline is left by the shape */
+		cairo_set_source_rgb (cr, 1, 1, 1);
+		cairo_paint (cr);
+		return FALSE;
+	}
 
-	if (zoom->size >= zoom->size_end) {
-		if (zoom->timeout_id)
-			g_source_remove (zoom->timeout_id);
-		zoom->timeout_id = 0;
+	ctk_window_get_size (CTK_WINDOW (widget), &width, &height);
 
-		ctk_widget_hide (widget);
-		g_idle_add (idle_destroy, widget);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_rgba (cr, 0, 0, 0, 0.0);
+	cairo_paint (cr);
 
-		g_object_unref (zoom->pixbuf);
-		zoom->pixbuf = NULL;
+	size = zoom->sizes [zoom->step];
 
-		g_slice_free (CompositedZoomData, zoom);
-	} else {
-		GdkPixbuf *scaled;
-		int width, height;
-		int x = 0, y = 0;
-
-		ctk_window_get_size (CTK_WINDOW (widget), &width, &height);
-
-		zoom->size += MAX ((zoom->size_end - zoom->size_start) / ZOOM_STEPS, 1);
-		zoom->opacity -= 1.0 / ((double) ZOOM_STEPS + 1);
-
-		scaled = gdk_pixbuf_scale_simple (zoom->pixbuf,
-						  zoom->size, zoom->size,
-						  GDK_INTERP_BILINEAR);
-
-		switch (zoom->orientation) {
-		case PANEL_ORIENTATION_TOP:
-			x = (width - gdk_pixbuf_get_width (scaled)) / 2;
-			y = 0;
-			break;
-
-		case PANEL_ORIENTATION_RIGHT:
-			x = width - gdk_pixbuf_get_width (scaled);
-			y = (height - gdk_pixbuf_get_height (scaled)) / 2;
-			break;
-
-		case PANEL_ORIENTATION_BOTTOM:
-			x = (width - gdk_pixbuf_get_width (scaled)) / 2;
-			y = height - gdk_pixbuf_get_height (scaled);
-			break;
-
-		case PANEL_ORIENTATION_LEFT:
-			x = 0;
-			y = (height - gdk_pixbuf_get_height (scaled)) / 2;
-			break;
-		}
+	switch (zoom->orientation) {
+	case PANEL_ORIENTATION_TOP:
+		x = (width - size) / 2;
+		y = 0;
+		break;
 
-		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-		cairo_set_source_rgba (cr, 0, 0, 0, 0.0);
-		cairo_rectangle (cr, 0, 0, width, height);
-		cairo_fill (cr);
+	case PANEL_ORIENTATION_RIGHT:
+		x = width - size;
+		y = (height - size) / 2;
+		break;
 
-		cdk_cairo_set_source_pixbuf (cr, scaled, x, y);
-		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-		cairo_paint_with_alpha (cr, MAX (zoom->opacity, 0));
+	case PANEL_ORIENTATION_BOTTOM:
+		x = (width - size) / 2;
+		y = height - size;
+		break;
 
-		g_object_unref (scaled);
+	case PANEL_ORIENTATION_LEFT:
+		x = 0;
+		y = (height - size) / 2;
+		break;
 	}
 
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+	cairo_rectangle (cr, x, y, size, size);
+	cairo_clip (cr);
+	cairo_set_source_surface (cr, zoom->atlas, x - zoom->offsets [zoom->step], y);
+	cairo_paint_with_alpha (cr, 1.0 - (zoom->step + 1) / ((double) zoom->n_steps + 1));
+
 	return FALSE;
 }
 
+static void
+zoom_outline_update (CtkWidget     *window,
+		     ZoomAnimation *zoom)
+{
+	CdkRectangle    rect;
+	CdkRectangle    inner;
+	cairo_region_t *region;
+	int             n = zoom->n_steps - 1;
+
+	rect.x      = zoom->from.x      + (zoom->to.x      - zoom->from.x)      * zoom->step / n;
+	rect.y      = zoom->from.y      + (zoom->to.y      - zoom->from.y)      * zoom->step / n;
+	rect.width  = zoom->from.width  + (zoom->to.width  - zoom->from.width)  * zoom->step / n;
+	rect.height = zoom->from.height + (zoom->to.height - zoom->from.height) * zoom->step / n;
+
+	rect.width  = MAX (rect.width, 3);
+	rect.height = MAX (rect.height, 3);
+
+	inner.x      = 1;
+	inner.y      = 1;
+	inner.width  = rect.width - 2;
+	inner.height = rect.height - 2;
+
+	ctk_window_move (CTK_WINDOW (window), rect.x, rect.y);
+	ctk_window_resize (CTK_WINDOW (window), rect.width, rect.height);
+
+	rect.x = 0;
+	rect.y = 0;
+	region = cairo_region_create_rectangle (&rect);
+	cairo_region_subtract_rectangle (region, &inner);
+	ctk_widget_shape_combine_region (window, region);
+	cairo_region_destroy (region);
+}
+
+static gboolean
+zoom_tick (CtkWidget     *window,
+	   CdkFrameClock *frame_clock,
+	   gpointer       user_data)
+{
+	ZoomAnimation *zoom = user_data;
+	gint64         now;
+	int            step;
+
+	now = cdk_frame_clock_get_frame_time (frame_clock);
+	if (!zoom->start_time)
+		zoom->start_time = now;
+
+	step = (now - zoom->start_time) / ZOOM_FRAME_TIME;
+
+	if (step >= zoom->n_steps) {
+		ctk_widget_hide (window);
+		g_idle_add (idle_destroy, window);
+		return G_SOURCE_REMOVE;
+	}
+
+	if (step != zoom->step) {
+		zoom->step = step;
+
+		if (zoom->atlas)
+			ctk_widget_queue_draw (window);
+		else
+			zoom_outline_update (window, zoom);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static CtkWidget *
+zoom_window_new (CdkScreen     *gscreen,
+		 ZoomAnimation *zoom)
+{
+	CtkWidget *win;
+
+	win = ctk_window_new (CTK_WINDOW_POPUP);
+
+	ctk_window_set_screen (CTK_WINDOW (win), gscreen);
+	ctk_window_set_keep_above (CTK_WINDOW (win), TRUE);
+	ctk_window_set_decorated (CTK_WINDOW (win), FALSE);
+	ctk_widget_set_app_paintable (win, TRUE);
+	ctk_window_set_gravity (CTK_WINDOW (win), CDK_GRAVITY_STATIC);
+
+	g_object_set_data_full (G_OBJECT (win), "zoom-animation", zoom,
+				(GDestroyNotify) zoom_animation_free);
+
+	g_signal_connect (G_OBJECT (win), "draw",
+			  G_CALLBACK (zoom_draw), zoom);
+	ctk_widget_add_tick_callback (win, zoom_tick, zoom, NULL);
+
+	return win;
+}
+
 static void
 draw_zoom_animation_composited (CdkScreen *gscreen,
 				int x, int y, int w, int h,
-				GdkPixbuf *pixbuf,
+				cairo_surface_t *surface,
 				PanelOrientation orientation)
 {
 	CtkWidget *win;
-	CompositedZoomData *zoom;
+	ZoomAnimation *zoom;
 	int wx = 0, wy = 0;
 
 	w += 2;
 	h += 2;
 
-	zoom = g_slice_new (CompositedZoomData);
-	zoom->size = w;
-	zoom->size_start = w;
-	zoom->size_end = w * ZOOM_FACTOR;
+	zoom = g_slice_new0 (ZoomAnimation);
+	zoom->n_steps = ZOOM_STEPS;
 	zoom->orientation = orientation;
-	zoom->opacity = 1.0;
-	zoom->pixbuf = g_object_ref (pixbuf);
-	zoom->timeout_id = 0;
+	zoom_build_atlas (zoom, surface, w, w * ZOOM_FACTOR);
 
-	win = ctk_window_new (CTK_WINDOW_POPUP);
+	win = zoom_window_new (gscreen, zoom);
 
-	ctk_window_set_screen (CTK_WINDOW (win), gscreen);
-	ctk_window_set_keep_above (CTK_WINDOW (win), TRUE);
-	ctk_window_set_decorated (CTK_WINDOW (win), FALSE);
-	ctk_widget_set_app_paintable(win, TRUE);
 	ctk_widget_set_visual (win, cdk_screen_get_rgba_visual (gscreen));
-
-	ctk_window_set_gravity (CTK_WINDOW (win), CDK_GRAVITY_STATIC);
 	ctk_window_set_default_size (CTK_WINDOW (win),
 				     w * ZOOM_FACTOR, h * ZOOM_FACTOR);
 
@@ -206,136 +324,39 @@ draw_zoom_animation_composited (CdkScreen *gscreen,
 
 	ctk_window_move (CTK_WINDOW (win), wx, wy);
 
-	g_signal_connect (G_OBJECT (win), "draw",
-			 G_CALLBACK (zoom_draw), zoom);
-
 	/* see doc for ctk_widget_set_app_paintable() */
 	ctk_widget_realize (win);
 	cdk_window_set_background_pattern (ctk_widget_get_window (win), NULL);
 	ctk_widget_show (win);
-
-	zoom->timeout_id = g_timeout_add (ZOOM_DELAY,
-					  (GSourceFunc) zoom_timeout,
-					  win);
 }
 
+/* This used to XOR rectangles on the root window with the server
+ * grabbed, sleeping between the steps. */
 static void
 draw_zoom_animation (CdkScreen *gscreen,
 		     int x, int y, int w, int h,
 		     int fx, int fy, int fw, int fh,
 		     int steps)
 {
-#define FRAMES (MINIATURIZE_ANIMATION_FRAMES_Z)
-	float cx[FRAMES], cy[FRAMES], cw[FRAMES], ch[FRAMES];
-	int cxi[FRAMES], cyi[FRAMES], cwi[FRAMES], chi[FRAMES];
-	float xstep, ystep, wstep, hstep;
-	int i, j;
-	GC frame_gc;
-	XGCValues gcv;
-	CdkColor color = { 65535, 65535, 65535 };
-	Display *dpy;
-	Window root_win;
-	int screen;
-	int depth;
-
-	dpy = cdk_x11_display_get_xdisplay (cdk_screen_get_display (gscreen));
-	root_win = CDK_WINDOW_XID (cdk_screen_get_root_window (gscreen));
-	screen = cdk_x11_screen_get_screen_number (gscreen);
-	depth = DefaultDepth(dpy,screen);
-
-	/* frame GC */
-	gcv.function = GXxor;
-	/* this will raise the probability of the XORed color being different
-	 * of the original color in PseudoColor when not all color cells are
-	 * initialized */
-	if (DefaultVisual(dpy, screen)->class==PseudoColor)
-		gcv.plane_mask = (1<<(depth-1))|1;
-	else
-		gcv.plane_mask = AllPlanes;
-	gcv.foreground = color.pixel;
-	if (gcv.foreground == 0)
-		gcv.foreground = 1;
-	gcv.line_width = 1;
-	gcv.subwindow_mode = IncludeInferiors;
-	gcv.graphics_exposures = False;
-
-	frame_gc = XCreateGC(dpy, root_win, GCForeground|GCGraphicsExposures
-			     |GCFunction|GCSubwindowMode|GCLineWidth
-			     |GCPlaneMask, &gcv);
-
-	xstep = (float)(fx-x)/steps;
-	ystep = (float)(fy-y)/steps;
-	wstep = (float)(fw-w)/steps;
-	hstep = (float)(fh-h)/steps;
-
-	for (j=0; j<FRAMES; j++) {
-		cx[j] = (float)x;
-		cy[j] = (float)y;
-		cw[j] = (float)w;
-		ch[j] = (float)h;
-		cxi[j] = (int)cx[j];
-		cyi[j] = (int)cy[j];
-		cwi[j] = (int)cw[j];
-		chi[j] = (int)ch[j];
-	}
-	XGrabServer(dpy);
-	for (i=0; i<steps; i++) {
-		for (j=0; j<FRAMES; j++) {
-			XDrawRectangle(dpy, root_win, frame_gc, cxi[j], cyi[j], cwi[j], chi[j]);
-		}
-		XFlush(dpy);
-#if (MINIATURIZE_ANIMATION_DELAY_Z > 0)
-		usleep(MINIATURIZE_ANIMATION_DELAY_Z);
-#else
-		usleep(10);
-#endif
-		for (j=0; j<FRAMES; j++) {
-			XDrawRectangle(dpy, root_win, frame_gc,
-				       cxi[j], cyi[j], cwi[j], chi[j]);
-			if (j<FRAMES-1) {
-				cx[j]=cx[j+1];
-				cy[j]=cy[j+1];
-				cw[j]=cw[j+1];
-				ch[j]=ch[j+1];
-
-				cxi[j]=cxi[j+1];
-				cyi[j]=cyi[j+1];
-				cwi[j]=cwi[j+1];
-				chi[j]=chi[j+1];
-
-			} else {
-				cx[j]+=xstep;
-				cy[j]+=ystep;
-				cw[j]+=wstep;
-				ch[j]+=hstep;
-
-				cxi[j] = (int)cx[j];
-				cyi[j] = (int)cy[j];
-				cwi[j] = (int)cw[j];
-				chi[j] = (int)ch[j];
-			}
-		}
-	}
-
-	for (j=0; j<FRAMES; j++) {
-		XDrawRectangle(dpy, root_win, frame_gc,
-				       cxi[j], cyi[j], cwi[j], chi[j]);
-	}
-	XFlush(dpy);
-#if (MINIATURIZE_ANIMATION_DELAY_Z > 0)
-	usleep(MINIATURIZE_ANIMATION_DELAY_Z);
-#else
-	usleep(10);
-#endif
-	for (j=0; j<FRAMES; j++) {
-		XDrawRectangle(dpy, root_win, frame_gc,
-				       cxi[j], cyi[j], cwi[j], chi[j]);
-	}
-
-	XUngrabServer(dpy);
-	XFreeGC (dpy, frame_gc);
+	CtkWidget *win;
+	ZoomAnimation *zoom;
+
+	zoom = g_slice_new0 (ZoomAnimation);
+	zoom->n_steps = steps + 1;
+	zoom->from.x = x;
+	zoom->from.y = y;
+	zoom->from.width = w;
+	zoom->from.height = h;
+	zoom->to.x = fx;
+	zoom->to.y = fy;
+	zoom->to.width = fw;
+	zoom->to.height = fh;
+
+	win = zoom_window_new (gscreen, zoom);
+
+	zoom_outline_update (win, zoom);
+	ctk_widget_show (win);
 }
-#undef FRAMES
 
 void
 xstuff_zoom_animate (CtkWidget *widget,
@@ -363,15 +384,10 @@ xstuff_zoom_animate (CtkWidget *widget,
 	gscreen = ctk_widget_get_screen (widget);
 
 	if (cdk_screen_is_composited (gscreen) && surface) {
-		GdkPixbuf *pixbuf = gdk_pixbuf_get_from_surface (surface,
-				0, 0,
-				cairo_image_surface_get_width (surface),
-				cairo_image_surface_get_height (surface));
 		draw_zoom_animation_composited (gscreen,
 				rect.x, rect.y,
 				rect.width, rect.height,
-				pixbuf, orientation);
-		g_object_unref (pixbuf);
+				surface, orientation);
 	} else {
 		CdkMonitor *monitor;
 		CdkDisplay *display;
@@ -50,6 +50,7 @@
 #include "cafe-panel-applet-factory.h"
 #include "cafe-panel-applet-marshal.h"
 #include "cafe-panel-applet-enums.h"
+#include "panel-watchdog.h"
 
 struct _CafePanelAppletPrivate {
 	CtkWidget         *plug;
@@ -77,6 +78,10 @@ struct _CafePanelAppletPrivate {
 
 	int               *size_hints;
 	int                size_hints_len;
+	int               *pending_size_hints;
+	int                pending_size_hints_len;
+	int                size_hints_hysteresis;
+	guint              size_hints_idle;
 
 	gboolean           moving_focus_out;
 
@@ -236,24 +241,10 @@ cafe_panel_applet_set_flags (CafePanelApplet      *applet,
 	}
 }
 
-static void
-cafe_panel_applet_size_hints_ensure (CafePanelApplet *applet,
-				int          new_size)
-{
-	if (applet->priv->size_hints && applet->priv->size_hints_len < new_size) {
-		g_free (applet->priv->size_hints);
-		applet->priv->size_hints = g_new (gint, new_size);
-	} else if (!applet->priv->size_hints) {
-		applet->priv->size_hints = g_new (gint, new_size);
-	}
-	applet->priv->size_hints_len = new_size;
-}
-
 static gboolean
 cafe_panel_applet_size_hints_changed (CafePanelApplet *applet,
 				 const int   *size_hints,
-				 int          n_elements,
-				 int          base_size)
+				 int          n_elements)
 {
 	gint i;
 
@@ -264,35 +255,28 @@ cafe_panel_applet_size_hints_changed (CafePanelApplet *applet,
 		return TRUE;
 
 	for (i = 0; i < n_elements; i++) {
-		if (size_hints[i] + base_size != applet->priv->size_hints[i])
+		if (ABS (size_hints[i] - applet->priv->size_hints[i]) > applet->priv->size_hints_hysteresis)
 			return TRUE;
 	}
 
 	return FALSE;
 }
 
-/**
- * cafe_panel_applet_set_size_hints:
- * @applet: applet
- * @size_hints: (array length=n_elements): List of integers
- * @n_elements: Length of @size_hints
- * @base_size: base_size
- */
-void
-cafe_panel_applet_set_size_hints (CafePanelApplet *applet,
-			     const int   *size_hints,
-			     int          n_elements,
-			     int          base_size)
+static gboolean
+cafe_panel_applet_flush_size_hints (CafePanelApplet *applet)
 {
 	gint i;
 
-	/* Make sure property has really changed to avoid bus traffic */
-	if (!cafe_panel_applet_size_hints_changed (applet, size_hints, n_elements, base_size))
-		return;
+	applet->priv->size_hints_idle = 0;
 
-	cafe_panel_applet_size_hints_ensure (applet, n_elements);
-	for (i = 0; i < n_elements; i++)
-		applet->priv->size_hints[i] = size_hints[i] + base_size;
+	if (!applet->priv->pending_size_hints)
+		return FALSE;
+
+	g_free (applet->priv->size_hints);
+	applet->priv->size_hints = applet->priv->pending_size_hints;
+	applet->priv->size_hints_len = applet->priv->pending_size_hints_len;
+	applet->priv->pending_size_hints = NULL;
+	applet->priv->pending_size_hints_len = 0;
 
 	g_object_notify (G_OBJECT (applet), "size-hints");
 
@@ -306,7 +290,7 @@ cafe_panel_applet_set_size_hints (CafePanelApplet *applet,
 		g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
 
 		children = g_new (GVariant *, applet->priv->size_hints_len);
-		for (i = 0; i < n_elements; i++)
+		for (i = 0; i < applet->priv->size_hints_len; i++)
 			children[i] = g_variant_new_int32 (applet->priv->size_hints[i]);
 		g_variant_builder_add (&builder, "{sv}", "SizeHints",
 				       g_variant_new_array (G_VARIANT_TYPE_INT32,
@@ -331,6 +315,73 @@ cafe_panel_applet_set_size_hints (CafePanelApplet *applet,
 		g_variant_builder_clear (&builder);
 		g_variant_builder_clear (&invalidated_builder);
 	}
+
+	return FALSE;
+}
+
+/**
+ * cafe_panel_applet_set_size_hints:
+ * @applet: applet
+ * @size_hints: (array length=n_elements): List of integers
+ * @n_elements: Length of @size_hints
+ * @base_size: base_size
+ *
+ * The hints are sent to the panel once the current frame is done, so
+ * setting them several times in a row, e.g. from every size allocation,
+ * only results in one relayout of the panel.
+ */
+void
+cafe_panel_applet_set_size_hints (CafePanelApplet *applet,
+			     const int   *size_hints,
+			     int          n_elements,
+			     int          base_size)
+{
+	gint *new_hints;
+	gint  i;
+
+	new_hints = g_new (gint, MAX (n_elements, 1));
+	for (i = 0; i < n_elements; i++)
+		new_hints[i] = size_hints[i] + base_size;
+
+	g_free (applet->priv->pending_size_hints);
+	applet->priv->pending_size_hints = NULL;
+	applet->priv->pending_size_hints_len = 0;
+
+	/* Make sure property has really changed to avoid bus traffic */
+	if (!cafe_panel_applet_size_hints_changed (applet, new_hints, n_elements)) {
+		g_free (new_hints);
+		return;
+	}
+
+	applet->priv->pending_size_hints = new_hints;
+	applet->priv->pending_size_hints_len = n_elements;
+
+	if (!applet->priv->size_hints_idle)
+		applet->priv->size_hints_idle =
+			g_idle_add_full (G_PRIORITY_HIGH_IDLE + 15,
+					 (GSourceFunc) cafe_panel_applet_flush_size_hints,
+					 applet, NULL);
+}
+
+/**
+ * cafe_panel_applet_set_size_hints_hysteresis:
+ * @applet: applet
+ * @hysteresis: number of pixels
+ *
+ * Makes cafe_panel_applet_set_size_hints() ignore new size hints when
+ * none of them differs by more than @hysteresis pixels from the hints
+ * the panel already has. Applets whose natural size fluctuates slightly
+ * can use this to avoid relayouting the whole panel each time.
+ *
+ * Since: 2.0.2
+ */
+void
+cafe_panel_applet_set_size_hints_hysteresis (CafePanelApplet *applet,
+					     int              hysteresis)
+{
+	g_return_if_fail (PANEL_IS_APPLET (applet));
+
+	applet->priv->size_hints_hysteresis = MAX (hysteresis, 0);
 }
 
 guint
@@ -800,7 +851,12 @@ cafe_panel_applet_finalize (GObject *object)
 		applet->priv->ui_manager = NULL;
 	}
 
+	if (applet->priv->size_hints_idle)
+		g_source_remove (applet->priv->size_hints_idle);
+	applet->priv->size_hints_idle = 0;
+
 	g_free (applet->priv->size_hints);
+	g_free (applet->priv->pending_size_hints);
 	g_free (applet->priv->prefs_path);
 	g_free (applet->priv->background);
 	g_free (applet->priv->id);
@@ -2306,6 +2362,45 @@ _cafe_panel_applet_setup_x_error_handler (void)
 }
 #endif
 
+static void
+cafe_panel_applet_watchdog_threshold_changed (GSettings   *settings,
+					      const gchar *key,
+					      gpointer     user_data G_GNUC_UNUSED)
+{
+	panel_watchdog_set_threshold (g_settings_get_int (settings, key), FALSE);
+}
+
+/* Out-of-process applets follow the watchdog setting of the panel, so
+ * that a stall can be tracked down whatever process it happens in. The
+ * factory belongs to the applet, so the watchdog only reports how long
+ * the stalls last, without taking a signal over to find out where. */
+static void
+cafe_panel_applet_setup_watchdog (void)
+{
+	GSettingsSchemaSource *source;
+	GSettingsSchema       *schema;
+	GSettings             *settings;
+
+	source = g_settings_schema_source_get_default ();
+	if (!source)
+		return;
+
+	schema = g_settings_schema_source_lookup (source, "org.cafe.panel", TRUE);
+	if (!schema)
+		return;
+
+	if (g_settings_schema_has_key (schema, "watchdog-threshold")) {
+		/* lives as long as the factory process */
+		settings = g_settings_new_full (schema, NULL, NULL);
+		g_signal_connect (settings, "changed::watchdog-threshold",
+				  G_CALLBACK (cafe_panel_applet_watchdog_threshold_changed),
+				  NULL);
+		cafe_panel_applet_watchdog_threshold_changed (settings, "watchdog-threshold", NULL);
+	}
+
+	g_settings_schema_unref (schema);
+}
+
 static int
 _cafe_panel_applet_factory_main_internal (const gchar               *factory_id,
 				     gboolean                   out_process,
@@ -2346,6 +2441,7 @@ _cafe_panel_applet_factory_main_internal (const gchar               *factory_id,
 		if (out_process)
 		{
 			g_object_weak_ref(G_OBJECT(factory), cafe_panel_applet_factory_main_finalized, NULL);
+			cafe_panel_applet_setup_watchdog();
 			ctk_main();
 		}
 
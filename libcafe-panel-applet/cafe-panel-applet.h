@@ -104,6 +104,7 @@ CafePanelAppletFlags cafe_panel_applet_get_flags(CafePanelApplet* applet);
 void cafe_panel_applet_set_flags(CafePanelApplet* applet, CafePanelAppletFlags flags);
 
 void cafe_panel_applet_set_size_hints(CafePanelApplet* applet, const int* size_hints, int n_elements, int base_size);
+void cafe_panel_applet_set_size_hints_hysteresis(CafePanelApplet* applet, int hysteresis);
 
 gboolean cafe_panel_applet_get_locked_down(CafePanelApplet* applet);
 